@@ -30,296 +30,465 @@
 #include "asn1.h"
 #ifdef ASN1_HAS_IOSTREAM
 #include <boost/smart_ptr.hpp>
-#include <sstream>
 #include "ios_helper.h"
 
 namespace ASN1 {
 
 bool AbstractData::setFromValueNotation(const std::string& valueString)
 {
-    std::stringstream strm(valueString, std::ios_base::in);
-    AVNDecoder decoder(strm);
+    AVNDecoder decoder(valueString.data(), valueString.data() + valueString.size());
     return decode(decoder);
 }
 
+std::istream & operator >>(std::istream &is, AbstractData & arg)
+{
+    if (!is.good()) return is;
+    return g_extractor(is, arg);
+}
+
+inline bool is_space(char c)
+{
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
 std::ios_base::iostate AbstractData::get_from(std::istream & strm)
 {
-    AVNDecoder decoder(strm);
-    if (decode(decoder))
-        return std::ios_base::goodbit;
-    return std::ios_base::failbit;
+	// The decoder works on a contiguous buffer, so the value is first taken out of the
+	// stream, one character at a time so that a pipe or a terminal is not waited on
+	// past its end. Decoding is tried where the value may end, at a closing brace or a
+	// separator outside of braces and quotes, and what follows the value is given back.
+	std::streambuf* sb = strm.rdbuf();
+	std::string buf;
+	int depth = 0;
+	char quote = 0;
+	bool started = false;
+	for (int ch; (ch = sb->sbumpc()) != std::char_traits<char>::eof(); )
+	{
+		char c = std::char_traits<char>::to_char_type(ch);
+		buf += c;
+		if (quote)
+		{
+			if (c == quote)
+				quote = 0;
+			continue;
+		}
+		if (c == '"' || c == '\'')
+			quote = c;
+		else if (c == '{')
+			++depth;
+		else if (c == '}')
+			--depth;
+		if (c != '}' && !is_space(c) && c != ',')
+		{
+			started = true;
+			continue;
+		}
+		if (!started || depth > 0)
+			continue;
+
+		AVNDecoder decoder(buf.data(), buf.data() + buf.size());
+		bool decoded = decode(decoder);
+		// a value cut short, such as "alt " of "alt : 5", needs more characters
+		if (!decoded && decoder.getPosition() == buf.data() + buf.size())
+			continue;
+		if (decoded)
+			for (const char* p = decoder.getPosition(); p != buf.data() + buf.size(); ++p)
+				sb->sungetc();
+		return decoded ? std::ios_base::goodbit : std::ios_base::failbit;
+	}
+
+	AVNDecoder decoder(buf.data(), buf.data() + buf.size());
+	return (decode(decoder) ? std::ios_base::goodbit : std::ios_base::failbit) | std::ios_base::eofbit;
+}
+
+inline bool is_identifier_char(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_digit(c) || c == '-' || c == '_';
 }
 
-std::istream & operator >>(std::istream &is, AbstractData & arg)
+inline int hex_value(char c)
 {
-    if (!is.good()) return is;
-    return g_extractor(is, arg);
+	if (is_digit(c)) return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
 }
 
-inline bool input_success(std::istream& strm)
+// Compares the len characters at name with the NUL terminated str, in strcmp order.
+inline int compare_name(const char* name, unsigned len, const char* str)
 {
-	return !(strm.rdstate() & (std::ios_base::badbit | std::ios_base::failbit));
+	int result = strncmp(name, str, len);
+	if (result == 0 && str[len] != 0)
+		return -1;
+	return result;
+}
+
+// Looks up a name among size names. index lists the positions of the names in 
+// name order, as emitted by asnparser; a linear search is used when it is absent.
+static int find_name(const char* const* names, const unsigned* index, unsigned size, 
+					 const char* name, unsigned len)
+{
+	if (index == NULL)
+	{
+		for (unsigned i = 0; i < size; ++i)
+			if (compare_name(name, len, names[i]) == 0)
+				return i;
+		return -1;
+	}
+
+	unsigned lower = 0, upper = size;
+	while (lower < upper)
+	{
+		unsigned middle = (lower + upper) / 2;
+		int result = compare_name(name, len, names[index[middle]]);
+		if (result == 0)
+			return index[middle];
+		if (result < 0)
+			upper = middle;
+		else
+			lower = middle + 1;
+	}
+	return -1;
 }
 
 bool IntegerWithNamedNumber::setFromName(const std::string& str)
 {
-	const NameEntry* begin = info()->nameEntries, *i = begin;
-	for (; i != begin+info()->entryCount; ++i)
-		if (strcmp(i->name, str.c_str()) == 0)
+	return setFromName(str.c_str(), str.size());
+}
+
+bool IntegerWithNamedNumber::setFromName(const char* str, unsigned len)
+{
+	const NameEntry* entries = info()->nameEntries;
+	const unsigned* index = info()->nameIndex;
+	unsigned lower = 0, upper = info()->entryCount;
+
+	if (index == NULL)
+	{
+		for (; lower != upper; ++lower)
+			if (compare_name(str, len, entries[lower].name) == 0)
+			{
+				value = entries[lower].value;
+				return true;
+			}
+		return false;
+	}
+
+	while (lower < upper)
+	{
+		unsigned middle = (lower + upper) / 2;
+		int result = compare_name(str, len, entries[index[middle]].name);
+		if (result == 0)
 		{
-			value = i->value;
+			value = entries[index[middle]].value;
 			return true;
 		}
+		if (result < 0)
+			upper = middle;
+		else
+			lower = middle + 1;
+	}
 	return false;
 }
 
 bool ENUMERATED::setFromName(const std::string& str)
 {
-	const char** pos = info()->names;
-	const char** end = pos + getMaximum()+1;
-	for (; pos != end ; ++pos)
-		if (strcmp(str.c_str(), *pos) == 0)
-			break;
-	value = pos - info()->names;
-	if (value <= getMaximum())
-		return true;
-	else
+	return setFromName(str.c_str(), str.size());
+}
+
+bool ENUMERATED::setFromName(const char* str, unsigned len)
+{
+	int pos = find_name(info()->names, info()->nameIndex, getMaximum()+1, str, len);
+	if (pos < 0)
 		return false;
+	value = pos;
+	return true;
 }
 
-bool AVNDecoder::decode(Null& value)
+int CHOICE::findSelection(const char* name, unsigned len) const
+{
+	return find_name(info()->names, info()->nameIndex, info()->totalChoices, name, len);
+}
+
+int SEQUENCE::findField(const char* name, unsigned len) const
+{
+	return find_name(info()->names, info()->nameIndex, fields.size(), name, len);
+}
+
+bool detail::TextInput::skipSpaces()
+{
+	while (cur != end && is_space(*cur))
+		++cur;
+	return cur != end;
+}
+
+bool detail::TextInput::getChar(char& c)
 {
-	std::string tmp;
-    char c;
-    while (strm >> c)
-    {
-        if (isalpha(c))
-            tmp += c;
-        else
-        {
-            strm.putback(c);
-            break;
-        }
-    }
-	if (tmp != "NULL")
+	if (!skipSpaces())
 		return false;
+	c = *cur++;
 	return true;
 }
 
-bool AVNDecoder::decode(BOOLEAN& value)
+bool detail::TextInput::peekChar(char& c)
 {
-	std::string tmp;
-    char c;
-    while (strm >> c)
-    {
-        if (isalpha(c))
-            tmp += c;
-        else
-        {
-            strm.putback(c);
-            break;
-        }
-    }
-    if (tmp == "TRUE")
-		value = true;
-	else if (tmp == "FALSE")
-		value = false;
-	else
+	if (!skipSpaces())
 		return false;
+	c = *cur;
 	return true;
 }
 
-bool AVNDecoder::decode(INTEGER& value)
+bool detail::TextInput::getIdentifier(Token& id)
 {
-	unsigned tmp;
-	if (!value.constrained() || value.getLowerLimit() < 0)
-		strm >> *(int*)&tmp;
-	else
-		strm >> tmp;
-	value = tmp;
-	return input_success(strm);
+	if (!skipSpaces())
+		return false;
+	const char* first = cur;
+	while (cur != end && is_identifier_char(*cur))
+		++cur;
+	id.first = first;
+	id.len = cur - first;
+	return id.len != 0;
 }
 
-bool AVNDecoder::decode(IntegerWithNamedNumber& value)
+bool detail::TextInput::getNumber(unsigned& magnitude, bool& negative)
+{
+	if (!skipSpaces())
+		return false;
+	negative = (*cur == '-');
+	if (negative && ++cur == end)
+		return false;
+	if (!is_digit(*cur))
+		return false;
+
+	magnitude = 0;
+	for (; cur != end && is_digit(*cur); ++cur)
+	{
+		unsigned d = *cur - '0';
+		if (magnitude > (~0u - d) / 10)
+			return false; // overflow
+		magnitude = magnitude * 10 + d;
+	}
+	return true;
+}
+
+bool AVNDecoder::getQuotedString(Token& str)
 {
 	char c;
-	if (strm >> c)
+	if (getChar(c) && c == '\"')
 	{
-		strm.putback(c);
-		if (isdigit(c) || c == '-')
-			return decode(static_cast<INTEGER&>(value));
-		
-		std::string tmp;
-		if (strm >> tmp)
-			return value.setFromName(tmp);
+		const char* last = std::find(cur, end, '\"');
+		if (last == end)
+			return false;
+		str.first = cur;
+		str.len = last - cur;
+		cur = last + 1;
+		return true;
 	}
 	return false;
 }
 
-bool AVNDecoder::decode(ENUMERATED& value)
+bool AVNDecoder::skipValue()
 {
-	std::string tmp;
-	if (strm >> tmp)
-		return value.setFromName(tmp);
-	return false;
+	// the value ends before the comma or the brace closing what holds it
+	if (!skipSpaces())
+		return false;
+	const char* first = cur;
+	const char* last = cur;
+	unsigned depth = 0;
+	for (; cur != end; ++cur)
+	{
+		if (*cur == '\"' || *cur == '\'')
+		{
+			const char* quote = std::find(cur + 1, end, *cur);
+			if (quote == end)
+				return false;
+			cur = quote;
+		}
+		else if (*cur == '{')
+			++depth;
+		else if (*cur == '}' || *cur == ',')
+		{
+			if (depth == 0)
+				break;
+			if (*cur == '}')
+				--depth;
+		}
+		if (!is_space(*cur))
+			last = cur + 1;
+	}
+	cur = last;
+	return depth == 0 && last != first;
 }
 
-bool AVNDecoder::decode(OBJECT_IDENTIFIER& value)
+bool AVNDecoder::getBinaryString(std::vector<char>& value, unsigned& totalBits)
 {
 	char c;
-	if (strm >> c )
+	if (!getChar(c) || c != '\'')
+		return false;
+
+	const char* first = cur;
+	const char* last = std::find(cur, end, '\'');
+	if (last == end)
+		return false;
+	cur = last + 1;
+
+	if (!getChar(c) || (c != 'B' && c != 'H'))
+		return false;
+
+	const unsigned bitsPerDigit = (c == 'B') ? 1 : 4;
+	value.clear();
+	value.reserve((last - first) * bitsPerDigit / 8 + 1);
+
+	unsigned nBits = 0, byte = 0;
+	for (; first != last; ++first)
 	{
-		if (c == '{')
+		if (is_space(*first))
+			continue;
+		int digit = (bitsPerDigit == 1) ? *first - '0' : hex_value(*first);
+		if (digit < 0 || digit >> bitsPerDigit)
+			return false;
+		byte = (byte << bitsPerDigit) | digit;
+		nBits += bitsPerDigit;
+		if ((nBits & 7) == 0)
 		{
-			std::string subString;
-			if (std::getline(strm, subString, '}'))
-			{
-				std::stringstream subIs(subString);
-				while (subIs >> subString)
-				{// process ObjIdComponent , either in the form "itu(0)"(NameAndNumberForm) 
-				// or a number such as "2250" (NumberForm)
-					std::stringstream s(subString);
-					unsigned v;
-					if (isdigit(subString[0])) // parse NumberForm
-					{
-						if (s >> v)
-							value.append(v);
-						else
-							return false;
-					}
-					else // parse NameAndNumberForm
-					{
-						if (std::getline(s, subString, '(') &&
-							s >> v)
-						{
-							value.append(v);
-							continue;
-						}
-						else if (subIs >> c)
-						{
-							if (c == '(' && s >> v)
-							{
-								value.append(v);
-								if (s >> c && c == ')')
-									continue;
-							}
-						} 
-						else
-							return false;
-					}
-				}
-				return true;
-			}
+			value.push_back(static_cast<char>(byte));
+			byte = 0;
 		}
-		return false;
 	}
-	return false;
+	if (nBits & 7)
+		value.push_back(static_cast<char>(byte << (8 - (nBits & 7))));
+	totalBits = nBits;
+	return true;
+}
+
+bool AVNDecoder::decode(Null& value)
+{
+	Token id;
+	return getIdentifier(id) && id.equal("NULL");
+}
+
+bool AVNDecoder::decode(BOOLEAN& value)
+{
+	Token id;
+	if (!getIdentifier(id))
+		return false;
+    if (id.equal("TRUE"))
+		value = true;
+	else if (id.equal("FALSE"))
+		value = false;
+	else
+		return false;
+	return true;
 }
 
-struct is_space_or_newline
-{
-	bool operator()(char c) { return c == ' ' || c == '\n'; }
-};
-
-bool get_from_string(std::string& str0, std::vector<char>& value, unsigned int& totalBits, int base)
-{
-	assert(base == 16 || base == 2);
-	
-	int nCharAByte = (base == 16 ) ? 2 : 8;
-	std::string str;
-	std::remove_copy_if(str0.begin()
-		,str0.end()
-		,std::inserter(str, str.begin())
-		,is_space_or_newline());
-	totalBits = str.size();
-	if (str.size() % nCharAByte) 
-		str.insert(str.end(), nCharAByte - (str.size() % nCharAByte), '0');
-	value.reserve(str.size()/nCharAByte);
-	std::string tmp(nCharAByte, ' ');
-	char* stopPos;
-	for (std::string::iterator it = str.begin(); it != str.end() ; it+=nCharAByte)
+bool AVNDecoder::decode(INTEGER& value)
+{
+	unsigned magnitude;
+	bool negative;
+	if (!getNumber(magnitude, negative))
+		return false;
+
+	if (!value.constrained() || value.getLowerLimit() < 0)
 	{
-		char v;
-		std::copy(it, it+nCharAByte, tmp.begin());
-		v = (char) strtol(&*tmp.begin(), &stopPos, base);
-		if (stopPos == &*tmp.end())
-			value.push_back(v);
-		else
+		if (magnitude > (negative ? 0x80000000u : 0x7FFFFFFFu))
 			return false;
+		value = static_cast<INTEGER::int_type>(negative ? 0u - magnitude : magnitude);
 	}
+	else if (!negative)
+		value = magnitude;
+	else
+		return false;
 	return true;
 }
 
-inline bool get_from_bstring(std::string& str, std::vector<char>& value, unsigned int& totalBits)
+bool AVNDecoder::decode(IntegerWithNamedNumber& value)
 {
-	return get_from_string(str, value, totalBits, 2);
+	char c;
+	if (peekChar(c))
+	{
+		if (is_digit(c) || c == '-')
+			return decode(static_cast<INTEGER&>(value));
+		
+		Token id;
+		if (getIdentifier(id))
+			return value.setFromName(id.first, id.len);
+	}
+	return false;
 }
 
-inline bool get_from_hstring(std::string& str, std::vector<char>& value, unsigned int& totalBits)
+bool AVNDecoder::decode(ENUMERATED& value)
 {
-	return get_from_string(str, value, totalBits, 16);
+	Token id;
+	if (getIdentifier(id))
+		return value.setFromName(id.first, id.len);
+	return false;
 }
 
-bool get_value_from(std::istream& strm, std::vector<char>& value, unsigned int& totalBits)
+bool AVNDecoder::decode(OBJECT_IDENTIFIER& value)
 {
+	// process ObjIdComponents, either in the form "itu(0)" (NameAndNumberForm) 
+	// or a number such as "2250" (NumberForm)
 	char c;
-	if (strm >> c)
+	if (!getChar(c) || c != '{')
+		return false;
+
+	value = OBJECT_IDENTIFIER();
+	while (peekChar(c))
 	{
-		if (c != '\'')
-			return false;
-		
-		std::string str;
-		if (!std::getline(strm, str, '\''))
-			return false;
+		if (c == '}')
+		{
+			++cur;
+			return true;
+		}
 
-		if (strm >> c)
+		unsigned v;
+		bool negative;
+		if (!is_digit(c))
 		{
-			switch (c)
-			{
-			case 'B':
-				return get_from_bstring(str, value, totalBits);
-			case 'H':
-				return get_from_hstring(str, value, totalBits);
-			default:
+			Token name;
+			if (!getIdentifier(name) || !getChar(c) || c != '(' || 
+				!getNumber(v, negative) || negative || !getChar(c) || c != ')')
 				return false;
-			}
 		}
+		else if (!getNumber(v, negative))
+			return false;
+		value.append(v);
 	}
 	return false;
 }
 
 bool AVNDecoder::decode(BIT_STRING& value)
 {
-	return get_value_from(strm, value.bitData, value.totalBits);
+	return getBinaryString(value.bitData, value.totalBits);
 }
 
 bool AVNDecoder::decode(OCTET_STRING& value)
 {
 	unsigned totalBits;
-	return get_value_from(strm, value, totalBits);
+	return getBinaryString(value, totalBits);
 }
 
-bool get_string(std::istream& strm, std::string& str)
+bool AVNDecoder::decode(ConstrainedString& value)
 {
-	char c;
-	if (strm >> c)
+	Token str;
+	if (getQuotedString(str))
 	{
-		if (c == '\"')
-			return !!std::getline(strm, str , '\"');
+		value.assign(str.first, str.len);
+		return true;
 	}
 	return false;
 }
 
-bool AVNDecoder::decode(ConstrainedString& value)
-{
-	return get_string(strm, value);
-}
-
 bool AVNDecoder::decode(BMPString& value)
 {
-	std::string str;
-	if (get_string(strm, str))
+	Token tok;
+	if (getQuotedString(tok))
 	{
+		std::string str(tok.first, tok.len);
 		boost::scoped_array<wchar_t> tmp(new wchar_t[str.size()+1]);
 		int len = mbstowcs(tmp.get(), str.c_str(), str.size());
 		if (len == -1)
@@ -330,27 +499,14 @@ bool AVNDecoder::decode(BMPString& value)
 	return false;
 }
 
-bool get_id(const char** names, unsigned size, const std::string& name, int& id)
-{
-	for (unsigned i = 0; i < size; ++i)
-		if (name == names[i])
-		{
-			id = i;
-			return true;
-		}
-	return false;
-}
-
 bool AVNDecoder::decode(CHOICE& value)
 {
-	std::string identifier;
+	Token identifier;
 	char c;
-    int choiceID;
-	if (strm >> identifier >> c)
+	if (getIdentifier(identifier) && getChar(c) && c == ':')
 	{
-		if (c ==':' && get_id(value.info()->names, value.info()->totalChoices, identifier, choiceID) 
-					&& value.select(choiceID))
-			return value.getSelection()->decode(*this);
+		int choiceID = value.findSelection(identifier.first, identifier.len);
+		return choiceID >= 0 && value.select(choiceID) && value.getSelection()->decode(*this);
 	}
 	return false;
 }
@@ -358,43 +514,51 @@ bool AVNDecoder::decode(CHOICE& value)
 bool AVNDecoder::decode(SEQUENCE_OF_Base& value)
 {
 	char c;
-	if (strm >> c)
-	{
-		if (c != '{' || (strm >> c, !strm))
-			return false;
-
-        value.clear();
+	if (!getChar(c) || c != '{' || !peekChar(c))
+		return false;
 
-		if (c != '}')
-			strm.putback(c);
-		else
-			return true; // no entry, return and indicate success
+	value.clear();
 
-		do {
-			std::unique_ptr<AbstractData> entry(value.createElement());
-			if (entry.get() && entry->decode(*this) && strm >> c)
-				value.push_back(entry.release());
-			else
-				return false;
-		} while (c == ',');
+	if (c == '}')
+	{
+		++cur;
+		return true; // no entry, return and indicate success
+	}
 
+	do {
+		std::unique_ptr<AbstractData> entry(value.createElement());
+		if (entry.get() && entry->decode(*this) && getChar(c))
+			value.push_back(entry.release());
+		else
+			return false;
+	} while (c == ',');
 
-		if (c == '}')
-			return true;
-	}
-	return false;
+	return c == '}';
 }
 
 bool AVNDecoder::decode(OpenData& value)
 {
-	// not implemented
-	return false;
+	if (value.is_expected())
+		return value.get_data().decode(*this);
+
+	// without the actual type, the text of the value is kept for a redecode
+	if (!skipSpaces())
+		return false;
+	const char* first = cur;
+	if (!skipValue())
+		return false;
+	value.set_text(OpenData::avnText, first, cur);
+	return true;
 }
 
 bool AVNDecoder::redecode(OpenData& value)
 {
-	// not implemented
-	return false;
+	if (!value.has_text(OpenData::avnText) || !value.has_data())
+		return false;
+	const std::string& text = value.get_text();
+	AVNDecoder decoder(text.data(), text.data() + text.size(), get_env());
+	char c;
+	return value.get_data().decode(decoder) && !decoder.peekChar(c);
 }
 
 bool AVNDecoder::decode(TypeConstrainedOpenData& value)
@@ -405,10 +569,10 @@ bool AVNDecoder::decode(TypeConstrainedOpenData& value)
 
 bool AVNDecoder::decode(GeneralizedTime& value)
 {
-	std::string str;
-	if (get_string(strm, str))
+	Token str;
+	if (getQuotedString(str))
 	{
-		value.set(str.c_str());
+		value.set(std::string(str.first, str.len).c_str());
 		return true;
 	}
 	return false;
@@ -417,30 +581,25 @@ bool AVNDecoder::decode(GeneralizedTime& value)
 Visitor::VISIT_SEQ_RESULT AVNDecoder::preDecodeExtensionRoots(SEQUENCE& value)
 {
 	char c;
-	if (strm >> c && c == '{')
+	if (getChar(c) && c == '{' && peekChar(c))
 	{
-		if (strm >> c)
+		if (c == '}')
 		{
-			if (c == '}')
-				return STOP;
-			else
-			{
-				strm.putback(c);
-				std::string id;
-				if (strm >> id)
-					identifiers.push_back(id);
-				else
-					return FAIL;
-			}
-			return CONTINUE;
+			++cur;
+			return STOP;
 		}
+		Token id;
+		if (!getIdentifier(id))
+			return FAIL;
+		identifiers.push_back(value.findField(id.first, id.len));
+		return CONTINUE;
 	}
 	return FAIL;
 }
 
 Visitor::VISIT_SEQ_RESULT AVNDecoder::decodeExtensionRoot(SEQUENCE& value, int index, int optional_id)
 {
-	if (identifiers.back() == value.getFieldName(index))
+	if (identifiers.back() == index)
 	{
 		if (optional_id != -1)
 			value.includeOptionalField(optional_id, index);
@@ -448,12 +607,19 @@ Visitor::VISIT_SEQ_RESULT AVNDecoder::decodeExtensionRoot(SEQUENCE& value, int i
 		if (field && field->decode(*this))
 		{
 			char c;
-			if (strm >> c)
+			Token id;
+			if (getChar(c))
 			{
-				if (c == ',' && (strm >> identifiers.back() ) )
+				if (c == ',' && getIdentifier(id))
+				{
+					identifiers.back() = value.findField(id.first, id.len);
 					return CONTINUE;
+				}
 				else if (c == '}')
+				{
+					identifiers.pop_back();
                     return STOP;
+				}
 			}
 		}
 		return FAIL;
@@ -469,10 +635,10 @@ Visitor::VISIT_SEQ_RESULT AVNDecoder::decodeKnownExtension(SEQUENCE& value, int
 
 bool AVNDecoder::decodeUnknownExtensions(SEQUENCE& value)
 {
-	if (identifiers.back() != "}")
-		return false;
+	// the closing brace of the SEQUENCE has been consumed by decodeExtensionRoot() once 
+	// the last field is decoded; being here means the current identifier matches no field.
 	identifiers.pop_back();
-	return true;
+	return false;
 }
 }
 #endif
@@ -30,17 +30,16 @@
 #include "asn1.h"
 #ifdef ASN1_HAS_IOSTREAM
 #include <boost/smart_ptr.hpp>
-#include <iomanip>
 #include "ios_helper.h"
 
 namespace ASN1 {
 
 std::string AbstractData::asValueNotation() const
 {
-    std::ostringstream strm;
-    AVNEncoder encoder(strm);
+    OpenBuf buf;
+    AVNEncoder encoder(buf);
     encode(encoder);
-    return strm.str();
+    return std::string(buf.begin(), buf.end());
 }
 
 std::ios_base::iostate AbstractData::print_on(std::ostream & strm) const
@@ -58,15 +57,23 @@ std::ostream & operator<<(std::ostream & os, const AbstractData & arg)
 }
 
 
-bool IntegerWithNamedNumber::getName(std::string& str) const
+const char* IntegerWithNamedNumber::getName() const
 {
 	const NameEntry* begin = info()->nameEntries;
 	const NameEntry* end   = begin+ info()->entryCount;
 	const NameEntry* i = std::lower_bound(begin, end, value, NameEntryCmp());
 
 	if (i != end && i->value == value)
+		return i->name;
+	return 0;
+}
+
+bool IntegerWithNamedNumber::getName(std::string& str) const
+{
+	const char* name = getName();
+	if (name != 0)
 	{
-		str = i->name;
+		str = name;
 		return true;
 	}
 	return false;
@@ -79,95 +86,116 @@ const char* ENUMERATED::getName() const
 	return 0;
 }
 
+static const char HexDigits[] = "0123456789abcdef";
+static const char Spaces[] = "                                                                ";
+
+bool detail::TextOutput::write(const char* str, unsigned len)
+{
+	if (sbuf)
+		return sbuf->sputn(str, len) == static_cast<std::streamsize>(len);
+	return out.append(str, len);
+}
+
+bool detail::TextOutput::writeUnsigned(unsigned value)
+{
+	char tmp[12];
+	char* p = tmp + sizeof(tmp);
+	do {
+		*--p = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value);
+	return write(p, tmp + sizeof(tmp) - p);
+}
+
+bool detail::TextOutput::writeInt(int value)
+{
+	if (value >= 0)
+		return writeUnsigned(value);
+	return write('-') && writeUnsigned(0u - static_cast<unsigned>(value));
+}
+
+bool detail::TextOutput::writeIndent(unsigned n)
+{
+	const unsigned chunk = sizeof(Spaces) - 1;
+	for (; n > chunk; n -= chunk)
+		if (!write(Spaces, chunk))
+			return false;
+	return write(Spaces, n);
+}
+
 bool AVNEncoder::encode(const Null& value)
 {
-	strm << "NULL";
-	return strm.good();
+	return write("NULL", 4);
 }
 
 bool AVNEncoder::encode(const BOOLEAN& value)
 {
 	if (value) 
-		strm << "TRUE";
-	else
-		strm << "FALSE";
-	return strm.good();
+		return write("TRUE", 4);
+	return write("FALSE", 5);
 }
 
 bool AVNEncoder::encode(const INTEGER& value)
 {
 	if (!value.constrained() || value.getLowerLimit() < 0)
-		strm << (int)value.getValue();
-	else
-		strm << (unsigned)value.getValue();
-	return strm.good();
+		return writeInt(value.getValue());
+	return writeUnsigned(value.getValue());
 }
 
 bool AVNEncoder::encode(const IntegerWithNamedNumber& value)
 {
-	std::string str;
-	if (value.getName(str))
-		strm << str;
-	else 
-		return encode(static_cast<const INTEGER&>(value));
-	return strm.good();
+	const char* name = value.getName();
+	if (name != 0)
+		return write(name);
+	return encode(static_cast<const INTEGER&>(value));
 }
 
 bool AVNEncoder::encode(const ENUMERATED& value)
 {
 	const char* name = value.getName();
 	if (name != 0)
-		strm << name;
-	else 
-		strm << value.asInt();
-	return strm.good();
+		return write(name);
+	return writeInt(value.asInt());
 }
 
 bool AVNEncoder::encode(const OBJECT_IDENTIFIER& value)
 {
-	strm << "{ ";
-	for (unsigned i = 0;  i < value.levels() && strm.good(); ++i) 
-		strm << value[i] << ' ';
-	strm << "}";
-	return strm.good();
+	if (!write("{ ", 2))
+		return false;
+	for (unsigned i = 0;  i < value.levels(); ++i) 
+		if (!writeUnsigned(value[i]) || !write(' '))
+			return false;
+	return write('}');
 }
 
 bool AVNEncoder::encode(const BIT_STRING& value)
 {
-	strm << '\'';
-	for (unsigned i = 0; i < value.size() && strm.good(); ++i)
-		if (value[i])
-			strm << '1';
-		else
-			strm << '0';
-	if (strm.good())
-		strm << "\'B";
-	return strm.good();
+	if (!write('\''))
+		return false;
+	for (unsigned i = 0; i < value.size(); ++i)
+		if (!write(value[i] ? '1' : '0'))
+			return false;
+	return write("\'B", 2);
 }
 
 bool AVNEncoder::encode(const OCTET_STRING& value)
 {
-	std::ios_base::fmtflags flags = strm.flags();
-	strm << '\'';
+	if (!write('\''))
+		return false;
 	
-	for (unsigned i = 0; i < value.size() && strm.good(); ++i)
+	for (unsigned i = 0; i < value.size(); ++i)
 	{
-		strm << std::hex << std::setw(2) << std::setfill('0') << (0xFF & value[i]);
-		if (i != value.size()-1) 
-			strm << ' ';
+		char hex[3] = { HexDigits[(value[i] >> 4) & 0x0F], HexDigits[value[i] & 0x0F], ' ' };
+		if (!write(hex, i != value.size()-1 ? 3 : 2))
+			return false;
 	}
 	
-	if (strm.good())
-		strm << "\'H";
-	strm.setf(flags);
-	strm << std::setfill(' ') ;
-	return strm.good();
+	return write("\'H", 2);
 }
 
 bool AVNEncoder::encode(const ConstrainedString& value)
 {
-	strm << '\"' << static_cast<const std::string&>(value) << '\"';
-	return strm.good();
+	return write('\"') && write(value.data(), value.size()) && write('\"');
 }
 
 bool AVNEncoder::encode(const BMPString& value)
@@ -175,31 +203,28 @@ bool AVNEncoder::encode(const BMPString& value)
 	boost::scoped_array<char> tmp(new char[value.size()*2+1]);
 	int len = wcstombs(tmp.get(), &*value.begin(), value.size());
 	if (len != -1)
+		return write('\"') && write(tmp.get(), len) && write('\"');
+
+	// output Quadruple form
+	if (!write('{'))
+		return false;
+	for (unsigned i = 0; i < value.size(); ++i)
 	{
-		tmp[len] = 0;
-		strm << '\"' << tmp.get() << '\"';
-	}
-	else // output Quadruple form
-	{
-		strm << '{';
-		for (unsigned i = 0; i < value.size() && strm.good(); ++i)
-		{
-			strm << "{ 0, 0, " << (int) (value[i] >> 8) << ", " << (int) value[i]  << '}';
-			if (strm.good() && i != value.size()-1)
-				strm << ", ";
-		}
-		if (strm.good())
-			strm << '}';
+		if (!write("{ 0, 0, ", 8) || !writeInt(value[i] >> 8) || 
+			!write(", ", 2) || !writeInt(value[i]) || !write('}'))
+			return false;
+		if (i != value.size()-1 && !write(", ", 2))
+			return false;
 	}
-	return strm.good();
+	return write('}');
 }
 
 bool AVNEncoder::encode(const CHOICE& value)
 {
 	if (value.currentSelection() >= 0)
 	{
-		strm << value.getSelectionName() << " : ";
-		return value.getSelection()->encode(*this);
+		return write(value.getSelectionName()) && write(" : ", 3) &&
+			value.getSelection()->encode(*this);
 	}
 	return false;
 }
@@ -210,6 +235,8 @@ bool AVNEncoder::encode(const OpenData& value)
 	{
 		return value.get_data().encode(*this);
 	}
+	else if (value.has_text(OpenData::avnText))
+		return write(value.get_text().data(), value.get_text().size());
 	else if (value.has_buf())
 	{
 		OCTET_STRING ostr(value.get_buf());
@@ -220,43 +247,41 @@ bool AVNEncoder::encode(const OpenData& value)
 
 bool AVNEncoder::encode(const GeneralizedTime& value)
 {
-	strm << '\"' << value.get() << '\"';
-	return strm.good();
+	std::string str = value.get();
+	return write('\"') && write(str.data(), str.size()) && write('\"');
 }
 
 bool AVNEncoder::encode(const SEQUENCE_OF_Base& value)
 {
-	strm << "{\n";
+	if (!write("{\n", 2))
+		return false;
     SEQUENCE_OF_Base::const_iterator first = value.begin(), last = value.end();
     indent +=2;
-	for (; first != last && strm.good(); ++first)
+	for (; first != last; ++first)
 	{
-		strm << std::setw(indent) << " ";
-		if (!(*first)->encode(*this))
+		if (!writeIndent(indent) || !(*first)->encode(*this))
+			return false;
+		if (first != last-1 && !write(",\n", 2))
 			return false;
-		if (first != last-1)
-			strm << ",\n";
 	}
     indent -=2;
-	if (value.size() && strm.good())
-		strm << '\n';
-	strm << std::setw(indent+1) << "}";
-	return strm.good();
+	if (value.size() && !write('\n'))
+		return false;
+	return writeIndent(indent) && write('}');
 }
 
 bool AVNEncoder::preEncodeExtensionRoots(const SEQUENCE& value) 
 {
 	outputSeparators.push_back(false);
-	strm << "{\n";
-	return strm.good();
+	return write("{\n", 2);
 }
 
 bool AVNEncoder::encodeExtensionRoot(const SEQUENCE& value, int index)
 {
-	if (outputSeparators.back())
-		strm << ",\n";
-	strm << std::setw(strlen(value.getFieldName(index)) + indent +2) 
-		<< value.getFieldName(index) << ' ';
+	if (outputSeparators.back() && !write(",\n", 2))
+		return false;
+	if (!writeIndent(indent+2) || !write(value.getFieldName(index)) || !write(' '))
+		return false;
     indent +=2;
 	if (!value.getField(index)->encode(*this))
 		return false;
@@ -272,11 +297,10 @@ bool AVNEncoder::encodeKnownExtension(const SEQUENCE& value, int index)
 
 bool AVNEncoder::afterEncodeSequence(const SEQUENCE& value)
 {
-	if (outputSeparators.back())
-		strm  << '\n';
+	if (outputSeparators.back() && !write('\n'))
+		return false;
 	outputSeparators.pop_back();
-	strm << std::setw(indent + 1) << "}";
-	return strm.good();
+	return writeIndent(indent) && write('}');
 }
 
 }
@@ -75,13 +75,12 @@ bool CHOICE::setID(unsigned tagVal, unsigned tagClass)
 
 inline bool BERDecoder::atEnd() 
 { 
-	return beginPosition >= endPosition; 
+	return input.atEnd(); 
 }
 
 inline unsigned char BERDecoder::decodeByte() 
 { 
-	assert(!atEnd()); 
-	return *beginPosition++; 
+	return input.get(); 
 }
 
 bool BERDecoder::decode(Null& value)
@@ -90,7 +89,7 @@ bool BERDecoder::decode(Null& value)
 	if (!decodeHeader(value, len))
 		return false;
 
-	beginPosition += len;
+	input.skip(len);
 	return true;
 }
 
@@ -149,10 +148,25 @@ bool BERDecoder::decode(OBJECT_IDENTIFIER& value)
 	if (!decodeHeader(value, len))
 		return false;
 
-	beginPosition += len;
-	if (atEnd()) return false;
-
-	return value.decodeCommon(beginPosition-len, len);
+	if (input.remaining() < len) 
+		return false;
+	if (len == 0)
+		return value.decodeCommon(NULL, 0);
+
+	// read in place, unless the identifier spans two blocks of the input
+	const char* data = input.take(len);
+	if (data)
+		return value.decodeCommon(data, len);
+	char stackBuf[64];
+	std::vector<char> heapBuf;
+	char* buf = stackBuf;
+	if (len > sizeof(stackBuf))
+	{
+		heapBuf.resize(len);
+		buf = &heapBuf[0];
+	}
+	input.read(buf, len);
+	return value.decodeCommon(buf, len);
 }
 
 bool BERDecoder::decode(BIT_STRING& value)
@@ -190,7 +204,7 @@ bool BERDecoder::decode(BMPString& value)
 	if (!decodeHeader(value, len))
 		return false;
 	value.resize(len/2);
-	if ((beginPosition+len) >= endPosition)
+	if (len >= input.remaining())
 		return false;
 	for (unsigned i = 0; i < len/2; ++i)
 		value[i] = (decodeByte() << 8) | decodeByte();
@@ -199,7 +213,7 @@ bool BERDecoder::decode(BMPString& value)
 
 bool BERDecoder::decodeChoicePreamle(CHOICE& value, memento_type& nextPosition)
 {
-	const char* savedPosition = beginPosition;
+	std::size_t savedPosition = input.position();
 
 	unsigned tag;
 	bool primitive;
@@ -209,12 +223,12 @@ bool BERDecoder::decodeChoicePreamle(CHOICE& value, memento_type& nextPosition)
 
 	if (dontCheckTag || value.getTag() != 0)
 	{
-		savedPosition = beginPosition;
+		savedPosition = input.position();
 		if (!decodeHeader(tag, primitive, entryLen))
 			return false;
 	}
-	nextPosition = beginPosition + entryLen;
-	beginPosition = savedPosition;
+	nextPosition = input.position() + entryLen;
+	input.seek(savedPosition);
 	if (value.setID(tag & 0xffff, tag >> 16))
 	{
 		if (value.getSelectionTag() != 0) 
@@ -246,13 +260,13 @@ bool BERDecoder::decode(SEQUENCE_OF_Base& value)
 	if (!decodeHeader(value, len))
 		return false;
 
-	const char* endPos = beginPosition + len;
+	std::size_t endPos = input.position() + len;
 
-	if (endPos > endPosition ) return false;
+	if (endPos > input.size()) return false;
 
 
 	SEQUENCE_OF_Base::iterator it = value.begin(), last = value.end();
-	while (beginPosition < endPos && it != last)
+	while (input.position() < endPos && it != last)
 	{
 		if (!(*it)->decode(*this))
 		{
@@ -265,21 +279,24 @@ bool BERDecoder::decode(SEQUENCE_OF_Base& value)
 	if (it != last)
 		value.erase(it, last);
 
-	while (beginPosition < endPos) {
+	while (input.position() < endPos) {
 		std::unique_ptr<AbstractData> obj(value.createElement());
 		if (!obj->decode(*this))
 			return false;
 		value.push_back(obj.release());
 	}
 
-	beginPosition = endPos;
+	input.seek(endPos);
 
 	return true;
 }
 
 bool BERDecoder::decode(OpenData& value)
 {
-	const char* savedPosition = beginPosition;
+	if (value.is_expected())
+		return decodeOpenType(value);
+
+	std::size_t savedPosition = input.position();
 
 	unsigned tag;
 	bool primitive;
@@ -288,7 +305,7 @@ bool BERDecoder::decode(OpenData& value)
 		return false;
 
 	if (value.getTag() == 0)
-		beginPosition = savedPosition;
+		input.seek(savedPosition);
 
 	if (!value.has_buf())
 		value.grab(new OpenBuf);
@@ -306,18 +323,24 @@ bool BERDecoder::redecode(OpenData& value)
 }
 
 bool BERDecoder::decode(TypeConstrainedOpenData& value)
+{
+	return decodeOpenType(value);
+}
+
+// the value of an open type whose type is known, which is written whole, inside 
+// the tag of its component when it has one
+bool BERDecoder::decodeOpenType(OpenData& value)
 {
 	assert(value.has_data());
-	const char* savedPosition = beginPosition;
-	
-	unsigned tag;
-	bool primitive;
-	unsigned entryLen;
-	if (!decodeHeader(tag, primitive, entryLen))
-		return false;
-	
-	if (value.getTag() == 0)
-		beginPosition = savedPosition;
+	if (dontCheckTag || value.getTag() != 0)
+	{
+		unsigned tag;
+		bool primitive;
+		unsigned entryLen;
+		dontCheckTag = 0;
+		if (!decodeHeader(tag, primitive, entryLen))
+			return false;
+	}
 	return value.get_data().decode(*this);
 }
 
@@ -342,7 +365,7 @@ Visitor::VISIT_SEQ_RESULT BERDecoder::preDecodeExtensionRoots(SEQUENCE& value)
 	if (!decodeHeader(value, len))
 		return FAIL;
 
-	endSEQUENCEPositions.push_back(beginPosition + len);
+	endSEQUENCEPositions.push_back(input.position() + len);
 	return !atEnd() ? CONTINUE : FAIL;
 }
 
@@ -354,7 +377,7 @@ Visitor::VISIT_SEQ_RESULT BERDecoder::decodeExtensionRoot(SEQUENCE& value, int i
 		else
 			return CONTINUE;
 
-	const char* savedPosition = beginPosition;
+	std::size_t savedPosition = input.position();
     
 	if ( (endSEQUENCEPositions.back() == savedPosition && optional_id == -1) || 
 		(endSEQUENCEPositions.back() < savedPosition))
@@ -365,7 +388,7 @@ Visitor::VISIT_SEQ_RESULT BERDecoder::decodeExtensionRoot(SEQUENCE& value, int i
 	unsigned entryLen;
 	if (!decodeHeader(tag, primitive, entryLen))
 		return FAIL;
-	beginPosition = savedPosition;
+	input.seek(savedPosition);
 	unsigned fieldTag = value.getFieldTag(index);
 
 	if ((fieldTag == tag) || (fieldTag == 0))
@@ -403,13 +426,16 @@ Visitor::VISIT_SEQ_RESULT BERDecoder::decodeKnownExtension(SEQUENCE& value, int
 
 bool BERDecoder::decodeUnknownExtensions(SEQUENCE& value)
 {
-	beginPosition = endSEQUENCEPositions.back();
+	input.seek(endSEQUENCEPositions.back());
 	endSEQUENCEPositions.pop_back();
 	return true;
 }
 
 bool BERDecoder::decodeTag(unsigned& tag, bool & primitive)
 {
+	if (atEnd())
+		return false;
+
 	unsigned tagVal, tagClass;
 	unsigned char ident = decodeByte();
 	tagClass = ident & 0xC0;
@@ -466,7 +492,7 @@ bool BERDecoder::decodeHeader(unsigned& tag,
 
 bool BERDecoder::decodeHeader(AbstractData & obj, unsigned & len)
 {
-	const char* pos = beginPosition;
+	std::size_t pos = input.position();
 
 	unsigned tag;
 	bool primitive;
@@ -474,22 +500,13 @@ bool BERDecoder::decodeHeader(AbstractData & obj, unsigned & len)
 		(tag == obj.getTag() || dontCheckTag--))
 		return true;
 
-	beginPosition = pos;
+	input.seek(pos);
 	return false;
 }
 
 unsigned BERDecoder::decodeBlock(char * bufptr, unsigned nBytes)
 {
-	if (beginPosition+nBytes > endPosition)
-		nBytes = endPosition - beginPosition;
-
-	if (nBytes == 0)
-		return 0;
-
-	memcpy(bufptr, beginPosition, nBytes);
-
-	beginPosition += nBytes;
-	return nBytes;
+	return input.read(bufptr, nBytes);
 }
 
 }
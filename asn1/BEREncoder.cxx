@@ -154,6 +154,15 @@ private:
 			length += ASN1::getObjectLength(**first, (*first)->getTag()); 
 		return true; 
 	}
+	bool encode(const SEQUENCE& value) {
+		const detail::EncodingCache* cache = value.getEncodingCache();
+		const detail::EncodingCache::Entry* entry = 
+			cache ? cache->find(detail::EncodingCache::ber, 0, false) : NULL;
+		if (entry == NULL)
+			return ConstVisitor::encode(value);
+		length += entry->octets.size();
+		return true;
+	}
 
 	bool preEncodeExtensionRoots(const SEQUENCE& value) { 
 		return true; 
@@ -196,7 +205,7 @@ inline void BEREncoder::encodeByte(unsigned value)
 
 inline void BEREncoder::encodeBlock(const char * bufptr, unsigned nBytes)
 {
-	encodedBuffer.insert(encodedBuffer.end(), bufptr, bufptr + nBytes);
+	encodedBuffer.append(bufptr, nBytes);
 }
 
 bool BEREncoder::encode(const Null& value)
@@ -214,6 +223,9 @@ bool BEREncoder::encode(const BOOLEAN& value)
 
 bool BEREncoder::encode(const INTEGER& value)
 {
+	if (!valid(value))
+		return false;
+
 	encodeHeader(value);
 	// output the integer bits
 	for (int count = getIntegerDataLength(value.getValue())-1; count >= 0; count--)
@@ -223,6 +235,9 @@ bool BEREncoder::encode(const INTEGER& value)
 
 bool BEREncoder::encode(const ENUMERATED& value)
 {
+	if (!valid(value))
+		return false;
+
 	encodeHeader(value);
 	// output the integer bits
 	for (int count = getIntegerDataLength(value.asInt())-1; count >= 0; count--)
@@ -232,6 +247,9 @@ bool BEREncoder::encode(const ENUMERATED& value)
 
 bool BEREncoder::encode(const OBJECT_IDENTIFIER& value)
 {
+	if (!valid(value))
+		return false;
+
 	encodeHeader(value);
 	std::vector<char> data;
 	value.encodeCommon(data);
@@ -241,6 +259,9 @@ bool BEREncoder::encode(const OBJECT_IDENTIFIER& value)
 
 bool BEREncoder::encode(const BIT_STRING& value)
 {
+	if (!valid(value))
+		return false;
+
 	encodeHeader(value);
 	if (value.size() == 0)
 		encodeByte(0);
@@ -253,6 +274,9 @@ bool BEREncoder::encode(const BIT_STRING& value)
 
 bool BEREncoder::encode(const OCTET_STRING& value)
 {
+	if (!valid(value))
+		return false;
+
 	encodeHeader(value);
 	encodeBlock(&value[0], value.size());
 	return true;
@@ -260,6 +284,9 @@ bool BEREncoder::encode(const OCTET_STRING& value)
 
 bool BEREncoder::encode(const ConstrainedString& value)
 {
+	if (!valid(value))
+		return false;
+
 	encodeHeader(value);
 	encodeBlock((const char*)value.c_str(), value.size());
 	return true;
@@ -267,6 +294,9 @@ bool BEREncoder::encode(const ConstrainedString& value)
 
 bool BEREncoder::encode(const BMPString& value)
 {
+	if (!valid(value))
+		return false;
+
 	encodeHeader(value);
 	for (unsigned i = 0; i < value.size(); ++i)
 	{
@@ -278,6 +308,9 @@ bool BEREncoder::encode(const BMPString& value)
 
 bool BEREncoder::encode(const CHOICE& value)
 {
+	if (!valid(value))
+		return false;
+
 	if (value.currentSelection() != CHOICE::unselected_)
 	{
 		if (tag != 0 && (tag!=0xffffffff || value.getTag() !=0))
@@ -290,6 +323,9 @@ bool BEREncoder::encode(const CHOICE& value)
 
 bool BEREncoder::encode(const SEQUENCE_OF_Base& value)
 {
+	if (!valid(value))
+		return false;
+
 	encodeHeader(value);
 	SEQUENCE_OF_Base::const_iterator first = value.begin(), last = value.end();
 	for (; first != last; ++first)
@@ -303,6 +339,9 @@ bool BEREncoder::encode(const SEQUENCE_OF_Base& value)
 
 bool BEREncoder::encode(const OpenData& value)
 {
+	if (!valid(value))
+		return false;
+
 	if (tag == 0xFFFFFFFF) 
 		tag = value.getTag();
 	if (tag != 0)
@@ -321,12 +360,61 @@ bool BEREncoder::encode(const OpenData& value)
 
 bool BEREncoder::encode(const GeneralizedTime& value)
 {
+	if (!valid(value))
+		return false;
+
 	encodeHeader(value);
 	std::string data(value.get());
 	encodeBlock((const char*)data.c_str(), data.size());
 	return true;
 }
 
+/*
+ * A SEQUENCE which keeps its encodings is first encoded on its own, and its contents 
+ * octets are kept for the next time, which only has to encode the header in front.
+ */
+bool BEREncoder::encode(const SEQUENCE& value)
+{
+	detail::EncodingCache* cache = value.encodingCache.get();
+	if (cache == NULL)
+		return ConstVisitor::encode(value);
+
+	const detail::EncodingCache::Entry* entry = cache->find(detail::EncodingCache::ber, 0, checked);
+	if (entry != NULL)
+	{
+		encodeHeader(value);
+		encodeBlock(entry->octets.data(), entry->octets.size());
+		return true;
+	}
+
+	OpenBuf buf;
+	BEREncoder subEncoder(buf);
+	subEncoder.checked = checked;
+	subEncoder.tag = tag;
+	if (!subEncoder.ConstVisitor::encode(value))
+	{
+		invalidValue = subEncoder.invalidValue;
+		return false;
+	}
+	encodeBlock(&buf[0], buf.size());
+
+	// skip the identifier and length octets
+	unsigned tagNumber = ((tag == 0xFFFFFFFF) ? value.getTag() : tag) & 0xffff;
+	unsigned headerSize = tagNumber < 31 ? 1 : 1 + (CountBits(tagNumber)+6)/7;
+	unsigned char lengthOctet = buf[headerSize++];
+	if (lengthOctet & 0x80)
+		headerSize += lengthOctet & 0x7f;
+
+	detail::EncodingCache::Entry fresh;
+	fresh.rule = detail::EncodingCache::ber;
+	fresh.startBits = 0;
+	fresh.endBits = 8;
+	fresh.checked = checked;
+	fresh.octets.assign(buf.begin() + headerSize, buf.end());
+	cache->store(fresh);
+	return true;
+}
+
 bool BEREncoder::preEncodeExtensionRoots(const SEQUENCE& value) 
 {
 	encodeHeader(value);
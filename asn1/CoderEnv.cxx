@@ -28,13 +28,149 @@
 #endif
 
 #include "asn1.h"
+#include <atomic>
+#include <thread>
 
 namespace ASN1 {
+
+template <class Destination>
+static bool encode_into(CoderEnv::EncodingRules rule, const AbstractData& val, 
+						Destination first, Destination last, OutputBuffer& out)
+{
+	if (rule == CoderEnv::per_Basic_Aligned)
+	{
+		PEREncoder encoder(first, last);
+		if (!val.encode(encoder))
+			return false;
+		out = encoder.getOutput();
+	}
+	else if (rule == CoderEnv::ber)
+	{
+		BEREncoder encoder(first, last);
+		if (!val.encode(encoder))
+			return false;
+		out = encoder.getOutput();
+	}
+#ifdef ASN1_HAS_IOSTREAM
+	else if (rule == CoderEnv::avn)
+	{
+		AVNEncoder encoder(first, last);
+		if (!val.encode(encoder))
+			return false;
+		out = encoder.getOutput();
+	}
+	else if (rule == CoderEnv::jer)
+	{
+		JEREncoder encoder(first, last);
+		if (!val.encode(encoder))
+			return false;
+		out = encoder.getOutput();
+	}
+#endif
+	else
+		return false;
+	return !out.overflow();
+}
+
+static bool encode_into(CoderEnv::EncodingRules rule, const AbstractData& val, OpenBuf& buf)
+{
+	buf.clear(); // the text encoders append to the buffer
+	if (rule == CoderEnv::per_Basic_Aligned)
+	{
+		PEREncoder encoder(buf, true, EncodedSize::capacity(val.getEncodedSize().maxPER));
+		return val.encode(encoder);
+	}
+	if (rule == CoderEnv::ber)
+	{
+		BEREncoder encoder(buf, EncodedSize::capacity(val.getEncodedSize().maxBER));
+		return val.encode(encoder);
+	}
+#ifdef ASN1_HAS_IOSTREAM
+	if (rule == CoderEnv::avn)
+	{
+		AVNEncoder encoder(buf);
+		return val.encode(encoder);
+	}
+	if (rule == CoderEnv::jer)
+	{
+		JEREncoder encoder(buf);
+		return val.encode(encoder);
+	}
+#endif
+	return false;
+}
+
+char* CoderEnv::encode(const AbstractData& val, char* first, char* last) const
+{
+	OutputBuffer out;
+	if (!encode_into(get_encodingRule(), val, first, last, out))
+		return NULL;
+	return out.getPosition();
+}
+
+IoVec* CoderEnv::encode(const AbstractData& val, IoVec* first, IoVec* last) const
+{
+	OutputBuffer out;
+	if (!encode_into(get_encodingRule(), val, first, last, out))
+		return NULL;
+	IoVec* segment = out.getSegment();
+	if (segment == last)
+		return last; // empty chain, nothing written
+	segment->iov_len = out.getPosition() - static_cast<char*>(segment->iov_base);
+	return segment + 1;
+}
    
-bool CoderEnv::decode(const char* first, const char* last, AbstractData& val, bool defered)
+template <class Encoder>
+static bool encode_checked(Encoder& encoder, const AbstractData& val, std::string* diagnostic)
+{
+	encoder.setChecked(true);
+	if (val.encode(encoder))
+		return true;
+#ifdef ASN1_HAS_IOSTREAM
+	if (diagnostic && encoder.getInvalidValue())
+	{
+		std::stringstream strm;
+		trace_invalid(strm, "", val);
+		*diagnostic = strm.str();
+		if (!diagnostic->empty() && *diagnostic->rbegin() == '\n')
+			diagnostic->erase(diagnostic->size()-1);
+	}
+#endif
+	return false;
+}
+
+bool CoderEnv::encodeChecked(const AbstractData& val, OpenBuf& buf, std::string* diagnostic) const
 {
 	if (get_encodingRule() == per_Basic_Aligned)
 	{
+		PEREncoder encoder(buf, true, EncodedSize::capacity(val.getEncodedSize().maxPER));
+		return encode_checked(encoder, val, diagnostic);
+	}
+	if (get_encodingRule() == ber)
+	{
+		BEREncoder encoder(buf, EncodedSize::capacity(val.getEncodedSize().maxBER));
+		return encode_checked(encoder, val, diagnostic);
+	}
+	return false;
+}
+   
+/*
+ * A PER input longer than any encoding of the type of val cannot be one of its values,
+ * and is turned down without being decoded when the environment asks for it. BER inputs 
+ * are not, since a BER encoder may use longer lengths or indefinite ones.
+ */
+static bool exceedsPER(const CoderEnv& env, const AbstractData& val, std::size_t size)
+{
+	unsigned maxSize = val.getEncodedSize().maxPER;
+	return env.get_rejectOversize() && maxSize != EncodedSize::Unbounded && size > maxSize;
+}
+
+bool CoderEnv::decode(const char* first, const char* last, AbstractData& val, bool defered) const
+{
+	if (get_encodingRule() == per_Basic_Aligned)
+	{
+		if (exceedsPER(*this, val, last - first))
+			return false;
 		PERDecoder decoder(first, last, defered ? NULL : this);
 		return val.decode(decoder);
 	}
@@ -46,12 +182,144 @@ bool CoderEnv::decode(const char* first, const char* last, AbstractData& val, bo
 #ifdef ASN1_HAS_IOSTREAM
 	if (get_encodingRule() == avn)
 	{
-		std::istringstream strm(std::string(first, last));
-		AVNDecoder decoder(strm);
+		AVNDecoder decoder(first, last, defered ? NULL : this);
+		return val.decode(decoder);
+	}
+	if (get_encodingRule() == jer)
+	{
+		JERDecoder decoder(first, last, defered ? NULL : this);
 		return val.decode(decoder);
 	}
 #endif
 	return false;
 
 }
+
+bool CoderEnv::decode(const IoVec* first, const IoVec* last, AbstractData& val, bool defered) const
+{
+	if (get_encodingRule() == per_Basic_Aligned)
+	{
+		std::size_t size = 0;
+		for (const IoVec* block = first; block != last; ++block)
+			size += block->iov_len;
+		if (exceedsPER(*this, val, size))
+			return false;
+		PERDecoder decoder(first, last, defered ? NULL : this);
+		return val.decode(decoder);
+	}
+	if (get_encodingRule() == ber)
+	{
+		BERDecoder decoder(first, last, defered ? NULL : this);
+		return val.decode(decoder);
+	}
+
+	// the text decoders keep pointers into their input, which must be contiguous
+	OpenBuf buf;
+	for (; first != last; ++first)
+		buf.insert(buf.end(), static_cast<const char*>(first->iov_base), 
+			static_cast<const char*>(first->iov_base) + first->iov_len);
+	const char* data = buf.empty() ? NULL : &*buf.begin();
+	return decode(data, data + buf.size(), val, defered);
+}
+
+namespace {
+
+/*
+ * The part of a batch handed to one worker. The items are taken from the front, a chunk
+ * at a time, by the owner of the share and, once they are done with theirs, by the other
+ * workers.
+ */
+struct BatchShare
+{
+	std::atomic<std::size_t> next;
+	std::size_t end;
+	OpenBuf arena; // scratch memory of the owner
+};
+
+enum { batchChunk = 8 };
+
+/*
+ * Joins the threads it holds when it goes out of scope, so that none is left joinable 
+ * when starting one of them throws.
+ */
+struct JoiningThreads
+{
+	std::vector<std::thread> threads;
+	~JoiningThreads()
+	{
+		for (unsigned t = 0; t < threads.size(); ++t)
+			threads[t].join();
+	}
+};
+
+template <class Item, class Process>
+std::size_t runBatch(Item* items, std::size_t count, unsigned nThreads, Process process)
+{
+	if (nThreads == 0)
+		nThreads = std::thread::hardware_concurrency();
+	std::size_t nChunks = (count + batchChunk - 1) / batchChunk;
+	if (nThreads > nChunks)
+		nThreads = static_cast<unsigned>(nChunks);
+	if (nThreads == 0)
+		nThreads = 1;
+
+	std::vector<BatchShare> shares(nThreads);
+	for (unsigned i = 0; i < nThreads; ++i)
+	{
+		shares[i].next = count * i / nThreads;
+		shares[i].end = count * (i + 1) / nThreads;
+	}
+
+	std::atomic<std::size_t> succeeded(0);
+	auto work = [&](unsigned self)
+	{
+		std::size_t n = 0;
+		for (unsigned k = 0; k < nThreads; ++k)
+		{
+			BatchShare& share = shares[(self + k) % nThreads];
+			for (;;)
+			{
+				std::size_t i = share.next.fetch_add(batchChunk);
+				if (i >= share.end)
+					break;
+				std::size_t e = std::min<std::size_t>(i + batchChunk, share.end);
+				for (; i < e; ++i)
+					n += process(items[i], shares[self].arena);
+			}
+		}
+		succeeded += n;
+	};
+
+	{
+		JoiningThreads workers;
+		workers.threads.reserve(nThreads - 1);
+		for (unsigned t = 1; t < nThreads; ++t)
+			workers.threads.push_back(std::thread(work, t));
+		work(0);
+	}
+	return succeeded;
+}
+
+}
+
+std::size_t CoderEnv::decodeBatch(DecodeItem* first, DecodeItem* last, unsigned nThreads) const
+{
+	return runBatch(first, last - first, nThreads, [this](DecodeItem& item, OpenBuf&)
+	{
+		return item.decoded = decode(item.first, item.last, *item.value, false);
+	});
+}
+
+std::size_t CoderEnv::encodeBatch(EncodeItem* first, EncodeItem* last, unsigned nThreads) const
+{
+	EncodingRules rule = get_encodingRule();
+	return runBatch(first, last - first, nThreads, [rule](EncodeItem& item, OpenBuf& arena)
+	{
+		item.encoded = encode_into(rule, *item.value, arena);
+		if (item.encoded)
+			item.output->assign(arena.begin(), arena.end());
+		return item.encoded;
+	});
+}
+
 }
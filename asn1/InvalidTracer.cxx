@@ -67,6 +67,8 @@ bool InvalidTracer::encode(const BOOLEAN& value)
 }
 
 bool InvalidTracer::encode(const INTEGER& value) { 
+	if (value.getConstraintType() == Unconstrained)
+		return true;
 	if (value.getLowerLimit() >= 0)
 	{
 		unsigned v = static_cast<unsigned>(value.getValue());
@@ -200,7 +202,7 @@ bool InvalidTracer::encode(const OpenData& value)
 
 bool InvalidTracer::encode(const GeneralizedTime& value)  
 { 
-	if (value.isStrictlyValid())
+	if (!value.isStrictlyValid())
 	{
 		strm << " This GeneralizedTime is not valid";
 		return false;
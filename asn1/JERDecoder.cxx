@@ -0,0 +1,593 @@
+/*
+ * jerdecoder.cxx
+ *
+ * Copyright (c) 2001 Institute for Information Industry, Taiwan, Republic of China 
+ * (http://www.iii.org.tw/iiia/ewelcome.htm)
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is III ASN.1 Tool
+ *
+ * The Initial Developer of the Original Code is Institute for Information Industry.
+ *
+ * Portions are Copyright (C) 1993 Free Software Foundation, Inc.
+ * All Rights Reserved.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "asn1.h"
+#ifdef ASN1_HAS_IOSTREAM
+
+namespace ASN1 {
+
+inline int hex_value(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+// Reads the character at p within the contents of a JSON string, either as an 
+// escape sequence or as a UTF-8 sequence, and stores its code point in c.
+static bool get_json_char(const char*& p, const char* last, unsigned& c)
+{
+	unsigned char first = *p++;
+	if (first == '\\')
+	{
+		if (p == last)
+			return false;
+		switch (*p++)
+		{
+		case '\"': c = '\"'; return true;
+		case '\\': c = '\\'; return true;
+		case '/':  c = '/';  return true;
+		case 'b':  c = '\b'; return true;
+		case 'f':  c = '\f'; return true;
+		case 'n':  c = '\n'; return true;
+		case 'r':  c = '\r'; return true;
+		case 't':  c = '\t'; return true;
+		case 'u':
+			if (last - p < 4)
+				return false;
+			c = 0;
+			for (int i = 0; i < 4; ++i)
+			{
+				int digit = hex_value(*p++);
+				if (digit < 0)
+					return false;
+				c = (c << 4) | digit;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	if (first < 0x80)
+	{
+		c = first;
+		return true;
+	}
+
+	unsigned nTrailing = (first >= 0xF0) ? 3 : (first >= 0xE0) ? 2 : (first >= 0xC0) ? 1 : 0;
+	if (nTrailing == 0 || last - p < static_cast<int>(nTrailing))
+		return false;
+	c = first & (0x3F >> nTrailing);
+	for (; nTrailing; --nTrailing)
+	{
+		unsigned char next = *p++;
+		if ((next & 0xC0) != 0x80)
+			return false;
+		c = (c << 6) | (next & 0x3F);
+	}
+	return true;
+}
+
+bool JERDecoder::getLiteral(const char* literal, unsigned len)
+{
+	if (!skipSpaces() || static_cast<unsigned>(end - cur) < len || strncmp(cur, literal, len) != 0)
+		return false;
+	cur += len;
+	return true;
+}
+
+bool JERDecoder::getString(Token& str, bool& escaped)
+{
+	char c;
+	if (!getChar(c) || c != '\"')
+		return false;
+
+	escaped = false;
+	str.first = cur;
+	for (; cur != end; ++cur)
+	{
+		if (*cur == '\"')
+		{
+			str.len = cur++ - str.first;
+			return true;
+		}
+		if (*cur == '\\')
+		{
+			escaped = true;
+			if (++cur == end)
+				break;
+		}
+	}
+	return false;
+}
+
+bool JERDecoder::getHex(std::vector<char>& value, unsigned& nDigits)
+{
+	Token str;
+	bool escaped;
+	if (!getString(str, escaped) || escaped)
+		return false;
+
+	value.clear();
+	value.reserve((str.len + 1) / 2);
+	for (unsigned i = 0; i < str.len; ++i)
+	{
+		int digit = hex_value(str.first[i]);
+		if (digit < 0)
+			return false;
+		if (i & 1)
+			value.back() = static_cast<char>(value.back() | digit);
+		else
+			value.push_back(static_cast<char>(digit << 4));
+	}
+	nDigits = str.len;
+	return true;
+}
+
+bool JERDecoder::skipValue()
+{
+	char c;
+	if (!peekChar(c))
+		return false;
+
+	Token str;
+	bool escaped;
+	if (c == '\"')
+		return getString(str, escaped);
+
+	if (c == '{' || c == '[')
+	{
+		// only the nesting matters, the syntax of the inner values is not checked
+		unsigned depth = 0;
+		do {
+			if (*cur == '\"')
+			{
+				if (!getString(str, escaped))
+					return false;
+				continue;
+			}
+			if (*cur == '{' || *cur == '[')
+				++depth;
+			else if (*cur == '}' || *cur == ']')
+				--depth;
+			++cur;
+		} while (depth && cur != end);
+		return depth == 0;
+	}
+
+	// number or literal name
+	const char* first = cur;
+	while (cur != end && *cur != ',' && *cur != '}' && *cur != ']' && 
+		   *cur != ' ' && *cur != '\t' && *cur != '\n' && *cur != '\r')
+		++cur;
+	return cur != first;
+}
+
+bool JERDecoder::decode(Null& value)
+{
+	return getLiteral("null", 4);
+}
+
+bool JERDecoder::decode(BOOLEAN& value)
+{
+	char c;
+	if (!peekChar(c))
+		return false;
+	if (c == 't' && getLiteral("true", 4))
+		value = true;
+	else if (c == 'f' && getLiteral("false", 5))
+		value = false;
+	else
+		return false;
+	return true;
+}
+
+// Reads a JSON number, which may have a fraction and an exponent, as long as its 
+// value is a whole number, such as 1.5e1 or 200e-2.
+bool JERDecoder::getWholeNumber(unsigned& magnitude, bool& negative)
+{
+	if (!getNumber(magnitude, negative))
+		return false;
+
+	const char* fraction = cur;
+	const char* fractionEnd = cur;
+	if (cur != end && *cur == '.')
+	{
+		fraction = ++cur;
+		while (cur != end && *cur >= '0' && *cur <= '9')
+			++cur;
+		fractionEnd = cur;
+		if (fraction == fractionEnd)
+			return false;
+	}
+
+	int exponent = 0;
+	if (cur != end && (*cur == 'e' || *cur == 'E'))
+	{
+		bool negativeExponent = false;
+		if (++cur != end && (*cur == '+' || *cur == '-'))
+			negativeExponent = (*cur++ == '-');
+		if (cur == end || *cur < '0' || *cur > '9')
+			return false;
+		for (; cur != end && *cur >= '0' && *cur <= '9'; ++cur)
+			if (exponent < 10000)
+				exponent = exponent * 10 + (*cur - '0');
+		if (negativeExponent)
+			exponent = -exponent;
+	}
+
+	// the digits of the fraction move in front of the point as far as the exponent 
+	// goes, and those left behind must be zeros
+	for (; fraction != fractionEnd; ++fraction)
+	{
+		unsigned d = *fraction - '0';
+		if (exponent <= 0)
+		{
+			if (d != 0)
+				return false;
+			continue;
+		}
+		if (magnitude > (~0u - d) / 10)
+			return false;
+		magnitude = magnitude * 10 + d;
+		--exponent;
+	}
+	for (; exponent > 0 && magnitude != 0; --exponent)
+	{
+		if (magnitude > ~0u / 10)
+			return false;
+		magnitude *= 10;
+	}
+	for (; exponent < 0 && magnitude != 0; ++exponent)
+	{
+		if (magnitude % 10 != 0)
+			return false;
+		magnitude /= 10;
+	}
+	return true;
+}
+
+bool JERDecoder::decode(INTEGER& value)
+{
+	unsigned magnitude;
+	bool negative;
+	if (!getWholeNumber(magnitude, negative))
+		return false;
+
+	if (!value.constrained() || value.getLowerLimit() < 0)
+	{
+		if (magnitude > (negative ? 0x80000000u : 0x7FFFFFFFu))
+			return false;
+		value = static_cast<INTEGER::int_type>(negative ? 0u - magnitude : magnitude);
+	}
+	else if (!negative)
+		value = magnitude;
+	else
+		return false;
+	return true;
+}
+
+bool JERDecoder::decode(ENUMERATED& value)
+{
+	Token str;
+	bool escaped;
+	return getString(str, escaped) && !escaped && value.setFromName(str.first, str.len);
+}
+
+bool JERDecoder::decode(OBJECT_IDENTIFIER& value)
+{
+	Token str;
+	bool escaped;
+	if (!getString(str, escaped) || escaped || str.len == 0)
+		return false;
+
+	value = OBJECT_IDENTIFIER();
+	const char* p = str.first;
+	const char* last = str.first + str.len;
+	for (;;)
+	{
+		if (p == last || *p < '0' || *p > '9')
+			return false;
+		unsigned v = 0;
+		for (; p != last && *p >= '0' && *p <= '9'; ++p)
+		{
+			unsigned d = *p - '0';
+			if (v > (~0u - d) / 10)
+				return false; // overflow
+			v = v * 10 + d;
+		}
+		value.append(v);
+		if (p == last)
+			return true;
+		if (*p++ != '.')
+			return false;
+	}
+}
+
+bool JERDecoder::decode(BIT_STRING& value)
+{
+	char c;
+	if (!peekChar(c))
+		return false;
+
+	unsigned nDigits;
+	if (c == '\"')
+	{
+		// fixed size, the length is given by the constraint
+		if (!getHex(value.bitData, nDigits) || value.getConstraintType() != FixedConstraint)
+			return false;
+		value.totalBits = value.getLowerLimit();
+		return (nDigits & 1) == 0 && value.bitData.size() == (value.totalBits + 7) / 8;
+	}
+
+	if (!getChar(c) || c != '{')
+		return false;
+
+	bool hasValue = false, hasLength = false;
+	do {
+		Token name;
+		bool escaped;
+		if (!getString(name, escaped) || !getChar(c) || c != ':')
+			return false;
+		if (name.equal("value"))
+			hasValue = getHex(value.bitData, nDigits);
+		else if (name.equal("length"))
+		{
+			bool negative;
+			hasLength = getWholeNumber(value.totalBits, negative) && !negative;
+		}
+		else if (!skipValue())
+			return false;
+	} while (getChar(c) && c == ',');
+
+	return c == '}' && hasValue && hasLength && 
+		(nDigits & 1) == 0 && value.bitData.size() == (value.totalBits + 7) / 8;
+}
+
+bool JERDecoder::decode(OCTET_STRING& value)
+{
+	unsigned nDigits;
+	return getHex(value, nDigits) && (nDigits & 1) == 0;
+}
+
+bool JERDecoder::decode(ConstrainedString& value)
+{
+	Token str;
+	bool escaped;
+	if (!getString(str, escaped))
+		return false;
+	if (!escaped)
+	{
+		value.assign(str.first, str.len);
+		return true;
+	}
+
+	std::string tmp;
+	tmp.reserve(str.len);
+	for (const char* p = str.first, *last = str.first + str.len; p != last; )
+	{
+		unsigned c;
+		if (!get_json_char(p, last, c) || c > 0xFF)
+			return false;
+		tmp += static_cast<char>(c);
+	}
+	value.assign(tmp);
+	return true;
+}
+
+bool JERDecoder::decode(BMPString& value)
+{
+	Token str;
+	bool escaped;
+	if (!getString(str, escaped))
+		return false;
+
+	std::wstring tmp;
+	tmp.reserve(str.len);
+	for (const char* p = str.first, *last = str.first + str.len; p != last; )
+	{
+		unsigned c;
+		if (!get_json_char(p, last, c) || c > 0xFFFF)
+			return false;
+		tmp += static_cast<wchar_t>(c);
+	}
+	value.assign(tmp);
+	return true;
+}
+
+bool JERDecoder::decode(CHOICE& value)
+{
+	Token name;
+	bool escaped;
+	char c;
+	if (getChar(c) && c == '{' && getString(name, escaped) && getChar(c) && c == ':')
+	{
+		int choiceID = value.findSelection(name.first, name.len);
+		return choiceID >= 0 && value.select(choiceID) && value.getSelection()->decode(*this) &&
+			getChar(c) && c == '}';
+	}
+	return false;
+}
+
+bool JERDecoder::decode(SEQUENCE_OF_Base& value)
+{
+	char c;
+	if (!getChar(c) || c != '[' || !peekChar(c))
+		return false;
+
+	value.clear();
+
+	if (c == ']')
+	{
+		++cur;
+		return true; // no entry, return and indicate success
+	}
+
+	do {
+		std::unique_ptr<AbstractData> entry(value.createElement());
+		if (entry.get() && entry->decode(*this) && getChar(c))
+			value.push_back(entry.release());
+		else
+			return false;
+	} while (c == ',');
+
+	return c == ']';
+}
+
+bool JERDecoder::decode(OpenData& value)
+{
+	if (value.is_expected())
+		return value.get_data().decode(*this);
+
+	// without the actual type, the JSON text of the value is kept for a redecode
+	if (!skipSpaces())
+		return false;
+	const char* first = cur;
+	if (!skipValue())
+		return false;
+	value.set_text(OpenData::jerText, first, cur);
+	return true;
+}
+
+bool JERDecoder::redecode(OpenData& value)
+{
+	if (!value.has_text(OpenData::jerText) || !value.has_data())
+		return false;
+	const std::string& text = value.get_text();
+	JERDecoder decoder(text.data(), text.data() + text.size(), get_env());
+	char c;
+	return value.get_data().decode(decoder) && !decoder.peekChar(c);
+}
+
+bool JERDecoder::decode(TypeConstrainedOpenData& value)
+{
+	assert(value.has_data());
+	return value.get_data().decode(*this);
+}
+
+bool JERDecoder::decode(GeneralizedTime& value)
+{
+	Token str;
+	bool escaped;
+	if (getString(str, escaped) && !escaped)
+	{
+		value.set(std::string(str.first, str.len).c_str());
+		return true;
+	}
+	return false;
+}
+
+Visitor::VISIT_SEQ_RESULT JERDecoder::preDecodeExtensionRoots(SEQUENCE& value)
+{
+	// The members are located first and each component is then decoded from the 
+	// position of its member, so that the members can appear in any order.
+	char c;
+	if (!getChar(c) || c != '{' || !peekChar(c))
+		return FAIL;
+
+	const unsigned base = members.size();
+	if (c == '}')
+		++cur;
+	else
+	{
+		do {
+			Token name;
+			bool escaped;
+			if (!getString(name, escaped) || escaped || !getChar(c) || c != ':' || !skipSpaces())
+			{
+				members.resize(base);
+				return FAIL;
+			}
+			Member member = { value.findField(name.first, name.len), cur };
+			members.push_back(member);
+			if (!skipValue() || !getChar(c))
+			{
+				members.resize(base);
+				return FAIL;
+			}
+		} while (c == ',');
+
+		if (c != '}')
+		{
+			members.resize(base);
+			return FAIL;
+		}
+	}
+
+	memberBases.push_back(base);
+	sequenceEnds.push_back(cur);
+	return CONTINUE; // visit the extensions anyway, decodeUnknownExtensions() finishes the SEQUENCE
+}
+
+Visitor::VISIT_SEQ_RESULT JERDecoder::decodeExtensionRoot(SEQUENCE& value, int index, int optional_id)
+{
+	for (unsigned i = memberBases.back(); i < members.size(); ++i)
+	{
+		if (members[i].pos == index)
+		{
+			if (optional_id != -1)
+				value.includeOptionalField(optional_id, index);
+			AbstractData* field = value.getField(index);
+			cur = members[i].value;
+			if (field && field->decode(*this))
+				return CONTINUE;
+			endSequence();
+			return FAIL;
+		}
+	}
+	if (optional_id != -1)
+		return CONTINUE; 
+	endSequence(); // a mandatory component is missing
+	return FAIL;
+}
+
+Visitor::VISIT_SEQ_RESULT JERDecoder::decodeKnownExtension(SEQUENCE& value, int index, int optional_id)
+{
+	return decodeExtensionRoot(value, index, optional_id);
+}
+
+bool JERDecoder::decodeUnknownExtensions(SEQUENCE& value)
+{
+	// unknown members have already been skipped
+	endSequence();
+	return true;
+}
+
+void JERDecoder::endSequence()
+{
+	cur = sequenceEnds.back();
+	members.resize(memberBases.back());
+	memberBases.pop_back();
+	sequenceEnds.pop_back();
+}
+
+}
+
+#endif
@@ -0,0 +1,255 @@
+/*
+ * jerencoder.cxx
+ *
+ * Copyright (c) 2001 Institute for Information Industry, Taiwan, Republic of China 
+ * (http://www.iii.org.tw/iiia/ewelcome.htm)
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is III ASN.1 Tool
+ *
+ * The Initial Developer of the Original Code is Institute for Information Industry.
+ *
+ * Portions are Copyright (C) 1993 Free Software Foundation, Inc.
+ * All Rights Reserved.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "asn1.h"
+#ifdef ASN1_HAS_IOSTREAM
+
+namespace ASN1 {
+
+static const char HexDigits[] = "0123456789ABCDEF";
+
+bool JEREncoder::writeHex(const char* data, unsigned len)
+{
+	if (!write('\"'))
+		return false;
+	for (unsigned i = 0; i < len; ++i)
+	{
+		char hex[2] = { HexDigits[(data[i] >> 4) & 0x0F], HexDigits[data[i] & 0x0F] };
+		if (!write(hex, 2))
+			return false;
+	}
+	return write('\"');
+}
+
+bool JEREncoder::writeString(const char* str, unsigned len)
+{
+	if (!write('\"'))
+		return false;
+
+	// runs of characters which need no escaping are written at once
+	const char* first = str;
+	const char* last = str + len;
+	for (; str != last; ++str)
+	{
+		unsigned char c = *str;
+		if (c >= 0x20 && c < 0x80 && c != '\"' && c != '\\')
+			continue;
+		if (!write(first, str - first))
+			return false;
+		first = str + 1;
+
+		if (c == '\"' || c == '\\')
+		{
+			char escaped[2] = { '\\', static_cast<char>(c) };
+			if (!write(escaped, 2))
+				return false;
+		}
+		else
+		{
+			char escaped[6] = { '\\', 'u', '0', '0', HexDigits[c >> 4], HexDigits[c & 0x0F] };
+			if (!write(escaped, 6))
+				return false;
+		}
+	}
+	return write(first, last - first) && write('\"');
+}
+
+bool JEREncoder::writeName(const char* name)
+{
+	return write('\"') && write(name) && write("\":", 2);
+}
+
+bool JEREncoder::encode(const Null& value)
+{
+	return write("null", 4);
+}
+
+bool JEREncoder::encode(const BOOLEAN& value)
+{
+	if (value) 
+		return write("true", 4);
+	return write("false", 5);
+}
+
+bool JEREncoder::encode(const INTEGER& value)
+{
+	if (!value.constrained() || value.getLowerLimit() < 0)
+		return writeInt(value.getValue());
+	return writeUnsigned(value.getValue());
+}
+
+bool JEREncoder::encode(const ENUMERATED& value)
+{
+	const char* name = value.getName();
+	if (name != 0)
+		return write('\"') && write(name) && write('\"');
+	return false;
+}
+
+bool JEREncoder::encode(const OBJECT_IDENTIFIER& value)
+{
+	if (!write('\"'))
+		return false;
+	for (unsigned i = 0;  i < value.levels(); ++i) 
+		if ((i != 0 && !write('.')) || !writeUnsigned(value[i]))
+			return false;
+	return write('\"');
+}
+
+bool JEREncoder::encode(const BIT_STRING& value)
+{
+	// a BIT STRING of fixed size is encoded as a bare hex string, otherwise the 
+	// length in bits is given along with the value
+	bool fixedSize = value.getConstraintType() == FixedConstraint && 
+		static_cast<unsigned>(value.getLowerLimit()) == value.getUpperLimit();
+	
+	std::vector<char> data(value.getData().begin(), value.getData().begin() + (value.size() + 7) / 8);
+	if (value.size() & 7)
+		data.back() &= static_cast<char>(0xFF << (8 - (value.size() & 7))); // unused bits are 0
+
+	if (fixedSize)
+		return writeHex(data.size() ? &*data.begin() : NULL, data.size());
+	return write("{\"value\":", 9) && writeHex(data.size() ? &*data.begin() : NULL, data.size()) && 
+		write(",\"length\":", 10) && writeUnsigned(value.size()) && write('}');
+}
+
+bool JEREncoder::encode(const OCTET_STRING& value)
+{
+	return writeHex(value.size() ? &*value.begin() : NULL, value.size());
+}
+
+bool JEREncoder::encode(const ConstrainedString& value)
+{
+	return writeString(value.data(), value.size());
+}
+
+bool JEREncoder::encode(const BMPString& value)
+{
+	if (!write('\"'))
+		return false;
+	for (unsigned i = 0; i < value.size(); ++i)
+	{
+		unsigned c = value[i] & 0xFFFF;
+		if (c >= 0x20 && c < 0x80 && c != '\"' && c != '\\')
+		{
+			if (!write(static_cast<char>(c)))
+				return false;
+		}
+		else if (c == '\"' || c == '\\')
+		{
+			char escaped[2] = { '\\', static_cast<char>(c) };
+			if (!write(escaped, 2))
+				return false;
+		}
+		else
+		{
+			char escaped[6] = { '\\', 'u', HexDigits[c >> 12], HexDigits[(c >> 8) & 0x0F], 
+				HexDigits[(c >> 4) & 0x0F], HexDigits[c & 0x0F] };
+			if (!write(escaped, 6))
+				return false;
+		}
+	}
+	return write('\"');
+}
+
+bool JEREncoder::encode(const CHOICE& value)
+{
+	if (value.currentSelection() >= 0)
+	{
+		return write('{') && writeName(value.getSelectionName()) &&
+			value.getSelection()->encode(*this) && write('}');
+	}
+	return false;
+}
+
+bool JEREncoder::encode(const OpenData& value)
+{
+	if (value.has_data())
+		return value.get_data().encode(*this);
+	else if (value.has_text(OpenData::jerText))
+		return write(value.get_text().data(), value.get_text().size());
+	else if (value.has_buf())
+	{
+		const std::vector<char>& buf = value.get_buf();
+		return writeHex(buf.size() ? &*buf.begin() : NULL, buf.size());
+	}
+	return false;
+}
+
+bool JEREncoder::encode(const GeneralizedTime& value)
+{
+	std::string str = value.get();
+	return writeString(str.data(), str.size());
+}
+
+bool JEREncoder::encode(const SEQUENCE_OF_Base& value)
+{
+	if (!write('['))
+		return false;
+    SEQUENCE_OF_Base::const_iterator first = value.begin(), last = value.end();
+	for (; first != last; ++first)
+	{
+		if (first != value.begin() && !write(','))
+			return false;
+		if (!(*first)->encode(*this))
+			return false;
+	}
+	return write(']');
+}
+
+bool JEREncoder::preEncodeExtensionRoots(const SEQUENCE& value) 
+{
+	outputSeparators.push_back(false);
+	return write('{');
+}
+
+bool JEREncoder::encodeExtensionRoot(const SEQUENCE& value, int index)
+{
+	if (outputSeparators.back() && !write(','))
+		return false;
+	if (!writeName(value.getFieldName(index)) || !value.getField(index)->encode(*this))
+		return false;
+	outputSeparators.back() = true;
+	return true;
+}
+
+bool JEREncoder::encodeKnownExtension(const SEQUENCE& value, int index)
+{
+	return encodeExtensionRoot(value, index);
+}
+
+bool JEREncoder::afterEncodeSequence(const SEQUENCE& value)
+{
+	outputSeparators.pop_back();
+	return write('}');
+}
+
+}
+
+#endif
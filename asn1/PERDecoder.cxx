@@ -42,9 +42,7 @@ namespace ASN1 {
 static unsigned MaximumArraySize = 128;
 static unsigned MaximumStringSize = 16*1024;
 
-extern unsigned CountBits(unsigned range);
-
-bool PERDecoder::decodeBitMap(std::vector<char>& bitData, unsigned nBit)
+bool PERDecoder::decodeBitMap(char* bitData, unsigned nBit)
 {
 	unsigned theBits;
 	int idx = 0;
@@ -66,7 +64,7 @@ bool PERDecoder::decodeBitMap(std::vector<char>& bitData, unsigned nBit)
 
 inline bool PERDecoder::atEnd() 
 { 
-	return beginPosition >= endPosition; 
+	return input.atEnd(); 
 }
 
 bool PERDecoder::decode(Null& value)
@@ -86,57 +84,20 @@ bool PERDecoder::decode(BOOLEAN& value)
 
 bool PERDecoder::decode(INTEGER& integer)
 {
-	// X.931 Sections 12
-
 	unsigned value;
-	if ((integer.getConstraintType() == ExtendableConstraint && decodeSingleBit()) 
-		|| integer.getConstraintType() < FixedConstraint) { //  12.1
-		unsigned len;
-		if (decodeLength(0, INT_MAX, len) != 0)
-			return false;
-		if (!decodeMultiBit(len*8, value))
-			return false;
-
-		if (!integer.constrained() && (value & 1 << ((len*8)-1) ) ) // negative value
-			value = (0xFFFFFFFF << (len*8)) | value;
-
-		integer = value;
-		return true;
-	}
-
-	if ((unsigned)integer.getLowerLimit() != integer.getUpperLimit())  // 12.2.1
-	if (decodeUnsigned(integer.getLowerLimit(), integer.getUpperLimit(), value) == 0) // 12.2.2 which devolves to 10.5
-	{
-		integer = value;
-		return true;
-	}
-
-	integer = integer.getLowerLimit();
+	if (!decodeInteger(value, integer.getPERConstraint()))
+		return false;
+	integer = value;
 	return true;
 }
 
 bool PERDecoder::decode(ENUMERATED& value)
 {
-	// X.691 Section 13
-
 	unsigned v;
-	if (value.extendable()) {  // 13.3
-		if (decodeSingleBit()) {
-			unsigned len = 0;
-			if (decodeSmallUnsigned(len) && len > 0 && decodeUnsigned(0, len-1, v) == 0)
-			{
-				value.setFromInt(v);
-				return true;
-			}
-		}
-	}
-
-	if (decodeUnsigned(0, value.getMaximum(), v)==0)	  // 13.2
-	{
-		value.setFromInt(v);
-		return true;
-	}
-	return false;
+	if (!decodeEnumerated(v, value.getMaximum(), value.extendable(), value.getPERWidth()))
+		return false;
+	value.setFromInt(v);
+	return true;
 }
 
 bool PERDecoder::decode(OBJECT_IDENTIFIER& value)
@@ -147,10 +108,18 @@ bool PERDecoder::decode(OBJECT_IDENTIFIER& value)
 	if (decodeLength(0, 255, dataLen) < 0)
 		return false;
 
-	beginPosition += dataLen;
-	if (atEnd()) return false;
+	if (input.remaining() < dataLen) 
+		return false;
+	if (dataLen == 0)
+		return value.decodeCommon(NULL, 0);
 
-	return value.decodeCommon(beginPosition-dataLen, dataLen);
+	// read in place, unless the identifier spans two blocks of the input
+	const char* data = input.take(dataLen);
+	if (data)
+		return value.decodeCommon(data, dataLen);
+	char buf[255];
+	input.read(buf, dataLen);
+	return value.decodeCommon(buf, dataLen);
 }
 
 bool PERDecoder::decode(BIT_STRING& value)
@@ -165,18 +134,7 @@ bool PERDecoder::decode(BIT_STRING& value)
 
 	value.resize(value.totalBits);
 
-	if (value.size() == 0)
-		return true;   // 15.7
-
-	if (value.size() > getBitsLeft())
-		return false;
-
-	if (value.size() > 16 && aligned()) {
-		unsigned nBytes = (value.size()+7)/8;
-		return decodeBlock(&*(value.bitData.begin()), nBytes) == nBytes;   // 15.9
-	}
-
-	return decodeBitMap( value.bitData, value.size());
+	return value.size() == 0 || decodeBits(&value.bitData[0], value.size());   // 15.7
 }
 
 bool PERDecoder::decode(OCTET_STRING& value)
@@ -192,29 +150,7 @@ bool PERDecoder::decode(OCTET_STRING& value)
 
 	value.resize(nBytes);   // 16.5
 
-	unsigned theBits;
-	switch (nBytes) {
-	case 0 :
-		break;
-
-	case 1 :  // 16.6
-		if (!decodeMultiBit(8, theBits))
-			return false;
-		value[0] = (char)theBits;
-		break;
-
-	case 2 :  // 16.6
-		if (!decodeMultiBit(8, theBits))
-			return false;
-		value[0] = (char)theBits;
-		if (!decodeMultiBit(8, theBits))
-			return false;
-		value[1] = (char)theBits;
-		break;
-	default: // 16.7
-		return decodeBlock(&(*value.begin()), nBytes) == nBytes;
-	}
-	return true;
+	return nBytes == 0 || decodeOctets(&value[0], nBytes);
 }
 
 bool PERDecoder::decode(ConstrainedString& value)
@@ -225,35 +161,14 @@ bool PERDecoder::decode(ConstrainedString& value)
 	if (decodeConstrainedLength(value, len) < 0)
 		return false;
 
-	unsigned nBits = value.getNumBits(aligned());
-
 	if (len > MaximumStringSize)
 		return false;
 
 	value.resize(len);
-	if (value.getConstraintType() == Unconstrained || value.getUpperLimit()*nBits > 16) {
-		if (nBits == 8)
-		{
-			if (decodeBlock(&(*value.begin()), len) != len)
-				value.resize(0);
-			return value.size() == len;
-		}
-		if (aligned())
-			byteAlign();
-	}
-
-
-	unsigned i;
-	for (i = 0; i < (unsigned)len; i++) {
-		unsigned theBits;
-		if (!decodeMultiBit(nBits, theBits))
-			return false;
-		if (nBits >= value.getCanonicalSetBits() && value.getCanonicalSetBits() > 4)
-			value[i] = (char)theBits;
-		else
-			value[i] = value.getCharacterSet()[theBits];
-	}
-	return true;
+	if (decodeChars(&value[0], len, value.getPERConstraint(), value.getPERCharSet()))
+		return true;
+	value.resize(0);
+	return false;
 }
 
 bool PERDecoder::decode(BMPString& value)
@@ -268,20 +183,7 @@ bool PERDecoder::decode(BMPString& value)
 		return false;
 
 	value.resize(len);
-
-	unsigned nBits = value.getNumBits(aligned());
-
-	if ((value.getConstraintType() == Unconstrained || value.getUpperLimit()*nBits > 16) && aligned())
-		byteAlign();
-
-	for (unsigned i = 0; i < (unsigned)len; i++)
-	{
-		unsigned theBits;
-		if (!decodeMultiBit(nBits, theBits))
-			return false;
-		value[i] = (wchar_t)(theBits + value.getFirstChar());
-	}
-	return true;
+	return decodeBMPChars(&value[0], len, value.getPERConstraint(), value.getPERCharSet());
 }
 
 bool PERDecoder::decodeChoicePreamle(CHOICE& value, memento_type& nextPosition)
@@ -302,7 +204,7 @@ bool PERDecoder::decodeChoicePreamle(CHOICE& value, memento_type& nextPosition)
 			unsigned len;
 			if (decodeLength(0, INT_MAX, len) != 0)
 					return false;
-			nextPosition.bytePosition = beginPosition + len;
+			nextPosition.bytePosition = input.position() + len;
 			nextPosition.bitPosition = 8;
 			return value.select(choiceID);
 		}
@@ -311,11 +213,11 @@ bool PERDecoder::decodeChoicePreamle(CHOICE& value, memento_type& nextPosition)
 	if (value.getNumChoices() < 2)
 		choiceID = 0;
 	else {
-		if (decodeUnsigned(0, value.getNumChoices()-1, choiceID) < 0)
+		if (decodeUnsigned(0, value.getNumChoices()-1, choiceID, value.getPERWidth()) < 0)
 			return false;
 	}
 
-	nextPosition.bytePosition = 0;
+	nextPosition.bytePosition = npos;
 	return value.select(choiceID);
 }
 
@@ -358,6 +260,9 @@ bool PERDecoder::decode(SEQUENCE_OF_Base& value)
 
 bool PERDecoder::decode(OpenData& data)
 {
+	if (data.is_expected())
+		return decodeOpenType(data);
+
 	OCTET_STRING value;
 	if (value.decode(*this))
 	{
@@ -378,12 +283,18 @@ bool PERDecoder::redecode(OpenData& value)
 }
 
 bool PERDecoder::decode(TypeConstrainedOpenData& value)
+{
+	return decodeOpenType(value);
+}
+
+// the value of an open type whose type is known, from the octets holding it
+bool PERDecoder::decodeOpenType(OpenData& value)
 {
 	assert(value.has_data());
 	unsigned len;
 	if (decodeLength(0, INT_MAX, len) != 0)
 		return false;
-	const char* nextPosition = beginPosition + len;
+	std::size_t nextPosition = input.position() + len;
 	bool ok = value.get_data().decode(*this);
 	setPosition(nextPosition);
 	return ok;
@@ -413,7 +324,7 @@ Visitor::VISIT_SEQ_RESULT PERDecoder::preDecodeExtensionRoots(SEQUENCE& value)
 			return FAIL;
 		hasExtension = decodeSingleBit() ;  // 18.1
 	}
-	return decodeBitMap(value.optionMap.bitData, value.optionMap.size()) ? 
+	return decodeBitMap(value.optionMap.bitData.data(), value.optionMap.size()) ? 
 		(hasExtension  ? CONTINUE : NO_EXTENSION) : FAIL;  // 18.2
 }
 
@@ -442,7 +353,7 @@ Visitor::VISIT_SEQ_RESULT PERDecoder::preDecodeExtensions(SEQUENCE& value)
 
 	value.extensionMap.resize(totalExtensions);
 	Visitor::VISIT_SEQ_RESULT result;
-	result = decodeBitMap(value.extensionMap.bitData, value.extensionMap.size()) ? CONTINUE : FAIL;
+	result = decodeBitMap(value.extensionMap.bitData.data(), value.extensionMap.size()) ? CONTINUE : FAIL;
 	return result;
 }
 
@@ -454,7 +365,7 @@ Visitor::VISIT_SEQ_RESULT PERDecoder::decodeKnownExtension(SEQUENCE& value, int
 	unsigned len;
 	if (decodeLength(0, INT_MAX, len) != 0)
 		return FAIL;
-	const char* nextExtensionPosition = beginPosition + len;
+	std::size_t nextExtensionPosition = input.position() + len;
 	if (value.getField(index) == NULL)
 		value.fields[index] = AbstractData::create(value.info()->fieldInfos[index]);
 	
@@ -475,7 +386,7 @@ bool PERDecoder::decodeUnknownExtensions(SEQUENCE& value)
 			unsigned len;
 			if (decodeLength(0, INT_MAX, len) != 0)
 				return false;
-			beginPosition += len;
+			input.skip(len);
 			if (atEnd())
 				return false;
 		}
@@ -483,9 +394,9 @@ bool PERDecoder::decodeUnknownExtensions(SEQUENCE& value)
 	return true;
 }
 
-void PERDecoder::setPosition(const char* newPos)
+void PERDecoder::setPosition(std::size_t newPos)
 {
-	beginPosition = newPos < endPosition ? newPos : endPosition;
+	input.seek(newPos);
 	bitOffset = 8;
 }
 
@@ -493,24 +404,149 @@ void PERDecoder::byteAlign()
 {
 	if (bitOffset != 8) {
 		bitOffset = 8;
-		beginPosition++;
+		input.skip(1);
 	}
 }
 
 unsigned PERDecoder::getBitsLeft() const
 {
-	return (endPosition - beginPosition)*8 - (8 - bitOffset);
+	return input.remaining()*8 - (8 - bitOffset);
 }
 
 int PERDecoder::decodeConstrainedLength(ConstrainedObject & obj, unsigned & length)
+{
+	return decodeConstrainedLength(obj.getPERConstraint(), length);
+}
+
+int PERDecoder::decodeConstrainedLength(const PERConstraint& constraint, unsigned & length)
 {
 	// The execution order is important in the following. The decodeSingleBit() function
 	// must be called if extendableFlag is true, no matter what.
-	if ((obj.getConstraintType() == ExtendableConstraint && decodeSingleBit()) 
-		|| obj.getConstraintType() == Unconstrained)
+	if ((constraint.type == ExtendableConstraint && decodeSingleBit()) 
+		|| constraint.type == Unconstrained)
 		return decodeLength(0, INT_MAX, length);
 	else
-		return decodeLength(obj.getLowerLimit(), obj.getUpperLimit(), length);
+		return decodeLength(constraint.lower, constraint.upper, length, constraint.width);
+}
+
+bool PERDecoder::decodeInteger(unsigned& value, const PERConstraint& constraint)
+{
+	// X.931 Sections 12
+
+	if ((constraint.type == ExtendableConstraint && decodeSingleBit()) 
+		|| constraint.type < FixedConstraint) { //  12.1
+		unsigned len;
+		if (decodeLength(0, INT_MAX, len) != 0)
+			return false;
+		if (!decodeMultiBit(len*8, value))
+			return false;
+
+		if (constraint.type == Unconstrained && (value & 1 << ((len*8)-1) ) ) // negative value
+			value = (0xFFFFFFFF << (len*8)) | value;
+		return true;
+	}
+
+	if ((unsigned)constraint.lower != constraint.upper)  // 12.2.1
+	if (decodeUnsigned(constraint.lower, constraint.upper, value, constraint.width) == 0) // 12.2.2 which devolves to 10.5
+		return true;
+
+	value = constraint.lower;
+	return true;
+}
+
+bool PERDecoder::decodeEnumerated(unsigned& value, int maximum, bool extendable, const PERWidth& width)
+{
+	// X.691 Section 13
+
+	if (extendable) {  // 13.3
+		if (decodeSingleBit()) {
+			unsigned len = 0;
+			if (decodeSmallUnsigned(len) && len > 0 && decodeUnsigned(0, len-1, value) == 0)
+				return true;
+		}
+	}
+
+	return decodeUnsigned(0, maximum, value, width)==0;	  // 13.2
+}
+
+bool PERDecoder::decodeBits(char* bitData, unsigned nBits)
+{
+	if (nBits > getBitsLeft())
+		return false;
+
+	if (nBits > 16 && aligned()) {
+		unsigned nBytes = (nBits+7)/8;
+		return decodeBlock(bitData, nBytes) == nBytes;   // 15.9
+	}
+
+	return decodeBitMap(bitData, nBits);
+}
+
+bool PERDecoder::decodeOctets(char* data, unsigned nBytes)
+{
+	unsigned theBits;
+	switch (nBytes) {
+	case 0 :
+		break;
+
+	case 1 :  // 16.6
+		if (!decodeMultiBit(8, theBits))
+			return false;
+		data[0] = (char)theBits;
+		break;
+
+	case 2 :  // 16.6
+		if (!decodeMultiBit(8, theBits))
+			return false;
+		data[0] = (char)theBits;
+		if (!decodeMultiBit(8, theBits))
+			return false;
+		data[1] = (char)theBits;
+		break;
+	default: // 16.7
+		return decodeBlock(data, nBytes) == nBytes;
+	}
+	return true;
+}
+
+bool PERDecoder::decodeChars(char* str, unsigned len, const PERConstraint& constraint, const PERCharSet& charSet)
+{
+	unsigned nBits = aligned() ? charSet.alignedBits : charSet.unalignedBits;
+
+	if (constraint.type == Unconstrained || constraint.upper*nBits > 16) {
+		if (nBits == 8)
+			return decodeBlock(str, len) == len;
+		if (aligned())
+			byteAlign();
+	}
+
+	for (unsigned i = 0; i < len; i++) {
+		unsigned theBits;
+		if (!decodeMultiBit(nBits, theBits))
+			return false;
+		if (nBits >= charSet.canonicalBits && charSet.canonicalBits > 4)
+			str[i] = (char)theBits;
+		else
+			str[i] = charSet.characters[theBits];
+	}
+	return true;
+}
+
+bool PERDecoder::decodeBMPChars(wchar_t* str, unsigned len, const PERConstraint& constraint, const PERBMPCharSet& charSet)
+{
+	unsigned nBits = aligned() ? charSet.alignedBits : charSet.unalignedBits;
+
+	if ((constraint.type == Unconstrained || constraint.upper*nBits > 16) && aligned())
+		byteAlign();
+
+	for (unsigned i = 0; i < len; i++)
+	{
+		unsigned theBits;
+		if (!decodeMultiBit(nBits, theBits))
+			return false;
+		str[i] = (wchar_t)(theBits + charSet.firstChar);
+	}
+	return true;
 }
 
 bool PERDecoder::decodeSingleBit()
@@ -519,7 +555,7 @@ bool PERDecoder::decodeSingleBit()
 		return false;
 
 	bitOffset--;
-	bool value = (*beginPosition & (1 << bitOffset)) != 0;
+	bool value = (input.peek() & (1 << bitOffset)) != 0;
 
 	if (bitOffset == 0) {
 		byteAlign();
@@ -539,22 +575,22 @@ bool PERDecoder::decodeMultiBit(unsigned nBits, unsigned& value)
         
 		if (nBits < bitOffset) {
 			bitOffset -= nBits;
-			value = (static_cast<unsigned char>(*beginPosition) >> bitOffset) & ((1 << nBits) - 1);
+			value = (input.peek() >> bitOffset) & ((1 << nBits) - 1);
 			return true;
 		}
         
-		value = static_cast<unsigned char>(*beginPosition++) & ((1 << bitOffset) - 1);
+		value = input.get() & ((1 << bitOffset) - 1);
 		nBits -= bitOffset;
 		bitOffset = 8;
         
 		while (nBits >= 8) {
-			value = (value << 8) | static_cast<unsigned char>(*beginPosition++);
+			value = (value << 8) | input.get();
 			nBits -= 8;
 		}
         
 		if (nBits > 0) {
 			bitOffset = 8 - nBits;
-			value = (value << nBits) | (static_cast<unsigned char>(*beginPosition) >> bitOffset);
+			value = (value << nBits) | (input.peek() >> bitOffset);
 		}
         
 		return true;
@@ -577,19 +613,21 @@ bool PERDecoder::decodeSmallUnsigned(unsigned & value)
 	return decodeMultiBit(len*8, value);
 }
 
-int PERDecoder::decodeLength(unsigned lower, unsigned upper, unsigned & len)
+int PERDecoder::decodeLength(unsigned lower, unsigned upper, unsigned & len, const PERWidth& width)
 {
 	// X.691 section 10.9
 
 	if (upper != INT_MAX && !alignedFlag) {
 		assert(upper - lower < 0x10000);  // 10.9.4.2 unsupported
 		unsigned base;
-		if (!decodeMultiBit(CountBits(upper - lower + 1), base))
+		if (!decodeMultiBit(width.orBounds(lower, upper).unalignedBits, base))
 			return -1;
+		len = base + lower;
+		return 0;
 	}
 
 	if (upper < 65536)  // 10.9.3.3
-		return decodeUnsigned(lower, upper, len);
+		return decodeUnsigned(lower, upper, len, width);
 
 	// 10.9.3.5
 	byteAlign();
@@ -608,7 +646,7 @@ int PERDecoder::decodeLength(unsigned lower, unsigned upper, unsigned & len)
 	return -1;
 }
 
-int PERDecoder::decodeUnsigned(unsigned lower, unsigned upper, unsigned & value)
+int PERDecoder::decodeUnsigned(unsigned lower, unsigned upper, unsigned & value, const PERWidth& width)
 {
 	// X.691 section 10.5
 
@@ -620,16 +658,14 @@ int PERDecoder::decodeUnsigned(unsigned lower, unsigned upper, unsigned & value)
 	if (atEnd())
 		return -1;
 
-	unsigned range = (upper - lower) + 1;
-	unsigned nBits = CountBits(range);
+	const PERWidth w = width.orBounds(lower, upper);
+	unsigned nBits = alignedFlag ? w.alignedBits : w.unalignedBits;
 
-	if (alignedFlag && (range == 0 || range > 255)) { // not 10.5.6 and not 10.5.7.1
-		if (nBits > 16) {                           // not 10.5.7.4
-			decodeLength(1, (nBits+7)/8, nBits);      // 12.2.6
+	if (alignedFlag && w.octetAligned) { // not 10.5.6 and not 10.5.7.1
+		if (nBits == 0) {                           // 10.5.7.4
+			decodeLength(1, (w.unalignedBits+7)/8, nBits);      // 12.2.6
 			nBits *= 8;
-		} else
-		if (nBits > 8)    // not 10.5.7.2
-			nBits = 16;          // 10.5.7.3
+		}
 		byteAlign();           // 10.7.5.2 - 10.7.5.4
 	}
 
@@ -647,17 +683,93 @@ unsigned PERDecoder::decodeBlock(char * bufptr, unsigned nBytes)
 		return 0; 
 
 	byteAlign();
-	
-	if (beginPosition+nBytes > endPosition)
-		nBytes = endPosition - beginPosition;
-	
-	if (nBytes == 0)
-		return 0;
-	
-	memcpy(bufptr, beginPosition, nBytes);
-	
-	beginPosition += nBytes;
-	return nBytes;
+	return input.read(bufptr, nBytes);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+namespace lite {
+
+bool PERReader::readBit(bool& value)
+{
+	if (decoder.getBitsLeft() == 0)
+		return false;
+	value = decoder.decodeSingleBit();
+	return true;
+}
+
+bool PERReader::readObjectId(ObjectId& value)
+{
+	// X.691 Section 23
+
+	unsigned dataLen;
+	char data[255];
+	if (decoder.decodeLength(0, 255, dataLen) < 0 || decoder.decodeBlock(data, dataLen) != dataLen)
+		return false;
+
+	unsigned nArcs = OBJECT_IDENTIFIER::decodeArcs(data, dataLen, value.data(), value.max_size());
+	if (nArcs == UINT_MAX)
+		return false;
+	value.resize(nArcs);
+	return true;
+}
+
+bool PERReader::readLength(unsigned& n, const PERConstraint& size, std::size_t maxSize)
+{
+	return decoder.decodeConstrainedLength(size, n) >= 0 && n <= MaximumStringSize && n <= maxSize;
+}
+
+bool PERReader::readCount(unsigned& n, const PERConstraint& size)
+{
+	return decoder.decodeConstrainedLength(size, n) >= 0 && n <= MaximumArraySize;
 }
 
+bool PERReader::readChoice(unsigned& selection, unsigned numChoices, bool extendable)
+{
+	// X.691 Section 22
+
+	if (decoder.atEnd())
+		return false;
+
+	if (extendable && decoder.decodeSingleBit()) {
+		if (!decoder.decodeSmallUnsigned(selection))
+			return false;
+		selection += numChoices;
+		return true;
+	}
+
+	if (numChoices < 2) {
+		selection = 0;
+		return true;
+	}
+	return decoder.decodeUnsigned(0, numChoices-1, selection) == 0;
+}
+
+bool PERReader::readExtensionCount(unsigned& n)
+{
+	if (!decoder.decodeSmallUnsigned(n))
+		return false;
+	return ++n <= MaximumArraySize;
+}
+
+bool PERReader::beginOpen(std::size_t& next)
+{
+	unsigned len;
+	if (decoder.decodeLength(0, INT_MAX, len) != 0 || len > decoder.input.remaining())
+		return false;
+	next = decoder.getPosition() + len;
+	return true;
+}
+
+bool PERReader::skipOpen()
+{
+	std::size_t next;
+	if (!beginOpen(next))
+		return false;
+	decoder.setPosition(next);
+	return true;
+}
+
+} // namespace lite
+
 } // namespace ASN1
@@ -40,7 +40,7 @@ namespace ASN1 {
 
 extern unsigned CountBits(unsigned range);
 
-void PEREncoder::encodeBitMap(const std::vector<char>& bitData, unsigned nBits)
+void PEREncoder::encodeBitMap(const char* bitData, unsigned nBits)
 {
 	int idx = 0;
 	unsigned bitsLeft = nBits;
@@ -73,51 +73,25 @@ bool PEREncoder::encode(const BOOLEAN& value)
 
 bool PEREncoder::encode(const INTEGER& integer)
 {
-	// X.931 Sections 12
-
-	unsigned value = (unsigned) integer.getValue();
-	if (encodeConstraint(integer, (int)value)) { //  12.1
-		unsigned nBytes;
-		unsigned adjusted_value = (integer.getConstraintType() == FixedConstraint ? 
-								value - integer.getLowerLimit() : value);
-		unsigned nBits;
-		if (adjusted_value == 0)
-			nBits = 1;
-		else
-		if (integer.getConstraintType() != FixedConstraint)
-			if ((int)value < 0)
-				nBits = CountBits( (~value) +1);
-			else	nBits = CountBits(value+1) +1;
-		else
-			nBits = CountBits(adjusted_value+1);
-		nBytes = (nBits+7)/8;
-		encodeLength(nBytes, 0, INT_MAX);
-		encodeMultiBit(adjusted_value, nBytes*8);
-		return true;
-	}
-  
-	if (static_cast<unsigned>(integer.getLowerLimit()) == integer.getUpperLimit()) // 12.2.1
-		return true;
+	if (!valid(integer))
+		return false;
 
-	// 12.2.2 which devolves to 10.5
-	return encodeUnsigned(value, integer.getLowerLimit(), integer.getUpperLimit());
+	return encodeInteger(integer.getValue(), integer.getPERConstraint());
 }
 
 bool PEREncoder::encode(const ENUMERATED& value)
 {
-	if (value.extendable()) {  // 13.3
-		bool extended = value.asInt() > value.getMaximum();
-		encodeSingleBit(extended);
-		if (extended) {
-			encodeSmallUnsigned(1+value.asInt());
-			return encodeUnsigned(value.asInt(), 0, value.asInt());
-		}
-	}               	
-	return encodeUnsigned(value.asInt(), 0, value.getMaximum());  // 13.2
+	if (!valid(value))
+		return false;
+
+	return encodeEnumerated(value.asInt(), value.getMaximum(), value.extendable(), value.getPERWidth());
 }
 
 bool PEREncoder::encode(const OBJECT_IDENTIFIER& value)
 {
+	if (!valid(value))
+		return false;
+
 	// X.691 Section 23
 
 	std::vector<char> eObjId;
@@ -130,102 +104,41 @@ bool PEREncoder::encode(const OBJECT_IDENTIFIER& value)
 
 bool PEREncoder::encode(const BIT_STRING& value)
 {
-	// X.691 Section 15
-
-	if (!encodeConstrainedLength(value, value.size()))
+	if (!valid(value))
 		return false;
 
-	if (value.size() == 0)
-		return true;
-
-	if (value.size() > 16 && aligned())
-		encodeBlock(&*value.getData().begin(), (value.size()+7)/8);   // 15.9
-	else {// 15.8
-		encodeBitMap(value.getData(), value.size());
-	}
-	return true;
+	return encodeBits(value.size() ? &value.getData()[0] : NULL, value.size(), value.getPERConstraint());
 }
 
 bool PEREncoder::encode(const OCTET_STRING& value)
 {
-	// X.691 Section 16
-	unsigned nBytes = value.size();
-
-	if (!encodeConstrainedLength(value, nBytes))
+	if (!valid(value))
 		return false;
 
-	switch (nBytes) {
-	case 0 :  // 16.5
-		break;
-
-	case 1 :  // 16.6
-		encodeMultiBit(value[0], 8);
-		break;
-
-	case 2 :  // 16.6
-		encodeMultiBit(value[0], 8);
-		encodeMultiBit(value[1], 8);
-		break;
-	default: // 16.7
-		encodeBlock(&*value.begin(), nBytes);
-	}
-	return true;
+	return encodeOctets(value.size() ? &value[0] : NULL, value.size(), value.getPERConstraint());
 }
 
 bool PEREncoder::encode(const ConstrainedString& value)
 {
-	// X.691 Section 26
-
-	unsigned len = value.size();
-	if (!encodeConstrainedLength(value, len))
+	if (!valid(value))
 		return false;
 
-	unsigned nBits = value.getNumBits(aligned());
-
-	if (value.getConstraintType() == Unconstrained || value.getUpperLimit()*nBits > 16) {
-		if (nBits == 8) {
-			encodeBlock(value.c_str(), len);
-			return true;
-		}
-		if (aligned())
-			byteAlign();
-	}
-
-	for (unsigned i = 0; i < len; i++) {
-		if (nBits >= value.getCanonicalSetBits() && value.getCanonicalSetBits() > 4)
-			encodeMultiBit(value[i], nBits);
-		else {
-			const void * ptr = memchr(value.getCharacterSet(), value[i], value.getCharacterSetSize());
-			if (ptr == NULL)
-				return false;
-			unsigned pos = ((const char *)ptr - value.getCharacterSet());
-			encodeMultiBit(pos, nBits);
-		}
-	}
-	return true;
+	return encodeChars(value.c_str(), value.size(), value.getPERConstraint(), value.getPERCharSet());
 }
 
 bool PEREncoder::encode(const BMPString& value)
 {
-	// X.691 Section 26
-
-	unsigned len = value.size();
-	if (!encodeConstrainedLength(value, len))
+	if (!valid(value))
 		return false;
 
-	unsigned nBits = value.getNumBits(aligned());
-
-	if ((value.getConstraintType() == Unconstrained || value.getUpperLimit()*nBits > 16) && aligned())
-		byteAlign();
-
-	for (unsigned i = 0; i < len; i++) 
-		encodeMultiBit(value[i] - value.getFirstChar(), nBits);
-
-	return true;
+	return encodeBMPChars(value.c_str(), value.size(), value.getPERConstraint(), value.getPERCharSet());
 }
 
 bool PEREncoder::encode(const CHOICE& value)
 {
+	if (!valid(value))
+		return false;
+
 	if (value.currentSelection() < 0)
 		return false;
 
@@ -239,7 +152,7 @@ bool PEREncoder::encode(const CHOICE& value)
 	}
 
 	if (value.getNumChoices() > 1)
-	if (!encodeUnsigned(value.currentSelection(), 0, value.getNumChoices()-1))
+	if (!encodeUnsigned(value.currentSelection(), 0, value.getNumChoices()-1, value.getPERWidth()))
 		return false;
 
 	return value.getSelection()->encode(*this);
@@ -247,8 +160,11 @@ bool PEREncoder::encode(const CHOICE& value)
 
 bool PEREncoder::encode(const SEQUENCE_OF_Base& value)
 {
+	if (!valid(value))
+		return false;
+
 	unsigned sz = value.size();
-	if (!encodeConstrainedLength(value, sz))
+	if (!encodeConstrainedLength(value.getPERConstraint(), sz))
 		return false;
 
 	SEQUENCE_OF_Base::const_iterator first = value.begin(), last = value.end();
@@ -258,13 +174,71 @@ bool PEREncoder::encode(const SEQUENCE_OF_Base& value)
 	return true;
 }
 
+/*
+ * A SEQUENCE which keeps its encodings is first encoded on its own, starting at the 
+ * same bit of an octet, and its bits are then spliced into the output.
+ */
+bool PEREncoder::encode(const SEQUENCE& value)
+{
+	detail::EncodingCache* cache = value.encodingCache.get();
+	if (cache == NULL)
+		return ConstVisitor::encode(value);
+
+	detail::EncodingCache::Rule rule = alignedFlag ? detail::EncodingCache::per_aligned 
+		: detail::EncodingCache::per_unaligned;
+	const detail::EncodingCache::Entry* entry = cache->find(rule, bitOffset, checked);
+	if (entry == NULL)
+	{
+		OpenBuf buf;
+		PEREncoder subEncoder(buf, alignedFlag);
+		subEncoder.checked = checked;
+		if (bitOffset != 8)
+			buf.push_back(0);
+		subEncoder.bitOffset = bitOffset;
+		if (!subEncoder.ConstVisitor::encode(value))
+		{
+			invalidValue = subEncoder.invalidValue;
+			return false;
+		}
+
+		detail::EncodingCache::Entry fresh;
+		fresh.rule = rule;
+		fresh.startBits = bitOffset;
+		fresh.endBits = subEncoder.bitOffset;
+		fresh.checked = checked;
+		fresh.octets.swap(buf);
+		entry = &cache->store(fresh);
+	}
+
+	const std::vector<char>& octets = entry->octets;
+	unsigned first = 0;
+	if (bitOffset != 8 && !octets.empty())
+		encodedBuffer.back() |= octets[first++];
+	if (octets.size() > first)
+		encodedBuffer.append(&octets[first], octets.size() - first);
+	bitOffset = entry->endBits;
+	return true;
+}
+
 bool PEREncoder::encode(const OpenData& value)
 {
-	return encodeAnyType(&value.get_data());
+	if (!valid(value))
+		return false;
+
+	if (value.has_data())
+		return encodeAnyType(&value.get_data());
+	if (!value.has_buf())
+		return false;
+	OpenBuf buf(value.get_buf());
+	encodeOpenType(buf);
+	return true;
 }
 
 bool PEREncoder::encode(const GeneralizedTime& value)
 {
+	if (!valid(value))
+		return false;
+
 	std::string notion(value.get());
 	encodeLength(notion.size(), 0, UINT_MAX);
 	encodeBlock(&*notion.begin(), notion.size());
@@ -284,7 +258,7 @@ bool PEREncoder::preEncodeExtensionRoots(const SEQUENCE& value)
 		}
 		encodeSingleBit(hasExtensions);  // 18.1
 	}
-	encodeBitMap(value.optionMap.bitData, value.optionMap.size());// 18.2
+	encodeBitMap(value.optionMap.bitData.data(), value.optionMap.size());// 18.2
 	return true;
 }
 
@@ -297,7 +271,7 @@ bool PEREncoder::preEncodeExtensions(const SEQUENCE& value)
 {
 	int totalExtensions = value.extensionMap.size();
 	encodeSmallUnsigned(totalExtensions-1);
-	encodeBitMap(value.extensionMap.bitData, value.extensionMap.size());
+	encodeBitMap(value.extensionMap.bitData.data(), value.extensionMap.size());
 	return true;
 }
 
@@ -306,31 +280,169 @@ bool PEREncoder::encodeKnownExtension(const SEQUENCE& value, int index)
 	return encodeAnyType(value.fields[index]);
 }
 
-bool PEREncoder::encodeConstrainedLength(const ConstrainedObject & obj, unsigned length) 
+bool PEREncoder::encodeConstrainedLength(const PERConstraint& constraint, unsigned length) 
 {
-	return (encodeConstraint(obj, length) ? // 26.4
+	return (encodeConstraint(constraint, length) ? // 26.4
 		encodeLength(length, 0, INT_MAX) :
-		encodeLength(length, obj.getLowerLimit(), obj.getUpperLimit()));
+		encodeLength(length, constraint.lower, constraint.upper, constraint.width));
 }
 
-bool PEREncoder::encodeConstraint(const ConstrainedObject & obj, unsigned value) 
+bool PEREncoder::encodeConstraint(const PERConstraint& constraint, unsigned value) 
 {
-	if (!obj.extendable())
-		return obj.getConstraintType() != FixedConstraint;
+	if (!constraint.extendable())
+		return constraint.type != FixedConstraint;
 
-	bool needsExtending = value > obj.getUpperLimit();
+	bool needsExtending = value > constraint.upper;
 	if (!needsExtending) {
-		if (obj.getLowerLimit() < 0) {
-			if ((int)value < obj.getLowerLimit())
+		if (constraint.lower < 0) {
+			if ((int)value < constraint.lower)
 				needsExtending = true;
 		} else {
-			if (value < (unsigned)obj.getLowerLimit())
+			if (value < (unsigned)constraint.lower)
 				needsExtending = true;
 		}
 	}
 
 	encodeSingleBit(needsExtending);
-	return needsExtending || obj.getConstraintType() < FixedConstraint;
+	return needsExtending || constraint.type < FixedConstraint;
+}
+
+bool PEREncoder::encodeInteger(int integer, const PERConstraint& constraint)
+{
+	// X.931 Sections 12
+
+	unsigned value = (unsigned) integer;
+	if (encodeConstraint(constraint, (int)value)) { //  12.1
+		unsigned nBytes;
+		unsigned adjusted_value = (constraint.type == FixedConstraint ? 
+								value - constraint.lower : value);
+		unsigned nBits;
+		if (adjusted_value == 0)
+			nBits = 1;
+		else
+		if (constraint.type != FixedConstraint)
+			if ((int)value < 0)
+				nBits = CountBits( (~value) +1);
+			else	nBits = CountBits(value+1) +1;
+		else
+			nBits = CountBits(adjusted_value+1);
+		nBytes = (nBits+7)/8;
+		encodeLength(nBytes, 0, INT_MAX);
+		encodeMultiBit(adjusted_value, nBytes*8);
+		return true;
+	}
+  
+	if (static_cast<unsigned>(constraint.lower) == constraint.upper) // 12.2.1
+		return true;
+
+	// 12.2.2 which devolves to 10.5
+	return encodeUnsigned(value, constraint.lower, constraint.upper, constraint.width);
+}
+
+bool PEREncoder::encodeEnumerated(int value, int maximum, bool extendable, const PERWidth& width)
+{
+	if (extendable) {  // 13.3
+		bool extended = value > maximum;
+		encodeSingleBit(extended);
+		if (extended) {
+			encodeSmallUnsigned(1+value);
+			return encodeUnsigned(value, 0, value);
+		}
+	}               	
+	return encodeUnsigned(value, 0, maximum, width);  // 13.2
+}
+
+bool PEREncoder::encodeBits(const char* bitData, unsigned nBits, const PERConstraint& constraint)
+{
+	// X.691 Section 15
+
+	if (!encodeConstrainedLength(constraint, nBits))
+		return false;
+
+	if (nBits == 0)
+		return true;
+
+	if (nBits > 16 && aligned())
+		encodeBlock(bitData, (nBits+7)/8);   // 15.9
+	else {// 15.8
+		encodeBitMap(bitData, nBits);
+	}
+	return true;
+}
+
+bool PEREncoder::encodeOctets(const char* data, unsigned nBytes, const PERConstraint& constraint)
+{
+	// X.691 Section 16
+
+	if (!encodeConstrainedLength(constraint, nBytes))
+		return false;
+
+	switch (nBytes) {
+	case 0 :  // 16.5
+		break;
+
+	case 1 :  // 16.6
+		encodeMultiBit(data[0], 8);
+		break;
+
+	case 2 :  // 16.6
+		encodeMultiBit(data[0], 8);
+		encodeMultiBit(data[1], 8);
+		break;
+	default: // 16.7
+		encodeBlock(data, nBytes);
+	}
+	return true;
+}
+
+bool PEREncoder::encodeChars(const char* str, unsigned len, const PERConstraint& constraint, const PERCharSet& charSet)
+{
+	// X.691 Section 26
+
+	if (!encodeConstrainedLength(constraint, len))
+		return false;
+
+	unsigned nBits = aligned() ? charSet.alignedBits : charSet.unalignedBits;
+
+	if (constraint.type == Unconstrained || constraint.upper*nBits > 16) {
+		if (nBits == 8) {
+			encodeBlock(str, len);
+			return true;
+		}
+		if (aligned())
+			byteAlign();
+	}
+
+	for (unsigned i = 0; i < len; i++) {
+		if (nBits >= charSet.canonicalBits && charSet.canonicalBits > 4)
+			encodeMultiBit(str[i], nBits);
+		else {
+			const void * ptr = memchr(charSet.characters, str[i], charSet.size);
+			if (ptr == NULL)
+				return false;
+			unsigned pos = ((const char *)ptr - charSet.characters);
+			encodeMultiBit(pos, nBits);
+		}
+	}
+	return true;
+}
+
+bool PEREncoder::encodeBMPChars(const wchar_t* str, unsigned len, const PERConstraint& constraint, const PERBMPCharSet& charSet)
+{
+	// X.691 Section 26
+
+	if (!encodeConstrainedLength(constraint, len))
+		return false;
+
+	unsigned nBits = aligned() ? charSet.alignedBits : charSet.unalignedBits;
+
+	if ((constraint.type == Unconstrained || constraint.upper*nBits > 16) && aligned())
+		byteAlign();
+
+	for (unsigned i = 0; i < len; i++) 
+		encodeMultiBit(str[i] - charSet.firstChar, nBits);
+
+	return true;
 }
 
 void PEREncoder::encodeSingleBit(bool value)
@@ -402,7 +514,7 @@ void PEREncoder::encodeSmallUnsigned(unsigned value)
 	encodeMultiBit(value, len*8);
 }
 
-bool PEREncoder::encodeLength(unsigned len, unsigned lower, unsigned upper)
+bool PEREncoder::encodeLength(unsigned len, unsigned lower, unsigned upper, const PERWidth& width)
 {
 	if (len < lower || len > upper)
 		return false;
@@ -411,12 +523,12 @@ bool PEREncoder::encodeLength(unsigned len, unsigned lower, unsigned upper)
 
 	if (upper != INT_MAX && !alignedFlag) {
 		assert(upper - lower < 0x10000);  // 10.9.4.2 unsupperted
-		encodeMultiBit(len - lower, CountBits(upper - lower + 1));   // 10.9.4.1
+		encodeMultiBit(len - lower, width.orBounds(lower, upper).unalignedBits);   // 10.9.4.1
 		return true;
 	}
 
 	if (upper < 65536)  // 10.9.3.3
-		return encodeUnsigned(len, lower, upper);
+		return encodeUnsigned(len, lower, upper, width);
 
 	byteAlign();
 
@@ -438,7 +550,7 @@ bool PEREncoder::encodeLength(unsigned len, unsigned lower, unsigned upper)
 	return true;
 }
 
-bool PEREncoder::encodeUnsigned(unsigned value, unsigned lower, unsigned upper)
+bool PEREncoder::encodeUnsigned(unsigned value, unsigned lower, unsigned upper, const PERWidth& width)
 {
 	if (value < lower || value > upper)
 		return false;
@@ -448,19 +560,17 @@ bool PEREncoder::encodeUnsigned(unsigned value, unsigned lower, unsigned upper)
 	if (lower == upper) // 10.5.4
 		return true;
 
-	unsigned range = (upper - lower) + 1;
-	unsigned nBits = CountBits(range);
+	const PERWidth w = width.orBounds(lower, upper);
+	unsigned nBits = alignedFlag ? w.alignedBits : w.unalignedBits;
 	unsigned adjusted_value = value - lower;
 
-	if (alignedFlag && (range == 0 || range > 255)) { // not 10.5.6 and not 10.5.7.1
-		if (nBits > 16) {                           // not 10.5.7.4
+	if (alignedFlag && w.octetAligned) { // not 10.5.6 and not 10.5.7.1
+		if (nBits == 0) {                           // 10.5.7.4
 			int numBytes = adjusted_value == 0 ? 1 : (((CountBits(adjusted_value + 1))+7)/8);
-			if (!encodeLength(numBytes, 1, (nBits+7)/8))    // 12.2.6
+			if (!encodeLength(numBytes, 1, (w.unalignedBits+7)/8))    // 12.2.6
 				return false;
 			nBits = numBytes*8;
-		} else
-		if (nBits > 8)      // not 10.5.7.2
-			nBits = 16;            // 10.5.7.3
+		}
 		byteAlign();             // 10.7.5.2 - 10.7.5.4
 	}
 
@@ -472,18 +582,27 @@ bool PEREncoder::encodeAnyType(const AbstractData * value)
 {
 	OpenBuf buf;
 	PEREncoder subEncoder(buf);
+	subEncoder.checked = checked;
 
 	if (value != NULL)
 	if (!value->encode(subEncoder))
+	{
+		invalidValue = subEncoder.invalidValue;
 		return false;
+	}
 
+	encodeOpenType(buf);
+	return true;
+}
+
+void PEREncoder::encodeOpenType(OpenBuf& buf)
+{
 	if (buf.size() == 0)				// Make sure extension has at least one
-		subEncoder.encodeSingleBit(false);	// byte in its ANY type encoding.
+		buf.push_back(0);			// byte in its ANY type encoding.
 
 	unsigned nBytes = buf.size();
 	encodeLength(nBytes, 0, INT_MAX);
 	encodeBlock(&*buf.begin(), nBytes);
-	return true;
 }
 
 void PEREncoder::encodeByte(unsigned value)
@@ -497,6 +616,147 @@ void PEREncoder::encodeBlock(const char * bufptr, unsigned nBytes)
 	if (nBytes == 0) 
 		return; 
 	byteAlign();
-	encodedBuffer.insert(encodedBuffer.end(), bufptr, bufptr + nBytes);
+	encodedBuffer.append(bufptr, nBytes);
 }
+
+/////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The encoder used by PERTemplate, which notes where the encodings of the patchable 
+ * fields lie. Each of them ends with a constrained whole number (X.691 10.5), written 
+ * in a number of bits which only depends on its range.
+ */
+class PERTemplate::Encoder : public PEREncoder
+{
+public:
+	Encoder(PERTemplate& tmpl) 
+		: PEREncoder(tmpl.encoding, tmpl.alignedFlag), fields(tmpl.fields) {}
+
+	bool encode(const BOOLEAN& value)
+	{
+		return PEREncoder::encode(value) && record(value, 0, 1, PERWidth(FixedConstraint, 0, 1), true);
+	}
+
+	bool encode(const INTEGER& value)
+	{
+		if (!PEREncoder::encode(value))
+			return false;
+		unsigned range = value.getUpperLimit() - value.getLowerLimit();
+		return record(value, value.getLowerLimit(), range, 
+			value.getPERWidth().orBounds(value.getLowerLimit(), value.getUpperLimit()),
+			value.getConstraintType() >= FixedConstraint && 
+			(unsigned)value.getValue() - value.getLowerLimit() <= range);
+	}
+
+	bool encode(const ENUMERATED& value)
+	{
+		return PEREncoder::encode(value) && 
+			record(value, 0, value.getMaximum(), value.getPERWidth().orBounds(0, value.getMaximum()),
+				value.asInt() <= value.getMaximum());
+	}
+
+private:
+	bool record(const AbstractData& value, int lower, unsigned range, const PERWidth& width, bool fixedSize)
+	{
+		for (std::vector<Field>::iterator i = fields.begin(); i != fields.end(); ++i)
+			if (i->value == &value)
+			{
+				unsigned nBits = aligned() ? width.alignedBits : width.unalignedBits;
+				if (aligned() && width.octetAligned && nBits == 0)
+					fixedSize = false;	// has a length determinant
+				if (!fixedSize)
+					return false;
+				i->lower = lower;
+				i->range = range;
+				i->nBits = nBits;
+				i->bitPosition = getBitPosition() - nBits;
+				i->recorded = true;
+			}
+		return true;
+	}
+
+	std::vector<Field>& fields;
+};
+
+unsigned PERTemplate::addField(const AbstractData& field)
+{
+	Field entry = { &field, 0, 0, 0, 0, false };
+	fields.push_back(entry);
+	return fields.size() - 1;
 }
+
+bool PERTemplate::encode(const AbstractData& value)
+{
+	for (std::vector<Field>::iterator i = fields.begin(); i != fields.end(); ++i)
+		i->recorded = false;
+
+	Encoder encoder(*this);
+	if (!value.encode(encoder))
+		return false;
+
+	for (std::vector<Field>::const_iterator i = fields.begin(); i != fields.end(); ++i)
+		if (!i->recorded)
+			return false;
+	return true;
+}
+
+bool PERTemplate::patch(OpenBuf& buf, unsigned index, int value) const
+{
+	assert(index < fields.size() && buf.size() == encoding.size());
+	const Field& field = fields[index];
+	unsigned adjusted_value = (unsigned)value - field.lower;
+	if (!field.recorded || adjusted_value > field.range)
+		return false;
+
+	for (unsigned i = 0; i < field.nBits; ++i)
+	{
+		std::size_t bit = field.bitPosition + i;
+		char mask = (char)(0x80 >> (bit & 7));
+		if ((adjusted_value >> (field.nBits - 1 - i)) & 1)
+			buf[bit / 8] |= mask;
+		else
+			buf[bit / 8] &= ~mask;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+namespace lite {
+
+bool PERWriter::writeObjectId(const ObjectId& value)
+{
+	// X.691 Section 23
+
+	char octets[5*ObjectId::static_size];
+	unsigned nBytes = OBJECT_IDENTIFIER::encodeArcs(value.data(), value.size(), octets);
+	if (!encoder.encodeLength(nBytes, 0, 255))
+		return false;
+	encoder.encodeBlock(octets, nBytes);
+	return true;
+}
+
+bool PERWriter::writeChoice(int selection, unsigned numChoices, bool extendable)
+{
+	// X.691 Section 22
+
+	if (selection < 0)
+		return false;
+
+	if (extendable) {
+		bool extended = selection >= static_cast<int>(numChoices);
+		encoder.encodeSingleBit(extended);
+		if (extended) {
+			encoder.encodeSmallUnsigned(selection - numChoices);
+			return true;
+		}
+	}
+
+	if (numChoices > 1)
+		return encoder.encodeUnsigned(selection, 0, numChoices-1);
+	return selection == 0;
+}
+
+} // namespace lite
+
+} // namespace ASN1
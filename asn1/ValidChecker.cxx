@@ -95,6 +95,8 @@ bool AbstractData::isStrictlyValid() const
 
 bool INTEGER::isStrictValid() const
 {
+	if (getConstraintType() == Unconstrained)
+		return true;
 	if (getLowerLimit() >= 0)
 	{
 		int v = static_cast<int>(value);
@@ -216,14 +218,14 @@ bool OpenData::isValid() const
 {
 	if (has_data())
 		return get_data().isValid();
-	return has_buf();
+	return has_buf() || text.get() != NULL;
 }
 
 bool OpenData::isStrictlyValid() const
 {
 	if (has_data())
 		return get_data().isStrictlyValid();
-	return has_buf();
+	return has_buf() || text.get() != NULL;
 }
 
 }// namespace ASN1
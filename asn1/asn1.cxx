@@ -36,7 +36,10 @@
 
 
 #include <memory>
+#include <atomic>
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include "asn1.h"
 
 
@@ -107,6 +110,58 @@ int lexicographic_compare_bytes(const char* first1, const char* last1,
 	return (first1 != last1 ? 1 : -1);
 }
 
+inline uint64_t hash_mix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	return h ^ (h >> 33);
+}
+
+inline std::size_t hash_combine(std::size_t seed, uint64_t v)
+{
+	return static_cast<std::size_t>(hash_mix(seed ^ (v + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2))));
+}
+
+inline uint64_t load_word(const unsigned char* p)
+{
+	uint64_t w;
+	memcpy(&w, p, sizeof(w));
+	return w;
+}
+
+inline uint64_t hash_round(uint64_t acc, uint64_t w)
+{
+	acc += w * 0xc2b2ae3d27d4eb4fULL;
+	acc = (acc << 31) | (acc >> 33);
+	return acc * 0x9e3779b185ebca87ULL;
+}
+
+/*
+ * Hashes a run of bytes a word at a time. Long runs go through four independent 
+ * accumulators, which the compiler can keep in vector registers.
+ */
+std::size_t hash_bytes(const void* data, std::size_t n, std::size_t seed)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	uint64_t h = seed + n;
+	if (n >= 32)
+	{
+		uint64_t acc[4] = { h, h + 1, h + 2, h + 3 };
+		for (; n >= 32; p += 32, n -= 32)
+			for (int i = 0; i < 4; ++i)
+				acc[i] = hash_round(acc[i], load_word(p + 8 * i));
+		h = hash_mix(acc[0]) ^ hash_mix(acc[1] + 1) ^ hash_mix(acc[2] + 2) ^ hash_mix(acc[3] + 3);
+	}
+	for (; n >= 8; p += 8, n -= 8)
+		h = hash_round(h, load_word(p));
+	uint64_t tail = 0;
+	for (unsigned shift = 0; n > 0; ++p, --n, shift += 8)
+		tail |= static_cast<uint64_t>(*p) << shift;
+	return static_cast<std::size_t>(hash_mix(h ^ tail));
+}
+
 /////////////////////////////////////////////////////////////////////
 
 
@@ -119,7 +174,13 @@ AbstractData::AbstractData(const void* information)
 
 const Null::InfoType Null::theInfo = { 
     Null::create, 
-    UniversalTagClass << 16 | UniversalNull
+    UniversalTagClass << 16 | UniversalNull,
+    { 0, 1, 2, 2 },
+    &Null::theDescriptor
+};
+
+const TypeDescriptor Null::theDescriptor = {
+    TypeDescriptor::e_null, "NULL", { Unconstrained, 0, 0 }, false, 0, 0, NULL
 };
 
 AbstractData* Null::create(const void* info)
@@ -150,12 +211,23 @@ int Null::do_compare(const AbstractData& other) const
 	return 0;
 }
 
+std::size_t Null::do_hash() const
+{
+	return 0;
+}
+
 
 /////////////////////////////////////////////////////////
 
 const BOOLEAN::InfoType BOOLEAN::theInfo = {
     BOOLEAN::create,
-    UniversalTagClass << 16 | UniversalBoolean 
+    UniversalTagClass << 16 | UniversalBoolean,
+    { 1, 1, 3, 3 },
+    &BOOLEAN::theDescriptor
+};
+
+const TypeDescriptor BOOLEAN::theDescriptor = {
+    TypeDescriptor::e_boolean, "BOOLEAN", { Unconstrained, 0, 0 }, false, 0, 0, NULL
 };
 
 BOOLEAN::BOOLEAN(const void* info)
@@ -202,14 +274,26 @@ int BOOLEAN::do_compare(const AbstractData& data) const
 	return value - that.value;
 }
 
+std::size_t BOOLEAN::do_hash() const
+{
+	return hash_combine(0, value);
+}
+
 ///////////////////////////////////////////////////////////////////////
 
 const INTEGER::InfoType INTEGER::theInfo = {
     &INTEGER::create,
     UniversalTagClass << 16 | UniversalInteger,
+    { 2, 7, 3, 7 },
+    &INTEGER::theDescriptor,
     Unconstrained,
     0,
-    UINT_MAX
+    UINT_MAX,
+    PERWidth(Unconstrained, 0, UINT_MAX)
+};
+
+const TypeDescriptor INTEGER::theDescriptor = {
+    TypeDescriptor::e_integer, "INTEGER", { Unconstrained, 0, UINT_MAX }, false, 0, 0, NULL
 };
 
 INTEGER::INTEGER(const void* info)
@@ -256,6 +340,11 @@ int INTEGER::do_compare(const AbstractData& data) const
 	else	return (int) value - (int) that.value;
 }
 
+std::size_t INTEGER::do_hash() const
+{
+	return hash_combine(0, value);
+}
+
 ///////////////////////////////////////////////////////
 IntegerWithNamedNumber::IntegerWithNamedNumber(const void* info)
 : INTEGER(info)
@@ -323,6 +412,11 @@ int ENUMERATED::do_compare(const AbstractData& other) const
 	return value - that.value;
 }
 
+std::size_t ENUMERATED::do_hash() const
+{
+	return hash_combine(0, value);
+}
+
 AbstractData* ENUMERATED::create(const void* info)
 {
 	return new ENUMERATED(info);
@@ -332,7 +426,13 @@ AbstractData* ENUMERATED::create(const void* info)
 
 const OBJECT_IDENTIFIER::InfoType OBJECT_IDENTIFIER::theInfo = {
     OBJECT_IDENTIFIER::create,
-    UniversalTagClass << 16 | UniversalObjectId
+    UniversalTagClass << 16 | UniversalObjectId,
+    { 1, EncodedSize::Unbounded, 2, EncodedSize::Unbounded },
+    &OBJECT_IDENTIFIER::theDescriptor
+};
+
+const TypeDescriptor OBJECT_IDENTIFIER::theDescriptor = {
+    TypeDescriptor::e_objectId, "OBJECT IDENTIFIER", { Unconstrained, 0, 0 }, false, 0, 0, NULL
 };
 
 OBJECT_IDENTIFIER::OBJECT_IDENTIFIER(const OBJECT_IDENTIFIER & other)
@@ -357,36 +457,47 @@ bool OBJECT_IDENTIFIER::encode(ConstVisitor& visitor) const
 
 bool OBJECT_IDENTIFIER::decodeCommon(const char* strm, unsigned dataLen)
 {
-  unsigned byteOffset=0;
+  // there cannot be more arcs than octets, plus the one the first octet expands into
+  value.resize(dataLen+1);
+  unsigned nArcs = decodeArcs(strm, dataLen, &value[0], value.size());
+  if (nArcs == UINT_MAX) {
+    value.clear();
+    return false;
+  }
+  value.resize(nArcs);
+  return true;
+}
 
-  value.clear();
+void OBJECT_IDENTIFIER::encodeCommon(std::vector<char> & encodecObjectId) const
+{
+  encodecObjectId.resize(value.size() < 2 ? 0 : 5*(value.size()-1));
+  if (!encodecObjectId.empty())
+    encodecObjectId.resize(encodeArcs(&value[0], value.size(), &encodecObjectId[0]));
+}
 
+unsigned OBJECT_IDENTIFIER::decodeArcs(const char* strm, unsigned dataLen, unsigned* arcs, unsigned maxArcs)
+{
   // handle zero length strings correctly
   if (dataLen == 0)
-  {
-      return true;
-  }
-
-  unsigned subId;
-
-  // Avoid reallocations in the while-loop below.
-  value.reserve(dataLen+1);
+    return 0;
 
   // start at the second identifier in the buffer, because we will later
   // expand the first number into the first two IDs
-  value.push_back(0);
-
+  unsigned nArcs = 1;
+  unsigned byteOffset = 0;
   while (dataLen > 0) {
     unsigned byte;
-    subId = 0;
+    unsigned subId = 0;
     do {    /* shift and add in low order 7 bits */
       if (dataLen == 0)
-        return false;
+        return UINT_MAX;
       byte = strm[byteOffset++];
       subId = (subId << 7) + (byte & 0x7f);
       dataLen--;
     } while ((byte & 0x80) != 0);
-    value.push_back(subId);
+    if (nArcs == maxArcs)
+      return UINT_MAX;
+    arcs[nArcs++] = subId;
   }
 
   /*
@@ -395,77 +506,46 @@ bool OBJECT_IDENTIFIER::decodeCommon(const char* strm, unsigned dataLen)
    *  X is the value of the first subidentifier.
    *  Y is the value of the second subidentifier.
    */
-  subId = value[1];
+  unsigned subId = arcs[1];
   if (subId < 40) {
-    value[0] = 0;
-    value[1] = subId;
+    arcs[0] = 0;
+    arcs[1] = subId;
   }
   else if (subId < 80) {
-    value[0] = 1;
-    value[1] = subId-40;
+    arcs[0] = 1;
+    arcs[1] = subId-40;
   }
   else {
-    value[0] = 2;
-    value[1] = subId-80;
+    arcs[0] = 2;
+    arcs[1] = subId-80;
   }
-
-
-  return true;
+  return nArcs;
 }
 
-void OBJECT_IDENTIFIER::encodeCommon(std::vector<char> & encodecObjectId) const
+unsigned OBJECT_IDENTIFIER::encodeArcs(const unsigned* arcs, unsigned nArcs, char* out)
 {
-  unsigned length = value.size();
-  const unsigned* objId = &value[0];
-
-  if (length < 2) {
+  if (nArcs < 2) {
     // Thise case is really illegal, but we have to do SOMETHING
-    encodecObjectId.resize(0);
-    return;
+    return 0;
   }
 
-  unsigned subId = (objId[0] * 40) + objId[1];
-  objId += 2;
-
-  unsigned outputPosition = 0;
-  encodecObjectId.reserve(length);
-  std::insert_iterator<std::vector<char> > insertItr(encodecObjectId, encodecObjectId.begin());
-  while (--length > 0) {
-    if (subId < 128)
-      *insertItr++ = (char)subId;
-    else {
-      unsigned mask = 0x7F; /* handle subid == 0 case */
-      int bits = 0;
-
-      /* testmask *MUST* !!!! be of an unsigned type */
-      unsigned testmask = 0x7F;
-      int      testbits = 0;
-      while (testmask != 0) {
-        if (subId & testmask) {  /* if any bits set */
-          mask = testmask;
-	        bits = testbits;
-	      }
-        testmask <<= 7;
-        testbits += 7;
-      }
-
-      /* mask can't be zero here */
-      while (mask != 0x7F) {
-        /* fix a mask that got truncated above */
-      	if (mask == 0x1E00000)
-	        mask = 0xFE00000;
-
-        *insertItr++ = (char)(((subId & mask) >> bits) | 0x80);
-
-        mask >>= 7;
-        bits -= 7;
-      }
-
-      *insertItr++ = (char)(subId & mask);
-    }
-	if (length >1)
-	  subId = *objId++;
+  unsigned subId = (arcs[0] * 40) + arcs[1];
+  unsigned length = 0;
+  for (unsigned i = 2; ; ++i) {
+    // the groups of 7 bits from the most significant one which is not zero, all
+    // but the last one with the high bit set
+    int shift = 28;
+    while (shift > 0 && (subId >> shift) == 0)
+      shift -= 7;
+    for (; shift > 0; shift -= 7)
+      out[length++] = (char)(((subId >> shift) & 0x7F) | 0x80);
+    out[length++] = (char)(subId & 0x7F);
+
+    if (i == nArcs)
+      break;
+    subId = arcs[i];
   }
+  return length;
 }
 
 
@@ -484,14 +564,26 @@ int OBJECT_IDENTIFIER::do_compare(const AbstractData& other) const
 	return levels() - that.levels();
 }
 
+std::size_t OBJECT_IDENTIFIER::do_hash() const
+{
+	return hash_bytes(value.data(), value.size() * sizeof(unsigned), 0);
+}
+
 ///////////////////////////////////////////////////////////////////////
 
 const BIT_STRING::InfoType BIT_STRING::theInfo = {
     BIT_STRING::create,
     UniversalTagClass << 16 | UniversalBitString,
+    { 1, EncodedSize::Unbounded, 3, EncodedSize::Unbounded },
+    &BIT_STRING::theDescriptor,
     Unconstrained,
     0,
-    UINT_MAX
+    UINT_MAX,
+    PERWidth(Unconstrained, 0, UINT_MAX)
+};
+
+const TypeDescriptor BIT_STRING::theDescriptor = {
+    TypeDescriptor::e_bitString, "BIT STRING", { Unconstrained, 0, UINT_MAX }, false, 0, 0, NULL
 };
 
 
@@ -538,13 +630,25 @@ int BIT_STRING::do_compare(const AbstractData& other) const
 	return totalBits - that.totalBits;
 }
 
+std::size_t BIT_STRING::do_hash() const
+{
+	return hash_bytes(bitData.data(), std::min<std::size_t>(bitData.size(), (totalBits + 7) / 8), totalBits);
+}
+
 ///////////////////////////////////////////////////////////////////////
 const OCTET_STRING::InfoType OCTET_STRING::theInfo = {
     OCTET_STRING::create,
     UniversalTagClass << 16 | UniversalOctetString,
+    { 1, EncodedSize::Unbounded, 2, EncodedSize::Unbounded },
+    &OCTET_STRING::theDescriptor,
     Unconstrained,
     0,
-    UINT_MAX
+    UINT_MAX,
+    PERWidth(Unconstrained, 0, UINT_MAX)
+};
+
+const TypeDescriptor OCTET_STRING::theDescriptor = {
+    TypeDescriptor::e_octetString, "OCTET STRING", { Unconstrained, 0, UINT_MAX }, false, 0, 0, NULL
 };
 
 OCTET_STRING::OCTET_STRING(const void* info)
@@ -593,6 +697,11 @@ int OCTET_STRING::do_compare(const AbstractData& other) const
 	return lexicographic_compare_bytes(&(*begin()), &(*end()), &(*that.begin()), &(*that.end()));
 }
 
+std::size_t OCTET_STRING::do_hash() const
+{
+	return hash_bytes(data(), size(), 0);
+}
+
 ///////////////////////////////////////////////////////////////////////
 ConstrainedString::ConstrainedString(const ConstrainedString& other)
 : ConstrainedObject(other.info_), base_string(other)
@@ -635,6 +744,11 @@ int ConstrainedString::do_compare(const AbstractData& other) const
 	return base_string::compare(that);
 }
 
+std::size_t ConstrainedString::do_hash() const
+{
+	return hash_bytes(data(), size(), 0);
+}
+
 AbstractData* ConstrainedString::create(const void* info)
 {
 	return new ConstrainedString(info);
@@ -683,9 +797,12 @@ static const char GeneralStringSet[]   = "\000\001\002\003\004\005\006\007"
 const NumericString::InfoType NumericString::theInfo = {
     ConstrainedString::create,
     UniversalTagClass << 16 | UniversalNumericString,
+    { 1, EncodedSize::Unbounded, 2, EncodedSize::Unbounded },
+    &NumericString::theDescriptor,
     Unconstrained,
     0, 
     UINT_MAX,
+    PERWidth(Unconstrained, 0, UINT_MAX),
     NumericStringSet,
     11,
     4,
@@ -693,12 +810,19 @@ const NumericString::InfoType NumericString::theInfo = {
     4
 };
 
+const TypeDescriptor NumericString::theDescriptor = {
+    TypeDescriptor::e_string, "NumericString", { Unconstrained, 0, UINT_MAX }, false, 0, 0, NULL
+};
+
 const PrintableString::InfoType PrintableString::theInfo = {
     ConstrainedString::create,
     UniversalTagClass << 16 | UniversalPrintableString,
+    { 1, EncodedSize::Unbounded, 2, EncodedSize::Unbounded },
+    &PrintableString::theDescriptor,
     Unconstrained,
     0, 
     UINT_MAX,
+    PERWidth(Unconstrained, 0, UINT_MAX),
     PrintableStringSet,
     74,
     7,
@@ -706,12 +830,19 @@ const PrintableString::InfoType PrintableString::theInfo = {
     8
 };
 
+const TypeDescriptor PrintableString::theDescriptor = {
+    TypeDescriptor::e_string, "PrintableString", { Unconstrained, 0, UINT_MAX }, false, 0, 0, NULL
+};
+
 const VisibleString::InfoType VisibleString::theInfo = {
     ConstrainedString::create,
     UniversalTagClass << 16 | UniversalVisibleString,
+    { 1, EncodedSize::Unbounded, 2, EncodedSize::Unbounded },
+    &VisibleString::theDescriptor,
     Unconstrained,
     0, 
     UINT_MAX,
+    PERWidth(Unconstrained, 0, UINT_MAX),
     VisibleStringSet,
     95,
     7,
@@ -719,12 +850,19 @@ const VisibleString::InfoType VisibleString::theInfo = {
     8
 };
 
+const TypeDescriptor VisibleString::theDescriptor = {
+    TypeDescriptor::e_string, "VisibleString", { Unconstrained, 0, UINT_MAX }, false, 0, 0, NULL
+};
+
 const IA5String::InfoType IA5String::theInfo = {
     ConstrainedString::create,
     UniversalTagClass << 16 | UniversalIA5String,
+    { 1, EncodedSize::Unbounded, 2, EncodedSize::Unbounded },
+    &IA5String::theDescriptor,
     Unconstrained,
     0, 
     UINT_MAX,
+    PERWidth(Unconstrained, 0, UINT_MAX),
     IA5StringSet,
     128,
     7,
@@ -732,12 +870,19 @@ const IA5String::InfoType IA5String::theInfo = {
     8
 };
 
+const TypeDescriptor IA5String::theDescriptor = {
+    TypeDescriptor::e_string, "IA5String", { Unconstrained, 0, UINT_MAX }, false, 0, 0, NULL
+};
+
 const GeneralString::InfoType GeneralString::theInfo = {
     ConstrainedString::create,
     UniversalTagClass << 16 | UniversalGeneralString,
+    { 1, EncodedSize::Unbounded, 2, EncodedSize::Unbounded },
+    &GeneralString::theDescriptor,
     Unconstrained,
     0, 
     UINT_MAX,
+    PERWidth(Unconstrained, 0, UINT_MAX),
     GeneralStringSet,
     256,
     8,
@@ -745,20 +890,31 @@ const GeneralString::InfoType GeneralString::theInfo = {
     8
 };
 
+const TypeDescriptor GeneralString::theDescriptor = {
+    TypeDescriptor::e_string, "GeneralString", { Unconstrained, 0, UINT_MAX }, false, 0, 0, NULL
+};
+
 ///////////////////////////////////////////////////////////////////////
 
 const BMPString::InfoType BMPString::theInfo = {
     BMPString::create,
     UniversalTagClass << 16 | UniversalBMPString,
+    { 1, EncodedSize::Unbounded, 2, EncodedSize::Unbounded },
+    &BMPString::theDescriptor,
     Unconstrained,
     0, 
     UINT_MAX,
+    PERWidth(Unconstrained, 0, UINT_MAX),
     0,
     0xffff,
     16,
     16
 };
 
+const TypeDescriptor BMPString::theDescriptor = {
+    TypeDescriptor::e_bmpString, "BMPString", { Unconstrained, 0, UINT_MAX }, false, 0, 0, NULL
+};
+
 BMPString::BMPString(const void* info)
 : ConstrainedObject(info) 
 { 
@@ -811,10 +967,21 @@ int BMPString::do_compare(const AbstractData& other) const
 	return base_string::compare(that);
 }
 
+std::size_t BMPString::do_hash() const
+{
+	return hash_bytes(data(), size() * sizeof(wchar_t), 0);
+}
+
 ///////////////////////////////////////////////////////////////////////
 const GeneralizedTime::InfoType GeneralizedTime::theInfo = {
     GeneralizedTime::create,
-    UniversalTagClass << 16 | UniversalGeneralisedTime
+    UniversalTagClass << 16 | UniversalGeneralisedTime,
+    { 1, EncodedSize::Unbounded, 2, EncodedSize::Unbounded },
+    &GeneralizedTime::theDescriptor
+};
+
+const TypeDescriptor GeneralizedTime::theDescriptor = {
+    TypeDescriptor::e_time, "GeneralizedTime", { Unconstrained, 0, 0 }, false, 0, 0, NULL
 };
 
 AbstractData* GeneralizedTime::create(const void* info)
@@ -930,6 +1097,18 @@ int GeneralizedTime::do_compare(const AbstractData& other) const
 	return utc - that.utc;
 }
 
+std::size_t GeneralizedTime::do_hash() const
+{
+	// the same fields as do_compare(), which ignores mindiff
+	std::size_t result = hash_combine(utc, year);
+	result = hash_combine(result, month);
+	result = hash_combine(result, day);
+	result = hash_combine(result, hour);
+	result = hash_combine(result, minute);
+	result = hash_combine(result, second);
+	return hash_combine(result, millisec);
+}
+
 time_t GeneralizedTime::get_time_t()
 {
 	struct tm t;
@@ -1023,6 +1202,12 @@ int CHOICE::do_compare(const AbstractData& other) const
 	return choiceID - that.choiceID;
 }
 
+std::size_t CHOICE::do_hash() const
+{
+	std::size_t result = hash_combine(0, choiceID);
+	return choiceID >= 0 ? hash_combine(result, choice->hash()) : result;
+}
+
 AbstractData* CHOICE::do_clone() const
 {
 	return new CHOICE(*this);
@@ -1134,6 +1319,8 @@ SEQUENCE::SEQUENCE(const SEQUENCE & other)
 	optionMap(other.optionMap),
 	extensionMap(other.extensionMap)
 {	
+	if (other.encodingCache.get())
+		encodingCache.reset(new detail::EncodingCache(*other.encodingCache));
 }
 
 SEQUENCE::~SEQUENCE()
@@ -1151,6 +1338,7 @@ SEQUENCE & SEQUENCE::operator=(const SEQUENCE & other)
 	fields.swap(temp_fields);
 	optionMap.swap(temp_optionalMap);
 	extensionMap.swap(temp_extensionMap);
+	invalidateEncoding();
 
 	return *this;
 }
@@ -1164,6 +1352,7 @@ bool SEQUENCE::hasOptionalField(unsigned opt) const
 
 void SEQUENCE::includeOptionalField(unsigned opt, unsigned pos)
 {
+	invalidateEncoding();
 	if (opt < (unsigned)optionMap.size())
 		optionMap.set(opt);
 	else {
@@ -1179,6 +1368,7 @@ void SEQUENCE::includeOptionalField(unsigned opt, unsigned pos)
 
 void SEQUENCE::removeOptionalField(unsigned opt)
 {
+	invalidateEncoding();
 	if (opt < (unsigned)optionMap.size())
 		optionMap.clear(opt);
 	else {
@@ -1188,8 +1378,16 @@ void SEQUENCE::removeOptionalField(unsigned opt)
 	}
 }
 
+void SEQUENCE::expectField(unsigned pos, AbstractData* aData)
+{
+	if (fields[pos] == NULL)
+		fields[pos] = AbstractData::create(info()->fieldInfos[pos]);
+	static_cast<OpenData*>(fields[pos])->expect(aData);
+}
+
 bool SEQUENCE::decode(Visitor& visitor)
 {
+	invalidateEncoding();
 	return visitor.decode(*this);
 }
 
@@ -1208,6 +1406,54 @@ void SEQUENCE::swap(SEQUENCE& other)
 	fields.swap(other.fields);
 	optionMap.swap(other.optionMap);
 	extensionMap.swap(other.extensionMap);
+	invalidateEncoding();
+	other.invalidateEncoding();
+}
+
+void SEQUENCE::cacheEncoding(bool enable)
+{
+	if (!enable)
+		encodingCache.reset();
+	else if (!encodingCache.get())
+		encodingCache.reset(new detail::EncodingCache);
+}
+
+detail::EncodingCache::EncodingCache(const EncodingCache& other)
+{
+	std::lock_guard<std::mutex> lock(other.mutex);
+	entries = other.entries;
+}
+
+const detail::EncodingCache::Entry* detail::EncodingCache::find(Rule rule, unsigned startBits, bool checked) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (std::list<Entry>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+		if (i->rule == rule && i->startBits == startBits && (i->checked || !checked))
+			return &*i;
+	return NULL;
+}
+
+const detail::EncodingCache::Entry& detail::EncodingCache::store(Entry& entry)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (std::list<Entry>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+		if (i->rule == entry.rule && i->startBits == entry.startBits && (i->checked || !entry.checked))
+			return *i;
+	// an unchecked entry is kept for the threads which may be reading it
+	entries.push_back(Entry());
+	Entry& stored = entries.back();
+	stored.rule = entry.rule;
+	stored.startBits = entry.startBits;
+	stored.endBits = entry.endBits;
+	stored.checked = entry.checked;
+	stored.octets.swap(entry.octets);
+	return stored;
+}
+
+void detail::EncodingCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
 }
 
 int SEQUENCE::do_compare(const AbstractData& other) const
@@ -1215,7 +1461,7 @@ int SEQUENCE::do_compare(const AbstractData& other) const
 	const SEQUENCE& that = *std::static_cast<const SEQUENCE*>(&other);
 	assert(info_ == that.info_);
 
-	int lastOptionalId = -1, result;
+	int lastOptionalId = -1, result = 0;
 	unsigned i;
 	for (i = 0; i < info()->numFields ; ++i)
 	{
@@ -1233,6 +1479,33 @@ int SEQUENCE::do_compare(const AbstractData& other) const
 		if (hasOptionalField(++lastOptionalId) && that.hasOptionalField(lastOptionalId))
 			result = fields[i]->compare(*that.fields[i]);
 		else	result = hasOptionalField(lastOptionalId) - that.hasOptionalField(lastOptionalId);
+
+		if (result != 0) return result;
+	}
+	return result;
+}
+
+std::size_t SEQUENCE::do_hash() const
+{
+	std::size_t result = 0;
+	int lastOptionalId = -1;
+	unsigned i;
+	for (i = 0; i < info()->numFields ; ++i)
+	{
+		int id = info()->ids[i];
+		if (id == mandatory_ || hasOptionalField(id))
+			result = hash_combine(result, fields[i]->hash());
+		else
+			result = hash_combine(result, 0);
+		lastOptionalId = ( id != mandatory_ ? id : lastOptionalId);
+	}
+
+	for (; i < fields.size(); ++i)
+	{
+		if (hasOptionalField(++lastOptionalId))
+			result = hash_combine(result, fields[i]->hash());
+		else
+			result = hash_combine(result, 0);
 	}
 	return result;
 }
@@ -1301,6 +1574,14 @@ int SEQUENCE_OF_Base::do_compare(const AbstractData& other) const
 	return container.size() - that.container.size();	  
 }
 
+std::size_t SEQUENCE_OF_Base::do_hash() const
+{
+	std::size_t result = hash_combine(0, container.size());
+	for (Container::const_iterator it = container.begin(), last = container.end(); it != last; ++it)
+		result = hash_combine(result, (*it)->hash());
+	return result;
+}
+
 void SEQUENCE_OF_Base::insert(iterator position, SEQUENCE_OF_Base::Container::size_type n, const AbstractData& x)	
 {
         SEQUENCE_OF_Base::Container::difference_type dist = std::distance(container.begin(), position);
@@ -1348,13 +1629,22 @@ void SEQUENCE_OF_Base::erase(iterator first, iterator last)
 
 const OpenData::InfoType OpenData::theInfo = {
     OpenData::create,
-    0
+    0,
+    { 1, EncodedSize::Unbounded, 0, EncodedSize::Unbounded },
+    &OpenData::theDescriptor
+};
+
+const TypeDescriptor OpenData::theDescriptor = {
+    TypeDescriptor::e_openType, "ANY", { Unconstrained, 0, 0 }, false, 0, 0, NULL
 };
 
 OpenData::OpenData(const OpenData& that)
 : AbstractData(that)
 , data(that.has_data() ? that.get_data().clone() : NULL)
 , buf(that.has_buf() ? new OpenBuf(that.get_buf()) : NULL )
+, text(that.text.get() ? new std::string(*that.text) : NULL)
+, textRules(that.textRules)
+, expected(false)
 {}
 
 AbstractData* OpenData::create(const void* info)
@@ -1371,11 +1661,18 @@ void OpenData::swap(OpenData& other)
 	OpenBuf* tmpBuf = buf.release();
 	buf.reset(other.buf.release());
 	other.buf.reset(tmpBuf);
+
+	text.swap(other.text);
+	std::swap(textRules, other.textRules);
+	std::swap(expected, other.expected);
 }
 
 bool OpenData::decode(Visitor& visitor)
 {
-	return visitor.decode(*this);
+	// an expected type is only good for one decode
+	bool result = visitor.decode(*this);
+	expected = false;
+	return result;
 }
 
 bool OpenData::encode(ConstVisitor& visitor) const
@@ -1391,11 +1688,24 @@ int OpenData::do_compare(const AbstractData& other) const
 	if (has_buf() && that.has_buf())
 		return lexicographic_compare_bytes(&(*get_buf().begin()), &(*get_buf().end()),
 			&(*that.get_buf().begin()), &(*that.get_buf().end()));
+	if (text.get() && that.text.get() && textRules == that.textRules)
+		return text->compare(*that.text);
 	if (isEmpty() && that.isEmpty())
 		return 0;
 	return has_data() ? 1 : -1;
 }
 
+std::size_t OpenData::do_hash() const
+{
+	if (has_data())
+		return get_data().hash();
+	if (has_buf())
+		return hash_bytes(get_buf().data(), get_buf().size(), 1);
+	if (text.get())
+		return hash_bytes(text->data(), text->size(), 2 + textRules);
+	return 0;
+}
+
 AbstractData* OpenData::do_clone() const 
 {
 	return new OpenData(*this);
@@ -1417,6 +1727,139 @@ AbstractData* TypeConstrainedOpenData::create(const void* info)
 
 /////////////////////////////////////////////////////////
 
+OutputBuffer::OutputBuffer(IoVec* first, IoVec* last)
+: buffer(NULL), cur(NULL), limit(NULL), segStart(NULL)
+, segment(first), lastSegment(last), written(0), overflowFlag(false)
+{
+	if (segment != lastSegment)
+	{
+		cur = segStart = static_cast<char*>(segment->iov_base);
+		limit = cur + segment->iov_len;
+	}
+}
+
+bool OutputBuffer::nextSegment()
+{
+	// skip the exhausted block and any empty one after it
+	while (segment != lastSegment && segment+1 != lastSegment)
+	{
+		written += cur - segStart;
+		++segment;
+		cur = segStart = static_cast<char*>(segment->iov_base);
+		limit = cur + segment->iov_len;
+		if (cur != limit)
+			return true;
+	}
+	overflowFlag = true;
+	written += cur - segStart;
+	segStart = cur; // makes back() return the scratch octet
+	return false;
+}
+
+bool OutputBuffer::append(const char* data, unsigned len)
+{
+	if (buffer)
+	{
+		buffer->insert(buffer->end(), data, data + len);
+		return true;
+	}
+	for (;;)
+	{
+		unsigned n = std::min<unsigned>(len, limit - cur);
+		if (n)
+			memcpy(cur, data, n);
+		cur += n;
+		if ((len -= n) == 0)
+			return true;
+		data += n;
+		if (!nextSegment())
+			return false;
+	}
+}
+
+InputBuffer::InputBuffer(const IoVec* first, const IoVec* last)
+: cur(NULL), limit(NULL), segStart(NULL), segOffset(0), total(0)
+, segment(first), firstSegment(first), lastSegment(last)
+{
+	for (; first != last; ++first)
+		total += first->iov_len;
+	if (segment != lastSegment)
+	{
+		cur = segStart = static_cast<const char*>(segment->iov_base);
+		limit = cur + segment->iov_len;
+		if (cur == limit)
+			nextSegment();
+	}
+}
+
+void InputBuffer::nextSegment()
+{
+	// move to the next block which is not empty, if any
+	while (segment != lastSegment && segment+1 != lastSegment)
+	{
+		segOffset += limit - segStart;
+		++segment;
+		cur = segStart = static_cast<const char*>(segment->iov_base);
+		limit = cur + segment->iov_len;
+		if (cur != limit)
+			return;
+	}
+}
+
+void InputBuffer::seek(std::size_t pos)
+{
+	if (pos > total)
+		pos = total;
+
+	if (pos < segOffset)
+	{
+		// rewind to the first block
+		segment = firstSegment;
+		segOffset = 0;
+		cur = segStart = static_cast<const char*>(segment->iov_base);
+		limit = cur + segment->iov_len;
+	}
+
+	while (pos - segOffset >= static_cast<std::size_t>(limit - segStart) && 
+		   segment != lastSegment && segment+1 != lastSegment)
+	{
+		cur = limit;
+		nextSegment();
+	}
+
+	cur = segStart + (pos - segOffset);
+	if (cur == limit)
+		nextSegment();
+}
+
+unsigned InputBuffer::read(char* buf, unsigned n)
+{
+	if (n > remaining())
+		n = remaining();
+
+	for (unsigned left = n; left; )
+	{
+		unsigned len = std::min<unsigned>(left, limit - cur);
+		memcpy(buf, cur, len);
+		buf += len;
+		left -= len;
+		cur += len;
+		if (cur == limit)
+			nextSegment();
+	}
+	return n;
+}
+
+/////////////////////////////////////////////////////////
+
+unsigned Module::allocateSlot()
+{
+	static std::atomic<unsigned> nextSlot(0);
+	return nextSlot++;
+}
+
+/////////////////////////////////////////////////////////
+
 bool Visitor::decode(SEQUENCE& value) 
 { 
 	VISIT_SEQ_RESULT result = preDecodeExtensionRoots(value);
@@ -1430,6 +1873,8 @@ bool Visitor::decode(SEQUENCE& value)
 	for (i = 0; i < value.info()->numFields; ++i)
 	{
 		int optionalId = value.info()->ids[i];
+		if (env)
+			value.preDecodeField(*env, i);
 		result = decodeExtensionRoot(value, i, optionalId);
 		if (result <= STOP)
 			return result != FAIL;
@@ -1446,6 +1891,8 @@ bool Visitor::decode(SEQUENCE& value)
 
 	for (; i < value.fields.size(); ++i)
 	{
+		if (env)
+			value.preDecodeField(*env, i);
 		result = decodeKnownExtension(value, i, ++lastOptionalId);
 		if (result != CONTINUE )
 			return result != FAIL;
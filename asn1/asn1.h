@@ -42,8 +42,13 @@
 #endif
 
 #include <assert.h>
+#include <string.h>
+#include <limits.h>
 #include <string>
 #include <memory>
+#include <new>
+#include <list>
+#include <mutex>
 #include <time.h>
 #include <boost/iterator.hpp>
 #include "AssocVector.h"
@@ -73,6 +78,148 @@ enum ConstraintType {
 class Visitor; //decode
 class ConstVisitor; //encode
 class AbstractData;
+class CoderEnv;
+
+namespace detail {
+
+constexpr unsigned countBits(unsigned range, unsigned nBits = 0)
+{
+	return range == 0 ? sizeof(unsigned)*8 :
+		nBits < sizeof(unsigned)*8 && range > (1u << nBits) ? countBits(range, nBits+1) : nBits;
+}
+
+constexpr unsigned alignedBits(unsigned range)
+{
+	return (range != 0 && range <= 255) ? countBits(range) : // 10.5.7.1
+		countBits(range) > 16 ? 0 :                          // 10.5.7.4, length and octets
+		countBits(range) > 8 ? 16 : 8;                       // 10.5.7.3, 10.5.7.2
+}
+
+}
+
+/**
+ * How PER encodes a whole number constrained to [lower, upper] (X.691 10.5.7),
+ * which is also how a constrained length is encoded (10.9). It only depends on
+ * the bounds, so it is worked out at compile time and kept in the InfoType of
+ * each constrained type, ENUMERATED and CHOICE; the codecs read it instead of
+ * counting bits. A default constructed PERWidth is not known and makes the
+ * codecs fall back to computing it from the bounds.
+ */
+struct PERWidth
+{
+	constexpr PERWidth()
+		: unalignedBits(0), alignedBits(0), octetAligned(false), known(false) {}
+	constexpr PERWidth(unsigned /* constraint type */, int lower, unsigned upper)
+		: unalignedBits(detail::countBits(upper - lower + 1)),
+		  alignedBits(detail::alignedBits(upper - lower + 1)),
+		  octetAligned(upper - lower + 1 == 0 || upper - lower + 1 > 255),
+		  known(true) {}
+
+	/** This width, or the one worked out from the bounds when it is not known. */
+	PERWidth orBounds(int lower, unsigned upper) const
+	{ return known ? *this : PERWidth(FixedConstraint, lower, upper); }
+
+	unsigned char unalignedBits; ///< bits of the unaligned variant
+	unsigned char alignedBits;   ///< bits of the aligned variant, 0 when octetAligned means length and octets
+	bool octetAligned;           ///< the aligned variant starts at an octet boundary
+	bool known;
+};
+
+/**
+ * The smallest and the largest encodings of the values of a type, in octets, 
+ * as asnparser works them out from the constraints. The largest is Unbounded 
+ * when the type is extensible, recursive or has no upper bound. They size the 
+ * buffers of the encoders and let a decoder turn down an input which is too long 
+ * to be a value of the type.
+ */
+struct EncodedSize
+{
+	enum { Unbounded = UINT_MAX };
+
+	/** The octets to reserve for an encoding of at most maxSize octets. */
+	static std::size_t capacity(unsigned maxSize) 
+	{ return maxSize <= 0x10000 ? maxSize : 256; }
+
+	unsigned minPER, maxPER; ///< aligned PER
+	unsigned minBER, maxBER; ///< BER with definite lengths
+};
+
+/**
+ * A PER visible constraint on a value or on a size, as ConstrainedObject keeps it in
+ * its InfoType, for the codecs to be given without an AbstractData.
+ */
+struct PERConstraint
+{
+	constexpr PERConstraint(unsigned type, int lower, unsigned upper)
+		: type(type), lower(lower), upper(upper), width(type, lower, upper) {}
+	constexpr PERConstraint(unsigned type, int lower, unsigned upper, const PERWidth& width)
+		: type(type), lower(lower), upper(upper), width(width) {}
+
+	bool extendable() const { return type == ExtendableConstraint; }
+
+	unsigned type;
+	int lower;
+	unsigned upper;
+	PERWidth width;
+};
+
+/**
+ * A read-only description of a type, which every InfoType points to. asnparser
+ * writes one for each type it generates an InfoType for, and a table of those of
+ * a module, so that tools such as printers, validators or skippers can walk the
+ * values from tables instead of visitors, and have the names of the fields without
+ * ASN1_HAS_IOSTREAM.
+ */
+struct TypeDescriptor
+{
+	enum Kind {
+		e_null, e_boolean, e_integer, e_enumerated, e_real, e_objectId, e_bitString,
+		e_octetString, e_string, e_bmpString, e_time, e_choice, e_sequence, e_set,
+		e_sequenceOf, e_setOf, e_openType
+	};
+
+	/**
+	 * A component of a SEQUENCE or SET, an alternative of a CHOICE in the order of
+	 * the selection indexes, the element of a SEQUENCE OF or the type of a type
+	 * constrained open type, or a named number of an INTEGER or ENUMERATED.
+	 */
+	struct Field
+	{
+		const char* name; ///< NULL for an element or the type of an open type
+		const void* info; ///< NULL for a named number, or a component removed by asnparser
+		unsigned tag;     ///< as getFieldTag() returns it, or 0 for the tag of info
+		int id;           ///< the optional field id or -1, or the named number
+	};
+
+	unsigned kind;
+	const char* name;         ///< the ASN.1 name of the type
+	PERConstraint constraint; ///< on the value, or on the size of strings and lists
+	bool extendable;          ///< SEQUENCE, SET, CHOICE and ENUMERATED with an extension marker
+	unsigned numRootFields;   ///< the fields in the extension root
+	unsigned numFields;
+	const Field* fields;
+};
+
+/**
+ * The characters a restricted string may have and the bits PER writes each of them in
+ * (X.691 27.5); the tail of the InfoType of a ConstrainedString.
+ */
+struct PERCharSet
+{
+	const char* characters;
+	unsigned size;
+	unsigned canonicalBits;  ///< the bits of a character of the type without a constraint
+	unsigned unalignedBits;
+	unsigned alignedBits;
+};
+
+/** The characters of a BMPString, a range of them; the tail of its InfoType. */
+struct PERBMPCharSet
+{
+	wchar_t firstChar, lastChar;
+	unsigned unalignedBits;
+	unsigned alignedBits;
+};
 
 namespace detail {
 
@@ -168,6 +315,15 @@ class AbstractData
 	 */
 	int compare(const AbstractData& other) const { return do_compare(other); } 
 
+	/**
+	 * Returns a hash code of the value.
+	 *
+	 * Values which compare() equal have the same hash code, so that they can be used as 
+	 * keys of unordered containers with ASN1::Hash. Like compare(), the hash code only 
+	 * depends on the value and not on the constraints or the tags of the type.
+	 */
+	std::size_t hash() const { return do_hash(); }
+
 	/*
 	 * Most operators are defined as member functions rather than friend functions because
 	 * GCC 2.95.x have problem to resolve template operator functions when  any non-template
@@ -188,6 +344,22 @@ class AbstractData
 	 */
 	unsigned getTag() const { return info()->tag; }
 
+	/**
+	 * Returns the smallest and the largest sizes of the PER and BER encodings of the type.
+	 */
+	const EncodedSize& getEncodedSize() const { return info()->encodedSize; }
+
+	/**
+	 * Returns the description of the type, or NULL when its InfoType has none.
+	 */
+	const TypeDescriptor* getDescriptor() const { return info()->descriptor; }
+	/**
+	 * Returns the description of the type of the \c info structure, such as the info of
+	 * a TypeDescriptor::Field, or NULL.
+	 */
+	static const TypeDescriptor* getDescriptor(const void* info)
+	{ return info == NULL ? NULL : static_cast<const InfoType*>(info)->descriptor; }
+
 	virtual bool decode(Visitor& v) = 0;
 	virtual bool encode(ConstVisitor& v) const = 0;
 
@@ -207,6 +379,7 @@ class AbstractData
 
   private:
 	virtual int do_compare(const AbstractData& other) const =0;
+	virtual std::size_t do_hash() const = 0;
 	virtual AbstractData* do_clone() const = 0;
 
   protected:
@@ -219,6 +392,8 @@ class AbstractData
 		  CreateFun create;
 		  unsigned tag; /* the tag is represented using the formula 
 						   (tagClass << 16 | tagNumber) */
+		  EncodedSize encodedSize;
+		  const TypeDescriptor* descriptor;
 	  };
   	  const void* info_;
 
@@ -256,6 +431,16 @@ class AbstractData
 #endif
 };
 
+/**
+ * Hash function object for ASN1::AbstractData values, e.g.
+ * \code
+ *   std::unordered_map<H225::CallIdentifier, Call*, ASN1::Hash> calls;
+ * \endcode
+ */
+struct Hash
+{
+	std::size_t operator()(const AbstractData& value) const { return value.hash(); }
+};
 
 
 
@@ -270,15 +455,21 @@ public:
 	unsigned getConstraintType() const { return info()->type; }
 	int getLowerLimit() const { return info()->lowerLimit; }
 	unsigned getUpperLimit() const { return info()->upperLimit; }
+	const PERWidth& getPERWidth() const { return info()->perWidth; }
+	PERConstraint getPERConstraint() const
+	{ return PERConstraint(info()->type, info()->lowerLimit, info()->upperLimit, info()->perWidth); }
 
 protected:
 	  struct InfoType 
 	  {
 		  CreateFun create;    
 		  unsigned tag;
+		  EncodedSize encodedSize;
+		  const TypeDescriptor* descriptor;
 		  unsigned type;
 		  int lowerLimit;
 		  unsigned upperLimit;
+		  PERWidth perWidth;
 	  };
 	const InfoType* info() const  { return static_cast<const InfoType*>(info_);}
 };
@@ -305,11 +496,13 @@ class Null : public AbstractData , public detail::Allocator<Null>
 	bool operator <= (const Null& ) const { return false; } 
 	bool operator >= (const Null& ) const { return false; } 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 public:
 	virtual bool decode(Visitor&);
@@ -365,11 +558,13 @@ class BOOLEAN : public AbstractData, public detail::Allocator<BOOLEAN>
 	bool operator <= (bool rhs) const { return value <= rhs ; } 
 	bool operator >= (bool rhs) const { return value >= rhs ; } 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 	bool value;
 public:
@@ -460,6 +655,7 @@ public:
     int_type operator / (int_type rhs) { int_type t(getValue()); return t/=rhs;}
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
@@ -468,6 +664,7 @@ public:
 	unsigned value;
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 public:
 	virtual bool decode(Visitor&);
@@ -504,11 +701,15 @@ class IntegerWithNamedNumber : public INTEGER
 	  {
 		  CreateFun create;  
 		  unsigned tag;
+		  EncodedSize encodedSize;
+		  const TypeDescriptor* descriptor;
 		  unsigned type;
 		  int lowerLimit;
 		  unsigned upperLimit;
+		  PERWidth perWidth;
 		  AVN_ONLY(const NameEntry* nameEntries;)
 		  AVN_ONLY(unsigned entryCount;)
+		  AVN_ONLY(const unsigned* nameIndex;) // nameEntries positions in name order, may be NULL
 	  };
 	const InfoType* info() const { return static_cast<const InfoType*>(info_); }
   private:
@@ -518,7 +719,9 @@ public:
 #ifdef ASN1_HAS_IOSTREAM
   public:
 	bool getName(std::string&) const;
+	const char* getName() const;
     bool setFromName(const std::string&);
+    bool setFromName(const char* name, unsigned len);
 #endif
 };
 
@@ -632,6 +835,7 @@ class Constrained_INTEGER : public INTEGER
 	int_type operator / (int_type rhs) const { int_type t(getValue()); return t/=rhs;}
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
@@ -641,9 +845,17 @@ template <ConstraintType contraint, int lower, unsigned upper >
 const typename Constrained_INTEGER<contraint, lower, upper>::InfoType Constrained_INTEGER<contraint, lower, upper>::theInfo = {
     &INTEGER::create,
     2,  
+    { 0, EncodedSize::Unbounded, 0, EncodedSize::Unbounded },
+    &Constrained_INTEGER<contraint, lower, upper>::theDescriptor,
     contraint,
     lower,
-    upper
+    upper,
+    PERWidth(contraint, lower, upper)
+};
+
+template <ConstraintType contraint, int lower, unsigned upper >
+const TypeDescriptor Constrained_INTEGER<contraint, lower, upper>::theDescriptor = {
+    TypeDescriptor::e_integer, "INTEGER", { contraint, lower, upper }, false, 0, 0, NULL
 };
 
 
@@ -665,6 +877,7 @@ class ENUMERATED : public AbstractData, public detail::Allocator<ENUMERATED>
 	bool isStrictlyValid() const { return value <= getMaximum();}
 	
 	int getMaximum() const { return info()->maxEnumValue; }
+	const PERWidth& getPERWidth() const { return info()->perWidth; }
 	
 	bool operator == (int rhs) const { return value == rhs; } 
 	bool operator != (int rhs) const { return value != rhs; } 
@@ -680,15 +893,20 @@ class ENUMERATED : public AbstractData, public detail::Allocator<ENUMERATED>
 	{
 		CreateFun create;    
 		unsigned tag;
+		EncodedSize encodedSize;
+		const TypeDescriptor* descriptor;
 		bool extendableFlag;
 		unsigned maxEnumValue;
+		PERWidth perWidth;
 		AVN_ONLY(const char** names;)
+		AVN_ONLY(const unsigned* nameIndex;) // names positions in name order, may be NULL
 	};
 	
 	void swap(ENUMERATED& other) { std::swap(value, other.value); }
 	int value;
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 	const InfoType* info() const { return static_cast<const InfoType*>(info_); } 
 public:
@@ -699,6 +917,7 @@ public:
   public:
 	const char* getName() const;
 	bool setFromName(const std::string&);
+	bool setFromName(const char* name, unsigned len);
 	const char** names() { return info()->names; }
 #endif
 };
@@ -747,6 +966,18 @@ class OBJECT_IDENTIFIER : public AbstractData, public detail::Allocator<OBJECT_I
 	bool decodeCommon(const char* data, unsigned dataLen);
 	void encodeCommon(std::vector<char> & eObjId) const;
 
+	/**
+	 * Writes the contents octets of the object identifier of the \c nArcs arcs at
+	 * \c arcs to \c out, at most 5 octets per arc, and returns how many there are.
+	 */
+	static unsigned encodeArcs(const unsigned* arcs, unsigned nArcs, char* out);
+	/**
+	 * Reads the arcs of the contents octets at \c data into \c arcs, which has room
+	 * for \c maxArcs of them, and returns how many there are, or UINT_MAX if the
+	 * octets are malformed or there are too many arcs.
+	 */
+	static unsigned decodeArcs(const char* data, unsigned dataLen, unsigned* arcs, unsigned maxArcs);
+
 	// comparison operators
 	bool operator == (const OBJECT_IDENTIFIER& rhs) const { return value == rhs.value; } 
 	bool operator != (const OBJECT_IDENTIFIER& rhs) const { return value != rhs.value; } 
@@ -756,11 +987,13 @@ class OBJECT_IDENTIFIER : public AbstractData, public detail::Allocator<OBJECT_I
 	bool operator >= (const OBJECT_IDENTIFIER& rhs) const { return value >= rhs.value; } 
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData * do_clone() const;
 	std::vector<unsigned> value;
 public:
@@ -842,11 +1075,14 @@ class BIT_STRING : public ConstrainedObject, public detail::Allocator<BIT_STRING
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
   private:
 	friend class BERDecoder;
 	friend class PERDecoder;
 	friend class AVNDecoder;
+	friend class JERDecoder;
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 
 	unsigned totalBits;
@@ -894,6 +1130,7 @@ public:
 
 	Constrained_BIT_STRING * clone() const { return static_cast<Constrained_BIT_STRING*>(BIT_STRING::clone());}
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
@@ -903,9 +1140,19 @@ template <class Constraint>
 const typename Constrained_BIT_STRING<Constraint>::InfoType Constrained_BIT_STRING<Constraint>::theInfo = {
     BIT_STRING::create,
     3,
+    { 0, EncodedSize::Unbounded, 0, EncodedSize::Unbounded },
+    &Constrained_BIT_STRING<Constraint>::theDescriptor,
     Constraint::constraint_type,
     Constraint::lower_bound,
-    Constraint::upper_bound
+    Constraint::upper_bound,
+    PERWidth(Constraint::constraint_type, Constraint::lower_bound, Constraint::upper_bound)
+};
+
+template <class Constraint>
+const TypeDescriptor Constrained_BIT_STRING<Constraint>::theDescriptor = {
+    TypeDescriptor::e_bitString, "BIT STRING",
+    { Constraint::constraint_type, Constraint::lower_bound, Constraint::upper_bound },
+    false, 0, 0, NULL
 };
 
 
@@ -965,11 +1212,13 @@ class OCTET_STRING : public ConstrainedObject, public std::vector<char>, public
     operator std::string () const { return std::string(begin(), end()); }
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 public:
 	virtual bool decode(Visitor&);
@@ -1015,6 +1264,7 @@ class Constrained_OCTET_STRING : public OCTET_STRING
 	void swap(Constrained_OCTET_STRING& other) { OCTET_STRING::swap(other); }
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
@@ -1024,9 +1274,19 @@ template <class Constraint>
 const typename Constrained_OCTET_STRING<Constraint>::InfoType Constrained_OCTET_STRING<Constraint>::theInfo = {
     OCTET_STRING::create,
     4,
+    { 0, EncodedSize::Unbounded, 0, EncodedSize::Unbounded },
+    &Constrained_OCTET_STRING<Constraint>::theDescriptor,
     Constraint::constraint_type,
     Constraint::lower_bound,
-    Constraint::upper_bound
+    Constraint::upper_bound,
+    PERWidth(Constraint::constraint_type, Constraint::lower_bound, Constraint::upper_bound)
+};
+
+template <class Constraint>
+const TypeDescriptor Constrained_OCTET_STRING<Constraint>::theDescriptor = {
+    TypeDescriptor::e_octetString, "OCTET STRING",
+    { Constraint::constraint_type, Constraint::lower_bound, Constraint::upper_bound },
+    false, 0, 0, NULL
 };
 
 
@@ -1075,7 +1335,7 @@ public:
    	bool isValid() const;
 	bool isStrictlyValid() const;
 	size_type find_first_invalid() const { 
-		return info()->characterSetSize ? find_first_not_of(info()->characterSet) : std::string::npos;
+		return info()->characterSetSize ? find_first_not_of(info()->characterSet, 0, info()->characterSetSize) : std::string::npos;
 	}
 
 #ifdef ASN1_HAS_IOSTREAM
@@ -1087,10 +1347,17 @@ public:
 	unsigned getCharacterSetSize() const { return info()->characterSetSize; }
 	unsigned getCanonicalSetBits() const { return info()->canonicalSetBits; }
 	unsigned getNumBits(bool align) const { return align ? info()->charSetAlignedBits : info()->charSetUnalignedBits; }
+	PERCharSet getPERCharSet() const
+	{
+		PERCharSet charSet = { info()->characterSet, info()->characterSetSize, info()->canonicalSetBits,
+			info()->charSetUnalignedBits, info()->charSetAlignedBits };
+		return charSet;
+	}
 
 	static AbstractData* create(const void*);
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 public:
 	virtual bool decode(Visitor&);
@@ -1105,9 +1372,12 @@ public:
 	{
 		CreateFun create;    
 		unsigned tag;
+		EncodedSize encodedSize;
+		const TypeDescriptor* descriptor;
 		unsigned type;
 		int lowerLimit;
 		unsigned upperLimit;
+		PERWidth perWidth;
 		const char* characterSet;
 		unsigned characterSetSize;
 		unsigned canonicalSetBits;
@@ -1135,6 +1405,7 @@ public:
 	void swap(NumericString& other) { base_string::swap(other); }
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 };
@@ -1155,6 +1426,7 @@ public:
 	static AbstractData* create();
 	void swap(PrintableString& other) { base_string::swap(other); }
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 };
@@ -1176,6 +1448,7 @@ public:
 	void swap(VisibleString& other) { base_string::swap(other); }
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 };
@@ -1197,6 +1470,7 @@ public:
 	void swap(IA5String& other) { base_string::swap(other); }
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 };
@@ -1218,6 +1492,7 @@ public:
 	void swap(GeneralString& other) { base_string::swap(other); }
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 };
@@ -1234,9 +1509,12 @@ class BMPString : public ConstrainedObject, public std::wstring
 	{
 	   CreateFun create;    
 	   unsigned tag;
+	   EncodedSize encodedSize;
+	   const TypeDescriptor* descriptor;
 	   unsigned type;
 	   int lowerLimit;
 	   unsigned upperLimit;
+	   PERWidth perWidth;
 	   wchar_t firstChar, lastChar;
 	   unsigned charSetUnalignedBits;
 	   unsigned charSetAlignedBits;
@@ -1295,8 +1573,15 @@ class BMPString : public ConstrainedObject, public std::wstring
 	unsigned getNumBits(bool align) const { 
         return align ? info()->charSetAlignedBits : info()->charSetUnalignedBits; 
     }
+	PERBMPCharSet getPERCharSet() const
+	{
+		PERBMPCharSet charSet = { info()->firstChar, info()->lastChar,
+			info()->charSetUnalignedBits, info()->charSetAlignedBits };
+		return charSet;
+	}
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 	size_type first_illegal_at() const;
@@ -1306,6 +1591,7 @@ class BMPString : public ConstrainedObject, public std::wstring
 	const InfoType* info() const { return static_cast<const InfoType*>(info_);}
 
 	int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData * do_clone() const;
 public:
 	virtual bool decode(Visitor&);
@@ -1370,11 +1656,13 @@ public:
 	bool isStrictlyValid() const;
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
 private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 
 	int year, month, day, hour, minute, second, millisec, mindiff;
@@ -1437,6 +1725,7 @@ class CHOICE : public AbstractData, public detail::Allocator<CHOICE>
      * Returns the number of alternatives in the extension root.
      */
 	unsigned getNumChoices() const { return info()->numChoices; } 
+	const PERWidth& getPERWidth() const { return info()->perWidth; }
 	bool extendable() const { return info()->extendableFlag; }
 	unsigned getSelectionTag() const {
         assert(choiceID >= 0);
@@ -1462,15 +1751,20 @@ class CHOICE : public AbstractData, public detail::Allocator<CHOICE>
 	{
 		CreateFun create;    
 		unsigned tag;
+		EncodedSize encodedSize;
+		const TypeDescriptor* descriptor;
 		bool extendableFlag;
 		const void** selectionInfos;
 		unsigned numChoices;
+		PERWidth perWidth; // of the choice index in the extension root
 		unsigned totalChoices;
 		unsigned* tags;
 		AVN_ONLY(const char** names;)
+		AVN_ONLY(const unsigned* nameIndex;) // names positions in name order, may be NULL
 	};
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const;
 	bool createSelection();
 	const InfoType* info() const { return static_cast<const InfoType*>(info_);}
@@ -1486,14 +1780,65 @@ public:
 #ifdef ASN1_HAS_IOSTREAM
   public:
 	const char* getSelectionName() const { assert(choiceID < static_cast<int>(info()->totalChoices)); return info()->names[choiceID]; }
+	/**
+	 * Returns the index of the alternative named by the \c len characters at \c name,
+	 * or -1 if there is no such alternative.
+	 */
+	int findSelection(const char* name, unsigned len) const;
 	friend class AVNDecoder;
+	friend class JERDecoder;
 #endif
 };
 
 class PEREncoder;
 class PERDecoder;
+class BEREncoder;
+
+namespace detail {
+
+/**
+ * The encodings of a SEQUENCE kept by the BER and PER encoders. A PER encoding depends 
+ * on where it starts within an octet, so it is kept along with the number of unused 
+ * bits in the last octet before it and in its own last octet. A BER encoding is kept 
+ * without its identifier and length octets, which depend on the tag it is encoded with.
+ *
+ * Several threads may encode the same value, e.g. through \c CoderEnv::encodeBatch(),
+ * so the entries are looked up and added under a lock. An entry is never changed once
+ * added, and the list keeps it in place, so it can be read without the lock.
+ */
+struct EncodingCache
+{
+	enum Rule { ber, per_aligned, per_unaligned };
+
+	struct Entry
+	{
+		Rule rule;
+		unsigned short startBits;
+		unsigned short endBits;
+		bool checked;	// the constraints were checked while encoding
+		std::vector<char> octets;
+	};
+
+	EncodingCache() {}
+	EncodingCache(const EncodingCache& other);
+
+	const Entry* find(Rule rule, unsigned startBits, bool checked) const;
+	/**
+	 * Adds \c entry, taking its octets, unless another thread has added one which
+	 * does for it in the meantime.
+	 *
+	 * @return The entry kept.
+	 */
+	const Entry& store(Entry& entry);
+	void clear();
 
+private:
+	EncodingCache& operator=(const EncodingCache&);
+	std::list<Entry> entries;
+	mutable std::mutex mutex;
+};
 
+} // namespace detail
 
 /** Class for ASN Sequence type.
 */
@@ -1517,6 +1862,7 @@ public:
      */
 	AbstractData* getField(unsigned pos) { 
         	assert(pos < fields.size());
+		invalidateEncoding();
 	        return fields[pos]; 
 	}
 	const AbstractData* getField(unsigned pos) const { 
@@ -1541,6 +1887,30 @@ public:
             return static_cast<const AbstractData::InfoType*>(info()->fieldInfos[pos])->tag; // IMPLICIT Tag
     }
 	bool extendable() const { return info()->extendableFlag; }
+
+	/**
+	 * Keeps the BER and PER encodings of this value, so that encoding it again splices 
+	 * them into the output instead of walking its components. This is meant for parts 
+	 * of a message which are sent unchanged over and over, such as an EndpointType or a 
+	 * capability table.
+	 *
+	 * The encodings are dropped whenever the value may change: through the generated 
+	 * set_, ref_ and omit_ functions, getField(), assignment, swap() and decoding. A 
+	 * component changed through a reference kept from before the last encoding is not 
+	 * noticed. A value which keeps its encodings may be encoded from several threads at 
+	 * once, but not changed while it is.
+	 */
+	void cacheEncoding(bool enable = true);
+	bool isEncodingCached() const { return encodingCache.get() != NULL; }
+	const detail::EncodingCache* getEncodingCache() const { return encodingCache.get(); }
+	/**
+	 * Drops the encodings kept by cacheEncoding().
+	 */
+	void invalidateEncoding() { 
+		if (encodingCache.get()) 
+			encodingCache->clear(); 
+	}
+
     /**
      * Makes an OPTIONAL field present.
      *
@@ -1566,6 +1936,19 @@ public:
 
 	SEQUENCE(const void* info);			   
 
+	/**
+	 * Called by the decoders before the component at \c pos is decoded, when the 
+	 * components before it have been. A SEQUENCE with a table constrained open type 
+	 * looks up here the type of that component from the key decoded before it, and 
+	 * passes it to expectField(), so that the value is decoded in place.
+	 */
+	virtual void preDecodeField(const CoderEnv& env, unsigned pos) {}
+	/**
+	 * Makes the open type at \c pos decode its value as \c aData, or keep its 
+	 * encoding if \c aData is NULL.
+	 */
+	void expectField(unsigned pos, AbstractData* aData);
+
 	enum
 	{
 		mandatory_ = -1
@@ -1596,6 +1979,7 @@ public:
 	FieldVector fields;
 	BitMap optionMap;
 	BitMap extensionMap;
+	mutable std::unique_ptr<detail::EncodingCache> encodingCache;
 
 	static const unsigned defaultTag;
 
@@ -1603,6 +1987,8 @@ public:
 	{
 		CreateFun create;    
 		unsigned tag;
+		EncodedSize encodedSize;
+		const TypeDescriptor* descriptor;
 		bool extendableFlag;
 		const void** fieldInfos;
 		int* ids;
@@ -1612,14 +1998,17 @@ public:
 		const char* nonOptionalExtensions;    
 		const unsigned* tags;
 		AVN_ONLY(const char** names;)
+		AVN_ONLY(const unsigned* nameIndex;) // names positions in name order, may be NULL
 	};
   private:
 	friend class Visitor;
 	friend class ConstVisitor;
 	friend class PEREncoder;
 	friend class PERDecoder;
+	friend class BEREncoder;
 
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 
 	const InfoType* info() const { return static_cast<const InfoType*>(info_);}
@@ -1630,6 +2019,11 @@ public:
 #ifdef ASN1_HAS_IOSTREAM
   public:
 	const char* getFieldName(int i) const { return info()->names[i]; }
+	/**
+	 * Returns the position of the component named by the \c len characters at \c name,
+	 * or -1 if there is no such component.
+	 */
+	int findField(const char* name, unsigned len) const;
 #endif
 
 };
@@ -1704,14 +2098,18 @@ class SEQUENCE_OF_Base : public ConstrainedObject, public detail::Allocator<SEQU
 	{
 		CreateFun create;    
 		unsigned tag;
+		EncodedSize encodedSize;
+		const TypeDescriptor* descriptor;
 		unsigned type;
 		int lowerLimit;
 		unsigned upperLimit;
+		PERWidth perWidth;
 		const void* elementInfo;
 	};
 
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 
    	struct create_from0
 	{
@@ -2057,6 +2455,8 @@ class SEQUENCE_OF : public SEQUENCE_OF_Base
 	void reverse() { std::reverse(container.begin(), container.end());}
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
+	static const TypeDescriptor::Field fieldDescriptors[1];
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
@@ -2098,12 +2498,27 @@ template <class T, class Constraint>
 const typename SEQUENCE_OF<T, Constraint>::InfoType SEQUENCE_OF<T, Constraint>::theInfo = {
     SEQUENCE_OF_Base::create,
     0x10,
+    { 0, EncodedSize::Unbounded, 0, EncodedSize::Unbounded },
+    &SEQUENCE_OF<T, Constraint>::theDescriptor,
     Constraint::constraint_type,
     Constraint::lower_bound,
     Constraint::upper_bound,
+    PERWidth(Constraint::constraint_type, Constraint::lower_bound, Constraint::upper_bound),
     &T::theInfo
 };
 
+template <class T, class Constraint>
+const TypeDescriptor::Field SEQUENCE_OF<T, Constraint>::fieldDescriptors[1] = {
+    { NULL, &T::theInfo, 0, -1 }
+};
+
+template <class T, class Constraint>
+const TypeDescriptor SEQUENCE_OF<T, Constraint>::theDescriptor = {
+    TypeDescriptor::e_sequenceOf, "SEQUENCE OF",
+    { Constraint::constraint_type, Constraint::lower_bound, Constraint::upper_bound },
+    false, 1, 1, SEQUENCE_OF<T, Constraint>::fieldDescriptors
+};
+
 template <class T, class Constraint>
 inline typename SEQUENCE_OF<T, Constraint>::iterator operator + 
 		(typename SEQUENCE_OF<T, Constraint>::difference_type i,
@@ -2167,6 +2582,7 @@ public:
 	SET_OF<T, Constraint>* clone() const { return static_cast<SET_OF<T, Constraint>*>(Inherited::clone()); }
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
@@ -2176,44 +2592,226 @@ template <class T, class Constraint>
 const typename SET_OF<T, Constraint>::InfoType SET_OF<T, Constraint>::theInfo = {
     SEQUENCE_OF_Base::create,
     0x11,
+    { 0, EncodedSize::Unbounded, 0, EncodedSize::Unbounded },
+    &SET_OF<T, Constraint>::theDescriptor,
     Constraint::constraint_type,
     Constraint::lower_bound,
     Constraint::upper_bound,
+    PERWidth(Constraint::constraint_type, Constraint::lower_bound, Constraint::upper_bound),
     &T::theInfo
 };
 
+template <class T, class Constraint>
+const TypeDescriptor SET_OF<T, Constraint>::theDescriptor = {
+    TypeDescriptor::e_setOf, "SET OF",
+    { Constraint::constraint_type, Constraint::lower_bound, Constraint::upper_bound },
+    false, 1, 1, SEQUENCE_OF<T, Constraint>::fieldDescriptors
+};
+
 
 typedef std::vector<char> OpenBuf;
 
+/**
+ * A block of memory laid out like the POSIX \c struct iovec, so that an array of them 
+ * can be passed to \c writev() or \c readv() as is.
+ */
+struct IoVec
+{
+	void* iov_base;
+	std::size_t iov_len;
+};
+
+/**
+ * The destination of an encoder.
+ *
+ * The encoded octets are either appended to a growable buffer, written into a caller 
+ * supplied range [first, last), or written into a chain of caller supplied blocks, each 
+ * of them being filled before moving to the next one. Writing into caller supplied 
+ * memory never allocates; once the memory is exhausted, writing fails and overflow() 
+ * returns true.
+ */
+class OutputBuffer
+{
+public:
+	OutputBuffer()
+		: buffer(NULL), cur(NULL), limit(NULL), segStart(NULL)
+		, segment(NULL), lastSegment(NULL), written(0), overflowFlag(false) {}
+	OutputBuffer(OpenBuf& buf)
+		: buffer(&buf), cur(NULL), limit(NULL), segStart(NULL)
+		, segment(NULL), lastSegment(NULL), written(0), overflowFlag(false) {}
+	OutputBuffer(char* first, char* last)
+		: buffer(NULL), cur(first), limit(last), segStart(first)
+		, segment(NULL), lastSegment(NULL), written(0), overflowFlag(false) {}
+	OutputBuffer(IoVec* first, IoVec* last);
+
+	bool push_back(char c) {
+		if (buffer)
+			buffer->push_back(c);
+		else if (cur != limit)
+			*cur++ = c;
+		else 
+			return nextSegment() && push_back(c);
+		return true;
+	}
+	bool append(const char* data, unsigned len);
+
+	/**
+	 * Returns the last octet written. After an overflow, the returned octet is a 
+	 * scratch one, so that callers may keep on or-ing bits into it.
+	 */
+	char& back() { 
+		if (buffer) 
+			return buffer->back(); 
+		return cur != segStart ? cur[-1] : scratch; 
+	}
+
+	bool overflow() const { return overflowFlag; }
+	/**
+	 * Returns the position following the last octet written into caller supplied memory.
+	 */
+	char* getPosition() const { return cur; }
+	/**
+	 * Returns the block being filled when writing into a chain of blocks.
+	 */
+	IoVec* getSegment() const { return segment; }
+	/**
+	 * Returns the number of octets written; for a growable buffer, that is its size.
+	 */
+	std::size_t size() const { 
+		return buffer ? buffer->size() : written + (cur - segStart); 
+	}
+private:
+	bool nextSegment();
+
+	OpenBuf* buffer;
+	char* cur;
+	char* limit;
+	char* segStart;
+	IoVec* segment;
+	IoVec* lastSegment;
+	std::size_t written; // octets in the blocks before the current one
+	bool overflowFlag;
+	char scratch;
+};
+
+/**
+ * The source of a decoder.
+ *
+ * The encoded octets are read either from a contiguous range [first, last) or from a
+ * chain of blocks [first, last), such as the two parts of a message wrapping around the 
+ * end of a ring buffer, without gathering them first. Positions are counted in octets 
+ * from the start of the input, whichever block they fall in.
+ */
+class InputBuffer
+{
+public:
+	InputBuffer(const char* first, const char* last)
+		: cur(first), limit(last), segStart(first), segOffset(0), total(last - first)
+		, segment(NULL), firstSegment(NULL), lastSegment(NULL) {}
+	InputBuffer(const IoVec* first, const IoVec* last);
+
+	bool atEnd() const { return cur == limit; }
+	/**
+	 * Returns the octet at the current position without consuming it.
+	 */
+	unsigned char peek() const { assert(!atEnd()); return *cur; }
+	unsigned char get() { 
+		assert(!atEnd()); 
+		unsigned char c = *cur++; 
+		if (cur == limit) 
+			nextSegment(); 
+		return c; 
+	}
+	void skip(std::size_t n) { 
+		if (n < static_cast<std::size_t>(limit - cur)) 
+			cur += n; 
+		else 
+			seek(position() + n); 
+	}
+	/**
+	 * Copies up to \c n octets into \c buf and returns the number of octets copied.
+	 */
+	unsigned read(char* buf, unsigned n);
+	/**
+	 * Returns the \c n octets at the current position and moves past them, when they 
+	 * lie in one block; otherwise returns NULL and does not move.
+	 */
+	const char* take(std::size_t n) {
+		if (n > static_cast<std::size_t>(limit - cur))
+			return NULL;
+		const char* data = cur;
+		skip(n);
+		return data;
+	}
+
+	std::size_t position() const { return segOffset + (cur - segStart); }
+	/**
+	 * Moves to the position \c pos, or to the end of the input if it is beyond.
+	 */
+	void seek(std::size_t pos);
+	std::size_t size() const { return total; }
+	std::size_t remaining() const { return total - position(); }
+private:
+	void nextSegment();
+
+	const char* cur;
+	const char* limit;
+	const char* segStart;
+	std::size_t segOffset; // position of segStart
+	std::size_t total;
+	const IoVec* segment;
+	const IoVec* firstSegment;
+	const IoVec* lastSegment;
+};
+
 class OpenData : public AbstractData, public detail::Allocator<OpenData>
 {
 public:
 	typedef AbstractData data_type;
 
-    OpenData(const void* info = &theInfo) : AbstractData(info){}
+    OpenData(const void* info = &theInfo) : AbstractData(info), textRules(avnText), expected(false) {}
 	OpenData(AbstractData* pData,const void* info = &theInfo) 
-        : AbstractData(info), data(pData) {}
+        : AbstractData(info), data(pData), textRules(avnText), expected(false) {}
 	OpenData(OpenBuf* pBuf) 
-        :  AbstractData(&theInfo),buf(pBuf) {}
+        :  AbstractData(&theInfo),buf(pBuf), textRules(avnText), expected(false) {}
 
 	OpenData(const AbstractData& aData, const void* info = &theInfo)
-        : AbstractData(info), data(aData.clone()) {}
+        : AbstractData(info), data(aData.clone()), textRules(avnText), expected(false) {}
 	OpenData(const OpenBuf& aBuf) 
-        :  AbstractData(&theInfo),buf( new OpenBuf(aBuf)) {}
+        :  AbstractData(&theInfo),buf( new OpenBuf(aBuf)), textRules(avnText), expected(false) {}
 
 	OpenData(const OpenData& that);
 
 	OpenData& operator = (const OpenData& that) { OpenData tmp(that);	swap(tmp); return *this; }
 	OpenData& operator = (const AbstractData& aData) { data.reset(aData.clone()); return *this; }
-	OpenData& operator = (const OpenBuf& aBuf) { buf.reset(new OpenBuf(aBuf)); return *this; }
+	OpenData& operator = (const OpenBuf& aBuf) { buf.reset(new OpenBuf(aBuf)); text.reset(); return *this; }
 
 	void grab(AbstractData* aData) { data.reset(aData); } 
-	void grab(OpenBuf* aBuf) { buf.reset(aBuf); }
+	void grab(OpenBuf* aBuf) { buf.reset(aBuf); text.reset(); }
 
 	AbstractData* release_data() { return data.release();} 
 	OpenBuf* release_buf() { return buf.release();}
 
-	bool isEmpty() const { return !has_data() && !has_buf(); }
+	/**
+	 * Makes the next decode read the value as \c aData in place, rather than keep 
+	 * its encoding for a redecode.
+	 */
+	void expect(AbstractData* aData) { data.reset(aData); buf.reset(); text.reset(); expected = (aData != NULL); }
+	bool is_expected() const { return expected; }
+
+	/**
+	 * The rules of the text kept by the JER and AVN decoders for a value whose type 
+	 * they do not know. The text is not an encoding: only the encoder of the same 
+	 * rules writes it back, and only the decoder of the same rules redecodes it.
+	 */
+	enum TextRules { avnText, jerText };
+	void set_text(TextRules rules, const char* first, const char* last)
+	{ text.reset(new std::string(first, last)); textRules = rules; buf.reset(); }
+	bool has_text() const { return text.get() != NULL; }
+	bool has_text(TextRules rules) const { return has_text() && textRules == rules; }
+	const std::string& get_text() const { return *text; }
+
+	bool isEmpty() const { return !has_data() && !has_buf() && !has_text(); }
 	bool has_data() const {return data.get() != NULL ;}
 	bool has_buf() const { return buf.get() != NULL; }
 
@@ -2237,14 +2835,19 @@ public:
 	bool operator >= (const OpenData& rhs) const { return do_compare(rhs) >= 0; }
     
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 
   protected:
 	std::unique_ptr<AbstractData> data;
 	std::unique_ptr<OpenBuf> buf;
+	std::unique_ptr<std::string> text;
+	TextRules textRules;
+	bool expected;
   private:
 	virtual int do_compare(const AbstractData& other) const;
+	virtual std::size_t do_hash() const;
 	virtual AbstractData* do_clone() const ;
 public:
 	virtual bool encode(ConstVisitor&) const;
@@ -2265,6 +2868,8 @@ protected:
 	{
 		CreateFun create;    
 		unsigned tag;
+		EncodedSize encodedSize;
+		const TypeDescriptor* descriptor;
 		const void* typeInfo;
 	};
 };
@@ -2300,6 +2905,8 @@ public:
 	void swap(Constrained_OpenData<T>& other) { OpenData::swap(other); }
 
 	static const InfoType theInfo;
+	static const TypeDescriptor theDescriptor;
+	static const TypeDescriptor::Field fieldDescriptors[1];
 	static bool equal_type(const ASN1::AbstractData& type)
 	{return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo);}
 private:
@@ -2310,9 +2917,21 @@ template <class T>
 const typename Constrained_OpenData<T>::InfoType Constrained_OpenData<T>::theInfo = {
     TypeConstrainedOpenData::create,
     0,
+    { 0, EncodedSize::Unbounded, 0, EncodedSize::Unbounded },
+    &Constrained_OpenData<T>::theDescriptor,
     &T::theInfo
 };
 
+template <class T>
+const TypeDescriptor::Field Constrained_OpenData<T>::fieldDescriptors[1] = {
+    { NULL, &T::theInfo, 0, -1 }
+};
+
+template <class T>
+const TypeDescriptor Constrained_OpenData<T>::theDescriptor = {
+    TypeDescriptor::e_openType, "ANY", { Unconstrained, 0, 0 }, false, 1, 1, fieldDescriptors
+};
+
 
 //////////////////////////////////////////////////////////////////////////////
 class CoderEnv;
@@ -2339,7 +2958,7 @@ public:
 	virtual bool decode(GeneralizedTime& value) = 0;
 	virtual bool decode(SEQUENCE& value) ;
 
-	CoderEnv* get_env() { return env;}
+	const CoderEnv* get_env() const { return env;}
 
 	enum VISIT_SEQ_RESULT
 	{
@@ -2349,7 +2968,7 @@ public:
 		CONTINUE
 	};
 protected:
-	Visitor(CoderEnv* coder) : env(coder) {}
+	Visitor(const CoderEnv* coder) : env(coder) {}
 
 private:
 
@@ -2409,7 +3028,7 @@ private:
      * @return true if the operation is successful.
      */
 	virtual bool decodeUnknownExtensions(SEQUENCE& value) { return true;}
-   	CoderEnv* env;
+   	const CoderEnv* env;
 };
 
 class ConstVisitor
@@ -2443,15 +3062,81 @@ private:
 
 /////////////////////////////////////////////////////////////////////////////////////
 
-class BEREncoder : public ConstVisitor
+namespace detail {
+
+/**
+ * The checked mode of the BER and PER encoders, in which the constraints of each value 
+ * are enforced while it is encoded, instead of walking the value with \c isValid() 
+ * before encoding it. The encoding then fails on the first invalid value and 
+ * \c getInvalidValue() tells which one it was; \c trace_invalid() can explain why.
+ */
+class ConstraintCheck
+{
+public:
+	void setChecked(bool flag) { checked = flag; }
+	bool isChecked() const { return checked; }
+	const AbstractData* getInvalidValue() const { return invalidValue; }
+
+protected:
+	ConstraintCheck() : checked(false), invalidValue(NULL) {}
+
+	template <class T>
+	bool valid(const T& value) 
+	{ 
+		return !checked || value.isValid() || reject(value);
+	}
+	// the components are checked as they are encoded, not along with their container
+	bool valid(const CHOICE& value)
+	{
+		return !checked || (value.currentSelection() >= 0 && 
+			(static_cast<unsigned>(value.currentSelection()) < value.getNumChoices() || value.extendable())) ||
+			reject(value);
+	}
+	bool valid(const SEQUENCE_OF_Base& value)
+	{
+		return !checked || (value.size() >= static_cast<unsigned>(value.getLowerLimit()) &&
+			(value.size() <= value.getUpperLimit() || value.extendable())) || 
+			reject(value);
+	}
+	bool valid(const OpenData& value)
+	{
+		return !checked || value.has_data() || value.has_buf() || reject(value);
+	}
+	bool reject(const AbstractData& value) { invalidValue = &value; return false; }
+
+	bool checked;
+	const AbstractData* invalidValue;
+};
+
+} // namespace detail
+
+class BEREncoder : public ConstVisitor, private detail::ConstraintCheck
 {
 public:
-	BEREncoder(OpenBuf& buf)
+	/**
+	 * Encodes into \c buf, which is cleared and made room for \c capacity octets, 
+	 * such as EncodedSize::capacity() of the type to encode.
+	 */
+	BEREncoder(OpenBuf& buf, std::size_t capacity = 256)
 		: encodedBuffer(buf), tag(0xffffffff)
 	{ 
-		encodedBuffer.clear(); 
-		encodedBuffer.reserve(256);
+		buf.clear(); 
+		buf.reserve(capacity);
 	}
+	BEREncoder(char* first, char* last)
+		: encodedBuffer(first, last), tag(0xffffffff) {}
+	BEREncoder(IoVec* first, IoVec* last)
+		: encodedBuffer(first, last), tag(0xffffffff) {}
+
+	using ConstraintCheck::setChecked;
+	using ConstraintCheck::isChecked;
+	using ConstraintCheck::getInvalidValue;
+
+	/**
+	 * Returns the destination of the encoding, to find out how much of it is used 
+	 * or whether it has been exhausted.
+	 */
+	const OutputBuffer& getOutput() const { return encodedBuffer; }
 
 	void encodeTag(unsigned tagNumber, char ident);
 	void encodeContentsLength(unsigned len);
@@ -2470,6 +3155,7 @@ public:
 	virtual bool encode(const SEQUENCE_OF_Base& value);
 	virtual bool encode(const OpenData& value);
 	virtual bool encode(const GeneralizedTime& value);
+	virtual bool encode(const SEQUENCE& value);
 private:
 	virtual bool preEncodeExtensionRoots(const SEQUENCE& value) ;
 	virtual bool encodeExtensionRoot(const SEQUENCE& value, int index);
@@ -2477,7 +3163,7 @@ private:
 
 	void encodeByte(unsigned value);
 	void encodeBlock(const char * bufptr, unsigned nBytes);
-	OpenBuf& encodedBuffer;
+	OutputBuffer encodedBuffer;
 	unsigned tag;
 };
 
@@ -2494,16 +3180,23 @@ public:
 	 *  decode the open type based on the information objects which are inserted to the CoderEnv
 	 *  objects.
 	 */
-	BERDecoder(const char* first, const char* last, CoderEnv* coder = NULL) 
+	BERDecoder(const char* first, const char* last, const CoderEnv* coder = NULL) 
+		: Visitor(coder)
+        , input(first, last) 
+        , dontCheckTag(0)
+        {}
+	/**
+	 * Constructs a decoder reading the encoded BER stream from the chain of blocks [first, last).
+	 */
+	BERDecoder(const IoVec* first, const IoVec* last, const CoderEnv* coder = NULL) 
 		: Visitor(coder)
-        , beginPosition(first)
-		, endPosition(last) 
+        , input(first, last) 
         , dontCheckTag(0)
         {}
 
-	typedef const char* memento_type;
-	memento_type get_memento() const { return beginPosition; }
-	void rollback(memento_type memento) { beginPosition = memento;}
+	typedef std::size_t memento_type;
+	memento_type get_memento() const { return input.position(); }
+	void rollback(memento_type memento) { input.seek(memento);}
 	bool decodeChoicePreamle(CHOICE& value, memento_type& nextPostion);
 
 	bool decodeTag(unsigned& tag, bool & primitive);
@@ -2537,24 +3230,51 @@ private:
 	bool atEnd();
 	unsigned char decodeByte();
 	unsigned decodeBlock(char * bufptr, unsigned nBytes);
+	bool decodeOpenType(OpenData& value);
 
-	const char* beginPosition;
-	const char* endPosition;
-	std::vector<const char*> endSEQUENCEPositions; 
+	InputBuffer input;
+	std::vector<std::size_t> endSEQUENCEPositions; 
 	int dontCheckTag;
 };
 
-class PEREncoder : public ConstVisitor
+namespace lite {
+class PERWriter;
+class PERReader;
+}
+
+class PEREncoder : public ConstVisitor, private detail::ConstraintCheck
 {
 public:
-	PEREncoder(OpenBuf& buf, bool isAligned = true) 
+	/**
+	 * Encodes into \c buf, which is cleared and made room for \c capacity octets, 
+	 * such as EncodedSize::capacity() of the type to encode.
+	 */
+	PEREncoder(OpenBuf& buf, bool isAligned = true, std::size_t capacity = 256) 
 		: encodedBuffer(buf)
 		, bitOffset (8)
 		, alignedFlag(isAligned)
     { 
-        encodedBuffer.clear(); 
-        encodedBuffer.reserve(256);
+        buf.clear(); 
+        buf.reserve(capacity);
     }
+	PEREncoder(char* first, char* last, bool isAligned = true) 
+		: encodedBuffer(first, last)
+		, bitOffset (8)
+		, alignedFlag(isAligned) {}
+	PEREncoder(IoVec* first, IoVec* last, bool isAligned = true) 
+		: encodedBuffer(first, last)
+		, bitOffset (8)
+		, alignedFlag(isAligned) {}
+
+	using ConstraintCheck::setChecked;
+	using ConstraintCheck::isChecked;
+	using ConstraintCheck::getInvalidValue;
+
+	/**
+	 * Returns the destination of the encoding, to find out how much of it is used 
+	 * or whether it has been exhausted.
+	 */
+	const OutputBuffer& getOutput() const { return encodedBuffer; }
 
 
 	/**
@@ -2575,30 +3295,113 @@ public:
 	virtual bool encode(const OpenData& value);
 	virtual bool encode(const GeneralizedTime& value);
 	virtual bool encode(const SEQUENCE_OF_Base& value);
+	virtual bool encode(const SEQUENCE& value);
 private:
 	virtual bool preEncodeExtensionRoots(const SEQUENCE& value) ;
 	virtual bool encodeExtensionRoot(const SEQUENCE& value, int index);
 	virtual bool preEncodeExtensions(const SEQUENCE& value) ;
 	virtual bool encodeKnownExtension(const SEQUENCE& value, int index);
 
-	void encodeBitMap(const std::vector<char>& bitData, unsigned nBits);
+	friend class lite::PERWriter;
+
+	void encodeBitMap(const char* bitData, unsigned nBits);
 	void encodeMultiBit(unsigned value, unsigned nBits);
-	bool encodeConstrainedLength(const ConstrainedObject & obj, unsigned length) ;
-	bool encodeConstraint(const ConstrainedObject & obj, unsigned value) ;
+	bool encodeConstrainedLength(const PERConstraint& constraint, unsigned length) ;
+	bool encodeConstraint(const PERConstraint& constraint, unsigned value) ;
 	void encodeSingleBit(bool value);
 	void encodeSmallUnsigned(unsigned value);
-	bool encodeLength(unsigned len, unsigned lower, unsigned upper);
-	bool encodeUnsigned(unsigned value, unsigned lower, unsigned upper);
+	bool encodeLength(unsigned len, unsigned lower, unsigned upper, const PERWidth& width = PERWidth());
+	bool encodeUnsigned(unsigned value, unsigned lower, unsigned upper, const PERWidth& width = PERWidth());
 	bool encodeAnyType(const AbstractData*);
-
+	void encodeOpenType(OpenBuf& buf);
+
+	// the encodings of the types without the objects holding them, shared with lite::PERWriter
+	bool encodeInteger(int value, const PERConstraint& constraint);
+	bool encodeEnumerated(int value, int maximum, bool extendable, const PERWidth& width);
+	bool encodeBits(const char* bitData, unsigned nBits, const PERConstraint& constraint);
+	bool encodeOctets(const char* data, unsigned nBytes, const PERConstraint& constraint);
+	bool encodeChars(const char* str, unsigned len, const PERConstraint& constraint, const PERCharSet& charSet);
+	bool encodeBMPChars(const wchar_t* str, unsigned len, const PERConstraint& constraint, const PERBMPCharSet& charSet);
+protected:
+	/**
+	 * Returns the number of bits written so far.
+	 */
+	std::size_t getBitPosition() const { return encodedBuffer.size() * 8 - (bitOffset & 7); }
+private:
 	void byteAlign();
 	void encodeByte(unsigned value);
 	void encodeBlock(const char * bufptr, unsigned nBytes);
-	OpenBuf& encodedBuffer;
+	OutputBuffer encodedBuffer;
 	unsigned short bitOffset;
 	bool alignedFlag;
 };
 
+/**
+ * A PER encoding made once, whose fixed size fields are then patched to produce other 
+ * encodings of the same message without running the encoder again, e.g.
+ * \code
+ *   PERTemplate keepAlive;
+ *   unsigned seqNum = keepAlive.addField(rrq.get_requestSeqNum());
+ *   keepAlive.encode(rrq);
+ *   ...
+ *   OpenBuf msg(keepAlive.getEncoding());
+ *   keepAlive.patch(msg, seqNum, nextSeqNum++);
+ * \endcode
+ *
+ * The fields which can be patched are BOOLEANs, and INTEGERs and ENUMERATEDs with a 
+ * fixed range whose encoding has no length determinant, i.e. whose range is no wider 
+ * than 64K in the aligned variant. The values patched in must be within the range, or 
+ * within the root of an extensible type; the template is not reused otherwise. Fields 
+ * inside an open type, or inside a SEQUENCE keeping its encodings, cannot be patched.
+ */
+class PERTemplate
+{
+public:
+	PERTemplate(bool isAligned = true) : alignedFlag(isAligned) {}
+
+	/**
+	 * Marks \c field, a component of the value to be encoded, as patchable.
+	 *
+	 * @return The index of the field to pass to patch().
+	 */
+	unsigned addField(const AbstractData& field);
+
+	/**
+	 * Encodes \c value and records where the encoding of each patchable field lies.
+	 *
+	 * @return false if \c value cannot be encoded, or if a patchable field is not part 
+	 *   of it or has no fixed size encoding.
+	 */
+	bool encode(const AbstractData& value);
+
+	const OpenBuf& getEncoding() const { return encoding; }
+
+	/**
+	 * Overwrites the encoding of the field numbered \c index in \c buf, a copy of 
+	 * getEncoding(), with the encoding of \c value.
+	 *
+	 * @return false if \c value is out of the range of the field.
+	 */
+	bool patch(OpenBuf& buf, unsigned index, int value) const;
+
+private:
+	class Encoder;
+
+	struct Field
+	{
+		const AbstractData* value;
+		int lower;
+		unsigned range;    // the patched value minus lower may not exceed range
+		std::size_t bitPosition;
+		unsigned nBits;
+		bool recorded;
+	};
+
+	std::vector<Field> fields;
+	OpenBuf encoding;
+	bool alignedFlag;
+};
+
 class PERDecoder  : public Visitor
 {
 public:
@@ -2615,28 +3418,36 @@ public:
 	 *
 	 * @warning The unaligned PER has never been fully tested in current version.
 	 */
-	PERDecoder(const char* first, const char* last, CoderEnv* coder = NULL, bool isAligned = true) 
+	PERDecoder(const char* first, const char* last, const CoderEnv* coder = NULL, bool isAligned = true) 
 		: Visitor(coder)
-        , beginPosition(first)
-		, endPosition(last)
+        , input(first, last)
 		, bitOffset (8)
 		, alignedFlag(isAligned){}
-
-	struct memento_type
-	{
-		memento_type(const char* bytePos=0, unsigned bitPos=0) 
+	/**
+	 * Constructs a decoder reading the encoded PER stream from the chain of blocks [first, last).
+	 */
+	PERDecoder(const IoVec* first, const IoVec* last, const CoderEnv* coder = NULL, bool isAligned = true) 
+		: Visitor(coder)
+        , input(first, last)
+		, bitOffset (8)
+		, alignedFlag(isAligned){}
+
+	enum { npos = ~0u };
+
+	struct memento_type
+	{
+		memento_type(std::size_t bytePos=npos, unsigned bitPos=0) 
 			: bytePosition(bytePos), bitPosition(bitPos){}
-		const char* bytePosition;
+		std::size_t bytePosition;
 		unsigned bitPosition;
 	};
 
-	memento_type get_memento() const { return memento_type(beginPosition,bitOffset); }
+	memento_type get_memento() const { return memento_type(input.position(),bitOffset); }
 	void rollback(memento_type memento)
 	{ 
-		if (memento.bytePosition != 0)
+		if (memento.bytePosition != npos)
 		{
-			beginPosition = (memento.bytePosition > endPosition ?
-                             endPosition : memento.bytePosition);
+			input.seek(memento.bytePosition);
 			bitOffset   = memento.bitPosition;
 		}
 	}
@@ -2644,11 +3455,15 @@ public:
 	bool aligned() const { return alignedFlag; }
 
 	bool decodeChoicePreamle(CHOICE& value, memento_type& nextPostion);
-	const char* getPosition() const { return beginPosition; }
-	const char* getNextPosition() const { return beginPosition + (bitOffset != 8 ? 1 : 0); }
-	void setPosition(const char* newPos);
+	/**
+	 * Returns the position of the current octet, counted from the start of the input.
+	 */
+	std::size_t getPosition() const { return input.position(); }
+	std::size_t getNextPosition() const { return input.position() + (bitOffset != 8 ? 1 : 0); }
+	void setPosition(std::size_t newPos);
 	int decodeConstrainedLength(ConstrainedObject & obj, unsigned & length);
-	int decodeLength(unsigned lower, unsigned upper, unsigned & len);
+	int decodeConstrainedLength(const PERConstraint& constraint, unsigned & length);
+	int decodeLength(unsigned lower, unsigned upper, unsigned & len, const PERWidth& width = PERWidth());
 
 	virtual VISIT_SEQ_RESULT preDecodeExtensionRoots(SEQUENCE& value);
 	virtual VISIT_SEQ_RESULT decodeExtensionRoot(SEQUENCE& value, int index, int optional_id);
@@ -2679,25 +3494,544 @@ private:
 	bool decodeSingleBit();
 	bool decodeMultiBit(unsigned nBits, unsigned& value);
 	bool decodeSmallUnsigned(unsigned & value);
-	int decodeUnsigned(unsigned lower, unsigned upper, unsigned & value);
+	int decodeUnsigned(unsigned lower, unsigned upper, unsigned & value, const PERWidth& width = PERWidth());
 
 	unsigned decodeBlock(char * bufptr, unsigned nBytes);
 
-	bool decodeBitMap(std::vector<char>& bitData, unsigned nBit);
+	bool decodeBitMap(char* bitData, unsigned nBit);
+	bool decodeOpenType(OpenData& value);
+
+	// the decodings of the types without the objects holding them, shared with 
+	// lite::PERReader; the lengths of the strings have been read and checked
+	friend class lite::PERReader;
 
-	const char* beginPosition;
-	const char* endPosition;
+	bool decodeInteger(unsigned& value, const PERConstraint& constraint);
+	bool decodeEnumerated(unsigned& value, int maximum, bool extendable, const PERWidth& width);
+	bool decodeBits(char* bitData, unsigned nBits);
+	bool decodeOctets(char* data, unsigned nBytes);
+	bool decodeChars(char* str, unsigned len, const PERConstraint& constraint, const PERCharSet& charSet);
+	bool decodeBMPChars(wchar_t* str, unsigned len, const PERConstraint& constraint, const PERBMPCharSet& charSet);
+
+	InputBuffer input;
 	unsigned short bitOffset;
 	bool alignedFlag;
 };
 
+/**
+ * The "lite" bindings: plain structs for the types of a module, generated by 
+ * asnparser -l alongside the classes, and the PER codec they are written with.
+ *
+ * A lite value is an aggregate with no virtual functions and, as far as the 
+ * constraints allow, no allocations: a string whose size is bounded is kept in an 
+ * Array inline, an OPTIONAL component is a bit of the \c present set of its SEQUENCE 
+ * and a CHOICE is a tagged union. Each SEQUENCE and CHOICE is a struct with the 
+ * free functions
+ * \code
+ *   bool encode_per(ASN1::lite::PERWriter& out, const T& value);
+ *   bool decode_per(ASN1::lite::PERReader& in, T& value);
+ *   bool to_lite(const Module::T& value, T& lite);
+ *   void from_lite(const T& lite, Module::T& value);
+ * \endcode
+ * The last two convert from and to the classes, for the code which needs the 
+ * Visitors or the other encoding rules. to_lite() fails if the value does not fit, 
+ * e.g. a string longer than the Array it is kept in. The other types are typedefs, 
+ * which are only written as the components of a struct.
+ *
+ * A lite value should be value initialized, as in \c T value = T(); before its 
+ * components are assigned.
+ */
+namespace lite {
+
+struct Null {};
+inline bool operator==(const Null&, const Null&) { return true; }
+
+/** At most N elements, kept inline. */
+template <class T, unsigned N>
+struct Array
+{
+	typedef T value_type;
+	typedef T* iterator;
+	typedef const T* const_iterator;
+	enum { static_size = N };
+
+	unsigned size() const { return length; }
+	static unsigned max_size() { return N; }
+	bool empty() const { return length == 0; }
+	void resize(unsigned n) { assert(n <= N); length = n; }
+	void clear() { length = 0; }
+	template <class Itr>
+	void assign(Itr first, Itr last) 
+	{ 
+		for (length = 0; first != last; ++first) {
+			assert(length < N);
+			elements[length++] = *first;
+		}
+	}
+
+	T* data() { return elements; }
+	const T* data() const { return elements; }
+	T& operator[](unsigned i) { return elements[i]; }
+	const T& operator[](unsigned i) const { return elements[i]; }
+	iterator begin() { return elements; }
+	iterator end() { return elements + length; }
+	const_iterator begin() const { return elements; }
+	const_iterator end() const { return elements + length; }
+
+	bool operator==(const Array& rhs) const 
+	{ return length == rhs.length && std::equal(begin(), end(), rhs.begin()); }
+	bool operator!=(const Array& rhs) const { return !(*this == rhs); }
+
+	unsigned length;
+	T elements[N];
+};
+
+/** 
+ * A BIT STRING of at most N bits, kept inline, the first one in the most 
+ * significant bit of the first octet.
+ */
+template <unsigned N>
+struct BitArray
+{
+	unsigned size() const { return nBits; }
+	static unsigned max_size() { return N; }
+	void resize(unsigned n) 
+	{ 
+		assert(n <= N);
+		for (unsigned i = nBits; i < n; ++i)
+			set(i, false);
+		nBits = n;
+	}
+
+	bool test(unsigned bit) const { return (octets[bit >> 3] & (0x80 >> (bit & 7))) != 0; }
+	void set(unsigned bit, bool value = true)
+	{ 
+		if (value)
+			octets[bit >> 3] |= (char)(0x80 >> (bit & 7));
+		else
+			octets[bit >> 3] &= (char)~(0x80 >> (bit & 7));
+	}
+
+	char* data() { return octets; }
+	const char* data() const { return octets; }
+
+	bool operator==(const BitArray& rhs) const 
+	{ 
+		for (unsigned i = 0; i < nBits; ++i)
+			if (test(i) != rhs.test(i))
+				return false;
+		return nBits == rhs.nBits;
+	}
+	bool operator!=(const BitArray& rhs) const { return !(*this == rhs); }
+
+	unsigned nBits;
+	char octets[N ? (N+7)/8 : 1];
+};
+
+/** A BIT STRING without a bound small enough for a BitArray. */
+class BitVector
+{
+public:
+	BitVector() : nBits(0) {}
+
+	unsigned size() const { return nBits; }
+	static unsigned max_size() { return UINT_MAX; }
+	void resize(unsigned n) 
+	{
+		octets.resize((n+7)/8);
+		for (unsigned i = nBits; i < n && (i & 7); ++i)
+			set(i, false);
+		nBits = n;
+	}
+
+	bool test(unsigned bit) const { return (octets[bit >> 3] & (0x80 >> (bit & 7))) != 0; }
+	void set(unsigned bit, bool value = true)
+	{ 
+		if (value)
+			octets[bit >> 3] |= (char)(0x80 >> (bit & 7));
+		else
+			octets[bit >> 3] &= (char)~(0x80 >> (bit & 7));
+	}
+
+	char* data() { return octets.empty() ? NULL : &octets[0]; }
+	const char* data() const { return octets.empty() ? NULL : &octets[0]; }
+
+	bool operator==(const BitVector& rhs) const 
+	{ 
+		for (unsigned i = 0; i < nBits; ++i)
+			if (test(i) != rhs.test(i))
+				return false;
+		return nBits == rhs.nBits;
+	}
+	bool operator!=(const BitVector& rhs) const { return !(*this == rhs); }
+
+private:
+	unsigned nBits;
+	std::vector<char> octets;
+};
+
+/** An OBJECT IDENTIFIER, of at most 16 arcs. */
+typedef Array<unsigned, 16> ObjectId;
+
+/** 
+ * Switches the alternative a lite CHOICE holds in its union; the previous one
+ * has been destroyed.
+ */
+template <class T>
+inline T& construct(T& alternative) { return *new (&alternative) T(); }
+template <class T>
+inline T& construct(T& alternative, const T& value) { return *new (&alternative) T(value); }
+template <class T>
+inline void destroy(T& alternative) { alternative.~T(); }
+
+/**
+ * Writes lite values in PER, with the encodings of PEREncoder. The generated 
+ * encode_per() functions pass each component the constraints of its type.
+ */
+class PERWriter
+{
+public:
+	PERWriter(OpenBuf& buf, bool isAligned = true, std::size_t capacity = 256) 
+		: encoder(buf, isAligned, capacity) {}
+	PERWriter(char* first, char* last, bool isAligned = true) 
+		: encoder(first, last, isAligned) {}
+	PERWriter(IoVec* first, IoVec* last, bool isAligned = true) 
+		: encoder(first, last, isAligned) {}
+
+	const OutputBuffer& getOutput() const { return encoder.getOutput(); }
+	bool aligned() const { return encoder.aligned(); }
+
+	bool writeBit(bool value) { encoder.encodeSingleBit(value); return true; }
+	bool writeInteger(int value, const PERConstraint& constraint) 
+	{ return encoder.encodeInteger(value, constraint); }
+	bool writeEnumerated(int value, int maximum, bool extendable)
+	{ return encoder.encodeEnumerated(value, maximum, extendable, PERWidth()); }
+	bool writeObjectId(const ObjectId& value);
+
+	template <class Octets>
+	bool writeOctets(const Octets& value, const PERConstraint& size)
+	{ return encoder.encodeOctets(value.size() ? &value[0] : NULL, value.size(), size); }
+	template <class Bits>
+	bool writeBits(const Bits& value, const PERConstraint& size)
+	{ return encoder.encodeBits(value.data(), value.size(), size); }
+	template <class Chars>
+	bool writeChars(const Chars& value, const PERConstraint& size, const PERCharSet& charSet)
+	{ return encoder.encodeChars(value.data(), value.size(), size, charSet); }
+	template <class Chars>
+	bool writeChars(const Chars& value, const PERConstraint& size, const PERBMPCharSet& charSet)
+	{ return encoder.encodeBMPChars(value.data(), value.size(), size, charSet); }
+
+	/** Writes the number of components of a SEQUENCE OF. */
+	bool writeCount(unsigned n, const PERConstraint& size) 
+	{ return encoder.encodeConstrainedLength(size, n); }
+	/** 
+	 * Writes the index of the alternative of a CHOICE with \c numChoices root 
+	 * alternatives; an extension addition is then written with writeOpen().
+	 */
+	bool writeChoice(int selection, unsigned numChoices, bool extendable);
+	/** Writes the number of extension additions of a SEQUENCE, before their bits. */
+	bool writeExtensionCount(unsigned n) { encoder.encodeSmallUnsigned(n-1); return true; }
+	/** Writes what \c encode writes to a PERWriter of its own as an open type. */
+	template <class Encode>
+	bool writeOpen(Encode encode)
+	{
+		OpenBuf buf;
+		PERWriter writer(buf, aligned());
+		if (!encode(writer))
+			return false;
+		encoder.encodeOpenType(buf);
+		return true;
+	}
+
+private:
+	PEREncoder encoder;
+};
+
+/**
+ * Reads lite values in PER, with the decodings of PERDecoder, and with the same 
+ * limits on the sizes of strings and of SEQUENCE OFs.
+ */
+class PERReader
+{
+public:
+	PERReader(const char* first, const char* last, bool isAligned = true) 
+		: decoder(first, last, NULL, isAligned) {}
+	PERReader(const IoVec* first, const IoVec* last, bool isAligned = true) 
+		: decoder(first, last, NULL, isAligned) {}
+
+	bool aligned() const { return decoder.aligned(); }
+	std::size_t getPosition() const { return decoder.getPosition(); }
+
+	bool readBit(bool& value);
+	bool readInteger(int& value, const PERConstraint& constraint)
+	{ 
+		unsigned v;
+		if (!decoder.decodeInteger(v, constraint))
+			return false;
+		value = v;
+		return true;
+	}
+	bool readInteger(unsigned& value, const PERConstraint& constraint)
+	{ return decoder.decodeInteger(value, constraint); }
+	template <class E>
+	bool readEnumerated(E& value, int maximum, bool extendable)
+	{
+		unsigned v;
+		if (!decoder.decodeEnumerated(v, maximum, extendable, PERWidth()))
+			return false;
+		value = static_cast<E>(v);
+		return true;
+	}
+	bool readObjectId(ObjectId& value);
+
+	template <class Octets>
+	bool readOctets(Octets& value, const PERConstraint& size)
+	{
+		unsigned n;
+		if (!readLength(n, size, value.max_size()))
+			return false;
+		value.resize(n);
+		return n == 0 || decoder.decodeOctets(&value[0], n);
+	}
+	template <class Bits>
+	bool readBits(Bits& value, const PERConstraint& size)
+	{
+		unsigned n;
+		if (!readLength(n, size, value.max_size()))
+			return false;
+		value.resize(n);
+		return n == 0 || decoder.decodeBits(value.data(), n);
+	}
+	template <class Chars>
+	bool readChars(Chars& value, const PERConstraint& size, const PERCharSet& charSet)
+	{
+		unsigned n;
+		if (!readLength(n, size, value.max_size()))
+			return false;
+		value.resize(n);
+		return n == 0 || decoder.decodeChars(&value[0], n, size, charSet);
+	}
+	template <class Chars>
+	bool readChars(Chars& value, const PERConstraint& size, const PERBMPCharSet& charSet)
+	{
+		unsigned n;
+		if (!readLength(n, size, value.max_size()))
+			return false;
+		value.resize(n);
+		return n == 0 || decoder.decodeBMPChars(&value[0], n, size, charSet);
+	}
+
+	bool readCount(unsigned& n, const PERConstraint& size);
+	/** 
+	 * Reads the index of the alternative of a CHOICE. That of an extension addition is 
+	 * \c numChoices or more, and its value is then read with readOpen() or skipOpen().
+	 */
+	bool readChoice(unsigned& selection, unsigned numChoices, bool extendable);
+	bool readExtensionCount(unsigned& n);
+	/** Reads an open type with \c decode, and goes on after it whatever \c decode read. */
+	template <class Decode>
+	bool readOpen(Decode decode)
+	{
+		std::size_t next;
+		if (!beginOpen(next))
+			return false;
+		bool ok = decode(*this);
+		decoder.setPosition(next);
+		return ok;
+	}
+	bool skipOpen();
+
+private:
+	bool readLength(unsigned& n, const PERConstraint& size, std::size_t maxSize);
+	bool beginOpen(std::size_t& next);
+
+	PERDecoder decoder;
+};
+
+inline bool to_lite(const BOOLEAN& value, bool& lite) { lite = value; return true; }
+inline void from_lite(bool lite, BOOLEAN& value) { value = lite; }
+
+inline bool to_lite(const ASN1::Null&, Null&) { return true; }
+inline void from_lite(const Null&, ASN1::Null&) {}
+
+inline bool to_lite(const INTEGER& value, int& lite) { lite = value.getValue(); return true; }
+inline bool to_lite(const INTEGER& value, unsigned& lite) { lite = value.getValue(); return true; }
+inline void from_lite(int lite, INTEGER& value) { value = lite; }
+inline void from_lite(unsigned lite, INTEGER& value) { value = static_cast<INTEGER::int_type>(lite); }
+
+template <class E>
+inline bool to_lite(const ENUMERATED& value, E& lite) { lite = static_cast<E>(value.asInt()); return true; }
+template <class E>
+inline void from_lite(E lite, ENUMERATED& value) { value.setFromInt(lite); }
+
+inline bool to_lite(const OBJECT_IDENTIFIER& value, ObjectId& lite)
+{
+	if (value.levels() > lite.max_size())
+		return false;
+	lite.resize(value.levels());
+	for (unsigned i = 0; i < lite.size(); ++i)
+		lite[i] = value[i];
+	return true;
+}
+inline void from_lite(const ObjectId& lite, OBJECT_IDENTIFIER& value) { value.assign(lite.begin(), lite.end()); }
+
+template <class Octets>
+inline bool to_lite(const OCTET_STRING& value, Octets& lite)
+{
+	if (value.size() > lite.max_size())
+		return false;
+	lite.assign(value.begin(), value.end());
+	return true;
+}
+template <class Octets>
+inline void from_lite(const Octets& lite, OCTET_STRING& value) { value.assign(lite.begin(), lite.end()); }
+
+template <class Chars>
+inline bool to_lite(const ConstrainedString& value, Chars& lite)
+{
+	if (value.size() > lite.max_size())
+		return false;
+	lite.assign(value.begin(), value.end());
+	return true;
+}
+template <class Chars>
+inline void from_lite(const Chars& lite, ConstrainedString& value) { value.assign(lite.data(), lite.size()); }
+
+template <class Chars>
+inline bool to_lite(const BMPString& value, Chars& lite)
+{
+	if (value.size() > lite.max_size())
+		return false;
+	lite.assign(value.begin(), value.end());
+	return true;
+}
+template <class Chars>
+inline void from_lite(const Chars& lite, BMPString& value) { value.assign(lite.data(), lite.size()); }
+
+template <class Bits>
+inline bool to_lite(const BIT_STRING& value, Bits& lite)
+{
+	if (value.size() > lite.max_size())
+		return false;
+	lite.resize(value.size());
+	for (unsigned i = 0; i < value.size(); ++i)
+		lite.set(i, value[i]);
+	return true;
+}
+template <class Bits>
+inline void from_lite(const Bits& lite, BIT_STRING& value) 
+{ 
+	value.resize(lite.size());
+	for (unsigned i = 0; i < lite.size(); ++i)
+		if (lite.test(i))
+			value.set(i);
+		else
+			value.clear(i);
+}
+
+template <class T, class Constraint, class L>
+inline bool to_lite(const SEQUENCE_OF<T, Constraint>& value, std::vector<L>& lite)
+{
+	lite.resize(value.size());
+	for (unsigned i = 0; i < value.size(); ++i)
+		if (!to_lite(value[i], lite[i]))
+			return false;
+	return true;
+}
+template <class L, class T, class Constraint>
+inline void from_lite(const std::vector<L>& lite, SEQUENCE_OF<T, Constraint>& value)
+{
+	value.resize(lite.size());
+	for (unsigned i = 0; i < lite.size(); ++i)
+		from_lite(lite[i], value[i]);
+}
+
+} // namespace lite
+
 #ifdef ASN1_HAS_IOSTREAM
 
-class AVNEncoder : public ConstVisitor
+namespace detail {
+
+/**
+ * Character output shared by the text encoders.
+ *
+ * The output goes either to an OutputBuffer or, unformatted, to the stream buffer of 
+ * an \c std::ostream. Writing fails once caller supplied memory is exhausted; 
+ * getPosition() then marks how far the output went.
+ */
+class TextOutput
+{
+public:
+	TextOutput(OpenBuf& buf) 
+		: out(buf), sbuf(NULL) {}
+	TextOutput(char* first, char* last)
+		: out(first, last), sbuf(NULL) {}
+	TextOutput(IoVec* first, IoVec* last)
+		: out(first, last), sbuf(NULL) {}
+	TextOutput(std::ostream& os) 
+		: sbuf(os.rdbuf()) {}
+
+	char* getPosition() const { return out.getPosition(); }
+	const OutputBuffer& getOutput() const { return out; }
+
+	bool write(const char* str, unsigned len);
+	bool write(const char* str) { return write(str, strlen(str)); }
+	bool write(char c) { return write(&c, 1); }
+	bool writeInt(int value);
+	bool writeUnsigned(unsigned value);
+	bool writeIndent(unsigned n);
+private:
+	OutputBuffer out;
+	std::streambuf* sbuf;
+};
+
+/**
+ * Character input shared by the text decoders.
+ *
+ * The input is a contiguous character buffer which must stay alive while decoding; 
+ * tokens are kept as pointers into it rather than being copied. getPosition() 
+ * returns the first character which has not been consumed.
+ */
+class TextInput
+{
+public:
+	TextInput(const char* first, const char* last) 
+		: cur(first), end(last) {}
+
+	const char* getPosition() const { return cur; }
+
+	struct Token
+	{
+		const char* first;
+		unsigned len;
+		bool equal(const char* str) const { return strncmp(first, str, len) == 0 && str[len] == 0; }
+	};
+
+	bool skipSpaces();
+	bool getChar(char& c);
+	bool peekChar(char& c);
+	bool getIdentifier(Token& id);
+	bool getNumber(unsigned& magnitude, bool& negative);
+
+protected:
+	const char* cur;
+	const char* end;
+};
+
+} // namespace detail
+
+/**
+ * Encoder for the ASN.1 value notation.
+ */
+class AVNEncoder : public ConstVisitor, private detail::TextOutput
 {
 public:
-	AVNEncoder(std::ostream& os) 
-		: strm(os), indent(0) {}
+	AVNEncoder(OpenBuf& buf) : TextOutput(buf), indent(0) {}
+	AVNEncoder(char* first, char* last) : TextOutput(first, last), indent(0) {}
+	AVNEncoder(IoVec* first, IoVec* last) : TextOutput(first, last), indent(0) {}
+	AVNEncoder(std::ostream& os) : TextOutput(os), indent(0) {}
+
+	using TextOutput::getPosition;
+	using TextOutput::getOutput;
 
 	virtual bool encode(const Null& value);
 	virtual bool encode(const BOOLEAN& value);
@@ -2719,16 +4053,20 @@ private:
 	virtual bool encodeKnownExtension(const SEQUENCE& value, int index);
 	virtual bool afterEncodeSequence(const SEQUENCE& value);
 
-	std::ostream& strm;
-	int indent;
+	unsigned indent;
 	std::vector<bool> outputSeparators; // used to indicate whether to output separator while parsing SEQUENCE
 };
 
-class AVNDecoder  : public Visitor
+/**
+ * Decoder for the ASN.1 value notation.
+ */
+class AVNDecoder  : public Visitor, private detail::TextInput
 {
 public:
-	AVNDecoder(std::istream& is, CoderEnv* coder = NULL) 
-		: Visitor(coder), strm(is) {}
+	AVNDecoder(const char* first, const char* last, const CoderEnv* coder = NULL) 
+		: Visitor(coder), TextInput(first, last) {}
+
+	using TextInput::getPosition;
 
 	virtual bool decode(Null& value);
 	virtual bool decode(BOOLEAN& value);
@@ -2752,8 +4090,108 @@ private:
 	virtual VISIT_SEQ_RESULT decodeKnownExtension(SEQUENCE& value, int index, int optional_id);
 	virtual bool decodeUnknownExtensions(SEQUENCE& value);
 
-	std::istream& strm;
-	std::vector<std::string> identifiers; // used to indicate the last parsed idetifier while parsing SEQUENCE.
+	bool getQuotedString(Token& str);
+	bool getBinaryString(std::vector<char>& value, unsigned& totalBits);
+	bool skipValue();
+
+	std::vector<int> identifiers; // positions of the last parsed field identifiers while parsing SEQUENCE.
+};
+
+/**
+ * Encoder for the JSON Encoding Rules (ITU-T X.697).
+ *
+ * The encoder writes compact JSON text, without any insignificant white space, using
+ * the component names emitted by asnparser. The output targets are the same as those 
+ * of AVNEncoder.
+ */
+class JEREncoder : public ConstVisitor, private detail::TextOutput
+{
+public:
+	JEREncoder(OpenBuf& buf) : TextOutput(buf) {}
+	JEREncoder(char* first, char* last) : TextOutput(first, last) {}
+	JEREncoder(IoVec* first, IoVec* last) : TextOutput(first, last) {}
+	JEREncoder(std::ostream& os) : TextOutput(os) {}
+
+	using TextOutput::getPosition;
+	using TextOutput::getOutput;
+
+	virtual bool encode(const Null& value);
+	virtual bool encode(const BOOLEAN& value);
+	virtual bool encode(const INTEGER& value);
+	virtual bool encode(const ENUMERATED& value);
+	virtual bool encode(const OBJECT_IDENTIFIER& value);
+	virtual bool encode(const BIT_STRING& value);
+	virtual bool encode(const OCTET_STRING& value);
+	virtual bool encode(const ConstrainedString& value);
+	virtual bool encode(const BMPString& value);
+	virtual bool encode(const CHOICE& value);
+	virtual bool encode(const OpenData& value);
+	virtual bool encode(const GeneralizedTime& value);
+	virtual bool encode(const SEQUENCE_OF_Base& value);
+private:
+	virtual bool preEncodeExtensionRoots(const SEQUENCE& value) ;
+	virtual bool encodeExtensionRoot(const SEQUENCE& value, int index);
+	virtual bool encodeKnownExtension(const SEQUENCE& value, int index);
+	virtual bool afterEncodeSequence(const SEQUENCE& value);
+
+	bool writeHex(const char* data, unsigned len);
+	bool writeString(const char* str, unsigned len);
+	bool writeName(const char* name);
+
+	std::vector<bool> outputSeparators; // used to indicate whether to output separator while parsing SEQUENCE
+};
+
+/**
+ * Decoder for the JSON Encoding Rules (ITU-T X.697).
+ *
+ * The members of a JSON object encoding a SEQUENCE may appear in any order; members 
+ * which are not known to the decoder are skipped. As with AVNDecoder, the input 
+ * buffer must stay alive while decoding.
+ */
+class JERDecoder  : public Visitor, private detail::TextInput
+{
+public:
+	JERDecoder(const char* first, const char* last, const CoderEnv* coder = NULL) 
+		: Visitor(coder), TextInput(first, last) {}
+
+	using TextInput::getPosition;
+
+	virtual bool decode(Null& value);
+	virtual bool decode(BOOLEAN& value);
+	virtual bool decode(INTEGER& value);
+	virtual bool decode(ENUMERATED& value);
+	virtual bool decode(OBJECT_IDENTIFIER& value);
+	virtual bool decode(BIT_STRING& value);
+	virtual bool decode(OCTET_STRING& value);
+	virtual bool decode(ConstrainedString& value);
+	virtual bool decode(BMPString& value);
+	virtual bool decode(CHOICE& value);
+	virtual bool decode(SEQUENCE_OF_Base& value);
+	virtual bool decode(OpenData& value);
+	virtual bool redecode(OpenData& value);
+	virtual bool decode(TypeConstrainedOpenData& value);
+	virtual bool decode(GeneralizedTime& value);
+private:
+	virtual VISIT_SEQ_RESULT preDecodeExtensionRoots(SEQUENCE& value);
+	virtual VISIT_SEQ_RESULT decodeExtensionRoot(SEQUENCE& value, int index, int optional_id);
+	virtual VISIT_SEQ_RESULT decodeKnownExtension(SEQUENCE& value, int index, int optional_id);
+	virtual bool decodeUnknownExtensions(SEQUENCE& value);
+
+	bool getString(Token& str, bool& escaped);
+	bool getLiteral(const char* literal, unsigned len);
+	bool getHex(std::vector<char>& value, unsigned& nDigits);
+	bool getWholeNumber(unsigned& magnitude, bool& negative);
+	bool skipValue();
+	void endSequence();
+
+	struct Member
+	{
+		int pos;
+		const char* value;
+	};
+	std::vector<Member> members; // components of the SEQUENCEs being decoded, as found in the input.
+	std::vector<unsigned> memberBases; // index in members of the first component of each SEQUENCE
+	std::vector<const char*> sequenceEnds; // positions after the closing brace of each SEQUENCE
 };
 
 
@@ -2765,40 +4203,119 @@ bool trace_invalid(std::ostream& os, const char* str, const AbstractData& data);
 class Module
 {
 public:
+	enum { no_slot = ~0u };
+
+	Module() : moduleName(NULL), moduleSlot(no_slot) {}
 	virtual ~Module(){};
 	const char* name() { return moduleName; }
+	/**
+	 * Returns the index under which a CoderEnv keeps the module, or \c no_slot if the 
+	 * module is only known by its name.
+	 */
+	unsigned slot() const { return moduleSlot; }
+
+	/**
+	 * Returns a new index for a module class. The generated module classes call it once 
+	 * each, the first time their slot is needed.
+	 */
+	static unsigned allocateSlot();
 protected:
 	const char* moduleName;
+	unsigned moduleSlot;
 };
 
 /////////////////////////////////////////////////////////////////////////////
 
+/**
+ * The modules known to the decoders and the encoding rules to use.
+ *
+ * All the state of an encoding or decoding lives in the coder created for the call, 
+ * so the const members can be called from any number of threads at once, as long as 
+ * nobody modifies the environment meanwhile. The usual set up is to register the 
+ * modules once, call \c freeze() and then share the environment between the threads.
+ * A thread needing other encoding rules can take a copy, which only copies the 
+ * pointers to the modules.
+ */
 class CoderEnv
 {
 public:
+	CoderEnv() : encodingRule(per_Basic_Aligned), rejectOversize(false), frozen(false) {}
+	CoderEnv(const CoderEnv& other) 
+		: encodingRule(other.encodingRule), rejectOversize(other.rejectOversize), 
+		  modules(other.modules), slots(other.slots), frozen(false) {}
+	CoderEnv& operator=(const CoderEnv& other)
+	{
+		assert(!frozen);
+		encodingRule = other.encodingRule;
+		rejectOversize = other.rejectOversize;
+		modules = other.modules;
+		slots = other.slots;
+		return *this;
+	}
 
-	Module* find(const char* moduleName) 
+	Module* find(const char* moduleName) const
 	{ 
-		Modules::iterator i = modules.find(moduleName);
+		Modules::const_iterator i = modules.find(moduleName);
 		return i != modules.end() ? i->second : NULL; 
 	}
-	void insert(Module* module) { assert(module); modules[module->name()] = module;}
-	void erase(Module* module) { assert(module); modules.erase(module->name()); }
-	void erase(const char* moduleName) { modules.erase(moduleName); }
+	/**
+	 * Returns the module kept under \c slot, without any name lookup.
+	 */
+	Module* find(unsigned slot) const
+	{
+		return slot < slots.size() ? slots[slot] : NULL;
+	}
+	void insert(Module* module) 
+	{ 
+		assert(module && !frozen); 
+		modules[module->name()] = module;
+		if (module->slot() != Module::no_slot)
+		{
+			if (module->slot() >= slots.size())
+				slots.resize(module->slot()+1);
+			slots[module->slot()] = module;
+		}
+	}
+	void erase(Module* module) { assert(module); erase(module->name()); }
+	void erase(const char* moduleName) 
+	{ 
+		assert(!frozen);
+		Module* module = find(moduleName);
+		if (module && module->slot() < slots.size())
+			slots[module->slot()] = NULL;
+		modules.erase(moduleName); 
+	}
 
-	enum EncodingRules { avn, ber, per_Basic_Aligned };
+	enum EncodingRules { avn, ber, per_Basic_Aligned, jer };
 
 	EncodingRules get_encodingRule() const { return encodingRule;}
-	void set_encodingRule(EncodingRules rule) { encodingRule = rule; }
+	void set_encodingRule(EncodingRules rule) { assert(!frozen); encodingRule = rule; }
+
+	/**
+	 * Forbids any further change to the environment, which can then be shared by 
+	 * threads. A copy of a frozen environment is not frozen.
+	 */
+	void freeze() { frozen = true; }
+	bool is_frozen() const { return frozen; }
 	void set_avn() {set_encodingRule(avn);}
 	bool is_avn() const { return encodingRule == avn;}
 	void set_ber() {set_encodingRule(ber);}
 	bool is_ber() const { return encodingRule == ber;}
 	void set_per_Basic_Aligned() {set_encodingRule(per_Basic_Aligned);}
 	bool is_per_Basic_Aligned() const { return encodingRule == per_Basic_Aligned;}
+	void set_jer() {set_encodingRule(jer);}
+	bool is_jer() const { return encodingRule == jer;}
+
+	/**
+	 * Makes the PER decoders turn down an input longer than the largest encoding 
+	 * asnparser worked out for the type, without decoding it. It is off by default, 
+	 * as a largest size found too small would then turn down valid inputs.
+	 */
+	void set_rejectOversize(bool reject = true) { assert(!frozen); rejectOversize = reject; }
+	bool get_rejectOversize() const { return rejectOversize; }
 
 	template <class OutputIterator>
-	bool encode(const AbstractData& val, OutputIterator begin)	
+	bool encode(const AbstractData& val, OutputIterator begin) const
 	{
 		if (get_encodingRule() == per_Basic_Aligned)
 			return encodePER(val, begin);
@@ -2807,34 +4324,110 @@ public:
 #ifdef ASN1_HAS_IOSTREAM
 		if (get_encodingRule() == avn)
 			return encodeAVN(val, begin);
+		if (get_encodingRule() == jer)
+			return encodeJER(val, begin);
 #endif
 		return false;
 	}
 
-	bool decode(const char* first, const char* last, AbstractData& val, bool defered);
+	/**
+	 * Encodes \c val into the caller supplied memory [first, last), without any 
+	 * intermediate buffer.
+	 *
+	 * @return The position following the encoding, or NULL if the encoding fails or 
+	 *  does not fit.
+	 */
+	char* encode(const AbstractData& val, char* first, char* last) const;
+
+	/**
+	 * Encodes \c val into the chain of blocks [first, last), each of them being filled 
+	 * before moving to the next one. On success, the encoding is held by the blocks from 
+	 * \c first up to the returned one, exclusive, and the length of the last of them is 
+	 * reduced to the part which is used; they can then be passed to \c writev() as is.
+	 *
+	 * @return NULL if the encoding fails or does not fit.
+	 */
+	IoVec* encode(const AbstractData& val, IoVec* first, IoVec* last) const;
+
+	/**
+	 * Encodes \c val into \c buf, checking its constraints in the same pass instead of 
+	 * calling \c isValid() beforehand. Only BER and PER support it. If the encoding fails 
+	 * because of an invalid value and \c diagnostic is not NULL, the path to that value 
+	 * and what is wrong with it are written there; nothing of the kind is done otherwise.
+	 */
+	bool encodeChecked(const AbstractData& val, OpenBuf& buf, std::string* diagnostic = NULL) const;
+
+	bool decode(const char* first, const char* last, AbstractData& val, bool defered) const;
 
-	bool decode(const unsigned char* first, const unsigned char* last , AbstractData& val, bool defered)
+	bool decode(const unsigned char* first, const unsigned char* last , AbstractData& val, bool defered) const
 	{
 		return decode(reinterpret_cast<const char*>(first), reinterpret_cast<const char*>(last), val, defered);
 	}
 
+	/**
+	 * Decodes \c val from the chain of blocks [first, last), such as the parts of a message
+	 * wrapping around the end of a ring buffer. The BER and PER decoders read across the 
+	 * block boundaries; the text encodings need the blocks to be gathered first.
+	 */
+	bool decode(const IoVec* first, const IoVec* last, AbstractData& val, bool defered) const;
+
+	bool decode(IoVec* first, IoVec* last, AbstractData& val, bool defered) const
+	{
+		return decode(const_cast<const IoVec*>(first), const_cast<const IoVec*>(last), val, defered);
+	}
+
 	template <class InputIterator>
-	bool decode(InputIterator first, InputIterator last, AbstractData& val, bool defered)
+	bool decode(InputIterator first, InputIterator last, AbstractData& val, bool defered) const
 	{
-#ifdef ASN1_HAS_IOSTREAM
-		if (get_encodingRule() == avn)
-		{
-			std::istringstream strm(std::string(first, last));
-			AVNDecoder decoder(strm);
-			return val.decode(decoder);
-		}
-#endif // ASN1_HAS_IOSTREAM
 		OpenBuf buf(first, last);
 		return decode((const char*)&buf[0], (const char*)&*buf.end(), val, defered);
 	}
 
+	/**
+	 * A message of a batch to decode: [first, last) is decoded into \c value, and
+	 * \c decoded tells whether it succeeded.
+	 */
+	struct DecodeItem
+	{
+		const char* first;
+		const char* last;
+		AbstractData* value;
+		bool decoded;
+	};
+
+	/**
+	 * A value of a batch to encode: \c value is encoded into \c output, and \c encoded
+	 * tells whether it succeeded.
+	 */
+	struct EncodeItem
+	{
+		const AbstractData* value;
+		OpenBuf* output;
+		bool encoded;
+	};
+
+	/**
+	 * Decodes the items of [first, last) on \c nThreads threads, the calling one included;
+	 * 0 means one thread per core. Each thread starts with its own share of the items, and
+	 * takes over the remaining items of the others once it is done with it. Embedded open
+	 * types are decoded as by \c decode() with \c defered false.
+	 *
+	 * @return The number of items which were decoded.
+	 */
+	std::size_t decodeBatch(DecodeItem* first, DecodeItem* last, unsigned nThreads = 0) const;
+
+	/**
+	 * Encodes the items of [first, last), spread over threads like \c decodeBatch(). Each 
+	 * thread encodes into a scratch buffer of its own, reused from one item to the next,
+	 * so that every output is allocated once, to its final size.
+	 *
+	 * @return The number of items which were encoded.
+	 */
+	std::size_t encodeBatch(EncodeItem* first, EncodeItem* last, unsigned nThreads = 0) const;
+
 protected:
 	EncodingRules encodingRule;
+	bool rejectOversize;
 	struct StringListeralCmp : public std::binary_function<const char*, const char*, bool>
 	{
 		bool operator() (const char* lhs, const char* rhs) const 
@@ -2842,12 +4435,31 @@ protected:
 	};
 	typedef Loki::AssocVector<const char*, Module*, StringListeralCmp> Modules;
 	Modules modules;
+	std::vector<Module*> slots; // modules by slot, for the generated code
+	bool frozen;
+
+	// the largest encoding which is made on the stack rather than in a buffer
+	enum { stackEncodeSize = 512 };
 
 	template <class OutputIterator>
-	bool encodePER(const AbstractData& val, OutputIterator begin)
+	bool encodePER(const AbstractData& val, OutputIterator begin) const
 	{
+		unsigned maxSize = val.getEncodedSize().maxPER;
+		if (maxSize <= stackEncodeSize)
+		{
+			char stackBuf[stackEncodeSize];
+			PEREncoder encoder(stackBuf, stackBuf + stackEncodeSize);
+			bool encoded = val.encode(encoder);
+			if (!encoder.getOutput().overflow())
+			{
+				if (encoded)
+					std::copy(stackBuf, encoder.getOutput().getPosition(), begin);
+				return encoded;
+			}
+		}
+
 		OpenBuf buf;
-		PEREncoder encoder(buf);
+		PEREncoder encoder(buf, true, EncodedSize::capacity(maxSize));
 		if (val.encode(encoder))
 		{
 		    std::copy(buf.begin(), buf.end(), begin);
@@ -2857,10 +4469,24 @@ protected:
 	}
 
 	template <class OutputIterator>
-	bool encodeBER(const AbstractData& val, OutputIterator begin)
+	bool encodeBER(const AbstractData& val, OutputIterator begin) const
 	{
+		unsigned maxSize = val.getEncodedSize().maxBER;
+		if (maxSize <= stackEncodeSize)
+		{
+			char stackBuf[stackEncodeSize];
+			BEREncoder encoder(stackBuf, stackBuf + stackEncodeSize);
+			bool encoded = val.encode(encoder);
+			if (!encoder.getOutput().overflow())
+			{
+				if (encoded)
+					std::copy(stackBuf, encoder.getOutput().getPosition(), begin);
+				return encoded;
+			}
+		}
+
 		OpenBuf buf;
-		BEREncoder encoder(buf);
+		BEREncoder encoder(buf, EncodedSize::capacity(maxSize));
 		if (val.encode(encoder))
 		{
 		    std::copy(buf.begin() , buf.end(), begin);
@@ -2871,14 +4497,26 @@ protected:
 
 #ifdef ASN1_HAS_IOSTREAM
 	template <class OutputIterator>
-	bool encodeAVN(const AbstractData& val, OutputIterator begin)
+	bool encodeAVN(const AbstractData& val, OutputIterator begin) const
 	{
-		std::ostringstream strm;
-		AVNEncoder encoder(strm);
+		OpenBuf buf;
+		AVNEncoder encoder(buf);
 		if (val.encode(encoder))
 		{
-			const std::string& str = strm.str();
-			std::copy(str.begin(), str.end(), begin);
+			std::copy(buf.begin(), buf.end(), begin);
+			return true;
+		}
+		return false;
+	}
+
+	template <class OutputIterator>
+	bool encodeJER(const AbstractData& val, OutputIterator begin) const
+	{
+		OpenBuf buf;
+		JEREncoder encoder(buf);
+		if (val.encode(encoder))
+		{
+			std::copy(buf.begin(), buf.end(), begin);
 			return true;
 		}
 		return false;
@@ -2888,20 +4526,183 @@ protected:
 
 
 template <class OutputIterator>
-bool encode(const AbstractData& val, CoderEnv* env, OutputIterator begin)
+bool encode(const AbstractData& val, const CoderEnv* env, OutputIterator begin)
 {
 	return env->encode(val, begin);
 }
 
 
 template <class InputIterator>
-bool decode(InputIterator first, InputIterator last, CoderEnv* env, AbstractData& val, bool defered = false)
+bool decode(InputIterator first, InputIterator last, const CoderEnv* env, AbstractData& val, bool defered = false)
 {
     return env->decode(first, last, val, defered);
 }
 
 ////////////////////////////////////////////////////////////////////////////
 
+namespace detail {
+
+struct KeyLess
+{
+	template <class T>
+	bool operator()(const T& lhs, const T& rhs) const { return lhs.first < rhs.first; }
+};
+
+struct SameKey
+{
+	template <class T>
+	bool operator()(const T& lhs, const T& rhs) const { return !(lhs.first < rhs.first) && !(rhs.first < lhs.first); }
+};
+
+/**
+ * Sorts the objects gathered for an information object set and drops those whose key 
+ * is already taken, keeping the first one as inserting them one at a time would. The 
+ * set can then be built in one go instead of growing a sorted table object by object.
+ */
+template <class Vector>
+void sort_unique_keys(Vector& objects)
+{
+	std::stable_sort(objects.begin(), objects.end(), KeyLess());
+	objects.erase(std::unique(objects.begin(), objects.end(), SameKey()), objects.end());
+}
+
+inline int key_value(const INTEGER& key) { return key.getValue(); }
+inline int key_value(const ENUMERATED& key) { return key.asInt(); }
+
+/**
+ * Maps the integer keys of the sorted table of an information object class straight to 
+ * the positions of their objects, so that the open types are dispatched without any 
+ * search. The keys come from a function which tells whether a key, such as a CHOICE 
+ * between an INTEGER and an OBJECT IDENTIFIER, has an integer value. The index is only 
+ * kept when those values are dense enough; otherwise \c lookup() fails and the table 
+ * has to be searched.
+ */
+class DenseIndex
+{
+public:
+	enum { npos = ~0u };
+
+	DenseIndex() : lowest(0), highest(0), count(0) {}
+
+	template <class ForwardIterator, class KeyValue>
+	void rebuild(ForwardIterator first, ForwardIterator last, KeyValue keyValue)
+	{
+		positions.clear();
+		count = 0;
+		int value;
+		ForwardIterator i;
+		for (i = first; i != last; ++i)
+			if (keyValue(i->first, value))
+				widen(value);
+		if (!dense())
+			return;
+		positions.assign(offset(highest) + 1, npos);
+		unsigned pos = 0;
+		for (i = first; i != last; ++i, ++pos)
+			if (keyValue(i->first, value))
+				positions[offset(value)] = pos;
+	}
+
+	/**
+	 * Updates the index once the object at \c position has been inserted into the table
+	 * [first, last). The table is only gone through again when its keys have just become
+	 * dense enough to be indexed.
+	 */
+	template <class RandomAccessIterator, class KeyValue>
+	void inserted(RandomAccessIterator first, RandomAccessIterator last, KeyValue keyValue,
+				  RandomAccessIterator position)
+	{
+		unsigned pos = static_cast<unsigned>(position - first);
+		shift(pos, 1);
+		int value;
+		if (!keyValue(position->first, value))
+			return;
+		int oldLowest = count ? lowest : value;
+		bool kept = !positions.empty();
+		widen(value);
+		if (!dense())
+			positions.clear();
+		else if (!kept)
+			rebuild(first, last, keyValue);
+		else
+		{
+			if (lowest < oldLowest)
+				positions.insert(positions.begin(), 
+					static_cast<unsigned>(oldLowest) - static_cast<unsigned>(lowest), npos);
+			if (offset(highest) >= positions.size())
+				positions.resize(offset(highest) + 1, npos);
+			positions[offset(value)] = pos;
+		}
+	}
+
+	/**
+	 * Updates the index before the object at \c position is erased from the table 
+	 * starting at \c first.
+	 */
+	template <class RandomAccessIterator, class KeyValue>
+	void erasing(RandomAccessIterator first, KeyValue keyValue, RandomAccessIterator position)
+	{
+		unsigned pos = static_cast<unsigned>(position - first);
+		int value;
+		if (keyValue(position->first, value))
+		{
+			--count;
+			if (!positions.empty())
+				positions[offset(value)] = npos;
+		}
+		shift(pos + 1, -1);
+	}
+
+	/**
+	 * Gives the position of the object of \c key in the table, or \c npos if there 
+	 * is none. Returns false if the table has to be searched instead.
+	 */
+	bool lookup(int key, unsigned& pos) const
+	{
+		if (positions.empty())
+			return false;
+		unsigned i = offset(key);
+		pos = i < positions.size() ? positions[i] : static_cast<unsigned>(npos);
+		return true;
+	}
+
+	void swap(DenseIndex& other)
+	{
+		std::swap(lowest, other.lowest);
+		std::swap(highest, other.highest);
+		std::swap(count, other.count);
+		positions.swap(other.positions);
+	}
+
+private:
+	unsigned offset(int key) const { return static_cast<unsigned>(key) - static_cast<unsigned>(lowest); }
+	// the range of the keys only grows until the next rebuild, which errs towards searching
+	void widen(int value)
+	{
+		if (count++ == 0)
+			lowest = highest = value;
+		else if (value < lowest)
+			lowest = value;
+		else if (value > highest)
+			highest = value;
+	}
+	bool dense() const { return count != 0 && offset(highest) < 4 * count + 64; }
+	void shift(unsigned from, int delta)
+	{
+		for (std::size_t i = 0; i < positions.size(); ++i)
+			if (positions[i] != npos && positions[i] >= from)
+				positions[i] += delta;
+	}
+
+	int lowest, highest;
+	std::size_t count;
+	std::vector<unsigned> positions;
+};
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////
+
 
 } // namespace ASN1
 
@@ -0,0 +1,173 @@
+/*
+ * asn1bench.cpp
+ *
+ * Copyright (c) 2001 Institute for Information Industry, Taiwan, Republic of China
+ * (http://www.iii.org.tw/iiia/ewelcome.htm)
+ *
+ * Permission to copy, use, modify, sell and distribute this software
+ * is granted provided this copyright notice appears in all copies.
+ * This software is provided "as is" without express or implied
+ * warranty, and with no claim as to its suitability for any purpose.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "test1.h"
+#include "myhttp.h"
+#ifdef ASN1_HAS_IOSTREAM
+#include <sstream>
+#endif
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+/*
+ * Reports the rates of the coders. asn1test checks their results; the figures here
+ * depend on the machine and are only printed.
+ */
+
+using namespace ASN1;
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void makeRequest(MyHTTP::GetRequest& gr)
+{
+	gr.set_header_only(true);
+	gr.set_accept_types().set_others().push_back(new MyHTTP::AcceptTypes_others_subtype("text"));
+	gr.set_url("www.asn1.com");
+}
+
+#ifdef ASN1_HAS_IOSTREAM
+void benchValueNotation()
+{
+	MyHTTP::GetRequest gr;
+	makeRequest(gr);
+	const unsigned count = 2000;
+	std::ostringstream os;
+	for (unsigned i = 0; i < count; ++i)
+		os << gr << '\n';
+
+	std::istringstream file(os.str());
+	Clock::time_point start = Clock::now();
+	unsigned n = 0;
+	MyHTTP::GetRequest value;
+	while (file >> value)
+		++n;
+	printf("ValueNotation from a stream : %.0f values/s\n", n / seconds(start));
+
+	CoderEnv env;
+	env.set_avn();
+	std::string one = gr.asValueNotation();
+	start = Clock::now();
+	for (n = 0; n < count && decode(one.begin(), one.end(), &env, value); ++n)
+		;
+	printf("ValueNotation from a buffer : %.0f values/s\n", n / seconds(start));
+}
+#endif
+
+/*
+ * Decodes the same message from several threads sharing one frozen environment, 
+ * as the number of threads grows.
+ */
+void benchSharedCoderEnv()
+{
+	CoderEnv env;
+	env.set_per_Basic_Aligned();
+	env.freeze();
+
+	MyHTTP::GetRequest gr;
+	makeRequest(gr);
+	std::vector<char> strm;
+	encode(gr, &env, std::back_inserter(strm));
+
+	const int decodesPerThread = 20000;
+	unsigned maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0)
+		maxThreads = 2;
+
+	double baseRate = 0;
+	for (unsigned nThreads = 1; nThreads <= maxThreads; nThreads *= 2)
+	{
+		std::vector<std::thread> threads;
+		Clock::time_point start = Clock::now();
+		for (unsigned t = 0; t < nThreads; ++t)
+			threads.push_back(std::thread([&]() {
+				for (int i = 0; i < decodesPerThread; ++i)
+				{
+					MyHTTP::GetRequest result;
+					decode(strm.begin(), strm.end(), &env, result);
+				}
+			}));
+		for (unsigned t = 0; t < nThreads; ++t)
+			threads[t].join();
+
+		double rate = nThreads * decodesPerThread / seconds(start);
+		if (nThreads == 1)
+			baseRate = rate;
+		printf("shared CoderEnv, %u threads : %.0f decodes/s (x%.2f)\n", nThreads, rate, rate/baseRate);
+	}
+}
+
+/*
+ * Encodes then decodes a batch of messages on 1, 2, 4 ... hardware_concurrency threads.
+ */
+void benchBatchCoder(CoderEnv::EncodingRules rule, const char* ruleName)
+{
+	CoderEnv env;
+	env.set_encodingRule(rule);
+	env.freeze();
+
+	MyHTTP::GetRequest gr;
+	makeRequest(gr);
+	const unsigned batchSize = 3*4096;
+	std::vector<MyHTTP::GetRequest> values(batchSize);
+	std::vector<OpenBuf> outputs(batchSize);
+	std::vector<CoderEnv::EncodeItem> toEncode(batchSize);
+	std::vector<CoderEnv::DecodeItem> toDecode(batchSize);
+	for (unsigned i = 0; i < batchSize; ++i)
+	{
+		CoderEnv::EncodeItem item = { &gr, &outputs[i], false };
+		toEncode[i] = item;
+	}
+
+	unsigned maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0)
+		maxThreads = 2;
+
+	double baseRate = 0;
+	for (unsigned nThreads = 1; nThreads <= maxThreads; nThreads *= 2)
+	{
+		Clock::time_point start = Clock::now();
+		env.encodeBatch(&toEncode[0], &toEncode[0] + batchSize, nThreads);
+		for (unsigned i = 0; i < batchSize; ++i)
+		{
+			CoderEnv::DecodeItem item = { &outputs[i][0], &outputs[i][0] + outputs[i].size(), &values[i], false };
+			toDecode[i] = item;
+		}
+		env.decodeBatch(&toDecode[0], &toDecode[0] + batchSize, nThreads);
+
+		double rate = batchSize / seconds(start);
+		if (nThreads == 1)
+			baseRate = rate;
+		printf("batch %s, %u threads : %.0f messages/s (x%.2f)\n", ruleName, nThreads, rate, rate/baseRate);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef ASN1_HAS_IOSTREAM
+	benchValueNotation();
+#endif
+	benchSharedCoderEnv();
+	benchBatchCoder(CoderEnv::per_Basic_Aligned, "PER");
+	benchBatchCoder(CoderEnv::ber, "BER");
+	return 0;
+}
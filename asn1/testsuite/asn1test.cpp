@@ -17,11 +17,14 @@
 
 #include "test1.h"
 #include "myhttp.h"
+#include "myhttp_lite.h"
 #ifdef ASN1_HAS_IOSTREAM
 #include <iostream>
 #endif
 
 #include "asn1test.h"
+#include <unordered_set>
+#include <memory>
  
 extern "C" void SMC1Init();
 
@@ -103,6 +106,156 @@ void ValueNotationTests()
 	MyHTTP::RejectProblem rp1, rp2;
 	rp1.set_invoke_mistypedArgument();
 	TEST("RejectProblem ValueNotation", env, rp1, rp2, "invoke-mistypedArgument");
+
+	if (!rp2.setFromName("returnError-mistypedParameter") || rp2 != 34 || rp2.setFromName("invoke"))
+		printf("RejectProblem setFromName FAIL !!!! \n");
+
+	unsigned arcs[] = { 0, 0, 8, 2250 };
+	OBJECT_IDENTIFIER oid1(arcs, arcs+4), oid2;
+	TEST("OBJECT_IDENTIFIER ValueNotation", env, oid1, oid2, "{ 0 0 8 2250 }");
+
+	TEST1::S1 s1, s2;
+	s1.push_back(new INTEGER(1));
+	s1.push_back(new INTEGER(-2));
+	TEST("SEQUENCE OF ValueNotation", env, s1, s2, "{\n  1,\n  -2\n}");
+
+	s2.setFromValueNotation("{1,-2}");
+	if (s1 != s2)
+		printf("compact SEQUENCE OF ValueNotation FAIL !!!! \n");
+
+	char shortBuf[4];
+	AVNEncoder encoder(shortBuf, shortBuf+sizeof(shortBuf));
+	if (s1.encode(encoder) || encoder.getPosition() != shortBuf+sizeof(shortBuf))
+		printf("SEQUENCE OF ValueNotation into a short buffer FAIL !!!! \n");
+}
+
+/*
+ * A stream which cannot seek and hands out one character at a time, as a pipe may.
+ */
+class PipeBuf : public std::streambuf
+{
+public:
+	PipeBuf(const char* str) : next(str), last(str + strlen(str)) {}
+	std::size_t delivered(const char* str) const { return next - str; }
+protected:
+	int_type underflow()
+	{
+		if (next == last)
+			return traits_type::eof();
+		current = *next++;
+		setg(&current, &current, &current+1);
+		return traits_type::to_int_type(current);
+	}
+private:
+	const char* next;
+	const char* last;
+	char current;
+};
+
+/*
+ * Values read one after another with operator>> must each take only their own text,
+ * from any stream.
+ */
+void testValueNotationStream()
+{
+	const char text[] = "5 {1,-2}\n-7";
+	PipeBuf pipe(text);
+	std::istream is(&pipe);
+	INTEGER a, c;
+	TEST1::S1 s;
+	is >> a;
+	if (!is || a != 5 || pipe.delivered(text) != 2 || is.rdbuf()->sgetc() != ' ')
+		printf("INTEGER from a pipe FAIL !!!! \n");
+	is >> s >> c;
+	if (!is.eof() || is.fail() || s.size() != 2 || s[1] != -2 || c != -7)
+		printf("values following each other from a pipe FAIL !!!! \n");
+
+	MyHTTP::GetRequest gr;
+	gr.set_header_only(true);
+	gr.set_accept_types().set_others().push_back(new MyHTTP::AcceptTypes_others_subtype("text"));
+	gr.set_url("www.asn1.com");
+	const unsigned count = 20;
+	std::ostringstream os;
+	for (unsigned i = 0; i < count; ++i)
+		os << gr << '\n';
+
+	std::istringstream file(os.str());
+	unsigned n = 0;
+	MyHTTP::GetRequest value;
+	while (file >> value && value == gr)
+		++n;
+	if (n != count || !file.eof())
+		printf("GetRequest values from a stream FAIL !!!! \n");
+
+	CoderEnv env;
+	env.set_avn();
+	std::string one = gr.asValueNotation();
+	MyHTTP::GetRequest decoded;
+	if (!decode(one.begin(), one.end(), &env, decoded) || decoded != gr)
+		printf("GetRequest value from a buffer FAIL !!!! \n");
+}
+
+void testJERCoder()
+{
+	CoderEnv env;
+	env.set_jer();
+
+	INTEGER i1(-5), i2;
+	TEST("value INTEGER ::= -5 (JER)", env, i1, i2, "-5");
+
+	Null null1, null2;
+	TEST("value NULL ::= NULL (JER)", env, null1, null2, "null");
+
+	IA5String is1 = "a\"b\\c", is2;
+	TEST("value IA5String ::= \"a\"\"b\\c\" (JER)", env, is1, is2, "\"a\\\"b\\\\c\"");
+
+	char buf[] = "\x00\x10\xab" ;
+	OCTET_STRING os1(buf, buf+3), os2;
+	TEST("value OCTET STRING ::= '0010AB'H (JER)", env, os1, os2, "\"0010AB\"");
+
+	BIT_STRING bs1, bs2;
+	bs1.resize(10);
+	bs1.set(5);
+	bs1.set(7);
+	bs1.set(9);
+	TEST("value BIT STRING ::= '0000010101'B (JER)", env, bs1, bs2, "{\"value\":\"0540\",\"length\":10}");
+
+	TEST1::S1 s1_1, s1_2;
+	s1_1.push_back(new INTEGER(2));
+	s1_1.push_back(new INTEGER(6));
+	TEST("value SEQUENCE OF INTEGER ::= {2,6} (JER)", env, s1_1, s1_2, "[2,6]");
+
+	TEST1::S4 s4_1, s4_2;
+	s4_1.set_name("A");
+	s4_1.set_attrib().select_f2().select_f3(true);
+	TEST("value S4 ::= { name A, attrib : f2 : f3 TRUE } (JER)",
+		env, s4_1, s4_2, "{\"name\":\"A\",\"attrib\":{\"f2\":{\"f3\":true}}}");
+
+	const char reordered[] = "{ \"attrib\" : {\"f2\":{\"f3\":true}}, \"unknown\":[{}], \"name\" : \"A\" }";
+	if (!decode(reordered, reordered+sizeof(reordered)-1, &env, s4_2) || s4_1 != s4_2)
+		printf("S4 with reordered members (JER) FAIL !!!! \n");
+
+	MyHTTP::GetRequest gr1, gr2;
+	gr1.set_header_only(true);
+	gr1.set_url("www.asn1.com");
+	TEST("value GetRequest ::= { header-only TRUE, url \"www.asn1.com\" } (JER)",
+		env, gr1, gr2, "{\"header-only\":true,\"url\":\"www.asn1.com\"}");
+
+	const char missing[] = "{\"header-only\":true}";
+	if (decode(missing, missing+sizeof(missing)-1, &env, gr2))
+		printf("GetRequest without url (JER) FAIL !!!! \n");
+
+	// JSON numbers with a fraction or an exponent are read when they are whole
+	const char* wholeNumbers[] = { "1.5e1", "-3.0", "200E-2", "0e5", "2E+1" };
+	const int wholeValues[] = { 15, -3, 2, 0, 20 };
+	for (unsigned i = 0; i < 5; ++i)
+		if (!decode(wholeNumbers[i], wholeNumbers[i] + strlen(wholeNumbers[i]), &env, i2) || 
+			i2 != wholeValues[i])
+			printf("INTEGER %s (JER) FAIL !!!! \n", wholeNumbers[i]);
+	const char* fractions[] = { "1.5", "25e-1", "1.", "1e" };
+	for (unsigned i = 0; i < 4; ++i)
+		if (decode(fractions[i], fractions[i] + strlen(fractions[i]), &env, i2))
+			printf("INTEGER %s (JER) FAIL !!!! \n", fractions[i]);
 }
 #endif
 
@@ -197,6 +350,37 @@ void testPERCoder()
 	TEST("vale IA5String (FROM (\"TF\")) (SIZE(0..16)) ::= \"TFFT\" (PER)",
 		env ,ia511str1, ia511str2,"\x24\x80");
 
+	unsigned arcs[] = { 0, 0, 8, 2250 };
+	OBJECT_IDENTIFIER oid1(arcs, arcs+4), oid2;
+	TEST("value OBJECT IDENTIFIER ::= { 0 0 8 2250 } (PER)", env, oid1, oid2, "\x04\x00\x08\x91\x4A");
+
+	char span[2];
+	if (env.encode(ia511str1, span, span+2) != span+2 || memcmp(span, "\x24\x80", 2) != 0 ||
+		env.encode(ia511str1, span, span+1) != NULL)
+		printf("IA5String (PER) into a caller supplied buffer FAIL !!!! \n");
+
+	char block1, block2[4];
+	IoVec chain[] = { { &block1, 1 }, { block2, sizeof(block2) } };
+	if (env.encode(ia511str1, chain, chain+2) != chain+2 || chain[1].iov_len != 1 || 
+		block1 != '\x24' || block2[0] != '\x80')
+		printf("IA5String (PER) into a chain of buffers FAIL !!!! \n");
+
+	IA5Str11 ia511str3;
+	if (!env.decode(chain, chain+2, ia511str3, false) || ia511str3 != ia511str1)
+		printf("IA5String (PER) from a chain of buffers FAIL !!!! \n");
+
+	MyHTTP::GetRequest gr;
+	gr.set_accept_types().set_standards().resize(4);
+	gr.set_url("www.asn1.com");
+	OpenBuf checked;
+	std::string diagnostic;
+	if (!env.encodeChecked(gr, checked, &diagnostic) || !diagnostic.empty())
+		printf("valid GetRequest (PER) checked encoding FAIL !!!! \n");
+
+	gr.ref_accept_types().ref_standards().resize(5);
+	if (env.encodeChecked(gr, checked, &diagnostic) || 
+		diagnostic.find(".accept-types.standards") != 0)
+		printf("invalid GetRequest (PER) checked encoding FAIL !!!! \n");
 }
 
 
@@ -281,6 +465,20 @@ void testBERCoder()
 	TEST("value S4 ::= { name A, attrib : f2 : f3 TRUE }",
 	env, s4_1, s4_2, "\x30\x06\x1A\x01\x41\x01\x01\xFF");
 
+	unsigned arcs[] = { 0, 0, 8, 2250 };
+	OBJECT_IDENTIFIER oid1(arcs, arcs+4), oid2;
+	TEST("value OBJECT IDENTIFIER ::= { 0 0 8 2250 } (BER)", env, oid1, oid2, "\x06\x04\x00\x08\x91\x4A");
+
+	char oidBlock1[] = "\x06\x04\x00\x08", oidBlock2[] = "\x91\x4A";
+	IoVec oidChain[] = { { oidBlock1, 4 }, { oidBlock2, 2 } };
+	OBJECT_IDENTIFIER oid3;
+	if (!env.decode(oidChain, oidChain+2, oid3, false) || oid3 != oid1)
+		printf("OBJECT IDENTIFIER (BER) from a chain of buffers FAIL !!!! \n");
+
+	const char noArcs[] = "\x06\x00";
+	if (!env.decode(noArcs, noArcs+2, oid3, false) || oid3.levels() != 0)
+		printf("OBJECT IDENTIFIER (BER) of no octets FAIL !!!! \n");
+
 	using namespace MyHTTP;
 
  
@@ -322,6 +520,581 @@ void IteratorTest()
 }
 
 
+/*
+ * Equal values must hash alike, so that they can key an unordered container.
+ */
+void testHash()
+{
+	MyHTTP::GetRequest gr1, gr2, gr3;
+	MyHTTP::GetRequest* requests[] = { &gr1, &gr2, &gr3 };
+	for (int i = 0; i < 3; ++i)
+	{
+		requests[i]->set_header_only(true);
+		requests[i]->set_accept_types().set_others().push_back(new MyHTTP::AcceptTypes_others_subtype("text"));
+		requests[i]->set_url("www.asn1.com/a/path/long/enough/to/fill/several/words");
+	}
+	gr3.ref_accept_types().ref_others().push_back(new MyHTTP::AcceptTypes_others_subtype("html"));
+
+	if (gr1.hash() != gr2.hash() || gr1.hash() == gr3.hash())
+		printf("GetRequest hash FAIL !!!! \n");
+
+	std::unordered_set<MyHTTP::GetRequest, ASN1::Hash> requestSet;
+	requestSet.insert(gr1);
+	requestSet.insert(gr2);
+	requestSet.insert(gr3);
+	if (requestSet.size() != 2 || requestSet.count(gr2) != 1)
+		printf("GetRequest in unordered_set FAIL !!!! \n");
+
+	// the time difference is left out of the comparison, and so of the hash
+	GeneralizedTime t1(2001, 3, 6, 3, 4, 5, 0, 60), t2(2001, 3, 6, 3, 4, 5, 0, -120), t3(2001, 3, 6, 3, 4, 6);
+	if (t1 != t2 || t1.hash() != t2.hash() || t1.hash() == t3.hash())
+		printf("GeneralizedTime hash FAIL !!!! \n");
+}
+
+/*
+ * A value keeping its encodings must encode as it would without, including after it 
+ * has been changed through a generated accessor.
+ */
+void testEncodingCache(CoderEnv::EncodingRules rule, const char* ruleName)
+{
+	CoderEnv env;
+	env.set_encodingRule(rule);
+
+	MyHTTP::GetRequest plain, cached;
+	MyHTTP::GetRequest* requests[] = { &plain, &cached };
+	for (int i = 0; i < 2; ++i)
+	{
+		requests[i]->set_header_only(true);
+		requests[i]->set_accept_types().set_others().push_back(new MyHTTP::AcceptTypes_others_subtype("text"));
+		requests[i]->set_url("www.asn1.com");
+	}
+	cached.cacheEncoding();
+
+	std::vector<char> expected, first, second;
+	encode(plain, &env, std::back_inserter(expected));
+	encode(cached, &env, std::back_inserter(first));
+	encode(cached, &env, std::back_inserter(second));
+	if (first != expected || second != expected)
+		printf("GetRequest (%s) with cached encoding FAIL !!!! \n", ruleName);
+
+	plain.set_url("www.asn1.com/index.html");
+	cached.set_url("www.asn1.com/index.html");
+	expected.clear(); 
+	first.clear();
+	encode(plain, &env, std::back_inserter(expected));
+	encode(cached, &env, std::back_inserter(first));
+	if (first != expected)
+		printf("GetRequest (%s) with cached encoding after set_url FAIL !!!! \n", ruleName);
+
+	// the threads of a batch all find the encoding missing and keep it at once
+	env.freeze();
+	const unsigned batchSize = 64;
+	std::vector<OpenBuf> outputs(batchSize);
+	std::vector<CoderEnv::EncodeItem> items(batchSize);
+	for (unsigned i = 0; i < batchSize; ++i)
+	{
+		CoderEnv::EncodeItem item = { &cached, &outputs[i], false };
+		items[i] = item;
+	}
+	bool ok = true;
+	for (int round = 0; ok && round < 200; ++round)
+	{
+		cached.invalidateEncoding();
+		ok = env.encodeBatch(&items[0], &items[0] + batchSize, 8) == batchSize;
+		for (unsigned i = 0; ok && i < batchSize; ++i)
+			ok = outputs[i] == expected;
+	}
+	if (!ok)
+		printf("GetRequest (%s) with cached encoding on several threads FAIL !!!! \n", ruleName);
+}
+
+// patches the field numbered index and compares the result with a full encoding of expected
+static bool patchMatches(const PERTemplate& tmpl, OpenBuf& patched, unsigned index, int value, 
+						 const AbstractData& expected)
+{
+	OpenBuf full;
+	PEREncoder encoder(full);
+	return tmpl.patch(patched, index, value) && expected.encode(encoder) && patched == full;
+}
+
+/*
+ * Patching a field of a PER template must give the encoding of the changed message, for
+ * the fields of each width class.
+ */
+void testPERTemplate()
+{
+	MyHTTP::GetRequest gr;
+	gr.set_header_only(true);
+	gr.set_lock(false);
+	gr.set_url("www.asn1.com");
+
+	PERTemplate tmpl;
+	unsigned lock = tmpl.addField(gr.get_lock());
+	if (!tmpl.encode(gr))
+	{
+		printf("GetRequest PER template FAIL !!!! \n");
+		return;
+	}
+
+	OpenBuf patched(tmpl.getEncoding()), expected;
+	gr.set_lock(true);
+	PEREncoder encoder(expected);
+	gr.encode(encoder);
+	if (!tmpl.patch(patched, lock, true) || patched != expected)
+		printf("GetRequest PER template patch FAIL !!!! \n");
+
+	// a bit-field after the preamble, an aligned octet and two aligned octets
+	MyHTTP::KeepAlive ka;
+	ka.set_urgent(true);
+	ka.set_ttl(4);
+	ka.set_state().set_busy();
+	ka.set_priority(7);
+	ka.set_colour().set_green();
+	ka.set_requestSeqNum(1);
+
+	PERTemplate kaTmpl;
+	unsigned ttl = kaTmpl.addField(ka.get_ttl());
+	unsigned state = kaTmpl.addField(ka.get_state());
+	unsigned priority = kaTmpl.addField(ka.get_priority());
+	unsigned colour = kaTmpl.addField(ka.get_colour());
+	unsigned seqNum = kaTmpl.addField(ka.get_requestSeqNum());
+	if (!kaTmpl.encode(ka))
+	{
+		printf("KeepAlive PER template FAIL !!!! \n");
+		return;
+	}
+
+	OpenBuf kaPatched(kaTmpl.getEncoding());
+	ka.set_ttl(3);
+	bool ok = patchMatches(kaTmpl, kaPatched, ttl, 3, ka);
+	ka.set_ttl(6);
+	if (!ok || !patchMatches(kaTmpl, kaPatched, ttl, 6, ka))
+		printf("KeepAlive PER template patch of a bit-field INTEGER FAIL !!!! \n");
+
+	ka.set_state().set_idle();
+	ok = patchMatches(kaTmpl, kaPatched, state, 0, ka);
+	ka.set_state().set_away();
+	ok = ok && patchMatches(kaTmpl, kaPatched, state, 2, ka);
+	ka.set_colour().set_blue();
+	if (!ok || !patchMatches(kaTmpl, kaPatched, colour, 2, ka))
+		printf("KeepAlive PER template patch of a bit-field ENUMERATED FAIL !!!! \n");
+
+	ka.set_priority(0);
+	ok = patchMatches(kaTmpl, kaPatched, priority, 0, ka);
+	ka.set_priority(255);
+	if (!ok || !patchMatches(kaTmpl, kaPatched, priority, 255, ka))
+		printf("KeepAlive PER template patch of a one octet INTEGER FAIL !!!! \n");
+
+	ka.set_requestSeqNum(65535);
+	ok = patchMatches(kaTmpl, kaPatched, seqNum, 65535, ka);
+	ka.set_requestSeqNum(256);
+	if (!ok || !patchMatches(kaTmpl, kaPatched, seqNum, 256, ka))
+		printf("KeepAlive PER template patch of a two octet INTEGER FAIL !!!! \n");
+
+	// values out of the range, or out of the root, would need another encoding
+	if (kaTmpl.patch(kaPatched, ttl, 7) || kaTmpl.patch(kaPatched, state, 3) || 
+		kaTmpl.patch(kaPatched, priority, 256) || kaTmpl.patch(kaPatched, seqNum, 0))
+		printf("KeepAlive PER template patch out of range FAIL !!!! \n");
+}
+
+void testPERWidth()
+{
+	// X.691 10.5.7: bit-field, one octet, two octets, then length and octets
+	const PERWidth w1(FixedConstraint, 3, 6), w2(FixedConstraint, 0, 255), 
+		w3(FixedConstraint, 0, 256), w4(FixedConstraint, 0, 65536);
+	if (w1.unalignedBits != 2 || w1.alignedBits != 2 || w1.octetAligned ||
+		w2.unalignedBits != 8 || w2.alignedBits != 8 || !w2.octetAligned ||
+		w3.unalignedBits != 9 || w3.alignedBits != 16 ||
+		w4.unalignedBits != 17 || w4.alignedBits != 0)
+		printf("PERWidth FAIL !!!! \n");
+
+	// a constrained length in the unaligned variant
+	Constrained_OCTET_STRING<SizeConstraint<FixedConstraint, 1, 4> > s1, s2;
+	s1.assign("\x01\x02\x03", "\x01\x02\x03" + 3);
+	OpenBuf buf;
+	PEREncoder encoder(buf, false);
+	if (!s1.encode(encoder))
+		printf("unaligned SIZE(1..4) OCTET STRING encode FAIL !!!! \n");
+	PERDecoder decoder(&*buf.begin(), &*buf.begin() + buf.size(), NULL, false);
+	if (!s2.decode(decoder) || s1 != s2)
+		printf("unaligned SIZE(1..4) OCTET STRING decode FAIL !!!! \n");
+}
+
+void testEncodedSize()
+{
+	BOOLEAN flag(true);
+	const EncodedSize& size = flag.getEncodedSize();
+	if (size.minPER != 1 || size.maxPER != 1 || size.minBER != 3 || size.maxBER != 3)
+		printf("BOOLEAN EncodedSize FAIL !!!! \n");
+
+	// encoded on the stack, and an input longer than any BOOLEAN is turned down when asked
+	CoderEnv env;
+	env.set_per_Basic_Aligned();
+	std::vector<char> strm;
+	if (!env.encode(flag, std::back_inserter(strm)) || strm.size() != 1)
+		printf("BOOLEAN PER encode FAIL !!!! \n");
+	strm.push_back(0);
+	BOOLEAN decoded;
+	if (!env.decode(&*strm.begin(), &*strm.begin() + strm.size(), decoded, false))
+		printf("trailing BOOLEAN PER decode FAIL !!!! \n");
+	env.set_rejectOversize();
+	if (env.decode(&*strm.begin(), &*strm.begin() + strm.size(), decoded, false))
+		printf("oversize BOOLEAN PER decode FAIL !!!! \n");
+
+	// the longest values of constrained types fit in their largest sizes
+	using namespace MyHTTP;
+	IA5Str01 ia501("012345");
+	IA5Str02 ia502("01234567890123456789");
+	IA5Str03 ia503("abcdefgh");
+	IA5Str10 ia510("TTT");
+	IA5Str11 ia511("TTTTTTTTTTTTTTTT");
+	NumberStr01 ns01("9999999999999999");
+	const AbstractData* largest[] = { &ia501, &ia502, &ia503, &ia510, &ia511, &ns01 };
+	for (unsigned i = 0; i < sizeof(largest)/sizeof(largest[0]); ++i)
+	{
+		const EncodedSize& size = largest[i]->getEncodedSize();
+		if (size.maxPER == EncodedSize::Unbounded || size.maxBER == EncodedSize::Unbounded)
+			printf("%s EncodedSize unbounded FAIL !!!! \n", largest[i]->getDescriptor()->name);
+
+		std::unique_ptr<AbstractData> decoded(largest[i]->clone());
+		strm.clear();
+		if (!env.encode(*largest[i], std::back_inserter(strm)) || strm.size() > size.maxPER ||
+			!env.decode(&*strm.begin(), &*strm.begin() + strm.size(), *decoded, false))
+			printf("%s largest PER FAIL !!!! \n", largest[i]->getDescriptor()->name);
+
+		CoderEnv berEnv;
+		berEnv.set_ber();
+		strm.clear();
+		if (!berEnv.encode(*largest[i], std::back_inserter(strm)) || strm.size() > size.maxBER)
+			printf("%s largest BER FAIL !!!! \n", largest[i]->getDescriptor()->name);
+	}
+}
+
+void testExpectedOpenData()
+{
+	// an open type whose type is known is decoded in place, without its encoding
+	OpenData value(INTEGER(300));
+	OpenBuf buf;
+	PEREncoder encoder(buf);
+	if (!value.encode(encoder))
+	{
+		printf("OpenData PER encode FAIL !!!! \n");
+		return;
+	}
+
+	OpenData decoded;
+	decoded.expect(new INTEGER);
+	PERDecoder decoder(&*buf.begin(), &*buf.begin() + buf.size());
+	if (!decoded.decode(decoder) || decoded.has_buf() || decoded.is_expected() ||
+		static_cast<INTEGER&>(decoded.get_data()) != 300)
+		printf("expected OpenData PER decode FAIL !!!! \n");
+
+#ifdef ASN1_HAS_IOSTREAM
+	// so do the text decoders, which otherwise keep the text of the value
+	const char text[] = " 300 ";
+	decoded.expect(new INTEGER);
+	JERDecoder jerDecoder(text, text + sizeof(text) - 1);
+	if (!decoded.decode(jerDecoder) || decoded.has_buf() ||
+		static_cast<INTEGER&>(decoded.get_data()) != 300)
+		printf("expected OpenData JER decode FAIL !!!! \n");
+
+	decoded.expect(new INTEGER);
+	AVNDecoder avnDecoder(text, text + sizeof(text) - 1);
+	if (!decoded.decode(avnDecoder) || decoded.has_buf() ||
+		static_cast<INTEGER&>(decoded.get_data()) != 300)
+		printf("expected OpenData AVN decode FAIL !!!! \n");
+
+	// the JSON text of a value of an unknown type is written back as it was read, 
+	// and cannot be written in a binary encoding
+	const char json[] = "{\"a\":[1, 2.5e1],\"b\":\"x\"}";
+	OpenData unknown, unknown2;
+	CoderEnv env;
+	env.set_jer();
+	std::vector<char> strm;
+	if (!decode(json, json + sizeof(json) - 1, &env, unknown) || unknown.has_buf() || 
+		!unknown.has_text(OpenData::jerText) ||
+		!encode(unknown, &env, std::back_inserter(strm)) ||
+		std::string(strm.begin(), strm.end()) != json)
+		printf("unknown OpenData JER round trip FAIL !!!! \n");
+	if (!decode(strm.begin(), strm.end(), &env, unknown2) || unknown2 != unknown)
+		printf("unknown OpenData JER decode FAIL !!!! \n");
+	env.set_per_Basic_Aligned();
+	strm.clear();
+	if (encode(unknown, &env, std::back_inserter(strm)))
+		printf("unknown OpenData from JER PER encode FAIL !!!! \n");
+	env.set_ber();
+	strm.clear();
+	if (encode(unknown, &env, std::back_inserter(strm)))
+		printf("unknown OpenData from JER BER encode FAIL !!!! \n");
+
+	const char number[] = " 2.5e1 ";
+	JERDecoder numberDecoder(number, number + sizeof(number) - 1);
+	if (!unknown.decode(numberDecoder) || !unknown.has_text(OpenData::jerText))
+		printf("OpenData JER decode FAIL !!!! \n");
+	unknown.grab(new INTEGER);
+	if (!numberDecoder.redecode(unknown) || static_cast<INTEGER&>(unknown.get_data()) != 25)
+		printf("OpenData JER redecode FAIL !!!! \n");
+
+	OpenData kept;
+	AVNDecoder textDecoder(text, text + sizeof(text) - 1);
+	if (!kept.decode(textDecoder) || kept.has_buf() || !kept.has_text(OpenData::avnText) || 
+		kept.get_text() != "300")
+		printf("OpenData AVN decode FAIL !!!! \n");
+	kept.grab(new INTEGER);
+	if (!textDecoder.redecode(kept) || static_cast<INTEGER&>(kept.get_data()) != 300)
+		printf("OpenData AVN redecode FAIL !!!! \n");
+#endif
+}
+
+// the keys of the table are integers, except the odd ones above 1000 which stand for keys
+// of another kind, such as object identifiers
+static bool tableKey(int key, int& value)
+{
+	value = key;
+	return key < 1000 || key % 2 == 0;
+}
+
+static bool checkIndex(const std::vector<std::pair<int, int> >& table, const detail::DenseIndex& index)
+{
+	for (unsigned pos = 0; pos < table.size(); ++pos)
+	{
+		unsigned found;
+		int value;
+		if (tableKey(table[pos].first, value) && (!index.lookup(value, found) || found != pos))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * The index of the integer keys of an information object set follows the insertions
+ * and the erasures one at a time, and gives way to searching when the keys are sparse.
+ */
+void testDenseIndex()
+{
+	typedef std::vector<std::pair<int, int> > Table;
+	Table table;
+	detail::DenseIndex index;
+	unsigned pos;
+
+	// dense keys, inserted in decreasing order so that every insertion moves the others
+	for (int key = 99; key >= -20; key -= 3)
+	{
+		Table::iterator i = table.insert(std::lower_bound(table.begin(), table.end(), 
+			std::make_pair(key, 0)), std::make_pair(key, 0));
+		index.inserted(table.begin(), table.end(), &tableKey, i);
+	}
+	if (!checkIndex(table, index) || !index.lookup(98, pos) || pos != index.npos ||
+		!index.lookup(-1000, pos) || pos != index.npos)
+		printf("DenseIndex dense keys FAIL !!!! \n");
+
+	// a key of another kind enters the table without entering the index
+	Table::iterator i = table.insert(table.end(), std::make_pair(1001, 0));
+	index.inserted(table.begin(), table.end(), &tableKey, i);
+	i = table.insert(std::lower_bound(table.begin(), table.end(), std::make_pair(-7, 0)), 
+		std::make_pair(-7, 0));
+	index.inserted(table.begin(), table.end(), &tableKey, i);
+	if (!checkIndex(table, index))
+		printf("DenseIndex after an insertion FAIL !!!! \n");
+
+	// lookups after erasures
+	index.erasing(table.begin(), &tableKey, table.begin() + 3);
+	int erasedKey = table[3].first;
+	table.erase(table.begin() + 3);
+	index.erasing(table.begin(), &tableKey, table.end() - 1);
+	table.erase(table.end() - 1);
+	if (!checkIndex(table, index) || !index.lookup(erasedKey, pos) || pos != index.npos)
+		printf("DenseIndex after an erasure FAIL !!!! \n");
+
+	index.rebuild(table.begin(), table.end(), &tableKey);
+	if (!checkIndex(table, index))
+		printf("DenseIndex rebuild FAIL !!!! \n");
+
+	// sparse keys leave the lookups to the table
+	i = table.insert(table.end(), std::make_pair(100000, 0));
+	index.inserted(table.begin(), table.end(), &tableKey, i);
+	if (index.lookup(0, pos))
+		printf("DenseIndex sparse keys FAIL !!!! \n");
+	index.rebuild(table.begin(), table.end(), &tableKey);
+	if (index.lookup(0, pos))
+		printf("DenseIndex rebuild with sparse keys FAIL !!!! \n");
+}
+
+void testTypeDescriptor()
+{
+	// the components are described in order with their tags, without iostreams
+	MyHTTP::GetRequest request;
+	const TypeDescriptor* descriptor = request.getDescriptor();
+	if (descriptor == NULL || descriptor->kind != TypeDescriptor::e_sequence || 
+		!descriptor->extendable || descriptor->numRootFields != 4 || descriptor->numFields != 4 ||
+		strcmp(descriptor->fields[3].name, "url") != 0 || descriptor->fields[3].id != -1 ||
+		descriptor->fields[1].id != 1 || descriptor->fields[3].tag != request.getFieldTag(3))
+		printf("GetRequest TypeDescriptor FAIL !!!! \n");
+	else if (AbstractData::getDescriptor(descriptor->fields[2].info)->kind != TypeDescriptor::e_set)
+		printf("AcceptTypes TypeDescriptor FAIL !!!! \n");
+
+	bool found = false;
+	for (const TypeDescriptor* const* itr = MyHTTP::typeDescriptors; *itr != NULL; ++itr)
+		found = found || *itr == descriptor;
+	if (!found)
+		printf("MyHTTP typeDescriptors FAIL !!!! \n");
+}
+
+// the lite struct of value must encode as the class does and decode back to it
+static void checkLiteMessage(const char* name, const MyHTTP::Transfer& value)
+{
+	OpenBuf expected, buf;
+	PEREncoder encoder(expected);
+	value.encode(encoder);
+
+	MyHTTP::lite::Transfer ls = MyHTTP::lite::Transfer();
+	lite::PERWriter out(buf);
+	if (!MyHTTP::lite::to_lite(value, ls) || !MyHTTP::lite::encode_per(out, ls) || buf != expected)
+	{
+		printf("lite %s encode_per FAIL !!!! \n", name);
+		return;
+	}
+
+	MyHTTP::lite::Transfer rs = MyHTTP::lite::Transfer();
+	lite::PERReader in(&*buf.begin(), &*buf.begin() + buf.size());
+	MyHTTP::Transfer back;
+	if (!MyHTTP::lite::decode_per(in, rs))
+	{
+		printf("lite %s decode_per FAIL !!!! \n", name);
+		return;
+	}
+	MyHTTP::lite::from_lite(rs, back);
+	if (back != value)
+		printf("lite %s from_lite FAIL !!!! \n", name);
+}
+
+void testLiteCoder()
+{
+	// the lite writer produces the encoding of the classes
+	INTEGER i(-5);
+	IA5String s;
+	s = "hello";
+	OpenBuf expected, buf;
+	PEREncoder encoder(expected);
+	i.encode(encoder);
+	s.encode(encoder);
+
+	lite::Array<char, 16> ls = lite::Array<char, 16>();
+	lite::PERWriter out(buf);
+	if (!lite::to_lite(s, ls) || !out.writeInteger(-5, i.getPERConstraint()) ||
+		!out.writeChars(ls, s.getPERConstraint(), s.getPERCharSet()) || buf != expected)
+		printf("lite PER encode FAIL !!!! \n");
+
+	int value = 0;
+	lite::Array<char, 16> rs = lite::Array<char, 16>();
+	lite::PERReader in(&*buf.begin(), &*buf.begin() + buf.size());
+	IA5String back;
+	if (!in.readInteger(value, i.getPERConstraint()) || value != -5 ||
+		!in.readChars(rs, s.getPERConstraint(), s.getPERCharSet()) || !(rs == ls))
+		printf("lite PER decode FAIL !!!! \n");
+	lite::from_lite(rs, back);
+	if (back != s)
+		printf("lite IA5String conversion FAIL !!!! \n");
+
+	// a whole message from the bindings asnparser -l writes
+	MyHTTP::Transfer msg;
+	msg.set_id(513);
+	msg.set_note("memo");
+	MyHTTP::KeepAlive& ka = msg.set_target().select_keepAlive();
+	ka.set_urgent(true);
+	ka.set_ttl(5);
+	ka.set_state().set_away();
+	ka.set_priority(200);
+	ka.set_colour().set_blue();
+	ka.set_requestSeqNum(4000);
+	msg.set_accept_types().set_others().push_back(new MyHTTP::AcceptTypes_others_subtype("text"));
+	msg.set_sender("alice");
+	msg.set_hops(17);
+	checkLiteMessage("Transfer with every field", msg);
+
+	// an extension alternative, and the last addition alone
+	MyHTTP::Transfer retry;
+	retry.set_id(0);
+	retry.set_target().select_retryAfter(90);
+	retry.set_hops(3);
+	checkLiteMessage("Transfer with an extension alternative", retry);
+
+	MyHTTP::Transfer root;
+	root.set_id(65535);
+	root.set_target().select_url("www.asn1.com");
+	checkLiteMessage("Transfer of the root", root);
+}
+
+/*
+ * Encodes then decodes a batch of messages of the shapes used above on several threads, 
+ * and compares each result with the one of a single-threaded encode or decode. The last
+ * message is truncated and must be the only one which fails to decode.
+ */
+void testBatchCoder(CoderEnv::EncodingRules rule, const char* ruleName)
+{
+	CoderEnv env;
+	env.set_encodingRule(rule);
+	env.freeze();
+
+	MyHTTP::GetRequest gr;
+	gr.set_header_only(true);
+	gr.set_accept_types().set_others().push_back(new MyHTTP::AcceptTypes_others_subtype("text"));
+	gr.set_url("www.asn1.com");
+	TEST1::S4 s4;
+	s4.set_name("A");
+	s4.set_attrib().select_f2().select_f3(true);
+	TEST1::S1 s1;
+	s1.push_back(new INTEGER(2));
+	const AbstractData* shapes[] = { &gr, &s4, &s1 };
+
+	// the messages differ from each other, so that a result given to the wrong item shows
+	const unsigned batchSize = 3*200;
+	std::vector<AbstractData*> sources(batchSize), values(batchSize);
+	std::vector<OpenBuf> outputs(batchSize);
+	std::vector<CoderEnv::EncodeItem> toEncode(batchSize);
+	std::vector<CoderEnv::DecodeItem> toDecode(batchSize);
+	for (unsigned i = 0; i < batchSize; ++i)
+	{
+		sources[i] = shapes[i%3]->clone();
+		if (i%3 == 2)
+			static_cast<TEST1::S1*>(sources[i])->push_back(new INTEGER(i));
+		values[i] = shapes[i%3]->clone();
+		CoderEnv::EncodeItem item = { sources[i], &outputs[i], false };
+		toEncode[i] = item;
+	}
+
+	for (unsigned nThreads = 1; nThreads <= 8; nThreads *= 2)
+	{
+		std::size_t encoded = env.encodeBatch(&toEncode[0], &toEncode[0] + batchSize, nThreads);
+		for (unsigned i = 0; i < batchSize; ++i)
+		{
+			CoderEnv::DecodeItem item = { &outputs[i][0], &outputs[i][0] + outputs[i].size(), values[i], false };
+			toDecode[i] = item;
+		}
+		toDecode[batchSize-1].last = toDecode[batchSize-1].first + 1;
+		std::size_t decoded = env.decodeBatch(&toDecode[0], &toDecode[0] + batchSize, nThreads);
+
+		bool ok = encoded == batchSize && decoded == batchSize-1 && !toDecode[batchSize-1].decoded;
+		for (unsigned i = 0; ok && i < batchSize; ++i)
+		{
+			std::vector<char> strm;
+			std::unique_ptr<AbstractData> single(shapes[i%3]->clone());
+			ok = toEncode[i].encoded && encode(*sources[i], &env, std::back_inserter(strm)) &&
+				OpenBuf(strm.begin(), strm.end()) == outputs[i] &&
+				decode(toDecode[i].first, toDecode[i].last, &env, *single) == toDecode[i].decoded &&
+				(!toDecode[i].decoded || (*values[i] == *single && *values[i] == *sources[i]));
+		}
+		if (!ok)
+			printf("batch encode/decode (%s) on %u threads FAIL !!!! \n", ruleName, nThreads);
+	}
+
+	for (unsigned i = 0; i < batchSize; ++i)
+	{
+		delete sources[i];
+		delete values[i];
+	}
+}
+
 int main(int argc, char* argv[])
 {
    
@@ -330,9 +1103,23 @@ int main(int argc, char* argv[])
 #endif
 #ifdef ASN1_HAS_IOSTREAM
 	ValueNotationTests();
+	testValueNotationStream();
+	testJERCoder();
 #endif
 	testBERCoder();
 	testPERCoder();
+	testHash();
+	testPERTemplate();
+	testPERWidth();
+	testEncodedSize();
+	testLiteCoder();
+	testExpectedOpenData();
+	testTypeDescriptor();
+	testDenseIndex();
+	testEncodingCache(CoderEnv::per_Basic_Aligned, "PER");
+	testEncodingCache(CoderEnv::ber, "BER");
+	testBatchCoder(CoderEnv::per_Basic_Aligned, "PER");
+	testBatchCoder(CoderEnv::ber, "BER");
 
 	std::string a("abcdefg");
 	bool b = (a == "abcdefg");
@@ -55,6 +55,7 @@ extern void H225Test(void);
 extern void H245Test(void);
 extern void H450Test(void);
 extern void H248Test(void);
+extern void EncodedSizeTest(void);
 
 extern "C" void SMC1Init();
 int main(int argc, char* argv[])
@@ -66,6 +67,7 @@ int main(int argc, char* argv[])
 	H225Test();
 	H248Test();    
 	H450Test();
+	EncodedSizeTest();
 	return 0; 
 }
 
@@ -18,6 +18,8 @@
 #include <call_transfer_operations.h>
 #include <h4501_supplementary_serviceapdu_structure.h>
 #include "asn1test.h"
+#include <thread>
+#include <atomic>
 
 #ifdef ASN1_HAS_IOSTREAM
 void EnumerationTest()
@@ -53,6 +55,19 @@ void H450Test()
 	h4501Module.get_OperationSet().insert(callTransferOperations.begin(),
 										  callTransferOperations.end());
 
+	// the index of the operation codes follows the operations inserted and erased one at a time
+	H4501::OPERATION oneByOne;
+	H4501::OPERATION::const_iterator op;
+	for (op = callTransferOperations.begin(); op != callTransferOperations.end(); ++op)
+		oneByOne.insert(*op);
+	oneByOne.erase(callTransferOperations.begin()->first);
+	bool indexed = oneByOne.size() + 1 == callTransferOperations.size() &&
+		oneByOne.find(callTransferOperations.begin()->first) == oneByOne.end();
+	for (op = ++callTransferOperations.begin(); indexed && op != callTransferOperations.end(); ++op)
+		indexed = oneByOne.find(op->first) != oneByOne.end() && oneByOne.find(op->first)->second == op->second;
+	if (!indexed)
+		printf("OPERATION set built one operation at a time FAIL !!!! \n");
+
 	ASN1::CoderEnv env;
     // set encoding rule
 
@@ -81,4 +96,83 @@ void H450Test()
 	"\x67\x00\x2D\x00\x4D\x00\x69\x00"
 	"\x6E\x00\x67\x00\x20\x00\x48\x00"
 	"\x75\x00\x61\x00\x6E\x00\x67");
+
+	// threads sharing a frozen copy of the environment each look the argument up in 
+	// the operation set of the module, and decode it in place
+	ASN1::CoderEnv sharedEnv(env);
+	sharedEnv.freeze();
+	std::vector<char> perStrm;
+	encode(pdu1, &sharedEnv, std::back_inserter(perStrm));
+	std::atomic<int> failures(0);
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < 4; ++t)
+		threads.push_back(std::thread([&]() {
+			for (int i = 0; i < 500; ++i)
+			{
+				H4501::H4501SupplementaryService result;
+				if (!decode(perStrm.begin(), perStrm.end(), &sharedEnv, result) || result != pdu1 ||
+					!result.get_serviceApdu().get_rosApdus()[0].get_invoke().get_argument().has_data())
+					++failures;
+			}
+		}));
+	for (unsigned t = 0; t < threads.size(); ++t)
+		threads[t].join();
+	printf("CTInitiate.invoke from several threads\n");
+	if (failures)
+		printf("CTInitiate.invoke with a shared CoderEnv FAIL !!!! \n");
+
+#ifdef ASN1_HAS_IOSTREAM
+	// the argument is written as JSON and read back as the type given by the opcode
+	env.set_jer();
+	std::vector<char> strm;
+	H4501::H4501SupplementaryService pdu3;
+	printf("CTInitiate.invoke (JER)\n");
+	if (!encode(pdu1, &env, std::back_inserter(strm)) ||
+		!decode(strm.begin(), strm.end(), &env, pdu3) || pdu1 != pdu3)
+		printf("CTInitiate.invoke (JER) FAIL !!!! \n");
+
+	// an argument whose opcode is not in the operation set keeps its JSON text, which 
+	// is written back as it was read but not in a binary encoding
+	H4501::H4501SupplementaryService pdu5, pdu6;
+	pdu5.set_serviceApdu().select_rosApdus().resize(1);
+	ROA::Invoke<H4501::InvokeIdSet, H4501::OperationSet>& unknownInvoke = 
+		pdu5.ref_serviceApdu().ref_rosApdus()[0].select_invoke();
+	unknownInvoke.set_invokeId(2);
+	unknownInvoke.set_opcode().select_local(999);
+	unknownInvoke.set_argument().grab(new ASN1::INTEGER(5));
+	strm.clear();
+	std::vector<char> strm2;
+	printf("unknown opcode invoke (JER)\n");
+	if (!encode(pdu5, &env, std::back_inserter(strm)) ||
+		!decode(strm.begin(), strm.end(), &env, pdu6) ||
+		!encode(pdu6, &env, std::back_inserter(strm2)) || strm != strm2)
+		printf("unknown opcode invoke (JER) FAIL !!!! \n");
+	ASN1::CoderEnv perEnv;
+	perEnv.set_per_Basic_Aligned();
+	strm2.clear();
+	if (encode(pdu6, &perEnv, std::back_inserter(strm2)))
+		printf("unknown opcode invoke from JER (PER) FAIL !!!! \n");
+
+	// the argument is decoded in place, as the opcode before it already tells its type
+	env.set_avn();
+	strm.clear();
+	H4501::H4501SupplementaryService pdu4;
+	printf("CTInitiate.invoke (AVN)\n");
+	if (!encode(pdu1, &env, std::back_inserter(strm)) ||
+		!decode(strm.begin(), strm.end(), &env, pdu4) || pdu1 != pdu4)
+		printf("CTInitiate.invoke (AVN) FAIL !!!! \n");
+
+	// so does the AVN text of the argument, which is not written as an OCTET STRING
+	H4501::H4501SupplementaryService pdu7;
+	strm.clear();
+	strm2.clear();
+	printf("unknown opcode invoke (AVN)\n");
+	if (!encode(pdu5, &env, std::back_inserter(strm)) ||
+		!decode(strm.begin(), strm.end(), &env, pdu7) ||
+		!encode(pdu7, &env, std::back_inserter(strm2)) || strm != strm2)
+		printf("unknown opcode invoke (AVN) FAIL !!!! \n");
+	strm2.clear();
+	if (encode(pdu7, &perEnv, std::back_inserter(strm2)))
+		printf("unknown opcode invoke from AVN (PER) FAIL !!!! \n");
+#endif
 }
@@ -0,0 +1,191 @@
+/*
+ * sizetest.cpp
+ *
+ * Copyright (c) 2001 Institute for Information Industry, Taiwan, Republic of China
+ * (http://www.iii.org.tw/iiia/ewelcome.htm)
+ *
+ * Permission to copy, use, modify, sell and distribute this software
+ * is granted provided this copyright notice appears in all copies.
+ * This software is provided "as is" without express or implied
+ * warranty, and with no claim as to its suitability for any purpose.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <h323_messages.h>
+#include <multimedia_system_control.h>
+#include <media_gateway_control.h>
+#include <h4501_supplementary_serviceapdu_structure.h>
+#include <set>
+#include <climits>
+#include <memory>
+#include "asn1test.h"
+
+/*
+ * Gives a value the longest encoding its constraints allow: the largest sizes of
+ * strings and lists, all the OPTIONAL components and the limits of integers. The
+ * alternatives of the CHOICEs are drawn from the seed, so that several fills of the
+ * same type go through different ones. A type which is not bounded cannot be filled.
+ */
+class LargestValue : public Visitor
+{
+public:
+	LargestValue(unsigned seed, bool upper) : Visitor(NULL), seed(seed), upper(upper) {}
+
+private:
+	bool decode(Null& value) { return true; }
+	bool decode(BOOLEAN& value) { value = true; return true; }
+	bool decode(INTEGER& value)
+	{
+		if (value.getConstraintType() == Unconstrained)
+			value = INT_MAX;
+		else
+			value = upper ? static_cast<int>(value.getUpperLimit()) : value.getLowerLimit();
+		return true;
+	}
+	bool decode(ENUMERATED& value) { value.setFromInt(value.getMaximum()); return true; }
+	bool decode(OBJECT_IDENTIFIER& value) { return false; }
+	bool decode(OCTET_STRING& value)
+	{
+		if (value.getConstraintType() == Unconstrained)
+			return false;
+		value.resize(value.getUpperLimit());
+		return true;
+	}
+	bool decode(BIT_STRING& value)
+	{
+		if (value.getConstraintType() == Unconstrained)
+			return false;
+		value.resize(value.getUpperLimit());
+		return true;
+	}
+	bool decode(ConstrainedString& value)
+	{
+		if (value.getConstraintType() == Unconstrained)
+			return false;
+		value.assign(value.getUpperLimit(), value.getCharacterSet()[value.getCharacterSetSize()-1]);
+		return true;
+	}
+	bool decode(BMPString& value)
+	{
+		if (value.getConstraintType() == Unconstrained)
+			return false;
+		value.assign(value.getUpperLimit(), value.getLastChar());
+		return true;
+	}
+	bool decode(CHOICE& value)
+	{
+		seed = seed * 1103515245 + 12345;
+		return value.select((seed >> 16) % value.getNumChoices()) && value.getSelection()->decode(*this);
+	}
+	bool decode(SEQUENCE_OF_Base& value)
+	{
+		if (value.getConstraintType() == Unconstrained)
+			return false;
+		value.resize(value.getUpperLimit());
+		for (SEQUENCE_OF_Base::iterator i = value.begin(); i != value.end(); ++i)
+			if (!(*i)->decode(*this))
+				return false;
+		return true;
+	}
+	bool decode(OpenData& value) { return false; }
+	bool redecode(OpenData& value) { return false; }
+	bool decode(TypeConstrainedOpenData& value) { return false; }
+	bool decode(GeneralizedTime& value) { return false; }
+
+	VISIT_SEQ_RESULT preDecodeExtensionRoots(SEQUENCE& value) { return NO_EXTENSION; }
+	VISIT_SEQ_RESULT decodeExtensionRoot(SEQUENCE& value, int pos, int optional_id)
+	{
+		if (optional_id != -1)
+			value.includeOptionalField(optional_id, pos);
+		return value.getField(pos)->decode(*this) ? CONTINUE : FAIL;
+	}
+
+	unsigned seed;
+	bool upper;
+};
+
+// collects the infos of the types used by the type of info
+static void collectTypes(const void* info, std::set<const void*>& types)
+{
+	if (info == NULL || !types.insert(info).second)
+		return;
+	const TypeDescriptor* descriptor = AbstractData::getDescriptor(info);
+	if (descriptor)
+		for (unsigned i = 0; i < descriptor->numFields; ++i)
+			collectTypes(descriptor->fields[i].info, types);
+}
+
+static void checkSize(const char* name, CoderEnv& env, const char* rule, const AbstractData& value,
+					  unsigned minSize, unsigned maxSize)
+{
+	std::vector<char> strm;
+	if (!env.encode(value, std::back_inserter(strm)))
+	{
+		printf("%s %s encode FAIL !!!! \n", name, rule);
+		return;
+	}
+	if (strm.size() < minSize || strm.size() > maxSize)
+	{
+		printf("%s %s EncodedSize FAIL !!!! %u octets not in [%u, %u]\n", name, rule,
+			   (unsigned)strm.size(), minSize, maxSize);
+		return;
+	}
+	// only the PER decoders turn down the inputs longer than the largest size
+	std::unique_ptr<AbstractData> decoded(value.clone());
+	if (env.is_per_Basic_Aligned() &&
+		(!env.decode(&*strm.begin(), &*strm.begin() + strm.size(), *decoded, false) || *decoded != value))
+		printf("%s %s decode FAIL !!!! \n", name, rule);
+}
+
+/*
+ * Encodes the longest values of every bounded type used by the PDUs, and checks that
+ * their encodings are no longer than the largest sizes asnparser worked out, which
+ * CoderEnv trusts to turn down the longer PER inputs.
+ */
+void EncodedSizeTest()
+{
+	std::set<const void*> types;
+	collectTypes(&H323_MESSAGES::H323_UserInformation::theInfo, types);
+	collectTypes(&H323_MESSAGES::RasMessage::theInfo, types);
+	collectTypes(&MULTIMEDIA_SYSTEM_CONTROL::MultimediaSystemControlMessage::theInfo, types);
+	collectTypes(&MEDIA_GATEWAY_CONTROL::MegacoMessage::theInfo, types);
+	collectTypes(&H4501_Supplementary_ServiceAPDU_Structure::H4501SupplementaryService::theInfo, types);
+
+	CoderEnv per, ber;
+	per.set_per_Basic_Aligned();
+	per.set_rejectOversize();
+	ber.set_ber();
+
+	unsigned checked = 0;
+	for (std::set<const void*>::const_iterator i = types.begin(); i != types.end(); ++i)
+	{
+		std::unique_ptr<AbstractData> value(AbstractData::create(*i));
+		if (!value.get())
+			continue;
+		const EncodedSize& size = value->getEncodedSize();
+		if (size.maxPER > 0x10000 || size.maxBER == EncodedSize::Unbounded)
+			continue;
+		const char* name = value->getDescriptor() ? value->getDescriptor()->name : "?";
+		for (unsigned seed = 0; seed < 16; ++seed)
+		{
+			for (int upper = 0; upper < 2; ++upper)
+			{
+				LargestValue filler(seed, upper != 0);
+				std::unique_ptr<AbstractData> largest(AbstractData::create(*i));
+				if (!largest->decode(filler))
+				{
+					printf("%s bounded but not filled FAIL !!!! \n", name);
+					break;
+				}
+				checkSize(name, per, "PER", *largest, size.minPER, size.maxPER);
+				checkSize(name, ber, "BER", *largest, size.minBER, size.maxBER);
+			}
+		}
+		++checked;
+	}
+	printf("EncodedSize of %u bounded types checked\n", checked);
+}
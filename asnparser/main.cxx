@@ -42,10 +42,15 @@
 #include <numeric>
 #include <set>
 #include <strstream>
+#include <sstream>
 #include <fstream>
+#include <iterator>
 #include <iostream>
 #include <iomanip>
+#include <thread>
+#include <atomic>
 #include <assert.h>
+#include <climits>
 #include "asn_grammar.h"
 
 #ifdef _WIN32
@@ -57,7 +62,7 @@
 unsigned lineNumber;
 std::string  fileName;
 
-unsigned fatals, warnings;
+std::atomic<unsigned> fatals, warnings;
 
 extern void yyrestart(FILE*);
 extern FILE * yyin;
@@ -101,7 +106,8 @@ static const char * CppReserveWords[] = {
 
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
 
-ModuleDefinition * Module;
+// the module being parsed or generated; each code generation thread has its own
+thread_local ModuleDefinition * Module;
 ModuleList Modules;
 ClassStack *classStack;
 ParameterList * DummyParameters;
@@ -163,6 +169,33 @@ struct strcompare : std::binary_function<const char*, const char*, bool>
 	}
 };
 
+struct NameIndexCompare : std::binary_function<unsigned, unsigned, bool>
+{
+	NameIndexCompare(const std::vector<std::string>& n) : names(n) {}
+	bool operator () (unsigned lhs, unsigned rhs) const {
+		return strcmp(names[lhs].c_str(), names[rhs].c_str()) < 0;
+	}
+	const std::vector<std::string>& names;
+};
+
+// Outputs the initializer of a table listing the positions of names in strcmp 
+// order, which lets the runtime look up value notation identifiers by binary search.
+static void GenerateNameIndex(std::ostream & cxx, const std::vector<std::string>& names)
+{
+	std::vector<unsigned> index(names.size());
+	for (size_t i = 0; i < index.size(); ++i)
+		index[i] = i;
+	std::sort(index.begin(), index.end(), NameIndexCompare(names));
+
+	cxx << "{ ";
+	for (size_t i = 0; i < index.size(); ++i) {
+		if (i != 0)
+			cxx << ", ";
+		cxx << index[i];
+	}
+	cxx << " }";
+}
+
 static std::string MakeIdentifierC(const std::string & identifier)
 {
 
@@ -237,50 +270,88 @@ std::string GetFileTitle(const std::string& fullname)
 }
 
 
-class OutputFile : public std::ofstream
+// A generated file is collected in memory and only written out by Close()
+// when it differs from what is already on disk; an unchanged output keeps
+// its timestamp, so make does not recompile anything that depends on it.
+class OutputFile : public std::ostringstream
 {
   public:
-	 OutputFile() {}
+	 OutputFile(StringList* outputs = NULL) : outputs(outputs), opened(false) {}
     ~OutputFile() { Close(); }
 
     bool Open(const std::string & path, const char* suffix, const char * extension);
     void Close();
+	bool is_open() const { return opened; }
 	const std::string& GetFilePath() const  { return filename; }
 private:
 	OutputFile(const OutputFile&);
 	OutputFile& operator = (const OutputFile&);
 	std::string filename;
+	StringList* outputs;
+	bool opened;
 };
 
 
+static bool WriteIfChanged(const std::string & filename, const std::string & contents)
+{
+  {
+    std::ifstream current(filename.c_str());
+    if (current.is_open() &&
+        std::string(std::istreambuf_iterator<char>(current),
+                    std::istreambuf_iterator<char>()) == contents)
+      return true;
+  }
+
+  std::ofstream file(filename.c_str());
+  if (file.is_open() && (file << contents).flush())
+    return true;
+
+  std::cerr << "asnparser : cannot create " << filename << std::endl;
+  return false;
+}
+
+
 bool OutputFile::Open(const std::string & path,
                       const char * suffix,
                       const char * extension)
 {
+  Close();
   filename = path + suffix + extension;
-  open(filename.c_str());
-  if (is_open()) {
-    *this << "//\n"
-             "// " << GetFileName(filename) << "\n"
-             "//\n"
-             "// Code automatically generated by asnparser.\n"
-             "//\n"
-             "\n";
-	return true;
+  str(std::string());
+  clear();
+
+  // the contents are only written on Close(), but a file which cannot be
+  // created is reported now, as it was when it was written straight away
+  if (!std::ofstream(filename.c_str(), std::ios_base::app).is_open()) {
+    std::cerr << "asnparser : cannot create " << filename << std::endl;
+    fatals++;
+    return false;
   }
-  std::cerr << "asnparser : cannot create " << filename << std::endl;
-  return false;
+
+  opened = true;
+  if (outputs)
+    outputs->push_back(filename);
+
+  *this << "//\n"
+           "// " << GetFileName(filename) << "\n"
+           "//\n"
+           "// Code automatically generated by asnparser.\n"
+           "//\n"
+           "\n";
+  return true;
 }
 
 
 void OutputFile::Close()
 {
-  if (is_open())
-    *this << "\n"
-             "// End of " << GetFileName(filename) << '\n';
-  using namespace std;
+  if (!opened)
+    return;
 
-  ofstream::close();
+  *this << "\n"
+           "// End of " << GetFileName(filename) << '\n';
+  opened = false;
+  if (!WriteIfChanged(filename, str()))
+    fatals++;
 }
 
 
@@ -332,18 +403,26 @@ std::ostream& operator << (std::ostream& os, const std::vector<std::shared_ptr<T
 //
 
 int verbose=0;
+bool makeDependencies = false;
+bool generateLite = false;
+// set once CacheTypeInfo() has run for every module. Its caches are then only read: what
+// they lack, such as the sizes of the types of information objects, is worked out anew
+// each time, so that it neither races nor depends on which module is written first.
+bool typeInfoCached = false;
 
 int main(int argc, char** argv)
 {
 
   extern int yydebug ;			//  nonzero means print parse trace	
 
-  const char* opt = "cdo:s:vm:";
+  const char* opt = "cdo:s:vm:j:Mr:l";
 
   int c;
   unsigned classesPerFile = 0;
+  unsigned jobs = 1;
   bool generateCpp = false;
   std::string path;
+  std::vector<std::string> roots;
 
   while ((c=getopt(argc, argv, opt)) != -1) {
 	  switch (c) {
@@ -363,6 +442,18 @@ int main(int argc, char** argv)
 		case 'v':
 			++verbose;
 			break;
+		case 'j':
+			jobs = atoi(optarg);
+			break;
+		case 'M':
+			makeDependencies = true;
+			break;
+		case 'r':
+			roots.push_back(optarg);
+			break;
+		case 'l':
+			generateLite = true;
+			break;
 	  }
   }
 
@@ -376,6 +467,10 @@ int main(int argc, char** argv)
               "  -s  n       Split output if it has more than n (default 50) classes\n"
               "  -o  dir     Output directory\n"
               "  -m  name    Macro name for generating DLLs under windows with MergeSym\n"
+              "  -j  n       Generate the C++ files of up to n modules in parallel\n"
+              "  -M          Write a make dependency file (.d) for each module\n"
+              "  -r  name    Only generate what Module.Type or Module.ObjectSet uses (may be repeated)\n"
+              "  -l          Also generate the lite bindings (<file>_lite.h/.cxx)\n"
 			  << std::endl;
     return 1;
   }
@@ -439,24 +534,69 @@ int main(int argc, char** argv)
          module->AddToRemoveList(RemoveList[i].substr(dotpos+1, RemoveList[i].size()-1));
   }
 
-  for (i = 0 ; i < Modules.size(); ++i) {
+  for (i = 0 ; i < Modules.size(); ++i)
       Modules[i]->RemoveReferences(verbose !=0 );
-	  Modules[i]->AdjustImportedModules();
+
+  if (roots.size()) {
+	  for (i = 0; i < roots.size(); ++i) {
+		  int dotpos = roots[i].find('.');
+		  ModuleDefinition* module = FindModule(roots[i].substr(0, dotpos).c_str());
+		  if (dotpos == -1 || !module || !module->MarkReachable(roots[i].substr(dotpos+1))) {
+			  std::cerr << "asnparser: cannot find root \"" << roots[i] << '"' << std::endl;
+			  return 1;
+		  }
+	  }
+	  for (i = 0 ; i < Modules.size(); ++i)
+		  Modules[i]->MarkTypesUsedByClasses();
+	  for (i = 0 ; i < Modules.size(); ++i)
+		  Modules[i]->RemoveUnreachableTypes(verbose != 0);
   }
 
-  for (i = 0; i < Modules.size(); ++i) {
-	Module = Modules[i].get();
-    if (verbose > 1)
-      std::cerr << "Module " << *Module << std::endl;
+  for (i = 0 ; i < Modules.size(); ++i)
+	  Modules[i]->AdjustImportedModules();
+
+  // from here on fatals counts the errors of generating the files, which
+  // make the run fail, so that a build does not go on with stale files
+  fatals = 0;
 
-    if (generateCpp)
-      Module->GenerateCplusplus(path,
-                                classesPerFile,
-                                verbose!=0);
+  if (generateCpp) {
+	// Rewriting the types may touch the modules they import from, so it
+	// is done for every module, in order, before any file is written.
+	for (i = 0; i < Modules.size(); ++i) {
+	  Module = Modules[i].get();
+      if (verbose > 1)
+        std::cerr << "Module " << *Module << std::endl;
+
+	  Module->PrepareCplusplus(verbose!=0);
+	}
+	// The sizes of a recursive type depend on where working them out
+	// starts, so they are worked out in module order, once.
+	for (i = 0; i < Modules.size(); ++i)
+	  Modules[i]->CacheTypeInfo();
+	typeInfoCached = true;
+
+	// Writing only reads the parse trees and can then run per module.
+	if (jobs > 1 && Modules.size() > 1) {
+	  std::atomic<size_t> next(0);
+	  std::vector<std::thread> workers;
+	  for (i = 0; i < jobs && i < Modules.size(); ++i)
+		workers.push_back(std::thread([&] {
+		  size_t n;
+		  while ((n = next++) < Modules.size()) {
+			Module = Modules[n].get();
+			Module->OutputCplusplus(path, classesPerFile, verbose!=0);
+		  }
+		}));
+	  for_all(workers, std::mem_fn(&std::thread::join));
+	}
+	else for (i = 0; i < Modules.size(); ++i) {
+	  Module = Modules[i].get();
+	  Module->OutputCplusplus(path, classesPerFile, verbose!=0);
+	}
   }
   
   delete classStack;
-  return 0;
+  return fatals != 0;
 }
 
 
@@ -793,6 +933,45 @@ void Constraint::GenerateObjectSetInstanceCode(const std::string& prefix, std::o
 		(*it)->GenerateObjectSetInstanceCode(prefix, cxx);
 }
 
+size_t Constraint::GetObjectSetInstanceCount() const
+{
+	size_t count = 0;
+	ConstraintElementVector::const_iterator it;
+	for (it = standard.begin(); it != standard.end(); ++it)
+		count += (*it)->GetObjectSetInstanceCount();
+	for (it = extensions.begin(); it != extensions.end(); ++it)
+		count += (*it)->GetObjectSetInstanceCount();
+	return count;
+}
+
+void Constraint::MarkReachable(ModuleDefinition& module) const
+{
+	ConstraintElementVector::const_iterator it = standard.begin(),
+		last = standard.end();
+
+	for (; it != last; ++it)
+		(*it)->MarkReachable(module);
+
+	for (it = extensions.begin(), last = extensions.end();
+		 it != last;
+		 ++it)
+		(*it)->MarkReachable(module);
+}
+
+void Constraint::ResolveReferences() const
+{
+	ConstraintElementVector::const_iterator it = standard.begin(),
+		last = standard.end();
+
+	for (; it != last; ++it)
+		(*it)->ResolveReferences();
+
+	for (it = extensions.begin(), last = extensions.end();
+		 it != last;
+		 ++it)
+		(*it)->ResolveReferences();
+}
+
 
 void Constraint::GenerateObjSetAccessCode(std::ostream& cxx)
 {
@@ -1069,6 +1248,31 @@ void ElementListConstraintElement::GenerateObjectSetInstanceCode(const std::stri
 		(*i)->GenerateObjectSetInstanceCode(prefix, cxx);
 }
 
+size_t ElementListConstraintElement::GetObjectSetInstanceCount() const
+{
+	size_t count = 0;
+	ConstraintElementVector::const_iterator i = elements.begin(), e = elements.end();
+	for (; i != e; ++i)
+		count += (*i)->GetObjectSetInstanceCount();
+	return count;
+}
+
+void ElementListConstraintElement::MarkReachable(ModuleDefinition& module) const
+{
+	ConstraintElementVector::const_iterator i = elements.begin(), e = elements.end();
+	for (; i != e; ++i)
+		(*i)->MarkReachable(module);
+}
+
+bool ElementListConstraintElement::ResolveReferences() const
+{
+	bool resolved = true;
+	ConstraintElementVector::const_iterator i = elements.begin(), e = elements.end();
+	for (; i != e; ++i)
+		resolved = (*i)->ResolveReferences() && resolved;
+	return resolved;
+}
+
 void ElementListConstraintElement::GenerateObjSetAccessCode(std::ostream& cxx)
 {
 	ConstraintElementVector::const_iterator i = elements.begin(), e = elements.end();
@@ -1170,6 +1374,12 @@ bool SingleValueConstraintElement::GetCharacterSet(std::string& characterSet) co
 	return false;
 }
 
+bool SingleValueConstraintElement::ResolveReferences() const
+{
+	value->ResolveReferences();
+	return true;
+}
+
 /////////////////////////////////////////////////////////
 
 ValueRangeConstraintElement::ValueRangeConstraintElement(ValuePtr lowerBound, ValuePtr upperBound)
@@ -1259,6 +1469,13 @@ bool ValueRangeConstraintElement::GetCharacterSet(std::string& characterSet) con
     return false;
 }
 
+bool ValueRangeConstraintElement::ResolveReferences() const
+{
+	lower->ResolveReferences();
+	upper->ResolveReferences();
+	return true;
+}
+
 
 /////////////////////////////////////////////////////////
 
@@ -1318,6 +1535,12 @@ std::string SubTypeConstraintElement::GetSubTypeName() const
     return subtype->GetTypeName();
 }
 
+bool SubTypeConstraintElement::ResolveReferences() const
+{
+	subtype->ResolveReferences();
+	return true;
+}
+
 
 
 /////////////////////////////////////////////////////////
@@ -1345,6 +1568,13 @@ bool NestedConstraintConstraintElement::HasPERInvisibleConstraint(const Paramete
 	return constraint->HasPERInvisibleConstraint(param);
 }
 
+bool NestedConstraintConstraintElement::ResolveReferences() const
+{
+	if (constraint.get())
+		constraint->ResolveReferences();
+	return true;
+}
+
 ///////////////////////////////////////////////////////
 
 SizeConstraintElement::SizeConstraintElement(ConstraintPtr constraint)
@@ -1676,6 +1906,11 @@ bool TypeBase::IsChoice() const
   return false;
 }
 
+const TypeBase* TypeBase::GetIntegerAlternative() const
+{
+  return NULL;
+}
+
 
 bool TypeBase::IsParameterizedType() const
 {
@@ -1736,6 +1971,19 @@ bool TypeBase::ReferencesType(const TypeBase &) const
   return false;
 }
 
+bool TypeBase::CollectReferences(StringList &) const
+{
+  return true;
+}
+
+
+void TypeBase::ResolveReferences() const
+{
+  ResolveReference();
+  for (size_t i = 0; i < constraints.size(); i++)
+    constraints[i]->ResolveReferences();
+}
+
 
 bool TypeBase::IsParameterisedImport() const
 {
@@ -1812,6 +2060,7 @@ void TypeBase::EndGenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std:
       << "inline bool " << GetClassNameString() << "::equal_type(const ASN1::AbstractData& type)\n" 
       << "{ return type.info() == reinterpret_cast<const ASN1::AbstractData::InfoType*>(&theInfo); }" << "\n\n";
 
+  GenerateEncodedSize(hdr);
   GenerateInfo(this, hdr, cxx);
 
   hdr << indent << "};\n\n";
@@ -1820,15 +2069,373 @@ void TypeBase::EndGenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std:
   isGenerated = true;
 }
 
+/////////////////////////////////////////////////////////
+//
+//  Sizes of the encodings, as the runtime writes them
+//
+
+SizeRange& SizeRange::operator += (const SizeRange& next)
+{
+	min = min + next.min < min ? UnboundedSize : min + next.min;
+	max = max + next.max < max ? UnboundedSize : max + next.max;
+	return *this;
+}
+
+SizeRange& SizeRange::operator |= (const SizeRange& other)
+{
+	min = std::min(min, other.min);
+	max = std::max(max, other.max);
+	return *this;
+}
+
+static unsigned long Multiply(unsigned long lhs, unsigned long rhs)
+{
+	if (lhs == UnboundedSize || rhs == UnboundedSize)
+		return lhs == 0 || rhs == 0 ? 0 : UnboundedSize;
+	return rhs != 0 && lhs > UnboundedSize / rhs ? UnboundedSize : lhs * rhs;
+}
+
+// count times the encoding of size
+static SizeRange Repeat(const SizeRange& count, const SizeRange& size)
+{
+	return SizeRange(Multiply(count.min, size.min), Multiply(count.max, size.max));
+}
+
+static unsigned SignificantBits(unsigned long long value)
+{
+	unsigned nBits = 0;
+	while (value != 0) {
+		value >>= 1;
+		nBits++;
+	}
+	return nBits;
+}
+
+/*
+ * A whole number constrained to range values in aligned PER (X.691 10.5.7), alignment 
+ * included. The widest ones are preceded by their length in octets.
+ */
+static SizeRange WholeNumberBits(unsigned long long range)
+{
+	if (range <= 1)
+		return SizeRange(0, 0);
+	unsigned nBits = SignificantBits(range - 1);
+	if (range <= 255)
+		return SizeRange(nBits, nBits);
+	if (range == 256)
+		return SizeRange(8, 8+7);
+	if (range <= 65536)
+		return SizeRange(16, 16+7);
+	unsigned nOctets = (nBits+7)/8;
+	SizeRange result = WholeNumberBits(nOctets);
+	result += SizeRange(8, 7 + nOctets*8);
+	return result;
+}
+
+// a length which is not constrained, up to the 16K the runtime supports (X.691 10.9.3.6, 10.9.3.7)
+static const SizeRange LengthBits(8, 7+16);
+
+// an INTEGER which is not constrained: its length and up to 5 octets
+static const SizeRange IntegerBits(8+8, 7+8+40);
+
+/*
+ * The constraint of a type, as written in its InfoType by GenerateInfo(), read back as 
+ * numbers. Returns false if there is no constraint or a bound is not a number, like a 
+ * value reference.
+ */
+static bool GetBounds(const std::string& constraint, std::string& kind, long long& lower, long long& upper)
+{
+	std::istringstream strm(constraint);
+	char comma = 0;
+	strm >> kind;
+	if (kind.empty() || kind[kind.size()-1] != ',')
+		return false;
+	kind.erase(kind.size()-1);
+	if (kind.compare(0, 6, "ASN1::") == 0)
+		kind.erase(0, 6);
+	if (!(strm >> lower >> comma) || comma != ',' || !(strm >> upper))
+		return false;
+	strm >> std::ws;
+	return strm.eof() && lower <= upper;
+}
+
+static std::string GetValueBounds(const TypeBase& type)
+{
+	std::string str = "ASN1::Unconstrained, 0, UINT_MAX";
+	if (type.GetConstraints().size())
+	{
+		str.clear();
+		type.GetConstraints()[0]->GetConstraint(str);
+	}
+	return str;
+}
+
+// the SIZE constraint of the first constraint of type or, when anyConstraint, of any of them
+static std::string GetSizeBounds(const TypeBase& type, bool anyConstraint)
+{
+	const SizeConstraintElement* sizeConstraint = NULL;
+	for (size_t i = 0; i < type.GetConstraints().size() && (i == 0 || anyConstraint); ++i)
+		if ((sizeConstraint = type.GetConstraints()[i]->GetSizeConstraint()) != NULL)
+			break;
+
+	if (sizeConstraint == NULL)
+		return "ASN1::Unconstrained, 0, UINT_MAX";
+
+	std::string str;
+	sizeConstraint->GetConstraint(str);
+	return str.substr(0, str.size()-2);
+}
+
+/*
+ * The length of something constrained by bounds, which can also be the number of 
+ * elements or characters, in aligned PER (X.691 10.9). count is set to how many.
+ */
+static SizeRange ConstrainedLengthBits(const std::string& bounds, SizeRange& count)
+{
+	std::string kind;
+	long long lower, upper;
+	if (!GetBounds(bounds, kind, lower, upper) || lower < 0 || 
+		(kind != "FixedConstraint" && kind != "ExtendableConstraint"))
+	{
+		count = SizeRange();
+		return LengthBits;
+	}
+
+	count = SizeRange(lower, upper);
+	SizeRange result = upper < 65536 ? WholeNumberBits(upper - lower + 1) : LengthBits;
+	if (kind == "ExtendableConstraint")
+	{
+		result = SizeRange(1 + result.min);
+		count.max = UnboundedSize;
+	}
+	return result;
+}
+
+// the length octets of BER contents of size octets
+static unsigned long BERLengthOctets(unsigned long size)
+{
+	if (size == UnboundedSize)
+		return UnboundedSize;
+	return size < 128 ? 1 : 1 + (SignificantBits(size)+7)/8;
+}
+
+// the contents octets of an INTEGER of value, in two's complement (X.690 8.3.2)
+static unsigned long IntegerOctets(long long value)
+{
+	unsigned long nOctets = 1;
+	while (value > 127 || value < -128) {
+		value >>= 8;
+		nOctets++;
+	}
+	return nOctets;
+}
+
+// an INTEGER or ENUMERATED value the runtime holds, which is an int or an unsigned
+static const SizeRange IntegerContents(1, 5);
+
+namespace {
+
+// the sizes worked out before writing, and those this thread is working out
+typedef std::pair<const TypeBase*, const TypeBase*> SizeKey;
+std::map<SizeKey, SizeRange> perBitsCache, berOctetsCache;
+thread_local std::set<SizeKey> perBitsSizing, berOctetsSizing;
+
+}
+
+SizeRange TypeBase::GetPERBits(const TypeBase& type) const
+{
+	SizeKey key(this, &type);
+	std::map<SizeKey, SizeRange>::const_iterator it = perBitsCache.find(key);
+	if (it != perBitsCache.end())
+		return it->second;
+
+	// the encodings of a recursive type have no largest size
+	if (!perBitsSizing.insert(key).second)
+		return SizeRange();
+	SizeRange result = ComputePERBits(type);
+	perBitsSizing.erase(key);
+	return typeInfoCached ? result : (perBitsCache[key] = result);
+}
+
+SizeRange TypeBase::GetBEROctets(const TypeBase& type) const
+{
+	SizeKey key(this, &type);
+	std::map<SizeKey, SizeRange>::const_iterator it = berOctetsCache.find(key);
+	if (it != berOctetsCache.end())
+		return it->second;
+
+	if (!berOctetsSizing.insert(key).second)
+		return SizeRange();
+	SizeRange contents = ComputeBERContents(type);
+	berOctetsSizing.erase(key);
+
+	// an untagged CHOICE or open type has no identifier and length octets of its own
+	SizeRange result;
+	const Tag& typeTag = type.GetTag();
+	if ((typeTag.type << 22 | typeTag.number) != 0)
+	{
+		unsigned long identifier = typeTag.number < 31 ? 1 : 1 + (SignificantBits(typeTag.number)+6)/7;
+		result = SizeRange(identifier + BERLengthOctets(contents.min), 
+			contents.max == UnboundedSize ? UnboundedSize : identifier + BERLengthOctets(contents.max));
+		result += contents;
+	}
+	else
+		result = contents;
+	return typeInfoCached ? result : (berOctetsCache[key] = result);
+}
+
+SizeRange TypeBase::ComputePERBits(const TypeBase&) const
+{
+	return SizeRange();
+}
+
+SizeRange TypeBase::ComputeBERContents(const TypeBase&) const
+{
+	return SizeRange();
+}
+
+/*
+ * Writes the sizes as the constants of the class, which its InfoType refers to. The PER
+ * encoding of a value takes at least one octet (X.691 10.1.3).
+ */
+void TypeBase::GenerateEncodedSize(std::ostream & hdr) const
+{
+	SizeRange perBits = GetPERBits(*this), berOctets = GetBEROctets(*this);
+	unsigned long sizes[4] = { 
+		(perBits.min + 7)/8, 
+		perBits.max == UnboundedSize ? UnboundedSize : std::max(1UL, (perBits.max + 7)/8),
+		berOctets.min, 
+		berOctets.max
+	};
+	const char* names[4] = { "minPERSize", "maxPERSize", "minBERSize", "maxBERSize" };
+
+	hdr << Indent(hdr.precision()+4) << "enum { ";
+	for (int i = 0; i < 4; ++i)
+	{
+		if (i != 0)
+			hdr << ", ";
+		hdr << names[i] << " = ";
+		if (sizes[i] >= UINT_MAX)
+			hdr << "ASN1::EncodedSize::Unbounded";
+		else
+			hdr << sizes[i];
+	}
+	hdr << " };\n";
+}
+
+// the InfoType member of the sizes written by GenerateEncodedSize()
+static void GenerateEncodedSizeInfo(const TypeBase* type, std::ostream& cxx)
+{
+	const std::string& name = type->GetClassNameString();
+	cxx << "    { " << name << "::minPERSize, " << name << "::maxPERSize, "
+		<< name << "::minBERSize, " << name << "::maxBERSize }";
+}
+
+// the InfoType member of the descriptor written by GenerateDescriptor()
+static void GenerateDescriptorInfo(const TypeBase* type, std::ostream& cxx)
+{
+	cxx << ",\n"
+		<< "    &" << type->GetClassNameString() << "::theDescriptor";
+}
+
+// the declarations of what GenerateFieldDescriptors() and GenerateDescriptor() define
+static void GenerateDescriptorDecl(size_t numFields, std::ostream& hdr)
+{
+	Indent indent(hdr.precision()+4);
+	hdr << indent << "static const ASN1::TypeDescriptor theDescriptor;\n";
+	if (numFields > 0)
+		hdr << indent << "static const ASN1::TypeDescriptor::Field fieldDescriptors[" << numFields << "];\n";
+}
+
+// a TypeDescriptor::Field, name is NULL or quoted
+static std::string FieldDescriptor(const std::string& name, const std::string& info, const std::string& tag, int id)
+{
+	std::ostringstream strm;
+	strm << "{ " << name << ", " << info << ", " << tag << ", " << id << " }";
+	return strm.str();
+}
+
+// the TypeDescriptor::Field of the component or alternative field at position pos
+static std::string ComponentDescriptor(const TypeBase& field, size_t pos, bool autoTag, int id)
+{
+	std::ostringstream tag;
+	if (autoTag)
+		tag << "0x" << std::hex << std::setw(6) << std::setfill('0') << (Tag::ContextSpecific << 22 | pos);
+	else
+		field.GenerateTags(tag);
+
+	return FieldDescriptor('"' + field.GetName() + '"',
+	                       field.IsRemovedType() ? "NULL" : "&" + field.GetIdentifier() + "::value_type::theInfo",
+	                       tag.str(), id);
+}
+
+// writes type::fieldDescriptors and returns it, or NULL when there are no fields
+static std::string GenerateFieldDescriptors(const TypeBase* type, const std::vector<std::string>& fields, std::ostream& cxx)
+{
+	if (fields.empty())
+		return "NULL";
+
+	const std::string& name = type->GetClassNameString();
+	cxx << type->GetTemplatePrefix()
+		<< "const ASN1::TypeDescriptor::Field " << name << "::fieldDescriptors[" << fields.size() << "] = {\n";
+	for (size_t i = 0; i < fields.size(); ++i)
+		cxx << "    " << fields[i] << (i+1 < fields.size() ? ",\n" : "\n");
+	cxx << "};\n\n";
+	return name + "::fieldDescriptors";
+}
+
+// writes type::theDescriptor, bounds are those of the InfoType of type
+static void GenerateDescriptor(const TypeBase* type, const char* kind, const std::string& bounds, bool extendable,
+							   size_t numRootFields, size_t numFields, const std::string& fields, std::ostream& cxx)
+{
+	cxx << type->GetTemplatePrefix()
+		<< "const ASN1::TypeDescriptor " << type->GetClassNameString() << "::theDescriptor = {\n"
+		<< "    ASN1::TypeDescriptor::" << kind << ",\n"
+		<< "    \"" << type->GetName() << "\",\n"
+		<< "    { " << bounds << " },\n"
+		<< "    " << (extendable ? "true" : "false") << ",\n"
+		<< "    " << numRootFields << ", " << numFields << ", " << fields << "\n"
+		<< "};\n\n";
+
+	// the table of the module lists those of its types which are not templates
+	if (type->GetTemplatePrefix().empty())
+		Module->AddDescriptor(*type);
+}
+
+// the TypeDescriptor::Kind of the types which have no GenerateInfo() of their own
+static const char* GetDescriptorKind(const char* ancestor)
+{
+	static const char* const kinds[][2] = {
+		{ "ASN1::Null", "e_null" },
+		{ "ASN1::BOOLEAN", "e_boolean" },
+		{ "ASN1::REAL", "e_real" },
+		{ "ASN1::OBJECT_IDENTIFIER", "e_objectId" },
+		{ "ASN1::GeneralizedTime", "e_time" },
+		{ "ASN1::UTCTime", "e_time" },
+		{ "ASN1::ObectDescriptor", "e_string" },
+		{ "ASN1::UnrCHARACTOR_STRING", "e_string" }
+	};
+
+	for (size_t i = 0; ancestor != NULL && i < sizeof(kinds)/sizeof(kinds[0]); ++i)
+		if (strcmp(ancestor, kinds[i][0]) == 0)
+			return kinds[i][1];
+	return "e_openType";
+}
+
 void TypeBase::GenerateInfo(const TypeBase* type, std::ostream & hdr, std::ostream& cxx)
 {
   Indent indent(hdr.precision()+4) ;
   hdr << indent << "static const InfoType theInfo;\n";
+  GenerateDescriptorDecl(0, hdr);
+  GenerateDescriptor(type, GetDescriptorKind(GetAncestorClass()), "ASN1::Unconstrained, 0, 0", false, 0, 0, "NULL", cxx);
   cxx << GetTemplatePrefix()
       << "const "<< type->GetClassNameString() << "::InfoType " <<  type->GetClassNameString() << "::theInfo = {\n"
       << "    " << GetAncestorClass() << "::create,\n"
       << "    ";
   type->GenerateTags(cxx);
+  cxx << ",\n";
+  GenerateEncodedSizeInfo(type, cxx);
+  GenerateDescriptorInfo(type, cxx);
   cxx << "\n"
       << "};\n\n";
 }
@@ -1842,6 +2449,7 @@ void TypeBase::GenerateTags(std::ostream & cxx) const
 }
 
 
+
 void TypeBase::GenerateCplusplusConstraints(const std::string & prefix, std::ostream & hdr, std::ostream & cxx, std::ostream & inl) const
 {
   for (size_t i = 0; i < constraints.size(); i++)
@@ -2024,6 +2632,13 @@ bool DefinedType::IsChoice() const
   return false;
 }
 
+const TypeBase* DefinedType::GetIntegerAlternative() const
+{
+  if (baseType.get())
+    return baseType->GetIntegerAlternative();
+  return NULL;
+}
+
 
 bool DefinedType::IsParameterizedType() const
 {
@@ -2039,9 +2654,16 @@ bool DefinedType::ReferencesType(const TypeBase & type) const
   return type.GetName() == referenceName;
 }
 
-bool DefinedType::UseType(const TypeBase & type) const
+bool DefinedType::CollectReferences(StringList & names) const
 {
-  return type.GetName() == referenceName;
+  ResolveReference();
+  names.push_back(referenceName);
+  return true;
+}
+
+bool DefinedType::UseType(const TypeBase & type) const
+{
+  return type.GetName() == referenceName;
 }
 
 void DefinedType::GenerateOperators(std::ostream & hdr, std::ostream & cxx, const TypeBase & actualType)
@@ -2193,6 +2815,23 @@ void DefinedType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ost
 		baseType->GenerateInfo(type, hdr, cxx);
 }
 
+// a reference which has no InfoType of its own has the sizes of the type it refers to
+SizeRange DefinedType::ComputePERBits(const TypeBase& type) const
+{
+	ResolveReference();
+	if (baseType.get() == NULL)
+		return SizeRange();
+	return baseType->ComputePERBits(&type == this && !NeedGenInfo() ? *baseType : type);
+}
+
+SizeRange DefinedType::ComputeBERContents(const TypeBase& type) const
+{
+	ResolveReference();
+	if (baseType.get() == NULL)
+		return SizeRange();
+	return baseType->ComputeBERContents(&type == this && !NeedGenInfo() ? *baseType : type);
+}
+
 TypePtr DefinedType::FlattenThisType(TypePtr& self, const TypeBase & parent)
 {
 	TypePtr result = self;
@@ -2273,6 +2912,11 @@ bool ParameterizedType::ReferencesType(const TypeBase & type) const
   return DefinedType::ReferencesType(type);
 }
 
+bool ParameterizedType::CollectReferences(StringList &) const
+{
+  return false;
+}
+
 bool ParameterizedType::UseType(const TypeBase & type) const
 {
 
@@ -2363,11 +3007,23 @@ bool SelectionType::CanReferenceType() const
 }
 
 
+void SelectionType::ResolveReferences() const
+{
+  TypeBase::ResolveReferences();
+  baseType->ResolveReferences();
+}
+
+
 bool SelectionType::ReferencesType(const TypeBase & type) const
 {
   return baseType->ReferencesType(type);
 }
 
+bool SelectionType::CollectReferences(StringList & names) const
+{
+  return baseType->CollectReferences(names);
+}
+
 bool SelectionType::UseType(const TypeBase& type) const 
 {
   return baseType->UseType(type);
@@ -2403,6 +3059,16 @@ void BooleanType::GenerateConstructors(std::ostream & hdr, std::ostream & , std:
   hdr << indent << GetIdentifier() << "(const void* info) : Inherited(info) {}\n";
 }
 
+SizeRange BooleanType::ComputePERBits(const TypeBase&) const
+{
+	return SizeRange(1, 1);
+}
+
+SizeRange BooleanType::ComputeBERContents(const TypeBase&) const
+{
+	return SizeRange(1, 1);
+}
+
 
 /////////////////////////////////////////////////////////
 
@@ -2487,15 +3153,27 @@ void IntegerType::GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std:
 
 }
 
+static bool CompareNamedNumber(const NamedNumberPtr& lhs, const NamedNumberPtr& rhs)
+{
+	return lhs->GetNumber() < rhs->GetNumber();
+}
+
 void IntegerType::GenerateInfo(const TypeBase* type, std::ostream& hdr , std::ostream& cxx)
 {
     Indent indent(hdr.precision()+4);
     hdr << indent << "static const InfoType theInfo;\n";
+    GenerateDescriptorDecl(allowedValues.size(), hdr);
+
+	// the runtime looks up the entries by value with binary search
+	std::vector<NamedNumberPtr> entries(allowedValues.begin(), allowedValues.end());
+	std::stable_sort(entries.begin(), entries.end(), CompareNamedNumber);
+
 	if ( !allowedValues.empty()  )
     {
 		hdr	<< indent -2 << "private:\n"
 			<< "#ifdef ASN1_HAS_IOSTREAM\n"
 			<< indent << "static const NameEntry nameEntries[" << allowedValues.size() << "];\n"
+			<< indent << "static const unsigned nameIndex[" << allowedValues.size() << "];\n"
 			<< "#endif\n";
 
         cxx << "#ifdef ASN1_HAS_IOSTREAM\n"
@@ -2503,23 +3181,34 @@ void IntegerType::GenerateInfo(const TypeBase* type, std::ostream& hdr , std::os
             << "const " << type->GetClassNameString() << "::NameEntry " << type->GetClassNameString() 
 			<< "::nameEntries[" << allowedValues.size() << "] = {\n";
 
-		NamedNumberList::iterator itr, last = allowedValues.end();
-		for (itr = allowedValues.begin() ; itr != last ; ++itr ) {
-			if (itr != allowedValues.begin())
+		std::vector<std::string> names;
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if (i != 0)
 				cxx << ",\n";
 
-			cxx << "    { " << (*itr)->GetNumber() << ", \"" 
-				        << (*itr)->GetName() << "\"}";
-
+			cxx << "    { " << entries[i]->GetNumber() << ", \"" 
+				        << entries[i]->GetName() << "\"}";
+			names.push_back(entries[i]->GetName());
 		}
 			
 		cxx << "\n"
-			<< "};\n"
+			<< "};\n\n"
+			<< type->GetTemplatePrefix()
+			<< "const unsigned " << type->GetClassNameString() 
+			<< "::nameIndex[" << allowedValues.size() << "] = ";
+		GenerateNameIndex(cxx, names);
+		cxx << ";\n"
 			<< "#endif\n\n";
 	}
-		
 
+	// the named numbers, also without ASN1_HAS_IOSTREAM
+	std::vector<std::string> fields;
+	for (size_t i = 0; i < entries.size(); ++i)
+		fields.push_back(FieldDescriptor('"' + entries[i]->GetName() + '"', "NULL", "0", entries[i]->GetNumber()));
 
+	std::string strm = GetValueBounds(*type);
+	GenerateDescriptor(type, "e_integer", strm, false, fields.size(), fields.size(),
+	                   GenerateFieldDescriptors(type, fields, cxx), cxx);
 
     cxx << type->GetTemplatePrefix()
         << "const " ;
@@ -2533,30 +3222,51 @@ void IntegerType::GenerateInfo(const TypeBase* type, std::ostream& hdr , std::os
     cxx << "    ";
 
     type->GenerateTags(cxx);
-
+    cxx << ",\n";
+    GenerateEncodedSizeInfo(type, cxx);
+    GenerateDescriptorInfo(type, cxx);
     cxx << ",\n"
         << "    ";
 
-	if (type->GetConstraints().size())
-	{
-		std::string strm;
-		type->GetConstraints()[0]->GetConstraint(strm);
-		cxx << strm;
-	}
-	else
-		cxx << "ASN1::Unconstrained, 0, UINT_MAX";
-
-    cxx << "\n";
+	// the C++ compiler works the PER width out, the bounds may be named values
+	cxx << strm << ",\n"
+		<< "    ASN1::PERWidth(" << strm << ")\n";
 	if ( allowedValues.size()  )
     {
         cxx << "#ifdef ASN1_HAS_IOSTREAM\n"
-            << "    , nameEntries, " << allowedValues.size() << "\n"
+            << "    , nameEntries, " << allowedValues.size() << ", nameIndex\n"
 			<< "#endif\n";
     }
 
     cxx << "};\n\n";
 }
 
+SizeRange IntegerType::ComputePERBits(const TypeBase& type) const
+{
+	std::string kind;
+	long long lower, upper;
+	bool numeric = GetBounds(GetValueBounds(type), kind, lower, upper);
+	if (kind == "FixedConstraint")
+		return numeric ? WholeNumberBits(upper - lower + 1) : SizeRange(0, IntegerBits.max);
+
+	if (kind == "ExtendableConstraint")
+	{
+		// a value outside the root is encoded as if it was not constrained
+		SizeRange root = numeric ? WholeNumberBits(upper - lower + 1) : SizeRange(0, IntegerBits.max);
+		return SizeRange(1 + std::min(root.min, IntegerBits.min), 1 + std::max(root.max, IntegerBits.max));
+	}
+	return IntegerBits;
+}
+
+SizeRange IntegerType::ComputeBERContents(const TypeBase& type) const
+{
+	std::string kind;
+	long long lower, upper;
+	if (GetBounds(GetValueBounds(type), kind, lower, upper) && kind == "FixedConstraint")
+		return SizeRange(1, std::max(IntegerOctets(lower), IntegerOctets(upper)));
+	return IntegerContents;
+}
+
 
 std::string IntegerType::GetTypeName() const
 {
@@ -2632,6 +3342,11 @@ bool IntegerType::ReferencesType(const TypeBase & type) const
 		return false;
 }
 
+bool IntegerType::CollectReferences(StringList &) const
+{
+	return constraints.empty();
+}
+
 /////////////////////////////////////////////////////////
 
 EnumeratedType::EnumeratedType(NamedNumberList& enums, bool extend, NamedNumberList* ext)
@@ -2672,17 +3387,23 @@ TypePtr EnumeratedType::FlattenThisType(TypePtr& self, const TypeBase & parent)
 }
 
 
-void EnumeratedType::GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl)
+int EnumeratedType::GetMaxEnumValue() const
 {
-  maxEnumValue = 0;
-  NamedNumberList::iterator itr, last = enumerations.end();
-
-
+  int maximum = 0;
+  NamedNumberList::const_iterator itr, last = enumerations.end();
   for (itr = enumerations.begin(); itr != last; ++itr) {
     int num = (*itr)->GetNumber();
-    if (maxEnumValue < num)
-      maxEnumValue = num;
+    if (maximum < num)
+      maximum = num;
   }
+  return maximum;
+}
+
+
+void EnumeratedType::GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl)
+{
+  maxEnumValue = GetMaxEnumValue();
+  NamedNumberList::iterator itr, last = enumerations.end();
 
   Indent indent(hdr.precision());
 
@@ -2767,6 +3488,8 @@ void EnumeratedType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::
 		 "        \"";
 
   int prevNum = -1;
+  bool contiguous = true;
+  std::vector<std::string> names;
   NamedNumberList::iterator itr, last = enumerations.end();
 
   for (itr = enumerations.begin(); itr != last; ++itr) {
@@ -2775,35 +3498,87 @@ void EnumeratedType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::
     }
 
     cxx << (*itr)->GetName();
+    names.push_back((*itr)->GetName());
 
     int num = (*itr)->GetNumber();
     if (num != prevNum+1) {
       cxx << '=' << num;
+      contiguous = false;
     }
     prevNum = num;
   }
 
   cxx << "\"\n"
-	  << "  };\n"
-	  << "#endif\n\n";
+	  << "  };\n";
+
+  // names can only be searched by position when they are indexed by the enumeration value
+  if (contiguous) {
+    cxx << "static const unsigned " << GetIdentifier() << "_enum_index__[] = ";
+    GenerateNameIndex(cxx, names);
+    cxx << ";\n";
+  }
+  cxx << "#endif\n\n";
+
+   std::vector<std::string> fields;
+   for (itr = enumerations.begin(); itr != last; ++itr)
+     fields.push_back(FieldDescriptor('"' + (*itr)->GetName() + '"', "NULL", "0", (*itr)->GetNumber()));
+
+   std::ostringstream bounds;
+   bounds << "ASN1::FixedConstraint, 0, " << maxEnumValue;
+   GenerateDescriptor(type, "e_enumerated", bounds.str(), extendable, numEnums, fields.size(),
+                      GenerateFieldDescriptors(type, fields, cxx), cxx);
 
    Indent indent(hdr.precision()+4);
    hdr << indent << "static const InfoType theInfo;\n";
+   GenerateDescriptorDecl(fields.size(), hdr);
    cxx << GetTemplatePrefix()
 	   << "const " << type->GetClassNameString() << "::InfoType " << type->GetClassNameString() << "::theInfo = {\n"
        << "    ASN1::ENUMERATED::create,\n"
        << "    ";
    type->GenerateTags(cxx);
+   cxx << ",\n";
+   GenerateEncodedSizeInfo(type, cxx);
+   GenerateDescriptorInfo(type, cxx);
    cxx << ",\n"
        << "    " << extendable << ",\n"
-       << "    " << maxEnumValue << "\n"
+       << "    " << maxEnumValue << ",\n"
+       << "    ASN1::PERWidth(ASN1::FixedConstraint, 0, " << maxEnumValue << ")\n"
        << "#ifdef ASN1_HAS_IOSTREAM\n"
-       << "    ," << GetIdentifier() << "_enum_names__\n"
+       << "    ," << GetIdentifier() << "_enum_names__, ";
+   if (contiguous)
+     cxx << GetIdentifier() << "_enum_index__\n";
+   else
+     cxx << "NULL\n";
+   cxx
        << "#endif\n"
        << "};\n\n";
    
 }
 
+SizeRange EnumeratedType::ComputePERBits(const TypeBase&) const
+{
+	SizeRange root = WholeNumberBits(maxEnumValue + 1ULL);
+	if (!extendable)
+		return root;
+
+	// a value outside the root is a normally small number (X.691 10.6), then the runtime
+	// writes the value again as a whole number
+	SizeRange extension(1+6, 1+7+8+32);
+	extension += WholeNumberBits(1ULL << 32);
+	return SizeRange(1 + std::min(root.min, extension.min), 1 + std::max(root.max, extension.max));
+}
+
+SizeRange EnumeratedType::ComputeBERContents(const TypeBase&) const
+{
+	if (extendable)
+		return IntegerContents;
+
+	SizeRange result(1, 1);
+	for (NamedNumberList::const_iterator itr = enumerations.begin(); itr != enumerations.end(); ++itr)
+		result.max = std::max(result.max, IntegerOctets((*itr)->GetNumber()));
+	return result;
+}
+
 /////////////////////////////////////////////////////////
 
 RealType::RealType()
@@ -2869,6 +3644,11 @@ void BitStringType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::o
 {
     Indent indent(hdr.precision() + 4);
     hdr << indent << "static const InfoType theInfo;\n";
+    GenerateDescriptorDecl(0, hdr);
+
+    std::string bounds = GetSizeBounds(*type, false);
+    GenerateDescriptor(type, "e_bitString", bounds, false, 0, 0, "NULL", cxx);
+
     cxx << type->GetTemplatePrefix()
         << "const "<< type->GetClassNameString() << "::InfoType " <<  type->GetClassNameString() << "::theInfo = {\n"
         << "    " ;
@@ -2878,26 +3658,38 @@ void BitStringType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::o
     cxx << "    ";
 
     type->GenerateTags(cxx);
-
+    cxx << ",\n";
+    GenerateEncodedSizeInfo(type, cxx);
+    GenerateDescriptorInfo(type, cxx);
     cxx << ",\n"
         << "    ";
 
-    const SizeConstraintElement* sizeConstraint ;
-
-    if (type->GetConstraints().size() && 
-        ((sizeConstraint = type->GetConstraints()[0]->GetSizeConstraint()) != NULL))
-    {
-   		std::string str;
-		sizeConstraint->GetConstraint(str);
-		cxx << str.substr(0, str.size()-2);
-    }
-    else
-        cxx << "ASN1::Unconstrained, 0, UINT_MAX";
+    cxx << bounds << ",\n"
+        << "    ASN1::PERWidth(" << bounds << ")";
 
     cxx << "\n"
         << "};\n\n";    
 }
 
+SizeRange BitStringType::ComputePERBits(const TypeBase& type) const
+{
+	SizeRange count;
+	SizeRange result = ConstrainedLengthBits(GetSizeBounds(type, false), count);
+	// bit strings longer than 16 bits are octet aligned
+	if (count.max > 16 && count.max != UnboundedSize)
+		count.max += 7;
+	result += count;
+	return result;
+}
+
+SizeRange BitStringType::ComputeBERContents(const TypeBase& type) const
+{
+	// the octet of unused bits and the bits
+	SizeRange count;
+	ConstrainedLengthBits(GetSizeBounds(type, false), count);
+	return SizeRange(1 + (count.min+7)/8, count.max == UnboundedSize ? UnboundedSize : 1 + (count.max+7)/8);
+}
+
 /////////////////////////////////////////////////////////
 
 OctetStringType::OctetStringType()
@@ -2948,6 +3740,11 @@ void OctetStringType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std:
 {
     Indent indent(hdr.precision() + 4);
     hdr << indent << "static const InfoType theInfo;\n";
+    GenerateDescriptorDecl(0, hdr);
+
+    std::string bounds = GetSizeBounds(*type, false);
+    GenerateDescriptor(type, "e_octetString", bounds, false, 0, 0, "NULL", cxx);
+
     cxx << type->GetTemplatePrefix()
         << "const "<< type->GetClassNameString() << "::InfoType " <<  type->GetClassNameString() << "::theInfo = {\n"
         << "    " ;
@@ -2957,26 +3754,38 @@ void OctetStringType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std:
     cxx << "    ";
 
     type->GenerateTags(cxx);
-
+    cxx << ",\n";
+    GenerateEncodedSizeInfo(type, cxx);
+    GenerateDescriptorInfo(type, cxx);
     cxx << ",\n"
         << "    ";
 
-    const SizeConstraintElement* sizeConstraint ;
-
-    if (type->GetConstraints().size() && 
-        (sizeConstraint = type->GetConstraints()[0]->GetSizeConstraint()) != NULL)
-    {
-   		std::string str;
-		sizeConstraint->GetConstraint(str);
-		cxx << str.substr(0, str.size()-2);
-    }
-    else
-        cxx << "ASN1::Unconstrained, 0, UINT_MAX";
+    cxx << bounds << ",\n"
+        << "    ASN1::PERWidth(" << bounds << ")";
 
     cxx << "\n"
         << "};\n\n";    
 }
 
+SizeRange OctetStringType::ComputePERBits(const TypeBase& type) const
+{
+	SizeRange count;
+	SizeRange result = ConstrainedLengthBits(GetSizeBounds(type, false), count);
+	SizeRange octets = Repeat(count, SizeRange(8, 8));
+	// octet strings longer than two octets are octet aligned
+	if (count.max > 2 && count.max != UnboundedSize)
+		octets.max += 7;
+	result += octets;
+	return result;
+}
+
+SizeRange OctetStringType::ComputeBERContents(const TypeBase& type) const
+{
+	SizeRange count;
+	ConstrainedLengthBits(GetSizeBounds(type, false), count);
+	return count;
+}
+
 /////////////////////////////////////////////////////////
 
 NullType::NullType()
@@ -2999,6 +3808,16 @@ const char * NullType::GetAncestorClass() const
   return "ASN1::Null";
 }
 
+SizeRange NullType::ComputePERBits(const TypeBase&) const
+{
+	return SizeRange(0, 0);
+}
+
+SizeRange NullType::ComputeBERContents(const TypeBase&) const
+{
+	return SizeRange(0, 0);
+}
+
 
 /////////////////////////////////////////////////////////
 
@@ -3128,9 +3947,9 @@ void SequenceType::GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std
 	GenerateComponent(**itr, hdr, tmpcxx, inl, i);
   }
 
-  std::strstream decoder;
-  for (itr=fields.begin() ; itr != last; ++itr) {
-      (*itr)->GenerateDecoder(decoder);
+  std::strstream preDecoder, decoder;
+  for (i = 0, itr=fields.begin() ; itr != last; ++i, ++itr) {
+      (*itr)->GenerateDecoder(fields, i, preDecoder, decoder);
   }
 
   hdr << indent << "    void swap(" << GetIdentifier() << "& other);\n";
@@ -3150,6 +3969,7 @@ void SequenceType::GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std
 
   cxx << "\n";
 
+  GenerateEncodedSize(hdr);
   GenerateInfo(this, hdr, cxx);
 
   decoder << std::ends;
@@ -3173,11 +3993,29 @@ void SequenceType::GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std
           << "    if (!visitor.get_env())\n"
 	      << "      return true;\n"
           << decoder.str()
+          << "    return true;\n"
           << "  }\n"
           << "  return false;\n"
           << "}\n\n";
   }
 
+  preDecoder << std::ends;
+  if (strlen(preDecoder.str()))
+  {
+      hdr << indent << "  protected:\n"
+          << indent << "    void preDecodeField(const ASN1::CoderEnv& env, unsigned pos);\n"
+          << indent << "  public:\n";
+
+      cxx << GetTemplatePrefix()
+          << "void " << GetClassNameString() << "::preDecodeField(const ASN1::CoderEnv& env, unsigned pos)\n"
+          << "{\n"
+          << "  switch (pos)\n"
+          << "  {\n"
+          << preDecoder.str()
+          << "  }\n"
+          << "}\n\n";
+  }
+
   hdr << indent << "};\n\n";
 
   tmpcxx << std::ends;
@@ -3288,15 +4126,15 @@ void SequenceType::GenerateComponent(TypeBase& field, std::ostream & hdr, std::o
 		hdr	<< indent << "    " << typenameKeyword << componentIdentifier << "::reference ref_" << componentIdentifier << " ();\n";
         inl << GetTemplatePrefix()
             << "inline " << typenameKeyword << GetClassNameString() << "::" << componentIdentifier << "::reference " << GetClassNameString() << "::ref_" << componentIdentifier << " ()\n"
-			<< "{ return " << varName.str() << ";}\n\n";
+			<< "{ invalidateEncoding(); return " << varName.str() << ";}\n\n";
 		hdr	<< indent << "    " << typenameKeyword << componentIdentifier << "::reference set_" << componentIdentifier << " ();\n";
         inl << GetTemplatePrefix()
             << "inline " << typenameKeyword << GetClassNameString() << "::" << componentIdentifier << "::reference " << GetClassNameString() << "::set_" << componentIdentifier << " ()\n"
-			<< "{ return " << varName.str() << ";}\n\n";
+			<< "{ invalidateEncoding(); return " << varName.str() << ";}\n\n";
 		hdr	<< indent << "    " << typenameKeyword << componentIdentifier << "::reference set_" << componentIdentifier << " ("<< primitiveFieldType << " value);" << std::endl;
         inl << GetTemplatePrefix()
             << "inline " << typenameKeyword << GetClassNameString() << "::" << componentIdentifier << "::reference " << GetClassNameString() << "::set_" << componentIdentifier << " ("<< primitiveFieldType << " value)\n"
-			<< "{ return " << varName.str() << " = value ;}\n\n";
+			<< "{ invalidateEncoding(); return " << varName.str() << " = value ;}\n\n";
 	}
 	else // optional component
 	{
@@ -3315,6 +4153,7 @@ void SequenceType::GenerateComponent(TypeBase& field, std::ostream & hdr, std::o
                 << "inline " << typenameKeyword << GetClassNameString() << "::" << componentIdentifier << "::reference " << GetClassNameString() << "::ref_" << componentIdentifier << " ()\n"
 				<< "{\n"
 				<< "  assert(hasOptionalField(" << enumName <<"));\n"
+				<< "  invalidateEncoding();\n"
 				<< "  return " << varName.str() << ";\n"
 				<< "}\n\n"; 
 		}
@@ -3376,6 +4215,14 @@ void SequenceType::GenerateForwardDecls(std::ostream & hdr)
     hdr << '\n';
 }
 
+void SequenceType::ResolveReferences() const
+{
+  TypeBase::ResolveReferences();
+  for (size_t i = 0; i < fields.size(); i++)
+    fields[i]->ResolveReferences();
+}
+
+
 bool SequenceType::ReferencesType(const TypeBase & type) const
 {
     if (detectingLoop) return false;
@@ -3400,6 +4247,14 @@ bool SequenceType::ReferencesType(const TypeBase & type) const
 	return false;
 }
 
+bool SequenceType::CollectReferences(StringList & names) const
+{
+	for (size_t i = 0; i < fields.size(); i++)
+		if (!fields[i]->CollectReferences(names))
+			return false;
+	return true;
+}
+
 TypeBase::RemoveReuslt SequenceType::CanRemoveType(const TypeBase& type)
 {
 	TypesVector::iterator itr, last=fields.end();
@@ -3438,10 +4293,11 @@ void SequenceType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::os
   int nExtensions=0;
   bool hasNonOptionalFields=false;
 
-  hdr << indent << "static const InfoType theInfo;\n"
-      << "  private:\n";
-
   size_t nTotalFields = fields.size();
+  hdr << indent << "static const InfoType theInfo;\n";
+  GenerateDescriptorDecl(type == this ? nTotalFields : 0, hdr);
+  hdr << "  private:\n";
+
   bool autoTag = true, useDefaultTag = (tag.mode != Tag::Automatic) ;
   if (nTotalFields >0 && type == this)
   {
@@ -3556,22 +4412,43 @@ void SequenceType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::os
  
       hdr << "#ifdef ASN1_HAS_IOSTREAM\n"
           << indent << "static const char* fieldNames[" << nTotalFields << "];\n"
+          << indent << "static const unsigned fieldNameIndex[" << nTotalFields << "];\n"
           << "#endif\n";
 
       cxx << "#ifdef ASN1_HAS_IOSTREAM\n"
           << GetTemplatePrefix() 
           << "const char* " << GetClassNameString() <<  "::fieldNames[" << nTotalFields << "] = {\n";
       
+      std::vector<std::string> names;
       for (i = 0; i < fields.size(); i++) {
           cxx << "        \"" << fields[i]->GetName() << '\"';
+          names.push_back(fields[i]->GetName());
           if (i != fields.size() -1)
               cxx << ",\n";
           else
               cxx << '\n'
-              << "};\n"
-              << "#endif\n\n";
+              << "};\n\n";
       }    
+
+      cxx << GetTemplatePrefix() 
+          << "const unsigned " << GetClassNameString() <<  "::fieldNameIndex[" << nTotalFields << "] = ";
+      GenerateNameIndex(cxx, names);
+      cxx << ";\n"
+          << "#endif\n\n";
+  }
+
+  std::string fieldDescriptors = GetIdentifier() + "::theDescriptor.fields";
+  if (type == this)
+  {
+      std::vector<std::string> descriptors;
+      unsigned optionalId = 0;
+      for (size_t i = 0; i < nTotalFields; ++i)
+          descriptors.push_back(ComponentDescriptor(*fields[i], i, autoTag,
+              i < numFields && fields[i]->IsOptional() ? (int) optionalId++ : -1));
+      fieldDescriptors = GenerateFieldDescriptors(type, descriptors, cxx);
   }
+  GenerateDescriptor(type, dynamic_cast<const SetType*>(this) ? "e_set" : "e_sequence", "ASN1::Unconstrained, 0, 0",
+                     extendable, numFields, nTotalFields, fieldDescriptors, cxx);
 
   std::string typenameKeyword;
   if (type->GetTemplatePrefix().size())
@@ -3582,7 +4459,10 @@ void SequenceType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::os
       << "    " << type->GetClassNameString() << "::create,\n"
       << "    ";
   type->GenerateTags(cxx);
-  cxx << ",\n"; 
+  cxx << ",\n";
+  GenerateEncodedSizeInfo(type, cxx);
+  GenerateDescriptorInfo(type, cxx);
+  cxx << ",\n";
 
   if (extendable) 
 	  cxx << "    true,\n";
@@ -3636,17 +4516,68 @@ void SequenceType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::os
   if (nTotalFields >0)
   {
       if (type == this)
-        cxx << GetClassNameString() << "::fieldNames\n";
+        cxx << GetClassNameString() << "::fieldNames, " 
+            << GetClassNameString() << "::fieldNameIndex\n";
       else
-        cxx << GetIdentifier() << "::theInfo.names\n";
+        cxx << GetIdentifier() << "::theInfo.names, "
+            << GetIdentifier() << "::theInfo.nameIndex\n";
   }
   else
-      cxx << "NULL\n";
+      cxx << "NULL, NULL\n";
   cxx << "#endif\n";
   
   cxx << "};\n\n";
 }
 
+SizeRange SequenceType::ComputePERBits(const TypeBase&) const
+{
+	// the extension bit and the bits of the optional fields in the root
+	unsigned long preamble = extendable ? 1 : 0;
+	SizeRange result(preamble, preamble);
+	for (size_t i = 0; i < numFields; ++i)
+	{
+		if (fields[i]->IsRemovedType())
+		{
+			result.max = UnboundedSize;
+			continue;
+		}
+		SizeRange field = fields[i]->GetPERBits(*fields[i]);
+		if (fields[i]->IsOptional())
+		{
+			result += SizeRange(1, 1);
+			field.min = 0;
+		}
+		result += field;
+	}
+
+	// the additions are open types, of any length
+	if (extendable)
+		result.max = UnboundedSize;
+	return result;
+}
+
+SizeRange SequenceType::ComputeBERContents(const TypeBase&) const
+{
+	SizeRange result(0, 0);
+	for (size_t i = 0; i < fields.size(); ++i)
+	{
+		if (fields[i]->IsRemovedType())
+		{
+			result.max = UnboundedSize;
+			continue;
+		}
+		SizeRange field = fields[i]->GetBEROctets(*fields[i]);
+		if (fields[i]->IsOptional() || i >= numFields)
+			field.min = 0;
+		result += field;
+	}
+
+	// the decoder skips what it does not know of in an extension
+	if (extendable)
+		result.max = UnboundedSize;
+	return result;
+}
+
 /////////////////////////////////////////////////////////
 
 SequenceOfType::SequenceOfType(TypePtr base, ConstraintPtr constraint, unsigned tag)
@@ -3720,11 +4651,23 @@ bool SequenceOfType::CanReferenceType() const
 }
 
 
+void SequenceOfType::ResolveReferences() const
+{
+  TypeBase::ResolveReferences();
+  baseType->ResolveReferences();
+}
+
+
 bool SequenceOfType::ReferencesType(const TypeBase & type) const
 {
   return baseType->ReferencesType(type);
 }
 
+bool SequenceOfType::CollectReferences(StringList & names) const
+{
+  return baseType->CollectReferences(names);
+}
+
 bool SequenceOfType::UseType(const TypeBase& type) const 
 {
   return baseType->UseType(type);
@@ -3775,6 +4718,13 @@ void SequenceOfType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::
 {
     Indent indent(hdr.precision() + 4);
     hdr << indent << "static const InfoType theInfo;\n";
+    GenerateDescriptorDecl(1, hdr);
+
+    std::vector<std::string> fields(1, FieldDescriptor("NULL", "&" + baseType->GetTypeName() + "::theInfo", "0", -1));
+    std::string bounds = GetSizeBounds(*type, false);
+    GenerateDescriptor(type, dynamic_cast<const SetOfType*>(this) ? "e_setOf" : "e_sequenceOf", bounds, false, 1, 1,
+                       GenerateFieldDescriptors(type, fields, cxx), cxx);
+
     cxx << type->GetTemplatePrefix()
         << "const "<< type->GetClassNameString() << "::InfoType " <<  type->GetClassNameString() << "::theInfo = {\n"
         << "    " ;
@@ -3784,27 +4734,35 @@ void SequenceOfType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::
     cxx << "    ";
 
     type->GenerateTags(cxx);
-
+    cxx << ",\n";
+    GenerateEncodedSizeInfo(type, cxx);
+    GenerateDescriptorInfo(type, cxx);
     cxx << ",\n"
         << "    ";
 
-    const SizeConstraintElement* sizeConstraint ;
-
-    if (type->GetConstraints().size() && 
-        ((sizeConstraint = type->GetConstraints()[0]->GetSizeConstraint()) != NULL))
-    {
-   		std::string str;
-		sizeConstraint->GetConstraint(str);
-		cxx << str.substr(0, str.size()-2);
-    }
-    else
-        cxx << "ASN1::Unconstrained, 0, UINT_MAX";
+    cxx << bounds << ",\n"
+        << "    ASN1::PERWidth(" << bounds << ")";
 
     cxx << ",\n"
         << "    &" << baseType->GetTypeName() << "::theInfo\n"
         << "};\n\n";    
 }
 
+SizeRange SequenceOfType::ComputePERBits(const TypeBase& type) const
+{
+	SizeRange count;
+	SizeRange result = ConstrainedLengthBits(GetSizeBounds(type, false), count);
+	result += Repeat(count, baseType->GetPERBits(*baseType));
+	return result;
+}
+
+SizeRange SequenceOfType::ComputeBERContents(const TypeBase& type) const
+{
+	SizeRange count;
+	ConstrainedLengthBits(GetSizeBounds(type, false), count);
+	return Repeat(count, baseType->GetBEROctets(*baseType));
+}
+
 /////////////////////////////////////////////////////////
 
 SetType::SetType()
@@ -4044,6 +5002,17 @@ bool ChoiceType::IsChoice() const
   return true;
 }
 
+const TypeBase* ChoiceType::GetIntegerAlternative() const
+{
+  for (size_t i = 0; i < numFields; ++i)
+  {
+    const char* ancestor = fields[i]->GetAncestorClass();
+    if (!fields[i]->IsRemovedType() && ancestor && strcmp(ancestor, "ASN1::INTEGER") == 0)
+      return fields[i].get();
+  }
+  return NULL;
+}
+
 
 const char * ChoiceType::GetAncestorClass() const
 {
@@ -4066,8 +5035,9 @@ void ChoiceType::GenerateInfo(const TypeBase* type,std::ostream& hdr, std::ostre
   size_t nFields = fields.size();
   Indent indent(hdr.precision()+4);
 
-  hdr << indent << "static const InfoType theInfo;\n"
-      << indent -2 << "private:\n";
+  hdr << indent << "static const InfoType theInfo;\n";
+  GenerateDescriptorDecl(type == this ? nFields : 0, hdr);
+  hdr << indent -2 << "private:\n";
 
   bool autoTag = true;
   // generate selection info table
@@ -4120,6 +5090,7 @@ void ChoiceType::GenerateInfo(const TypeBase* type,std::ostream& hdr, std::ostre
       
       hdr << "#ifdef ASN1_HAS_IOSTREAM\n"
           << indent << "static const char* selectionNames[" << nFields << "];\n"
+          << indent << "static const unsigned selectionNameIndex[" << nFields << "];\n"
           << "#endif\n";
       
       cxx << "#ifdef ASN1_HAS_IOSTREAM\n"
@@ -4127,6 +5098,7 @@ void ChoiceType::GenerateInfo(const TypeBase* type,std::ostream& hdr, std::ostre
           << "const char* " << GetClassNameString() << "::selectionNames[" << nFields << "] = { ";
       
       bool outputEnum = false;
+      std::vector<std::string> names;
       
       for (i = 0; i < nFields; i++) {
           if (outputEnum) {
@@ -4138,13 +5110,28 @@ void ChoiceType::GenerateInfo(const TypeBase* type,std::ostream& hdr, std::ostre
           }
           
           cxx << sortedFields[i]->GetName();
+          names.push_back(sortedFields[i]->GetName());
           
           cxx << "\"";
       }
-      cxx << "};\n"
+      cxx << "};\n\n"
+          << GetTemplatePrefix()
+          << "const unsigned " << GetClassNameString() << "::selectionNameIndex[" << nFields << "] = ";
+      GenerateNameIndex(cxx, names);
+      cxx << ";\n"
           << "#endif\n\n";
   }
 
+  std::string fieldDescriptors = GetIdentifier() + "::theDescriptor.fields";
+  if (type == this)
+  {
+      std::vector<std::string> descriptors;
+      for (size_t i = 0; i < nFields; ++i)
+          descriptors.push_back(ComponentDescriptor(*sortedFields[i], i, autoTag, -1));
+      fieldDescriptors = GenerateFieldDescriptors(type, descriptors, cxx);
+  }
+  GenerateDescriptor(type, "e_choice", "ASN1::Unconstrained, 0, 0", extendable, numFields, nFields, fieldDescriptors, cxx);
+
   std::string typenameKeyword;
   if (type->GetTemplatePrefix().length())
 	typenameKeyword="typename ";
@@ -4155,6 +5142,9 @@ void ChoiceType::GenerateInfo(const TypeBase* type,std::ostream& hdr, std::ostre
       << "    ";
   type->GenerateTags(cxx);
   cxx << ",\n";
+  GenerateEncodedSizeInfo(type, cxx);
+  GenerateDescriptorInfo(type, cxx);
+  cxx << ",\n";
 
   if (extendable) 
 	  cxx << "    true,\n";
@@ -4166,7 +5156,9 @@ void ChoiceType::GenerateInfo(const TypeBase* type,std::ostream& hdr, std::ostre
   else
       cxx << "    " << GetIdentifier() << "::theInfo.selectionInfos,\n";
 
-  cxx << "    " <<  numFields << ", " << nFields << ",\n" 
+  cxx << "    " <<  numFields << ", "
+      << "ASN1::PERWidth(ASN1::FixedConstraint, 0, " << (numFields > 0 ? numFields-1 : 0) << "), "
+      << nFields << ",\n" 
 	  << "    ";
 
   if (!autoTag)
@@ -4181,14 +5173,48 @@ void ChoiceType::GenerateInfo(const TypeBase* type,std::ostream& hdr, std::ostre
 
   cxx << "#ifdef ASN1_HAS_IOSTREAM\n";
   if (type == this)
-      cxx << "   ," << GetClassNameString() << "::selectionNames\n";
+      cxx << "   ," << GetClassNameString() << "::selectionNames, " 
+          << GetClassNameString() << "::selectionNameIndex\n";
   else
-      cxx << "   ," << GetIdentifier() << "::theInfo.names\n";
+      cxx << "   ," << GetIdentifier() << "::theInfo.names, " 
+          << GetIdentifier() << "::theInfo.nameIndex\n";
 
   cxx << "#endif\n" 
       << "};\n\n";
 }
 
+SizeRange ChoiceType::ComputePERBits(const TypeBase&) const
+{
+	if (numFields == 0)
+		return SizeRange();
+
+	// the alternatives in the root, any one of them
+	SizeRange alternatives(UnboundedSize, 0);
+	for (size_t i = 0; i < numFields; ++i)
+		alternatives |= fields[i]->IsRemovedType() ? SizeRange() : fields[i]->GetPERBits(*fields[i]);
+
+	unsigned long preamble = extendable ? 1 : 0;
+	SizeRange result(preamble, preamble);
+	result += WholeNumberBits(numFields);
+	result += alternatives;
+	if (extendable)
+		result.max = UnboundedSize;
+	return result;
+}
+
+SizeRange ChoiceType::ComputeBERContents(const TypeBase&) const
+{
+	if (fields.empty())
+		return SizeRange();
+
+	SizeRange result(UnboundedSize, 0);
+	for (size_t i = 0; i < fields.size(); ++i)
+		result |= fields[i]->IsRemovedType() ? SizeRange() : fields[i]->GetBEROctets(*fields[i]);
+	if (extendable)
+		result.max = UnboundedSize;
+	return result;
+}
+
 /////////////////////////////////////////////////////////
 
 EmbeddedPDVType::EmbeddedPDVType()
@@ -4283,6 +5309,9 @@ static const char GeneralStringSet[]   = "\000\001\002\003\004\005\006\007"
 
 StringTypeBase::StringTypeBase(int tag)
   : TypeBase(tag, Module)
+  , canonicalSet(NULL)
+  , canonicalSetRep("NULL")
+  , canonicalSetSize(0)
 {
 }
 
@@ -4333,68 +5362,105 @@ void StringTypeBase::GenerateInfo(const TypeBase* type,std::ostream& hdr, std::o
 {
 	Indent indent(hdr.precision()+4);
 	hdr << indent << "static const InfoType theInfo;\n";
+	GenerateDescriptorDecl(0, hdr);
+
+	std::string bounds = GetSizeBounds(*type, true);
+	GenerateDescriptor(type, "e_string", bounds, false, 0, 0, "NULL", cxx);
+
 	cxx << type->GetTemplatePrefix()
         << "const "<< type->GetClassNameString() << "::InfoType " <<  type->GetClassNameString() << "::theInfo = {\n"
 		<< "    ASN1::ConstrainedString::create,\n"
 		<< "    ";
 	type->GenerateTags(cxx);
 	cxx << ",\n";
-	const SizeConstraintElement* sizeConstraint = NULL;
-	size_t i;
-	for (i = 0; i < type->GetConstraints().size(); ++i)
-		if ((sizeConstraint = type->GetConstraints()[i]->GetSizeConstraint()) != NULL)
-			break;
-
-	if (sizeConstraint != NULL)
-	{
-		std::string str;
-		sizeConstraint->GetConstraint(str);
-		cxx << "    " << str.substr(0, str.size()-2) << ",\n";
-	}
-	else
-		cxx << "    ASN1::Unconstrained, 0, UINT_MAX,\n";
+	GenerateEncodedSizeInfo(type, cxx);
+	GenerateDescriptorInfo(type, cxx);
+	cxx << ",\n";
+	cxx << "    " << bounds << ",\n"
+		<< "    ASN1::PERWidth(" << bounds << "),\n"
+		<< "    " << GetCharSet(*type, ",\n    ") << "\n"
+		<< "};\n\n";
+}
 
+std::string StringTypeBase::GetCharSet(const TypeBase& type, const char* separator) const
+{
 	const FromConstraintElement* fromConstraint = NULL;
-	for (i = 0; i < type->GetConstraints().size(); ++i)
-		if ((fromConstraint = type->GetConstraints()[i]->GetFromConstraint()) != NULL)
+	for (size_t i = 0; i < type.GetConstraints().size(); ++i)
+		if ((fromConstraint = type.GetConstraints()[i]->GetFromConstraint()) != NULL)
 			break;
 
-	cxx << "    ";
-
+	std::ostringstream strm;
 	int charSetUnalignedBits;
 	std::string characterSet;
 	if (fromConstraint != NULL &&
         (characterSet = fromConstraint->GetCharacterSet(canonicalSet, canonicalSetSize)).size())
 	{
-		cxx << '"';
+		strm << '"';
 		for (size_t i = 0; i < characterSet.size(); ++i)
 		{
-			if (isprint(characterSet[i]) && characterSet[i] != '"')
-				cxx << characterSet[i];
-			else
-				cxx << "\\x" << std::hex << (unsigned) characterSet[i];
+			unsigned char c = characterSet[i];
+			if (isprint(c) && c != '"' && c != '\\')
+				strm << c;
+			else // octal, which cannot run into the next character
+				strm << '\\' << std::oct << std::setw(3) << std::setfill('0') << (unsigned) c
+				     << std::dec << std::setfill(' ');
 		}
 
-		cxx << "\", " << characterSet.size()  << ",\n";
+		strm << "\", " << characterSet.size();
 		charSetUnalignedBits = CountBits(characterSet.size());
-		
 	}
 	else
 	{
-		cxx << 	canonicalSetRep << ", " << canonicalSetSize << ",\n";
+		strm << canonicalSetRep << ", " << canonicalSetSize;
 		charSetUnalignedBits = CountBits(canonicalSetSize);
 	}
 
-	cxx <<  "    " << CountBits(canonicalSetSize) << ",\n";
-	
-
     int charSetAlignedBits = 1;
 	while (charSetUnalignedBits > charSetAlignedBits)
 		charSetAlignedBits <<= 1;
 
-	cxx << "    " << charSetUnalignedBits << ", " << charSetAlignedBits << "\n"
-		<< "};\n\n";
+	strm << separator << CountBits(canonicalSetSize)
+		<< separator << charSetUnalignedBits << ", " << charSetAlignedBits;
+	return strm.str();
+}
+
+// the charSetAlignedBits written by GenerateInfo()
+unsigned StringTypeBase::GetCharSetAlignedBits(const TypeBase& type) const
+{
+	const FromConstraintElement* fromConstraint = NULL;
+	for (size_t i = 0; i < type.GetConstraints().size(); ++i)
+		if ((fromConstraint = type.GetConstraints()[i]->GetFromConstraint()) != NULL)
+			break;
+
+	std::string characterSet;
+	if (fromConstraint != NULL)
+		characterSet = fromConstraint->GetCharacterSet(canonicalSet, canonicalSetSize);
+
+	unsigned charSetUnalignedBits = CountBits(characterSet.size() ? characterSet.size() : canonicalSetSize);
+	unsigned charSetAlignedBits = 1;
+	while (charSetUnalignedBits > charSetAlignedBits)
+		charSetAlignedBits <<= 1;
+	return charSetAlignedBits;
+}
+
+SizeRange StringTypeBase::ComputePERBits(const TypeBase& type) const
+{
+	SizeRange count;
+	SizeRange result = ConstrainedLengthBits(GetSizeBounds(type, true), count);
+	unsigned long charBits = GetCharSetAlignedBits(type);
+	SizeRange characters = Repeat(count, SizeRange(charBits, charBits));
+	// strings longer than two octets are octet aligned
+	if (characters.max > 16 && characters.max != UnboundedSize)
+		characters.max += 7;
+	result += characters;
+	return result;
+}
 
+SizeRange StringTypeBase::ComputeBERContents(const TypeBase& type) const
+{
+	SizeRange count;
+	ConstrainedLengthBits(GetSizeBounds(type, true), count);
+	return count;
 }
 
 /////////////////////////////////////////////////////////
@@ -4433,39 +5499,39 @@ void BMPStringType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::o
 {
 	Indent indent(hdr.precision()+4);
 	hdr << indent << "static const InfoType theInfo;\n";
+	GenerateDescriptorDecl(0, hdr);
+
+	std::string bounds = GetSizeBounds(*type, true);
+	GenerateDescriptor(type, "e_bmpString", bounds, false, 0, 0, "NULL", cxx);
+
 	cxx << type->GetTemplatePrefix()
         << "const "<< type->GetClassNameString() << "::InfoType " <<  type->GetClassNameString() << "::theInfo = {\n"
 		<< "    ASN1::BMPString::create,\n"
 		<< "    ";
 	GenerateTags(cxx);
 	cxx << ",\n";
-	const SizeConstraintElement* sizeConstraint = NULL;
-	size_t i;
-	for (i = 0; i < type->GetConstraints().size(); ++i)
-		if ((sizeConstraint = type->GetConstraints()[i]->GetSizeConstraint()) != NULL)
-			break;
-
-	if (sizeConstraint != NULL)
-	{
-		std::string str;
-		sizeConstraint->GetConstraint(str);
-		cxx << "    " << str.substr(0, str.size()-2) << ",\n";
-	}
-	else
-		cxx << "    ASN1::Unconstrained, 0, UINT_MAX,\n";
+	GenerateEncodedSizeInfo(type, cxx);
+	GenerateDescriptorInfo(type, cxx);
+	cxx << ",\n";
+	cxx << "    " << bounds << ",\n"
+		<< "    ASN1::PERWidth(" << bounds << "),\n"
+		<< "    " << GetCharSet(*type, ",\n    ") << "\n"
+		<< "};\n\n";
+}
 
+std::string BMPStringType::GetCharSet(const TypeBase& type, const char* separator) const
+{
 	const FromConstraintElement* fromConstraint = NULL;
-	for (i = 0; i < type->GetConstraints().size(); ++i)
-		if ((fromConstraint = type->GetConstraints()[i]->GetFromConstraint()) != NULL)
+	for (size_t i = 0; i < type.GetConstraints().size(); ++i)
+		if ((fromConstraint = type.GetConstraints()[i]->GetFromConstraint()) != NULL)
 			break;
 
-	cxx << "    ";
-
+	std::ostringstream strm;
     int range = 0xffff;
 	if (fromConstraint != NULL)
-        range = fromConstraint->GetRange(cxx);
+        range = fromConstraint->GetRange(strm);
 	else
-		cxx << 	0 << ", " << 0xffff ;
+		strm << 0 << ", " << 0xffff;
 
     int charSetUnalignedBits = CountBits(range);
 	
@@ -4473,10 +5539,36 @@ void BMPStringType::GenerateInfo(const TypeBase* type, std::ostream& hdr, std::o
 	while (charSetUnalignedBits > charSetAlignedBits)
 		charSetAlignedBits <<= 1;
 
-	cxx << ",\n"
-        << "    " << charSetUnalignedBits << ", " << charSetAlignedBits << "\n"
-		<< "};\n\n";
+	strm << separator << charSetUnalignedBits << ", " << charSetAlignedBits;
+	return strm.str();
+}
+
+unsigned BMPStringType::GetCharSetAlignedBits(const TypeBase& type) const
+{
+	const FromConstraintElement* fromConstraint = NULL;
+	for (size_t i = 0; i < type.GetConstraints().size(); ++i)
+		if ((fromConstraint = type.GetConstraints()[i]->GetFromConstraint()) != NULL)
+			break;
+
+	int range = 0xffff;
+	if (fromConstraint != NULL)
+	{
+		std::ostringstream dummy;
+		range = fromConstraint->GetRange(dummy);
+	}
 
+	unsigned charSetUnalignedBits = CountBits(range);
+	unsigned charSetAlignedBits = 1;
+	while (charSetUnalignedBits > charSetAlignedBits)
+		charSetAlignedBits <<= 1;
+	return charSetAlignedBits;
+}
+
+SizeRange BMPStringType::ComputeBERContents(const TypeBase& type) const
+{
+	SizeRange count;
+	ConstrainedLengthBits(GetSizeBounds(type, true), count);
+	return Repeat(count, SizeRange(2, 2));
 }
 /////////////////////////////////////////////////////////
 
@@ -4802,6 +5894,11 @@ bool ObjectClassFieldType::ReferencesType(const TypeBase & type) const
   return false;
 }
 
+bool ObjectClassFieldType::CollectReferences(StringList &) const
+{
+  return false;
+}
+
 TypeBase* ObjectClassFieldType::GetFieldType() 
 {
 	return asnObjectClass->GetFieldType(asnObjectClassField);
@@ -4840,44 +5937,78 @@ void ObjectClassFieldType::AddTableConstraint(std::shared_ptr<TableConstraint> c
 	tableConstraint = constraint;
 }
 
-void ObjectClassFieldType::GenerateDecoder(std::ostream& cxx)
+/*
+ * The object sets are keyed by a single field, so the object is selected by the first
+ * at-notation which names a component of the SEQUENCE; the other ones constrain fields 
+ * that the object sets do not keep. When that key comes first, preDecodeField() has the 
+ * open type decoded in place; otherwise its encoding is kept and redecoded afterwards.
+ */
+void ObjectClassFieldType::GenerateDecoder(const TypesVector& components, size_t index, 
+                                           std::ostream& preDecoder, std::ostream& decoder)
 {
-  if (tableConstraint.get() && tableConstraint->GetAtNotations() && tableConstraint->GetAtNotations()->size() ==1)
+  if (tableConstraint.get() == NULL || tableConstraint->GetAtNotations() == NULL)
+	  return;
+
+  const TypeBase* key = NULL;
+  size_t keyIndex = 0;
+  const StringList & lst = *(tableConstraint->GetAtNotations());
+  for (size_t i = 0; i < lst.size() && key == NULL; ++i)
   {
-      Indent indent(4); 
+      std::string keyname = lst[i];
+      if (keyname[0]== '.')
+          keyname = keyname.substr(1);
+      for (keyIndex = 0; keyIndex < components.size(); ++keyIndex)
+          if (components[keyIndex]->GetName() == keyname && !components[keyIndex]->IsRemovedType())
+          {
+              key = components[keyIndex].get();
+              break;
+          }
+  }
+  if (key == NULL)
+      return;
 
-      if (IsOptional())
-      {
-          cxx << indent << "if (" << GetName() << "_isPresent())\n"
+  std::string objSetName = tableConstraint->GetObjectSetIdentifier();
+  std::string fieldIdentifier = asnObjectClassField.substr(1);
+  std::string keyValue = "get_" + key->GetIdentifier() + "()";
+  std::string hasKey = key->IsOptional() ? key->GetIdentifier() + "_isPresent() && " : "";
+
+  if (keyIndex < index)
+      preDecoder << "    case " << index << ":\n"
+                 << "    {\n"
+                 << "      " << objSetName << " objSet(env);\n"
+                 << "      expectField(" << index << ", objSet.get() && " << hasKey << "objSet->count(" << keyValue << ") ?\n"
+                 << "        objSet->find(" << keyValue << ")->get_" << fieldIdentifier << "() : NULL);\n"
+                 << "      break;\n"
+                 << "    }\n";
+
+  Indent indent(4);
+  std::string field = "ref_" + GetIdentifier() + "()";
+  if (IsOptional())
+  {
+      decoder << indent << "if (" << GetIdentifier() << "_isPresent())\n"
               << indent << "{\n";
-          indent +=2;
-      }
+      indent +=2;
+  }
 
-      const StringList & lst = *(tableConstraint->GetAtNotations());
-      std::string keyname = lst[0];
-      if (keyname[0]== '.')
-          keyname = keyname.substr(1);
-      std::string fieldIdentifier = asnObjectClassField.substr(1);
-      cxx << indent << tableConstraint->GetObjectSetIdentifier() << " objSet(*visitor.get_env());\n"
-          << indent << "if (objSet.get())\n"
-	      << indent << "{\n"
-          << indent << "  if (objSet->count(get_" << keyname << "()))\n"
+  decoder << indent << "if (" << field << ".has_buf() || " << field << ".has_text())\n"
+          << indent << "{\n"
+          << indent << "  " << objSetName << " objSet(*visitor.get_env());\n"
+          << indent << "  if (!objSet.get())\n"
+          << indent << "    return false;\n"
+          << indent << "  if (" << hasKey << "objSet->count(" << keyValue << "))\n"
           << indent << "  {\n"
-          << indent << "    ref_" << GetName() << "().grab(objSet->find(get_" <<  keyname
-                            << "())->get_" << fieldIdentifier << "());\n"
-          << indent << "    return visitor.redecode(ref_" << GetName() << "());\n"
+          << indent << "    " << field << ".grab(objSet->find(" << keyValue << ")->get_" << fieldIdentifier << "());\n"
+          << indent << "    if (!visitor.redecode(" << field << "))\n"
+          << indent << "      return false;\n"
           << indent << "  }\n"
-		  << indent << "  else\n" 
-		  << indent << "    return objSet.extensible();\n"
+          << indent << "  else if (!objSet.extensible())\n"
+          << indent << "    return false;\n"
           << indent << "}\n";
 
-       if (IsOptional())
-       {
-           indent-=2;
-           cxx << indent << "}\n";
-       }
-      
-
+  if (IsOptional())
+  {
+      indent-=2;
+      decoder << indent << "}\n";
   }
 }
 
@@ -4889,14 +6020,23 @@ void ObjectClassFieldType::GenerateInfo(const TypeBase* type, std::ostream& hdr,
   {
       Indent indent(hdr.precision()+4) ;
       hdr << indent << "static const InfoType theInfo;\n";
+      GenerateDescriptorDecl(1, hdr);
+
+      std::vector<std::string> fields(1, FieldDescriptor("NULL", "&" + constrainedType + "::theInfo", "0", -1));
+      GenerateDescriptor(type, "e_openType", "ASN1::Unconstrained, 0, 0", false, 1, 1,
+                         GenerateFieldDescriptors(type, fields, cxx), cxx);
+
       cxx << GetTemplatePrefix()
 		  << "const "<< type->GetClassNameString() << "::InfoType " <<  type->GetClassNameString() << "::theInfo = {\n"
           << "    TypeConstrainedOpenData::create,\n"
           << "    ";
       
       type->GenerateTags(cxx);
+      cxx << ",\n";
+      GenerateEncodedSizeInfo(type, cxx);
+      GenerateDescriptorInfo(type, cxx);
       cxx << ",\n"
-          << "    &" << constrainedType << "::theInfo;\n"
+          << "    &" << constrainedType << "::theInfo\n"
           << "};\n\n";
   }
   else
@@ -4975,6 +6115,796 @@ bool ImportedType::IsPrimitiveType() const
         return false;
 }
 
+// the definition of the type in the module it is imported from
+static const TypeBase* GetDefinition(const ImportedType& type, const TypePtr& reference)
+{
+	if (reference.get())
+		return reference.get();
+	ModuleDefinition* module = FindModule(type.GetModuleName().c_str());
+	const TypeBase* definition = module ? module->FindType(type.GetName()).get() : NULL;
+	return definition != &type ? definition : NULL;
+}
+
+SizeRange ImportedType::ComputePERBits(const TypeBase&) const
+{
+	const TypeBase* definition = GetDefinition(*this, reference);
+	return definition ? definition->GetPERBits(*definition) : SizeRange();
+}
+
+SizeRange ImportedType::ComputeBERContents(const TypeBase&) const
+{
+	// the identifier and length octets are those of the definition
+	const TypeBase* definition = GetDefinition(*this, reference);
+	return definition ? definition->GetBEROctets(*definition) : SizeRange();
+}
+
+
+/////////////////////////////////////////////////////////
+//
+//  Lite bindings
+//
+//  With -l, asnparser also writes the plain structs of asn1.h's ASN1::lite to
+//  <module>_lite.h and <module>_lite.cxx: a struct for each SEQUENCE and CHOICE of the
+//  module, a typedef for each other type, and the functions encoding them in PER and
+//  converting them from and to the classes. A type is left out when one of its
+//  components has no lite type, such as a REAL, an open type or a recursive type.
+//
+
+// the largest bounds of the strings and BIT STRINGs which are kept inline
+static const long long MaxLiteArraySize = 256;
+static const long long MaxLiteBitArraySize = 2048;
+
+namespace {
+
+// the lite types worked out before writing, and those this thread is working out
+typedef std::pair<const TypeBase*, const TypeBase*> LiteKey;
+std::map<LiteKey, std::string> liteTypeCache;
+thread_local std::set<LiteKey> liteTypeComputing;
+
+}
+
+std::string TypeBase::GetLiteType(const TypeBase& type) const
+{
+	LiteKey key(this, &type);
+	std::map<LiteKey, std::string>::const_iterator it = liteTypeCache.find(key);
+	if (it != liteTypeCache.end())
+		return it->second;
+
+	// a recursive type cannot hold its components by value
+	if (!liteTypeComputing.insert(key).second)
+		return std::string();
+	std::string result = HasParameters() ? std::string() : ComputeLiteType(type);
+	liteTypeComputing.erase(key);
+	return typeInfoCached ? result : (liteTypeCache[key] = result);
+}
+
+std::string TypeBase::ComputeLiteType(const TypeBase&) const
+{
+	return std::string();
+}
+
+void TypeBase::GenerateLiteCodec(const TypeBase&, const std::string&, bool, std::ostream&) const
+{
+}
+
+void TypeBase::GenerateLite(std::ostream& hdr, std::ostream&)
+{
+	std::string liteType = GetLiteType(*this);
+	if (liteType.size())
+		hdr << "typedef " << liteType << ' ' << GetIdentifier() << ";\n";
+}
+
+// writes the call of the PERWriter or PERReader function named name
+static void GenerateLiteCall(std::ostream& cxx, bool encode, const std::string& name, const std::string& args)
+{
+	Indent indent(cxx.precision());
+	cxx << indent << "if (!" << (encode ? "out.write" : "in.read") << name << '(' << args << "))\n"
+		<< indent << "  return false;\n";
+}
+
+// an Array when bounds is a fixed SIZE no larger than maxSize, else container
+static std::string GetLiteArrayType(const std::string& element, const std::string& container,
+                                    const std::string& bounds, long long maxSize)
+{
+	std::string kind;
+	long long lower, upper;
+	if (!GetBounds(bounds, kind, lower, upper) || kind != "FixedConstraint" || upper < 1 || upper > maxSize)
+		return container;
+
+	std::ostringstream strm;
+	strm << "ASN1::lite::Array<" << element << ", " << upper << '>';
+	return strm.str();
+}
+
+std::string DefinedType::ComputeLiteType(const TypeBase& type) const
+{
+	ResolveReference();
+	if (baseType.get() == NULL)
+		return std::string();
+	return baseType->GetLiteType(&type == this && !NeedGenInfo() ? *baseType : type);
+}
+
+void DefinedType::GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	ResolveReference();
+	if (baseType.get() != NULL)
+		baseType->GenerateLiteCodec(&type == this && !NeedGenInfo() ? *baseType : type, value, encode, cxx);
+}
+
+std::string ParameterizedType::ComputeLiteType(const TypeBase&) const
+{
+	return std::string();
+}
+
+std::string BooleanType::ComputeLiteType(const TypeBase&) const
+{
+	return "bool";
+}
+
+void BooleanType::GenerateLiteCodec(const TypeBase&, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	GenerateLiteCall(cxx, encode, "Bit", value);
+}
+
+std::string IntegerType::ComputeLiteType(const TypeBase& type) const
+{
+	std::string kind;
+	long long lower, upper;
+	if (GetBounds(GetValueBounds(type), kind, lower, upper) && kind == "FixedConstraint" && lower >= 0)
+		return "unsigned";
+	return "int";
+}
+
+void IntegerType::GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	GenerateLiteCall(cxx, encode, "Integer", value + ", ASN1::PERConstraint(" + GetValueBounds(type) + ")");
+}
+
+// the NamedNumber of the class, whose values are those of the PER encoding
+std::string EnumeratedType::ComputeLiteType(const TypeBase&) const
+{
+	return GetCModuleName() + "::" + GetIdentifier() + "::NamedNumber";
+}
+
+void EnumeratedType::GenerateLiteCodec(const TypeBase&, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	std::ostringstream args;
+	args << value << ", " << GetMaxEnumValue() << ", " << (extendable ? "true" : "false");
+	GenerateLiteCall(cxx, encode, "Enumerated", args.str());
+}
+
+std::string BitStringType::ComputeLiteType(const TypeBase& type) const
+{
+	std::string kind;
+	long long lower, upper;
+	if (!GetBounds(GetSizeBounds(type, false), kind, lower, upper) || kind != "FixedConstraint" ||
+		upper > MaxLiteBitArraySize)
+		return "ASN1::lite::BitVector";
+
+	std::ostringstream strm;
+	strm << "ASN1::lite::BitArray<" << upper << '>';
+	return strm.str();
+}
+
+void BitStringType::GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	GenerateLiteCall(cxx, encode, "Bits", value + ", ASN1::PERConstraint(" + GetSizeBounds(type, false) + ")");
+}
+
+std::string OctetStringType::ComputeLiteType(const TypeBase& type) const
+{
+	return GetLiteArrayType("char", "std::vector<char>", GetSizeBounds(type, false), MaxLiteArraySize);
+}
+
+void OctetStringType::GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	GenerateLiteCall(cxx, encode, "Octets", value + ", ASN1::PERConstraint(" + GetSizeBounds(type, false) + ")");
+}
+
+std::string NullType::ComputeLiteType(const TypeBase&) const
+{
+	return "ASN1::lite::Null";
+}
+
+// only the strings whose characters the runtime knows
+std::string StringTypeBase::ComputeLiteType(const TypeBase& type) const
+{
+	if (canonicalSet == NULL)
+		return std::string();
+	return GetLiteArrayType("char", "std::string", GetSizeBounds(type, true), MaxLiteArraySize);
+}
+
+void StringTypeBase::GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	GenerateLiteCall(cxx, encode, "Chars", value + ", ASN1::PERConstraint(" + GetSizeBounds(type, true) + "), "
+		"ASN1::PERCharSet{ " + GetCharSet(type, ", ") + " }");
+}
+
+std::string BMPStringType::ComputeLiteType(const TypeBase& type) const
+{
+	return GetLiteArrayType("wchar_t", "std::wstring", GetSizeBounds(type, true), MaxLiteArraySize);
+}
+
+void BMPStringType::GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	GenerateLiteCall(cxx, encode, "Chars", value + ", ASN1::PERConstraint(" + GetSizeBounds(type, true) + "), "
+		"ASN1::PERBMPCharSet{ " + GetCharSet(type, ", ") + " }");
+}
+
+std::string ObjectIdentifierType::ComputeLiteType(const TypeBase&) const
+{
+	return "ASN1::lite::ObjectId";
+}
+
+void ObjectIdentifierType::GenerateLiteCodec(const TypeBase&, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	GenerateLiteCall(cxx, encode, "ObjectId", value);
+}
+
+// a std::vector, but not a std::vector<bool>, whose elements cannot be referred to
+std::string SequenceOfType::ComputeLiteType(const TypeBase&) const
+{
+	std::string element = baseType->GetLiteType(*baseType);
+	if (element.empty() || element == "bool")
+		return std::string();
+	return "std::vector<" + element + ">";
+}
+
+void SequenceOfType::GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	Indent indent(cxx.precision());
+	std::string size = "ASN1::PERConstraint(" + GetSizeBounds(type, false) + ")";
+	if (encode)
+		GenerateLiteCall(cxx, true, "Count", value + ".size(), " + size);
+	else
+		cxx << indent << "{\n"
+			<< indent << "  unsigned n;\n"
+			<< indent << "  if (!in.readCount(n, " << size << "))\n"
+			<< indent << "    return false;\n"
+			<< indent << "  " << value << ".resize(n);\n"
+			<< indent << "}\n";
+
+	// the index is named after how deeply the SEQUENCE OF is nested
+	std::ostringstream index;
+	index << 'i' << std::count(value.begin(), value.end(), '[');
+	cxx << indent << "for (size_t " << index.str() << " = 0; " << index.str() << " < " << value << ".size(); ++"
+		<< index.str() << ") {\n"
+		<< std::setprecision(cxx.precision() + 2);
+	baseType->GenerateLiteCodec(*baseType, value + '[' + index.str() + ']', encode, cxx);
+	cxx << std::setprecision(cxx.precision() - 2)
+		<< indent << "}\n";
+}
+
+std::string SequenceType::ComputeLiteType(const TypeBase&) const
+{
+	for (size_t i = 0; i < fields.size(); ++i)
+	{
+		if (fields[i]->IsRemovedType())
+		{
+			// a mandatory component cannot be written without its type
+			if (i < numFields && !fields[i]->IsOptional())
+				return std::string();
+		}
+		else if (fields[i]->GetLiteType(*fields[i]).empty())
+			return std::string();
+	}
+	return GetCModuleName() + "::lite::" + GetIdentifier();
+}
+
+void SequenceType::GenerateLiteCodec(const TypeBase&, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	Indent indent(cxx.precision());
+	cxx << indent << "if (!" << (encode ? "encode_per(out, " : "decode_per(in, ") << value << "))\n"
+		<< indent << "  return false;\n";
+}
+
+// writes the codec of an extension addition, which is an open type
+static void GenerateLiteOpenType(const TypeBase& field, const std::string& value, bool encode, std::ostream& cxx)
+{
+	Indent indent(cxx.precision());
+	cxx << (encode ? "out.writeOpen([&](ASN1::lite::PERWriter& out) {\n" : "in.readOpen([&](ASN1::lite::PERReader& in) {\n")
+		<< std::setprecision(cxx.precision() + 4);
+	field.GenerateLiteCodec(field, value, encode, cxx);
+	cxx << std::setprecision(cxx.precision() - 4)
+		<< indent << "    return true;\n"
+		<< indent << "  })";
+}
+
+/*
+ * A SEQUENCE is a struct of its components. The OPTIONAL ones and the extension
+ * additions are numbered in that order by OptionalFields, which index the present
+ * set. A component left out with -r keeps its number, but has no enumerator.
+ */
+void SequenceType::GenerateLite(std::ostream& hdr, std::ostream& cxx)
+{
+	if (GetLiteType(*this).empty())
+		return;
+
+	const std::string name = GetIdentifier();
+	const std::string className = GetCModuleName() + "::" + GetIdentifier();
+	size_t i;
+
+	std::vector<int> bits(fields.size(), -1);
+	int nBits = 0, nRootBits = 0;
+	for (i = 0; i < fields.size(); ++i)
+		if (i >= numFields || fields[i]->IsOptional())
+		{
+			bits[i] = nBits++;
+			if (i < numFields)
+				nRootBits++;
+		}
+	const int nAdditions = nBits - nRootBits;
+
+	hdr << "struct " << name << "\n"
+		   "{\n";
+	if (nBits > 0)
+	{
+		hdr << "  enum OptionalFields {";
+		bool numbered = true;
+		const char* separator = "\n";
+		for (i = 0; i < fields.size(); ++i)
+		{
+			if (bits[i] < 0)
+				continue;
+			if (fields[i]->IsRemovedType())
+			{
+				numbered = false;
+				continue;
+			}
+			hdr << separator << "    e_" << fields[i]->GetIdentifier();
+			if (!numbered)
+				hdr << " = " << bits[i];
+			numbered = true;
+			separator = ",\n";
+		}
+		hdr << "\n"
+			   "  };\n"
+			   "\n"
+			   "  bool isPresent(OptionalFields field) const { return present[field]; }\n"
+			   "  void include(OptionalFields field) { present.set(field); }\n"
+			   "  void omit(OptionalFields field) { present.reset(field); }\n"
+			   "\n";
+	}
+	for (i = 0; i < fields.size(); ++i)
+		if (!fields[i]->IsRemovedType())
+			hdr << "  " << fields[i]->GetLiteType(*fields[i]) << ' ' << fields[i]->GetIdentifier() << ";\n";
+	if (nBits > 0)
+		hdr << "  std::bitset<" << nBits << "> present;\n";
+	hdr << "};\n"
+		   "\n"
+		   "bool encode_per(ASN1::lite::PERWriter& out, const " << name << "& value);\n"
+		   "bool decode_per(ASN1::lite::PERReader& in, " << name << "& value);\n"
+		   "bool to_lite(const " << className << "& value, " << name << "& lite);\n"
+		   "void from_lite(const " << name << "& lite, " << className << "& value);\n"
+		   "\n";
+
+	for (int encode = 1; encode >= 0; --encode)
+	{
+		if (encode)
+			cxx << "bool encode_per(ASN1::lite::PERWriter& out, const " << name << "& value)\n"
+				   "{\n";
+		else
+			cxx << "bool decode_per(ASN1::lite::PERReader& in, " << name << "& value)\n"
+				   "{\n";
+
+		// the preamble: the extension bit and the bits of the OPTIONAL components
+		if (extendable)
+		{
+			if (encode && nAdditions > 0)
+				cxx << "  bool extended = (value.present >> " << nRootBits << ").any();\n"
+					   "  if (!out.writeBit(extended))\n";
+			else if (encode)
+				cxx << "  if (!out.writeBit(false))\n";
+			else
+				cxx << "  bool extended = false;\n"
+					   "  if (!in.readBit(extended))\n";
+			cxx << "    return false;\n";
+		}
+		if (!encode && nBits > 0)
+			cxx << "  bool bit;\n"
+				   "  value.present.reset();\n";
+		else if (!encode && extendable)
+			cxx << "  bool bit;\n";
+
+		for (i = 0; i < numFields; ++i)
+		{
+			if (bits[i] < 0)
+				continue;
+			std::string bit = fields[i]->IsRemovedType() ? std::string() : name + "::e_" + fields[i]->GetIdentifier();
+			if (encode)
+				cxx << "  if (!out.writeBit(" << (bit.size() ? "value.present[" + bit + "]" : "false") << "))\n"
+					   "    return false;\n";
+			else if (bit.size())
+				cxx << "  if (!in.readBit(bit))\n"
+					   "    return false;\n"
+					   "  value.present[" << bit << "] = bit;\n";
+			else
+				cxx << "  if (!in.readBit(bit) || bit)\n"
+					   "    return false;\n";
+		}
+
+		// the root components
+		for (i = 0; i < numFields; ++i)
+		{
+			TypeBase& field = *fields[i];
+			if (field.IsRemovedType())
+				continue;
+			std::string value = "value." + field.GetIdentifier();
+			if (bits[i] < 0)
+			{
+				cxx << std::setprecision(2);
+				field.GenerateLiteCodec(field, value, encode != 0, cxx);
+				continue;
+			}
+			cxx << "  if (value.present[" << name << "::e_" << field.GetIdentifier() << "]) {\n"
+				<< std::setprecision(4);
+			field.GenerateLiteCodec(field, value, encode != 0, cxx);
+			cxx << "  }\n";
+		}
+
+		// the extension additions, each in an open type
+		if (extendable && nAdditions > 0)
+		{
+			cxx << "  if (extended) {\n";
+			if (encode)
+				cxx << "    unsigned nAdditions = " << nAdditions << ";\n"
+					   "    while (!value.present[" << nRootBits << " + nAdditions - 1])\n"
+					   "      --nAdditions;\n"
+					   "    if (!out.writeExtensionCount(nAdditions))\n"
+					   "      return false;\n"
+					   "    for (unsigned i = 0; i < nAdditions; ++i)\n"
+					   "      if (!out.writeBit(value.present[" << nRootBits << " + i]))\n"
+					   "        return false;\n";
+			else
+				cxx << "    unsigned nAdditions, unknown = 0;\n"
+					   "    if (!in.readExtensionCount(nAdditions))\n"
+					   "      return false;\n"
+					   "    for (unsigned i = 0; i < nAdditions; ++i) {\n"
+					   "      if (!in.readBit(bit))\n"
+					   "        return false;\n"
+					   "      if (i < " << nAdditions << ")\n"
+					   "        value.present[" << nRootBits << " + i] = bit;\n"
+					   "      else\n"
+					   "        unknown += bit;\n"
+					   "    }\n";
+
+			for (i = numFields; i < fields.size(); ++i)
+			{
+				TypeBase& field = *fields[i];
+				if (field.IsRemovedType())
+				{
+					// skipped, as if it were unknown
+					if (!encode)
+						cxx << "    if (value.present[" << bits[i] << "]) {\n"
+							   "      value.present.reset(" << bits[i] << ");\n"
+							   "      if (!in.skipOpen())\n"
+							   "        return false;\n"
+							   "    }\n";
+					continue;
+				}
+				cxx << "    if (value.present[" << name << "::e_" << field.GetIdentifier() << "] && !"
+					<< std::setprecision(4);
+				GenerateLiteOpenType(field, "value." + field.GetIdentifier(), encode != 0, cxx);
+				cxx << ")\n"
+					   "      return false;\n";
+			}
+			if (!encode)
+				cxx << "    for (; unknown > 0; --unknown)\n"
+					   "      if (!in.skipOpen())\n"
+					   "        return false;\n";
+			cxx << "  }\n";
+		}
+		else if (extendable && !encode)
+		{
+			// every addition is unknown
+			cxx << "  if (extended) {\n"
+				   "    unsigned nAdditions, unknown = 0;\n"
+				   "    if (!in.readExtensionCount(nAdditions))\n"
+				   "      return false;\n"
+				   "    for (unsigned i = 0; i < nAdditions; ++i) {\n"
+				   "      if (!in.readBit(bit))\n"
+				   "        return false;\n"
+				   "      unknown += bit;\n"
+				   "    }\n"
+				   "    for (; unknown > 0; --unknown)\n"
+				   "      if (!in.skipOpen())\n"
+				   "        return false;\n"
+				   "  }\n";
+		}
+		cxx << "  return true;\n"
+			   "}\n"
+			   "\n";
+	}
+
+	// the conversions, through the accessors of the class
+	cxx << "bool to_lite(const " << className << "& value, " << name << "& lite)\n"
+		   "{\n";
+	if (nBits > 0)
+		cxx << "  lite.present.reset();\n";
+	for (i = 0; i < fields.size(); ++i)
+	{
+		TypeBase& field = *fields[i];
+		if (field.IsRemovedType())
+			continue;
+		std::string id = field.GetIdentifier();
+		if (bits[i] < 0)
+			cxx << "  if (!to_lite(value.get_" << id << "(), lite." << id << "))\n"
+				   "    return false;\n";
+		else if (field.GetTypeName() == "ASN1::Null")
+			cxx << "  if (value." << id << "_isPresent())\n"
+				   "    lite.include(" << name << "::e_" << id << ");\n";
+		else
+			cxx << "  if (value." << id << "_isPresent()) {\n"
+				   "    lite.include(" << name << "::e_" << id << ");\n"
+				   "    if (!to_lite(value.get_" << id << "(), lite." << id << "))\n"
+				   "      return false;\n"
+				   "  }\n";
+	}
+	cxx << "  return true;\n"
+		   "}\n"
+		   "\n"
+		   "void from_lite(const " << name << "& lite, " << className << "& value)\n"
+		   "{\n";
+	for (i = 0; i < fields.size(); ++i)
+	{
+		TypeBase& field = *fields[i];
+		if (field.IsRemovedType())
+			continue;
+		std::string id = field.GetIdentifier();
+		if (bits[i] < 0)
+			cxx << "  from_lite(lite." << id << ", value.set_" << id << "());\n";
+		else
+			cxx << "  if (lite.isPresent(" << name << "::e_" << id << "))\n"
+				   "    from_lite(lite." << id << ", value.set_" << id << "());\n"
+				   "  else\n"
+				   "    value.omit_" << id << "();\n";
+	}
+	cxx << "}\n"
+		   "\n";
+}
+
+std::string ChoiceType::ComputeLiteType(const TypeBase&) const
+{
+	for (size_t i = 0; i < fields.size(); ++i)
+		if (!fields[i]->IsRemovedType() && fields[i]->GetLiteType(*fields[i]).empty())
+			return std::string();
+	return GetCModuleName() + "::lite::" + GetIdentifier();
+}
+
+/*
+ * A CHOICE is a tagged union. Its alternatives are numbered by Choices in the order
+ * of the ids of the class; selection is -1 when there is none, and the number read
+ * for an unknown extension addition.
+ */
+void ChoiceType::GenerateLite(std::ostream& hdr, std::ostream& cxx)
+{
+	if (GetLiteType(*this).empty())
+		return;
+
+	const std::string name = GetIdentifier();
+	const std::string className = GetCModuleName() + "::" + GetIdentifier();
+	size_t i;
+
+	std::vector<TypeBase*> alternatives;
+	for (i = 0; i < fields.size(); ++i)
+		alternatives.push_back(fields[i].get());
+	if (GetTag().mode != Tag::Automatic)
+		std::sort(alternatives.begin(), alternatives.end(), CompareTag);
+
+	hdr << "struct " << name << "\n"
+		   "{\n"
+		   "  enum Choices {";
+	bool numbered = true;
+	const char* separator = "\n";
+	for (i = 0; i < alternatives.size(); ++i)
+	{
+		if (alternatives[i]->IsRemovedType())
+		{
+			numbered = false;
+			continue;
+		}
+		hdr << separator << "    e_" << alternatives[i]->GetIdentifier();
+		if (!numbered)
+			hdr << " = " << i;
+		numbered = true;
+		separator = ",\n";
+	}
+	hdr << "\n"
+		   "  };\n"
+		   "\n"
+		   "  " << name << "() : selection(-1) {}\n"
+		   "  " << name << "(const " << name << "& other) : selection(-1) { *this = other; }\n"
+		   "  " << name << "& operator=(const " << name << "& other);\n"
+		   "  ~" << name << "() { reset(); }\n"
+		   "  void reset();\n"
+		   "\n";
+	for (i = 0; i < alternatives.size(); ++i)
+	{
+		if (alternatives[i]->IsRemovedType())
+			continue;
+		std::string id = alternatives[i]->GetIdentifier();
+		hdr << "  " << alternatives[i]->GetLiteType(*alternatives[i]) << "& select_" << id << "()"
+			   " { reset(); selection = e_" << id << "; return ASN1::lite::construct(" << id << "); }\n";
+	}
+	hdr << "\n"
+		   "  int selection;\n"
+		   "  union {\n";
+	for (i = 0; i < alternatives.size(); ++i)
+		if (!alternatives[i]->IsRemovedType())
+			hdr << "    " << alternatives[i]->GetLiteType(*alternatives[i]) << ' ' << alternatives[i]->GetIdentifier() << ";\n";
+	hdr << "  };\n"
+		   "};\n"
+		   "\n"
+		   "bool encode_per(ASN1::lite::PERWriter& out, const " << name << "& value);\n"
+		   "bool decode_per(ASN1::lite::PERReader& in, " << name << "& value);\n"
+		   "bool to_lite(const " << className << "& value, " << name << "& lite);\n"
+		   "void from_lite(const " << name << "& lite, " << className << "& value);\n"
+		   "\n";
+
+	cxx << name << "& " << name << "::operator=(const " << name << "& other)\n"
+		   "{\n"
+		   "  if (this != &other) {\n"
+		   "    reset();\n"
+		   "    switch (other.selection) {\n";
+	for (i = 0; i < alternatives.size(); ++i)
+		if (!alternatives[i]->IsRemovedType())
+		{
+			std::string id = alternatives[i]->GetIdentifier();
+			cxx << "      case e_" << id << ":\n"
+				   "        ASN1::lite::construct(" << id << ", other." << id << ");\n"
+				   "        break;\n";
+		}
+	cxx << "    }\n"
+		   "    selection = other.selection;\n"
+		   "  }\n"
+		   "  return *this;\n"
+		   "}\n"
+		   "\n"
+		   "void " << name << "::reset()\n"
+		   "{\n"
+		   "  switch (selection) {\n";
+	for (i = 0; i < alternatives.size(); ++i)
+		if (!alternatives[i]->IsRemovedType())
+		{
+			std::string id = alternatives[i]->GetIdentifier();
+			cxx << "    case e_" << id << ":\n"
+				   "      ASN1::lite::destroy(" << id << ");\n"
+				   "      break;\n";
+		}
+	cxx << "  }\n"
+		   "  selection = -1;\n"
+		   "}\n"
+		   "\n";
+
+	const char* ext = extendable ? "true" : "false";
+	cxx << "bool encode_per(ASN1::lite::PERWriter& out, const " << name << "& value)\n"
+		   "{\n"
+		   "  if (!out.writeChoice(value.selection, " << numFields << ", " << ext << "))\n"
+		   "    return false;\n"
+		   "  switch (value.selection) {\n";
+	for (i = 0; i < alternatives.size(); ++i)
+	{
+		TypeBase& field = *alternatives[i];
+		if (field.IsRemovedType())
+			continue;
+		std::string value = "value." + field.GetIdentifier();
+		cxx << "    case " << name << "::e_" << field.GetIdentifier() << ":\n";
+		if (i < numFields)
+		{
+			cxx << std::setprecision(6);
+			field.GenerateLiteCodec(field, value, true, cxx);
+			cxx << "      return true;\n";
+		}
+		else
+		{
+			cxx << "      return " << std::setprecision(4);
+			GenerateLiteOpenType(field, value, true, cxx);
+			cxx << ";\n";
+		}
+	}
+	cxx << "  }\n"
+		   "  return false;\n"
+		   "}\n"
+		   "\n"
+		   "bool decode_per(ASN1::lite::PERReader& in, " << name << "& value)\n"
+		   "{\n"
+		   "  unsigned selection;\n"
+		   "  if (!in.readChoice(selection, " << numFields << ", " << ext << "))\n"
+		   "    return false;\n"
+		   "  switch (selection) {\n";
+	for (i = 0; i < alternatives.size(); ++i)
+	{
+		TypeBase& field = *alternatives[i];
+		if (field.IsRemovedType())
+			continue;
+		std::string id = field.GetIdentifier();
+		cxx << "    case " << name << "::e_" << id << ":\n"
+			   "      value.select_" << id << "();\n";
+		if (i < numFields)
+		{
+			cxx << std::setprecision(6);
+			field.GenerateLiteCodec(field, "value." + id, false, cxx);
+			cxx << "      return true;\n";
+		}
+		else
+		{
+			cxx << "      return " << std::setprecision(4);
+			GenerateLiteOpenType(field, "value." + id, false, cxx);
+			cxx << ";\n";
+		}
+	}
+	cxx << "  }\n";
+	if (extendable)
+		cxx << "  // an alternative left out with -r, or an unknown extension addition\n"
+			   "  value.reset();\n"
+			   "  if (selection < " << numFields << ")\n"
+			   "    return false;\n"
+			   "  value.selection = selection;\n"
+			   "  return in.skipOpen();\n";
+	else
+		cxx << "  return false;\n";
+	cxx << "}\n"
+		   "\n";
+
+	// the conversions; the accessors of the class are named after the ASN.1 names
+	cxx << "bool to_lite(const " << className << "& value, " << name << "& lite)\n"
+		   "{\n"
+		   "  switch (value.currentSelection()) {\n";
+	for (i = 0; i < alternatives.size(); ++i)
+	{
+		TypeBase& field = *alternatives[i];
+		if (field.IsRemovedType())
+			continue;
+		std::string id = field.GetIdentifier(), accessor = field.GetName();
+		str_replace(accessor, "-", "_");
+		cxx << "    case " << className << "::" << id << "::id_:\n";
+		if (field.GetTypeName() == "ASN1::Null")
+			cxx << "      lite.select_" << id << "();\n"
+				   "      return true;\n";
+		else
+			cxx << "      return to_lite(value.get_" << accessor << "(), lite.select_" << id << "());\n";
+	}
+	cxx << "  }\n"
+		   "  lite.reset();\n"
+		   "  return value.currentSelection() == ASN1::CHOICE::unselected_;\n"
+		   "}\n"
+		   "\n"
+		   "void from_lite(const " << name << "& lite, " << className << "& value)\n"
+		   "{\n"
+		   "  switch (lite.selection) {\n";
+	for (i = 0; i < alternatives.size(); ++i)
+	{
+		TypeBase& field = *alternatives[i];
+		if (field.IsRemovedType())
+			continue;
+		std::string id = field.GetIdentifier(), accessor = field.GetName();
+		str_replace(accessor, "-", "_");
+		cxx << "    case " << name << "::e_" << id << ":\n"
+			   "      from_lite(lite." << id << ", value.select_" << accessor << "());\n"
+			   "      break;\n";
+	}
+	cxx << "  }\n"
+		   "}\n"
+		   "\n";
+}
+
+std::string ImportedType::ComputeLiteType(const TypeBase&) const
+{
+	const TypeBase* definition = GetDefinition(*this, reference);
+	return definition ? definition->GetLiteType(*definition) : std::string();
+}
+
+void ImportedType::GenerateLiteCodec(const TypeBase&, const std::string& value, bool encode, std::ostream& cxx) const
+{
+	const TypeBase* definition = GetDefinition(*this, reference);
+	if (definition)
+		definition->GenerateLiteCodec(*definition, value, encode, cxx);
+}
+
+// the module it is imported from has the lite type
+void ImportedType::GenerateLite(std::ostream&, std::ostream&)
+{
+}
 
 /////////////////////////////////////////////////////////
 TypeFromObject::TypeFromObject(InformationObjectPtr  obj, const std::string& fld)
@@ -5079,12 +7009,18 @@ void DefinedValue::PrintOn(std::ostream & strm) const
 }
 
 
-void DefinedValue::GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl) const
+void DefinedValue::ResolveReferences() const
 {
   if (unresolved) {
     unresolved = false;
 	actualValue = Module->FindValue(referenceName);
   }
+}
+
+
+void DefinedValue::GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl) const
+{
+  ResolveReferences();
 
   if (actualValue.get() != NULL)
     actualValue->GenerateCplusplus(hdr, cxx, inl);
@@ -5316,6 +7252,13 @@ void SequenceValue::PrintOn(std::ostream & strm) const
   strm << " }";
 }
 
+
+void SequenceValue::ResolveReferences() const
+{
+  for (size_t i = 0; i < values.size(); i++)
+    values[i]->ResolveReferences();
+}
+
 /////////////////////////////////////////////////////
 
 void ChoiceValue::PrintOn(std::ostream & strm) const
@@ -5420,6 +7363,22 @@ bool ImportModule::HasValuesOrObjects() const
 	return false;
 }
 
+void ImportModule::RemoveUnreachableObjects(ModuleDefinition& module)
+{
+	// an object left out with -r no longer makes the Module of this module
+	// take the Module it is imported from
+	SymbolList reachable;
+	for (size_t i = 0; i < symbols.size(); ++i)
+	{
+		const std::string& name = symbols[i]->GetName();
+		if ((dynamic_cast<ObjectReference*>(symbols[i].get()) && !module.FindInformationObject(name)) ||
+			(dynamic_cast<ObjectSetReference*>(symbols[i].get()) && !module.FindInformationObjectSet(name)))
+			continue;
+		reachable.push_back(symbols[i]);
+	}
+	symbols.swap(reachable);
+}
+
 std::string ImportModule::GetCModuleName() const
 {
 	return MakeIdentifierC(fullModuleName);
@@ -5434,6 +7393,9 @@ ModuleDefinition::ModuleDefinition(const std::string& name, Tag::Mode defTagMode
   defaultTagMode = defTagMode;
   exportAll = false;
   indentLevel = 1;
+  hasTemplates = false;
+  sourceFile = fileName;
+  descriptorTable = "typeDescriptors";
 
   for (size_t i = 0; i < Modules.size(); ++i)
   {
@@ -5572,59 +7534,162 @@ void ModuleDefinition::AdjustModuleName(const std::string & sourcePath,bool isSu
 		path += tmp.substr(tmp.size()-tmp.find('_'));
 	}
 
+	// a sub-module shares the namespace of its module, so its table is named after its file
+	descriptorTable = "typeDescriptors";
+	if (isSubModule)
+		descriptorTable = ToLower(MakeIdentifierC(::GetFileName(path))) + "_" + descriptorTable;
 }
 
-bool ModuleDefinition::ReorderTypes()
+/*
+ * Places the types of a module after the types they reference, in the order the bubble 
+ * pass used to give: the first type not placed yet is placed unless it references one of 
+ * the others, in which case it goes to the back of the queue. A type is only checked 
+ * against the types it names, when they can be told, in the order of the queue, so the 
+ * same ReferencesType() calls are made and the same forward declarations come out, 
+ * without scanning the whole queue for every type. When every type in the queue has gone 
+ * to the back since one was placed, they reference each other; the loop is reported, 
+ * along with the whole chain of references, and the first type is placed regardless.
+ */
+class TypeSorter
 {
-  // Reorder types
-  // Determine if we need a separate file for template closure
-  bool hasTemplates = false;
-  size_t loopDetect = 0;
-  size_t bubble = 0;
+public:
+  TypeSorter(const TypesVector& types)
+	  : types(types), placed(types.size(), false), turn(types.size()), 
+	    named(types.size(), true), candidates(types.size()), blocker(types.size())
+  {
+	  std::multimap<std::string, size_t> positions;
+	  size_t i;
+	  for (i = 0; i < types.size(); ++i)
+		  positions.insert(std::make_pair(types[i]->GetName(), i));
 
-  typedef std::list<std::shared_ptr<TypeBase> > TypesList;
-  TypesList rtypes(types.begin(), types.end());
+	  for (i = 0; i < types.size(); ++i)
+	  {
+		  queue.push_back(i);
+		  turn[i] = i;
 
-  TypesList::iterator itr , bubble_itr=rtypes.begin();
+		  StringList names;
+		  if (!types[i]->CanReferenceType())
+			  continue;
+		  if (!types[i]->CollectReferences(names))
+		  {
+			  named[i] = false;
+			  continue;
+		  }
+		  for (size_t n = 0; n < names.size(); ++n)
+		  {
+			  std::pair<std::multimap<std::string, size_t>::const_iterator, 
+				  std::multimap<std::string, size_t>::const_iterator> 
+				  range = positions.equal_range(names[n]);
+			  for (; range.first != range.second; ++range.first)
+				  if (types[range.first->second] != types[i])
+					  candidates[i].push_back(range.first->second);
+		  }
+		  std::sort(candidates[i].begin(), candidates[i].end());
+		  candidates[i].erase(std::unique(candidates[i].begin(), candidates[i].end()), candidates[i].end());
+	  }
+  }
 
-  while (bubble < types.size()) {
+  void Sort()
+  {
+	  size_t nextTurn = types.size();
+	  size_t sentBack = 0; // since a type was placed
+	  while (!queue.empty())
+	  {
+		  size_t i = queue.front();
+		  queue.pop_front();
+		  if (ReferencesWaitingType(i))
+		  {
+			  if (sentBack <= queue.size())
+			  {
+				  turn[i] = nextTurn++;
+				  queue.push_back(i);
+				  ++sentBack;
+				  continue;
+			  }
+			  ReportLoop(i);
+		  }
+		  placed[i] = true;
+		  order.push_back(types[i]);
+		  sentBack = 0;
+	  }
+  }
 
-    bool makesReference = false;
-    TypeBase*  bubbleType = bubble_itr->get();
-    if (bubbleType->CanReferenceType()) {
-      for (itr = bubble_itr; itr != rtypes.end(); ++itr) {
-        if (bubbleType != itr->get() && bubbleType->ReferencesType(**itr)) {
-          makesReference = true;
-          break;
-        }
-      }
-    }
+  TypesVector order;
 
-    if (makesReference) {
-	  rtypes.push_back(*bubble_itr);
-	  rtypes.erase(bubble_itr++);
-      if (loopDetect > rtypes.size()) {
-        std::cerr << StdError(Fatal)
-               << "Recursive type definition: " << bubbleType->GetName() 
-			   << " references " << (*itr)->GetName() <<std::endl;
-		break;		
-      }
-      loopDetect++;
-    }
-    else {
-      loopDetect = bubble;
-      bubble++;
-	  ++bubble_itr;
-    }
+private:
+  struct ByTurn
+  {
+	  ByTurn(const std::vector<size_t>& turn) : turn(turn) {}
+	  bool operator()(size_t a, size_t b) const { return turn[a] < turn[b]; }
+	  const std::vector<size_t>& turn;
+  };
 
-    if (bubbleType->HasParameters())
-      hasTemplates = true;
+  bool ReferencesWaitingType(size_t i)
+  {
+	  TypeBase& type = *types[i];
+	  if (!named[i])
+	  {
+		  for (std::list<size_t>::const_iterator j = queue.begin(); j != queue.end(); ++j)
+			  if (types[*j] != types[i] && type.ReferencesType(*types[*j]))
+			  {
+				  blocker[i] = *j;
+				  return true;
+			  }
+		  return false;
+	  }
+
+	  std::vector<size_t> waiting;
+	  for (size_t c = 0; c < candidates[i].size(); ++c)
+		  if (!placed[candidates[i][c]])
+			  waiting.push_back(candidates[i][c]);
+	  std::sort(waiting.begin(), waiting.end(), ByTurn(turn));
+	  for (size_t w = 0; w < waiting.size(); ++w)
+		  if (type.ReferencesType(*types[waiting[w]]))
+		  {
+			  blocker[i] = waiting[w];
+			  return true;
+		  }
+	  return false;
+  }
+
+  void ReportLoop(size_t i)
+  {
+	  // every type waiting was checked since the last one was placed, so
+	  // following what each of them references comes back to one of them
+	  std::vector<size_t> path;
+	  std::vector<bool> onPath(types.size(), false);
+	  for (; !onPath[i]; i = blocker[i])
+	  {
+		  onPath[i] = true;
+		  path.push_back(i);
+	  }
+
+	  std::cerr << StdError(Fatal) << "Recursive type definition: ";
+	  for (size_t k = std::find(path.begin(), path.end(), i) - path.begin(); k < path.size(); ++k)
+		  std::cerr << types[path[k]]->GetName() << " references ";
+	  std::cerr << types[i]->GetName() << std::endl;
   }
 
-  //types.assign(rtypes.begin(), rtypes.end());
-  types.clear();
-  std::copy( rtypes.begin(), rtypes.end(), std::back_inserter(types));
+  const TypesVector& types;
+  std::list<size_t> queue;
+  std::vector<bool> placed;
+  std::vector<size_t> turn;
+  std::vector<bool> named;
+  std::vector<std::vector<size_t> > candidates;
+  std::vector<size_t> blocker;
+};
+
+bool ModuleDefinition::ReorderTypes()
+{
+  // Determine if we need a separate file for template closure
+  bool hasTemplates = false;
+  for (size_t i = 0; i < types.size(); ++i) 
+    if (types[i]->HasParameters())
+      hasTemplates = true;
 
+  TypeSorter sorter(types);
+  sorter.Sort();
+  types.swap(sorter.order);
   return hasTemplates;
 }
 
@@ -5632,17 +7697,18 @@ void ModuleDefinition::GenerateCplusplus(const std::string & dir,
                                          unsigned classesPerFile,
                                          bool verbose)
 {
-  size_t i,classesCount = 1;
+  PrepareCplusplus(verbose);
+  OutputCplusplus(dir, classesPerFile, verbose);
+}
+
+void ModuleDefinition::PrepareCplusplus(bool verbose)
+{
+  size_t i;
 
   Module = this;
-  std::string path(dir);
-  if (path.length())
-	  path += DIR_SEPARATOR;
 
   if (verbose)
 	  std::cout << "Processing files " << this->GetFileName() << "...\n"; 
-	  
-  path += GetFileName();
 
   // Remove all PER Invisible constraint
    for (i = 0; i < types.size(); i++)
@@ -5656,17 +7722,57 @@ void ModuleDefinition::GenerateCplusplus(const std::string & dir,
 	std::string name = types[i]->GetName();
    }
 
+  // Resolve the references against this module now, rather than against
+  // whichever module is being written when one is first used
+  for (i = 0; i < types.size(); i++)
+    types[i]->ResolveReferences();
+
+  // and so are the names the classes, objects, object sets and values use,
+  // so that writing the modules, in parallel with -j, only reads them
+  for (i = 0; i < objectClasses.size(); i++)
+    objectClasses[i]->ResolveReference();
+  for (i = 0; i < informationObjects.size(); i++)
+    informationObjects[i]->ResolveReferences();
+  for (i = 0; i < informationObjectSets.size(); i++)
+    informationObjectSets[i]->ResolveReferences();
+  for (i = 0; i < values.size(); i++)
+    values[i]->ResolveReferences();
+
   if (verbose)
 	  std::cout << "Sorting " << types.size() << " types..." << std::endl;
 
-  bool hasTemplates = ReorderTypes();
+  hasTemplates = ReorderTypes();
 
 
   // Adjust all of the C++ identifiers prepending module name
   for (i = 0; i < types.size(); i++)
     types[i]->AdjustIdentifier(true);
+}
 
- 
+void ModuleDefinition::CacheTypeInfo()
+{
+  Module = this;
+  for (size_t i = 0; i < types.size(); i++) {
+    types[i]->GetPERBits(*types[i]);
+    types[i]->GetBEROctets(*types[i]);
+    if (generateLite && !types[i]->HasParameters())
+      types[i]->GetLiteType(*types[i]);
+  }
+}
+
+void ModuleDefinition::OutputCplusplus(const std::string & dir,
+                                       unsigned classesPerFile,
+                                       bool verbose)
+{
+  size_t i,classesCount = 1;
+  StringList outputs;
+
+  Module = this;
+  std::string path(dir);
+  if (path.length())
+	  path += DIR_SEPARATOR;
+
+  path += GetFileName();
 
   // Generate the code
   if (verbose)
@@ -5676,7 +7782,7 @@ void ModuleDefinition::GenerateCplusplus(const std::string & dir,
   // Output the special template closure file, if necessary
   std::string templateFilename;
   if (hasTemplates) {
-	  OutputFile templateFile;
+	  OutputFile templateFile(&outputs);
 	  
 	  if (!templateFile.Open(path, "_t", ".cxx"))
 		  return;
@@ -5701,7 +7807,7 @@ void ModuleDefinition::GenerateCplusplus(const std::string & dir,
 
   // Start the header file
   {
-	  OutputFile hdrFile;
+	  OutputFile hdrFile(&outputs);
 	  if (!hdrFile.Open(path, "", ".h"))
 		  return;
 
@@ -5720,7 +7826,7 @@ void ModuleDefinition::GenerateCplusplus(const std::string & dir,
 	  else
 		  classesPerFile = types.size();
 	  
-	  OutputFile cxxFile;
+	  OutputFile cxxFile(&outputs);
 
 	  if (!cxxFile.Open(path, numFiles > 1 ? "_1" : "" , ".cxx"))
 		  return;
@@ -5827,15 +7933,24 @@ void ModuleDefinition::GenerateCplusplus(const std::string & dir,
 	  
 	  // Generate Information Objects & Information ObjectSets
 	  GenerateClassModule(hdrFile, cxxFile, inl);
-	  
-	  
+
+	  // The descriptors of the types, for tools which walk the values from tables
+	  hdrFile << "extern const ASN1::TypeDescriptor* const " << descriptorTable << "[];\n\n";
+	  cxxFile << "const ASN1::TypeDescriptor* const " << descriptorTable << "[] = {\n";
+	  for (i = 0; i < types.size(); ++i)
+		  if (describedTypes.count(types[i].get()))
+			  cxxFile << "    &" << types[i]->GetClassNameString() << "::theDescriptor,\n";
+	  cxxFile << "    NULL\n"
+		  "};\n\n";
+
+
 	  //if (useNamespaces)
 	  cxxFile << "} // namespace " << cModuleName << "\n";
 	  
 	  inl << std::ends;
 	  if (strlen(inl.str()))
 	  {
-		  OutputFile inlFile;
+		  OutputFile inlFile(&outputs);
 		  if (!inlFile.Open(path, "", ".inl"))
 			  return;
 		  
@@ -5857,7 +7972,109 @@ void ModuleDefinition::GenerateCplusplus(const std::string & dir,
 	  if (verbose)
 		  std::cout << "Completed " << cxxFile.GetFilePath() << std::endl;
 	}
-	
+
+  if (generateLite)
+	  OutputLite(path, outputs);
+
+  if (makeDependencies)
+	  WriteDependencies(path, outputs);
+}
+
+
+void ModuleDefinition::OutputLite(const std::string & path, StringList& outputs)
+{
+  size_t i;
+  std::strstream hdr, cxx;
+  for (i = 0; i < types.size(); ++i)
+	  if (!types[i]->HasParameters())
+		  types[i]->GenerateLite(hdr, cxx);
+
+  OutputFile hdrFile(&outputs);
+  if (!hdrFile.Open(path, "_lite", ".h"))
+	  return;
+
+  hdrFile << "#ifndef __" << ToUpper(GetFileName()) << "_LITE_H\n"
+	  "#define __" << ToUpper(GetFileName()) << "_LITE_H\n"
+	  "\n"
+	  "#include <bitset>\n"
+	  "#include \"" << ::GetFileName(path) << ".h\"\n";
+  for (i = 0; i < imports.size(); ++i)
+	  hdrFile << "#include \"" << imports[i]->GetFileName() << "_lite.h\"\n";
+  for (i = 0; i < subModules.size(); ++i)
+	  hdrFile << "#include \"" << subModules[i]->GetFileName() << "_lite.h\"\n";
+
+  hdr << std::ends;
+  hdrFile << "\n"
+	  "namespace " << cModuleName << " {\n"
+	  "namespace lite {\n"
+	  "\n"
+	  << hdr.str()
+	  << "} // namespace lite\n"
+	  "} // namespace " << cModuleName << "\n"
+	  "\n"
+	  "#endif // __" << ToUpper(GetFileName()) << "_LITE_H\n"
+	  "\n";
+
+  OutputFile cxxFile(&outputs);
+  if (!cxxFile.Open(path, "_lite", ".cxx"))
+	  return;
+
+  cxx << std::ends;
+  cxxFile << "#ifdef HAVE_CONFIG_H \n"
+	  "#include <config.h>\n"
+	  "#endif\n\n"
+	  "#include \"" << ::GetFileName(path) << "_lite.h\"\n"
+	  "\n"
+	  "namespace " << cModuleName << " {\n"
+	  "namespace lite {\n"
+	  "\n"
+	  "using ASN1::lite::to_lite;\n"
+	  "using ASN1::lite::from_lite;\n"
+	  "\n"
+	  << cxx.str()
+	  << "} // namespace lite\n"
+	  "} // namespace " << cModuleName << "\n";
+}
+
+
+void ModuleDefinition::CollectSourceFiles(StringList& files, std::set<const ModuleDefinition*>& visited) const
+{
+  if (!visited.insert(this).second)
+	  return;
+
+  if (std::find(files.begin(), files.end(), sourceFile) == files.end())
+	  files.push_back(sourceFile);
+
+  for (size_t i = 0; i < imports.size(); ++i) {
+	  const ModuleDefinition* module = FindModule(imports[i]->GetName().c_str());
+	  if (module)
+		  module->CollectSourceFiles(files, visited);
+  }
+}
+
+
+void ModuleDefinition::WriteDependencies(const std::string & path, const StringList& outputs) const
+{
+  // The generated files depend on the ASN.1 file of this module and on
+  // those of every module it imports from, directly or not.
+  StringList sources;
+  std::set<const ModuleDefinition*> visited;
+  CollectSourceFiles(sources, visited);
+
+  std::ostringstream deps;
+  size_t i;
+  for (i = 0; i < outputs.size(); ++i)
+	  deps << outputs[i] << (i+1 < outputs.size() ? " " : " :");
+  for (i = 0; i < sources.size(); ++i)
+	  deps << " \\\n  " << sources[i];
+  deps << "\n";
+
+  // empty rules, so that make does not fail when an ASN.1 file goes away
+  for (i = 0; i < sources.size(); ++i)
+	  deps << "\n" << sources[i] << " :\n";
+
+  if (!WriteIfChanged(path + ".d", deps.str()))
+    fatals++;
 }
 
 
@@ -5914,6 +8131,7 @@ void ModuleDefinition::GenerateClassModule(std::ostream& hdrFile, std::ostream&
 			  needComma = true;
 		  }
 	  hdrFile << ");\n";
+	  hdrFile << "    static unsigned id();\n";
 
 	  hdrFile << tmphdr.str();
 
@@ -5958,6 +8176,7 @@ void ModuleDefinition::GenerateClassModule(std::ostream& hdrFile, std::ostream&
 		  }
 
       cxxFile << "  moduleName = \"" << moduleName << "\";\n";  
+      cxxFile << "  moduleSlot = id();\n";  
 
 	  for (i = 0 ; i < informationObjects.size(); ++i)
 	  {
@@ -5971,6 +8190,12 @@ void ModuleDefinition::GenerateClassModule(std::ostream& hdrFile, std::ostream&
 		  std::bind(&InformationObjectSet::GenerateInstanceCode, _1, std::ref(cxxFile)));
 
 	  cxxFile << "}\n\n";
+
+	  cxxFile << "unsigned Module::id()\n"
+		         "{\n"
+		         "  static const unsigned slot = ASN1::Module::allocateSlot();\n"
+		         "  return slot;\n"
+		         "}\n\n";
   }
 }
 
@@ -6057,6 +8282,7 @@ std::string ModuleDefinition::CreateSubModules(SymbolList& exportedSymbols)
     typedef std::list<std::string> StringList;
     StringList unhandledSymbols;
     ModuleDefinitionPtr subModule(new ModuleDefinition(moduleName, defaultTagMode));
+    subModule->sourceFile = sourceFile;
 
 	TypesVector& exportedTypes = subModule->types;
 
@@ -6202,6 +8428,134 @@ void ModuleDefinition::AddToRemoveList(const std::string& reference)
     removeList.push_back(reference);
 }
 
+bool ModuleDefinition::MarkReachable(const std::string& name)
+{
+    TypePtr type = FindType(name);
+    if (type.get())
+        MarkReachable(*type);
+    else if (const InformationObjectSet* objectSet = FindInformationObjectSet(name))
+        MarkReachable(*objectSet);
+    else if (const InformationObject* object = FindInformationObject(name))
+        MarkReachable(*object);
+    else
+        return false;
+    return true;
+}
+
+void ModuleDefinition::MarkReachable(const TypeBase& type)
+{
+    if (!reachableTypes.insert(&type).second)
+        return;
+
+    if (const ImportedType* importedType = dynamic_cast<const ImportedType*>(&type))
+    {
+        ModuleDefinition* module = FindModule(importedType->GetModuleName().c_str());
+        if (module)
+            module->MarkReachable(type.GetName());
+        return;
+    }
+
+    // unresolved references are looked up in the current Module
+    ModuleDefinition* current = Module;
+    Module = this;
+
+    StringList names;
+    if (type.CollectReferences(names))
+    {
+        for (size_t i = 0; i < names.size(); ++i)
+            MarkReachable(names[i]);
+    }
+    else
+    {
+        for (size_t i = 0; i < types.size(); ++i)
+            if (types[i].get() != &type && 
+                (type.UseType(*types[i]) || type.ReferencesType(*types[i])))
+                MarkReachable(*types[i]);
+    }
+
+    // the object sets that constrain the type, the same test CreateObjectSetTypes() makes
+    for (size_t i = 0; i < informationObjectSets.size(); ++i)
+        if (!reachableObjectSets.count(informationObjectSets[i].get()) &&
+            type.ReferencesType(ObjectSetType(informationObjectSets[i])))
+            MarkReachable(*informationObjectSets[i]);
+    Module = current;
+}
+
+void ModuleDefinition::MarkReachable(const InformationObject& object)
+{
+    if (!reachableObjects.insert(&object).second)
+        return;
+
+    ModuleDefinition* current = Module;
+    Module = this;
+    object.MarkReachable(*this);
+    Module = current;
+}
+
+void ModuleDefinition::MarkReachable(const InformationObjectSet& objectSet)
+{
+    if (!reachableObjectSets.insert(&objectSet).second)
+        return;
+
+    ModuleDefinition* current = Module;
+    Module = this;
+    objectSet.MarkReachable(*this);
+    Module = current;
+}
+
+void ModuleDefinition::MarkTypesUsedByClasses()
+{
+    // the classes are always generated, and so are the types of their fields
+    ModuleDefinition* current = Module;
+    Module = this;
+    for (size_t i = 0; i < objectClasses.size(); ++i)
+        objectClasses[i]->MarkReachable(*this);
+    Module = current;
+}
+
+void ModuleDefinition::RemoveUnreachableTypes(bool verbose)
+{
+    size_t i;
+    TypesVector reachable;
+    for (i = 0; i < types.size(); ++i)
+    {
+        TypePtr& type = types[i];
+        // imported types generate no code, only the #include of their module
+        if (reachableTypes.count(type.get()) || dynamic_cast<ImportedType*>(type.get()))
+            reachable.push_back(type);
+        else
+        {
+            if (typeMap[type->GetName()] == type)
+                typeMap.erase(type->GetName());
+            if (verbose)
+                std::cout << "Remove Type : " << type->GetName() << "\n";
+        }
+    }
+    types.swap(reachable);
+    reachableTypes.clear();
+
+    InformationObjectList reachableObjectList;
+    for (i = 0; i < informationObjects.size(); ++i)
+        if (reachableObjects.count(informationObjects[i].get()))
+            reachableObjectList.push_back(informationObjects[i]);
+        else if (verbose)
+            std::cout << "Remove Object : " << informationObjects[i]->GetName() << "\n";
+    informationObjects.swap(reachableObjectList);
+    reachableObjects.clear();
+
+    InformationObjectSetList reachableObjectSetList;
+    for (i = 0; i < informationObjectSets.size(); ++i)
+        if (reachableObjectSets.count(informationObjectSets[i].get()))
+            reachableObjectSetList.push_back(informationObjectSets[i]);
+        else if (verbose)
+            std::cout << "Remove Object Set : " << informationObjectSets[i]->GetName() << "\n";
+    informationObjectSets.swap(reachableObjectSetList);
+    reachableObjectSets.clear();
+
+    for (i = 0; i < imports.size(); ++i)
+        imports[i]->RemoveUnreachableObjects(*this);
+}
+
 void MoveTypes(TypesVector& sourceList, TypesVector& toBeExtractedList, TypesVector& targetList)
 {
     for (size_t i = 0; i < sourceList.size(); ++i)
@@ -6309,6 +8663,12 @@ void FieldSpec::PrintOn(std::ostream& strm) const
 		strm << " OPTIONAL";
 }
 
+void FieldSpec::MarkReachable(ModuleDefinition& module) const
+{
+	if (const TypeBase* type = GetFieldType())
+		module.MarkReachable(*type);
+}
+
 void FieldSpec::GenerateTypeField(const std::string& ,
 								   const std::string& ,
 								   const TypeBase* ,
@@ -6378,6 +8738,12 @@ void TypeFieldSpec::ResolveReference() const
 		type->ResolveReference();
 }
 
+void TypeFieldSpec::MarkReachable(ModuleDefinition& module) const
+{
+	if (type.get())
+		module.MarkReachable(*type);
+}
+
 void TypeFieldSpec::Generate_info_type_constructor(std::ostream& cxx) const
 {
 	if (!type.get())
@@ -7064,6 +9430,12 @@ void ObjectClassDefn::ResolveReference() const
 	std::for_each(fieldSpecs->begin(), fieldSpecs->end(), std::mem_fn(&FieldSpec::ResolveReference));
 }
 
+void ObjectClassDefn::MarkReachable(ModuleDefinition& module) const
+{
+	std::for_each(fieldSpecs->begin(), fieldSpecs->end(),
+		std::bind(&FieldSpec::MarkReachable, _1, std::ref(module)));
+}
+
 void ObjectClassDefn::ResolveKey()
 {
 	if (!keyType.get())
@@ -7097,6 +9469,14 @@ void ObjectClassDefn::GenerateCplusplus(std::ostream& hdr, std::ostream& cxx, st
 	}
 
 	ResolveKey();
+
+	// integer keys, or CHOICE keys with an INTEGER alternative such as the operation codes 
+	// of ROS, are looked up by direct indexing; the other ones by binary search
+	const char* keyClass = keyType->GetAncestorClass();
+	const TypeBase* keyAlternative = keyType->GetIntegerAlternative();
+	bool directIndex = keyAlternative || (keyClass && (strcmp(keyClass, "ASN1::INTEGER") == 0 ||
+		strcmp(keyClass, "ASN1::ENUMERATED") == 0));
+	const char* reindex = directIndex ? " index.rebuild(rep.begin(), rep.end(), &index_key);" : "";
  
 	hdr << "class " << GetName() << "\n"
 		<< "{\n"
@@ -7195,9 +9575,9 @@ void ObjectClassDefn::GenerateCplusplus(std::ostream& hdr, std::ostream& cxx, st
         << "    " << GetName() << "(){}\n"
            "    template <class InputIterator>\n"
            "            " << GetName() << "(InputIterator first, InputIterator last)\n"
-           "        : rep(first, last) {}\n"
+           "        : rep(first, last) {" << reindex << (directIndex ? " }\n" : "}\n") <<
            "    " << GetName() << "(const " << GetName() << "& other)\n"
-           "        : rep(other.rep) {}\n\n"
+           "        : rep(other.rep) {" << reindex << (directIndex ? " }\n\n" : "}\n\n") <<
            "        " << GetName() << "& operator = (const " << GetName() << "& other)\n"
            "    { " << GetName() << " tmp(other); swap(tmp);  return *this; }\n\n"
            "    // iterators\n"
@@ -7215,26 +9595,77 @@ void ObjectClassDefn::GenerateCplusplus(std::ostream& hdr, std::ostream& cxx, st
            "    // modifiers\n"
            "    std::pair<iterator, bool> insert(const value_type& x)\n"
            "    { \n"
-           "        std::pair<map_type::iterator, bool> r = rep.insert(x); \n"
-           "        return std::pair<iterator, bool>(r.first, r.second);\n"
-           "    }\n"
-           "    iterator insert(iterator position, const value_type& x)\n"
-           "    { return iterator(rep.insert(position.base(), x)); }\n"
-           "    void insert(const_iterator first, const_iterator last)\n"
-           "    { rep.insert(first.base(), last.base()); }\n"
-           "    void erase(iterator position) { rep.erase(position.base()); }\n"
-           "    void erase(const key_type& key) { rep.erase(key); }\n"
-           "    void erase(iterator first, iterator last) { rep.erase(first.base(), last.base()); }\n"
-           "    void swap(" << GetName() << "& other) { rep.swap(other.rep); }\n"
-           "    void clear() { rep.clear(); }\n"
+           "        std::pair<map_type::iterator, bool> r = rep.insert(x); \n";
+	if (directIndex)
+		hdr << "        if (r.second)\n"
+		       "            index.inserted(rep.begin(), rep.end(), &index_key, r.first);\n";
+	hdr << "        return std::pair<iterator, bool>(r.first, r.second);\n"
+           "    }\n";
+	if (directIndex)
+		hdr << "    iterator insert(iterator position, const value_type& x)\n"
+		       "    { return insert(x).first; }\n";
+	else
+		hdr << "    iterator insert(iterator position, const value_type& x)\n"
+		       "    { return iterator(rep.insert(position.base(), x)); }\n";
+	hdr << "    void insert(const_iterator first, const_iterator last)\n"
+           "    { rep.insert(first.base(), last.base());" << reindex << " }\n";
+	if (directIndex)
+		hdr << "    void erase(iterator position)\n"
+		       "    { index.erasing(rep.begin(), &index_key, position.base()); rep.erase(position.base()); }\n"
+		       "    void erase(const key_type& key)\n"
+		       "    { map_type::iterator i = rep.find(key); if (i != rep.end()) erase(iterator(i)); }\n";
+	else
+		hdr << "    void erase(iterator position) { rep.erase(position.base()); }\n"
+		       "    void erase(const key_type& key) { rep.erase(key); }\n";
+	hdr << "    void erase(iterator first, iterator last) { rep.erase(first.base(), last.base());" << reindex << " }\n"
+           "    void swap(" << GetName() << "& other) { rep.swap(other.rep);" 
+		   << (directIndex ? " index.swap(other.index); " : " ") << "}\n"
+           "    void clear() { rep.clear();" << reindex << " }\n"
            "    key_compare key_comp() const { return rep.key_comp(); }\n"
-           "    // operations\n"
-           "    iterator find(const key_type& key) { return iterator(rep.find(key)); }\n"
-           "    const_iterator find(const key_type& key) const { return const_iterator(rep.find(key)); }\n"
-           "    size_type count(const key_type& key) const { return rep.count(key); }\n"
-           "  private:\n"
-           "    map_type rep;\n"
-           "};\n";
+           "    // operations\n";
+	if (directIndex)
+		hdr << "    iterator find(const key_type& key)\n"
+		       "    {\n"
+		       "        unsigned pos; int value;\n"
+		       "        if (index_key(key, value) && index.lookup(value, pos))\n"
+		       "            return iterator(pos == index.npos ? rep.end() : rep.begin() + pos);\n"
+		       "        return iterator(rep.find(key));\n"
+		       "    }\n"
+		       "    const_iterator find(const key_type& key) const\n"
+		       "    {\n"
+		       "        unsigned pos; int value;\n"
+		       "        if (index_key(key, value) && index.lookup(value, pos))\n"
+		       "            return const_iterator(pos == index.npos ? rep.end() : rep.begin() + pos);\n"
+		       "        return const_iterator(rep.find(key));\n"
+		       "    }\n"
+		       "    size_type count(const key_type& key) const\n"
+		       "    {\n"
+		       "        unsigned pos; int value;\n"
+		       "        if (index_key(key, value) && index.lookup(value, pos))\n"
+		       "            return pos != index.npos;\n"
+		       "        return rep.count(key);\n"
+		       "    }\n";
+	else
+		hdr << "    iterator find(const key_type& key) { return iterator(rep.find(key)); }\n"
+		       "    const_iterator find(const key_type& key) const { return const_iterator(rep.find(key)); }\n"
+		       "    size_type count(const key_type& key) const { return rep.count(key); }\n";
+	hdr << "  private:\n";
+	if (keyAlternative)
+		hdr << "    static bool index_key(const key_type& key, int& value)\n"
+		       "    {\n"
+		       "        if (key.currentSelection() != key_type::" << keyAlternative->GetIdentifier() << "::id_)\n"
+		       "            return false;\n"
+		       "        value = ASN1::detail::key_value(static_cast<const key_type::" 
+		                      << keyAlternative->GetIdentifier() << "::value_type&>(*key.getSelection()));\n"
+		       "        return true;\n"
+		       "    }\n";
+	else if (directIndex)
+		hdr << "    static bool index_key(const key_type& key, int& value)\n"
+		       "    { value = ASN1::detail::key_value(key); return true; }\n";
+	hdr << "    map_type rep;\n";
+	if (directIndex)
+		hdr << "    ASN1::detail::DenseIndex index;\n";
+	hdr << "};\n";
     hdr << std::setprecision(0);
 }
 
@@ -7566,6 +9997,11 @@ void FieldSetting::GenerateInstanceCode(const std::string& prefix, std::ostream&
 	setting->GenerateInstanceCode(prefix + identifier + ".", cxx);
 }
 
+void FieldSetting::MarkReachable(ModuleDefinition& module) const
+{
+	setting->MarkReachable(module);
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 
 InformationObject::~InformationObject()
@@ -7655,6 +10091,21 @@ void DefinedObject::GenerateInstanceCode(std::ostream& cxx) const
 	else
 		reference->GenerateInstanceCode(cxx);
 }
+
+void DefinedObject::MarkReachable(ModuleDefinition& module) const
+{
+	// the name of an object parameter finds no object of the module
+	if (const InformationObject* object = reference ? reference : module.FindInformationObject(referenceName))
+		module.MarkReachable(*object);
+}
+
+bool DefinedObject::ResolveReferences() const
+{
+	// the name of an object parameter finds no object of the module
+	if (reference == NULL)
+		reference = Module->FindInformationObject(referenceName);
+	return reference != NULL;
+}
 /////////////////////////////////////////////////////////////////////////////////
 
 void ImportedObject::GenerateInstanceCode(std::ostream& cxx) const
@@ -7662,6 +10113,27 @@ void ImportedObject::GenerateInstanceCode(std::ostream& cxx) const
 	cxx << ToLower(MakeIdentifierC(moduleName)) << "->get_" << MakeIdentifierC(referenceName) << "().make()";
 }
 
+void ImportedObject::MarkReachable(ModuleDefinition& ) const
+{
+	ModuleDefinition* module = FindModule(moduleName.c_str());
+	if (module && reference)
+		module->MarkReachable(*reference);
+}
+
+bool ImportedObject::ResolveReferences() const
+{
+	// the names the object uses are those of the module it is defined in
+	ModuleDefinition* module = FindModule(moduleName.c_str());
+	if (module && reference)
+	{
+		ModuleDefinition* current = Module;
+		Module = module;
+		reference->ResolveReferences();
+		Module = current;
+	}
+	return reference != NULL;
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 
 bool DefaultObjectDefn::SetObjectClass(const ObjectClassBase* definedClass)
@@ -7798,6 +10270,18 @@ void DefaultObjectDefn::GenerateInstanceCode(std::ostream& cxx) const
 								  _1, nam, std::ref(cxx)) );
 
 }
+
+void DefaultObjectDefn::MarkReachable(ModuleDefinition& module) const
+{
+   std::for_each(settings->begin(), settings->end(), 
+	                std::bind(&FieldSetting::MarkReachable, _1, std::ref(module)) );
+}
+
+bool DefaultObjectDefn::ResolveReferences() const
+{
+   std::for_each(settings->begin(), settings->end(), std::mem_fn(&FieldSetting::ResolveReferences));
+   return true;
+}
 /////////////////////////////////////////////////////////////////////////////////
 
 ObjectFromObject::ObjectFromObject(InformationObjectPtr referenceObj, 
@@ -7838,6 +10322,11 @@ void ObjectFromObject::GenerateInstanceCode(std::ostream& ) const
 	// not implemented
 }
 
+void ObjectFromObject::MarkReachable(ModuleDefinition& module) const
+{
+	module.MarkReachable(*refObj);
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 
 
@@ -7867,6 +10356,11 @@ void TypeSetting::PrintOn(std::ostream & strm) const
 	strm << *type; 
 }
 
+void TypeSetting::MarkReachable(ModuleDefinition& module) const
+{
+	module.MarkReachable(*type);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -7901,6 +10395,20 @@ void ValueSetting::PrintOn(std::ostream & strm) const
     strm << *value;
 }
 
+void ValueSetting::MarkReachable(ModuleDefinition& module) const
+{
+	if (type.get())
+		module.MarkReachable(*type);
+}
+
+void ValueSetting::ResolveReferences() const
+{
+	if (type.get())
+		type->ResolveReferences();
+	if (value.get())
+		value->ResolveReferences();
+}
+
 ////////////////////////////////////////////////////////
 
 ValueSetSetting::ValueSetSetting(ValueSetPtr set)
@@ -7934,6 +10442,16 @@ void ObjectSetting::PrintOn(std::ostream & strm) const
     strm << *object; 
 }
 
+void ObjectSetting::MarkReachable(ModuleDefinition& module) const
+{
+	module.MarkReachable(*object);
+}
+
+void ObjectSetting::ResolveReferences() const
+{
+	object->ResolveReferences();
+}
+
 void ObjectSetting::GenerateCplusplus(const std::string& , const std::string& , std::ostream& , std::ostream& , std::ostream& , unsigned& flag)
 {
 	flag |= has_object_setting;
@@ -7976,6 +10494,11 @@ void ObjectSetSetting::GenerateInstanceCode(const std::string& prefix, std::ostr
 	objectSet->GenerateObjectSetInstanceCode(prefix + "insert(", cxx);
 }
 
+void ObjectSetSetting::MarkReachable(ModuleDefinition& module) const
+{
+	objectSet->MarkReachable(module);
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 
 InformationObjectSetDefn::InformationObjectSetDefn(const std::string& nam,
@@ -8034,7 +10557,25 @@ void InformationObjectSetDefn::GenerateInstanceCode(std::ostream& cxx) const
 {
 	if (!HasParameters())
 	{
-		rep->GenerateObjectSetInstanceCode("  m_" + MakeIdentifierC(name)+".insert(",cxx);
+		size_t count = rep->GetObjectSetInstanceCount();
+		if (count == 0)
+			return;
+
+		// gather the objects first, so that the set is sorted and indexed only once
+		std::strstream objects;
+		rep->GenerateObjectSetInstanceCode("    objects.push_back(", objects);
+		objects << std::ends;
+		std::string code = objects.str();
+		objects.freeze(false);
+
+		std::string className = MakeIdentifierC(objectClass->GetName());
+		cxx << "  {\n"
+			   "    std::vector<" << className << "::value_type> objects;\n"
+			   "    objects.reserve(" << count << ");\n"
+			<< code
+			<< "    ASN1::detail::sort_unique_keys(objects);\n"
+			   "    " << className << "(objects.begin(), objects.end()).swap(m_" << MakeIdentifierC(name) << ");\n"
+			   "  }\n";
 	}
 }
 
@@ -8059,7 +10600,7 @@ void InformationObjectSetDefn::GenerateType(std::ostream& hdr, std::ostream& cxx
 		   "{\n"
 		   "  public:\n"
            "    typedef " << objClassName << " element_type;\n"
-		   "    " << typeName << "(ASN1::CoderEnv& env);\n";
+		   "    " << typeName << "(const ASN1::CoderEnv& env);\n";
 
 	cxx << "\n"
 		   "//\n"
@@ -8068,7 +10609,7 @@ void InformationObjectSetDefn::GenerateType(std::ostream& hdr, std::ostream& cxx
 
 	bool needDeleteObjSet = false;
 	cxx << templatePrefix
-		<< classNameString << "::" << typeName << "(ASN1::CoderEnv& env)\n"
+		<< classNameString << "::" << typeName << "(const ASN1::CoderEnv& env)\n"
 		<< "{\n";
 	needDeleteObjSet = GenerateTypeConstructor(cxx);
 	cxx	<< "}\n\n";
@@ -8106,7 +10647,7 @@ bool InformationObjectSetDefn::GenerateTypeConstructor(std::ostream& cxx) const
         return true;
     }
 
-    cxx << "  ASN1::Module* module = env.find(\"" << Module->GetName() << "\");\n"
+    cxx << "  ASN1::Module* module = env.find(" << Module->GetCModuleName() << "::Module::id());\n"
         << "  if (module)\n"
         << "	objSet =  &(static_cast<"<< Module->GetCModuleName() << "::Module*>(module)->get_"
             << MakeIdentifierC(GetName()) << "());\n";
@@ -8134,6 +10675,40 @@ const InformationObjectSet* DefinedObjectSet::GetReference() const
     return reference;
 }
 
+void DefinedObjectSet::MarkReachable(ModuleDefinition& module) const
+{
+	// the name of an object set parameter finds no object set of the module
+	if (const InformationObjectSet* objectSet = reference ? reference : module.FindInformationObjectSet(referenceName))
+		module.MarkReachable(*objectSet);
+}
+
+bool DefinedObjectSet::ResolveReferences() const
+{
+	// nor has a set with parameters objects of its own
+	if (reference == NULL)
+		reference = Module->FindInformationObjectSet(referenceName);
+	return reference != NULL && !reference->HasParameters();
+}
+
+void ImportedObjectSet::MarkReachable(ModuleDefinition& ) const
+{
+	ModuleDefinition* module = FindModule(moduleName.c_str());
+	if (module && reference)
+		module->MarkReachable(*reference);
+}
+
+void ImportedObjectSet::ResolveReferences() const
+{
+	ModuleDefinition* module = FindModule(moduleName.c_str());
+	if (module && reference)
+	{
+		ModuleDefinition* current = Module;
+		Module = module;
+		reference->ResolveReferences();
+		Module = current;
+	}
+}
+
 
 const ObjectClassBase* DefinedObjectSet::GetObjectClass() const
 {
@@ -8258,6 +10833,14 @@ Constraint* ObjectSetFromObject::GetRepresentation() const
     return rep.get();
 }
 
+bool ObjectSetFromObject::ResolveReferences() const
+{
+    if (!refObj->ResolveReferences())
+        return false;
+    GetRepresentation();
+    return true;
+}
+
 bool ObjectSetFromObject::HasPERInvisibleConstraint(const Parameter& ) const
 {
     return false;
@@ -8323,6 +10906,14 @@ ConstraintPtr ObjectSetFromObjects::GetRepresentation() const
     return rep;
 }
 
+bool ObjectSetFromObjects::ResolveReferences() const
+{
+    if (!refObjSet->ResolveReferences())
+        return false;
+    GetRepresentation();
+    return true;
+}
+
 bool ObjectSetFromObjects::HasPERInvisibleConstraint(const Parameter& ) const
 {
     return false;
@@ -8472,6 +11063,11 @@ void SingleObjectConstraintElement::GenerateObjectSetInstanceCode(const std::str
 	cxx << ");\n";
 }
 
+void SingleObjectConstraintElement::MarkReachable(ModuleDefinition& module) const
+{
+	module.MarkReachable(*object);
+}
+
 /////////////////////////////////////////////////////////////////////////
 
 ValueSetDefn::ValueSetDefn()
@@ -39,6 +39,7 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <set>
 #include <functional>
 #include <stack>
 #include <string>
@@ -184,12 +185,30 @@ class Tag : public Printable
     static const char * modeNames[];
 };
 
+/**
+ * The smallest and the largest size of the encodings of the values of a type, in
+ * bits for PER and in octets for BER. The largest is UnboundedSize when there is
+ * none, or when it cannot be told.
+ */
+const unsigned long UnboundedSize = ~0UL;
+
+struct SizeRange
+{
+	SizeRange(unsigned long lo = 0, unsigned long hi = UnboundedSize) : min(lo), max(hi) {}
+	SizeRange& operator += (const SizeRange& next);  // followed by next
+	SizeRange& operator |= (const SizeRange& other); // either this or other
+
+	unsigned long min;
+	unsigned long max;
+};
+
 class ValueSet;
 class Constraint;
 class Parameter;
 class SizeConstraintElement;
 class FromConstraintElement;
 class SubTypeConstraintElement;
+class ModuleDefinition;
 
 typedef std::shared_ptr<ValueSet> ValueSetPtr;
 typedef std::shared_ptr<Constraint> ConstraintPtr;
@@ -213,7 +232,14 @@ class ConstraintElementBase : public Printable
 
 	virtual bool HasPERInvisibleConstraint(const Parameter&) const { return false;}
     virtual void GenerateObjectSetInstanceCode(const std::string& , std::ostream& ) const{}
+    // the number of objects GenerateObjectSetInstanceCode writes
+    virtual size_t GetObjectSetInstanceCount() const { return 0; }
     virtual void GenerateObjSetAccessCode(std::ostream& ){}
+    // marks the objects and object sets this element of an object set names, for -r
+    virtual void MarkReachable(ModuleDefinition& ) const {}
+    // looks up what the element names before the files are written; false when a
+    // name is left unresolved, as the name of a parameter is
+    virtual bool ResolveReferences() const { return true; }
 	virtual bool GetCharacterSet(std::string& characterSet) const;
 	virtual const SizeConstraintElement* GetSizeConstraint() const;
 	virtual const FromConstraintElement* GetFromConstraint() const;
@@ -266,7 +292,10 @@ class Constraint : public Printable
 	virtual std::unique_ptr<Constraint> Clone() const;
 	bool HasPERInvisibleConstraint(const Parameter&) const;
     void GenerateObjectSetInstanceCode(const std::string& prefix, std::ostream& cxx) const;
+    size_t GetObjectSetInstanceCount() const;
     void GenerateObjSetAccessCode(std::ostream& );
+    void MarkReachable(ModuleDefinition& module) const;
+    void ResolveReferences() const;
 
   protected:
     ConstraintElementVector standard;
@@ -304,7 +333,10 @@ class ElementListConstraintElement : public ConstraintElementBase
 	virtual ConstraintPtr GetObjectSetFromObjectSetField(const std::string& field) const;
 	virtual bool HasPERInvisibleConstraint(const Parameter&) const;
     virtual void GenerateObjectSetInstanceCode(const std::string& prefix, std::ostream& cxx) const;
+    virtual size_t GetObjectSetInstanceCount() const;
     virtual void GenerateObjSetAccessCode(std::ostream& );
+    virtual void MarkReachable(ModuleDefinition& module) const;
+    virtual bool ResolveReferences() const;
 
 	virtual const SizeConstraintElement* GetSizeConstraint() const;
 	virtual const FromConstraintElement* GetFromConstraint() const;
@@ -334,6 +366,7 @@ class SingleValueConstraintElement : public ConstraintElementBase
 	const ValuePtr& GetValue() const { return value; }
 	virtual bool HasPERInvisibleConstraint(const Parameter&) const;
 	virtual bool GetCharacterSet(std::string& characterSet) const;
+	virtual bool ResolveReferences() const;
 
   protected:
     const ValuePtr value;
@@ -354,6 +387,7 @@ class ValueRangeConstraintElement : public ConstraintElementBase
     virtual void GenerateCplusplus(const std::string & fn, std::ostream & hdr, std::ostream & cxx, std::ostream & inl) const;
 	virtual bool HasPERInvisibleConstraint(const Parameter&) const;
     virtual bool GetCharacterSet(std::string& characterSet) const;
+	virtual bool ResolveReferences() const;
   protected:
     ValuePtr lower;
     ValuePtr upper;
@@ -375,6 +409,7 @@ class SubTypeConstraintElement : public ConstraintElementBase
     virtual const SubTypeConstraintElement* GetSubTypeConstraint() const;
     std::string GetSubTypeName() const;
     const TypePtr GetSubType() const { return subtype;}
+	virtual bool ResolveReferences() const;
   protected:
     TypePtr subtype;
 };
@@ -388,6 +423,7 @@ class NestedConstraintConstraintElement : public ConstraintElementBase
 
     virtual bool ReferencesType(const TypeBase & type) const;
 	virtual bool HasPERInvisibleConstraint(const Parameter&) const;
+	virtual bool ResolveReferences() const;
 
   protected:
     ConstraintPtr constraint;
@@ -596,6 +632,7 @@ class TypeBase : public Printable
     virtual bool IsParameterizedType() const;
     virtual bool IsPrimitiveType() const;
 	virtual bool IsSequenceOfType() const { return false;}
+	virtual const TypeBase* GetIntegerAlternative() const;
     virtual void GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
     virtual void GenerateForwardDecls(std::ostream & hdr);
     virtual void GenerateOperators(std::ostream & hdr, std::ostream & cxx, const TypeBase & actualType);
@@ -603,12 +640,44 @@ class TypeBase : public Printable
     virtual std::string GetTypeName() const;
     virtual bool CanReferenceType() const;
     virtual bool ReferencesType(const TypeBase & type) const;
+    /**
+     * Appends the names of the types which ReferencesType() may find this type to reference.
+     * Returns false when they cannot be told, so that every type has to be checked.
+     */
+    virtual bool CollectReferences(StringList & names) const;
 	virtual const std::string& GetCModuleName() const;
     virtual bool IsParameterisedImport() const;
 	virtual bool CanBeFwdDeclared(bool isComponent = false) const;
 	virtual bool FwdDeclareMe(std::ostream & hdr);
     virtual void GenerateInfo(const TypeBase* type, std::ostream & hdr, std::ostream& cxx);
 
+    /**
+     * Returns the sizes of the aligned PER encodings of the values of this type, in bits,
+     * and of their BER encodings, identifier and length octets included. The constraints 
+     * are those of type, which is this type or one defined from it, as in GenerateInfo().
+     */
+    SizeRange GetPERBits(const TypeBase& type) const;
+    SizeRange GetBEROctets(const TypeBase& type) const;
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    void GenerateEncodedSize(std::ostream & hdr) const;
+
+    /**
+     * The lite bindings written by asnparser -l. GetLiteType() returns the C++ type of the
+     * lite values of this type, with the constraints of type as in GetPERBits(), or an
+     * empty string when the type has none, e.g. when it is recursive.
+     */
+    std::string GetLiteType(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    /**
+     * Writes the statements encoding the lite value \c value to the PERWriter \c out, or
+     * decoding it from the PERReader \c in, indented by cxx.precision(). They return false
+     * from the function they are in when that fails.
+     */
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
+    /** Writes the lite type of a type of the module, and its functions. */
+    virtual void GenerateLite(std::ostream& hdr, std::ostream& cxx);
+
     bool IsGenerated() const { return isGenerated; }
     virtual void BeginGenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
     void EndGenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
@@ -619,6 +688,8 @@ class TypeBase : public Printable
 	virtual void BeginParseThisTypeValue() const {}
 	virtual void EndParseThisTypeValue() const {}
 	virtual void ResolveReference() const {}
+	// resolves this type and the references of its components, before the files are written
+	virtual void ResolveReferences() const;
 
 	virtual std::string GetPrimitiveType() const;
 
@@ -631,7 +702,14 @@ class TypeBase : public Printable
 	TypePtr SeqOfFlattenThisType(const TypeBase & parent, TypePtr thisPtr);
 
 	const ParameterList& GetParameters() const { return parameters; }
-    virtual void GenerateDecoder(std::ostream&){}
+    /**
+     * Write the decoding of a table constrained open type, which is components[index] 
+     * of its SEQUENCE: to preDecoder, the case of preDecodeField() which looks up its 
+     * type before it is decoded, and to decoder, the redecode for when its key could 
+     * not be decoded first.
+     */
+    virtual void GenerateDecoder(const TypesVector& components, size_t index, 
+                                 std::ostream& preDecoder, std::ostream& decoder) {}
 
     enum RemoveReuslt
     {
@@ -682,12 +760,14 @@ class DefinedType : public TypeBase
     void PrintOn(std::ostream &) const;
 
     virtual bool IsChoice() const;
+	virtual const TypeBase* GetIntegerAlternative() const;
     virtual bool IsParameterizedType() const;
     virtual void GenerateOperators(std::ostream & hdr, std::ostream & cxx, const TypeBase & actualType);
     virtual const char * GetAncestorClass() const;
     virtual std::string GetTypeName() const;
     virtual bool CanReferenceType() const;
     virtual bool ReferencesType(const TypeBase & type) const;
+    virtual bool CollectReferences(StringList & names) const;
     virtual void GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
 	virtual bool CanBeFwdDeclared(bool isComponent = false) const ;
 
@@ -702,6 +782,10 @@ class DefinedType : public TypeBase
    	virtual std::string GetPrimitiveType() const;
 	virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
     virtual TypePtr FlattenThisType(TypePtr& self, const TypeBase & parent);
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
 
   protected:
     void ConstructFromType(TypePtr& refType, const std::string & name);
@@ -724,8 +808,10 @@ class ParameterizedType : public DefinedType
     virtual bool IsParameterizedType() const;
     virtual std::string GetTypeName() const;
     virtual bool ReferencesType(const TypeBase & type) const;
+    virtual bool CollectReferences(StringList & names) const;
 	virtual bool UseType(const TypeBase& type) const ;
     virtual RemoveReuslt CanRemoveType(const TypeBase&);
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
   protected:
     ActualParameterList arguments;
 };
@@ -745,7 +831,9 @@ class SelectionType : public TypeBase
     virtual const char * GetAncestorClass() const;
     virtual bool CanReferenceType() const;
     virtual bool ReferencesType(const TypeBase & type) const;
+    virtual bool CollectReferences(StringList & names) const;
 	virtual bool UseType(const TypeBase& type) const ;
+	virtual void ResolveReferences() const;
 
   protected:
     std::string selection;
@@ -761,6 +849,10 @@ class BooleanType : public TypeBase
     virtual const char * GetAncestorClass() const;
 	virtual std::string GetPrimitiveType() const { return "bool";}
 	virtual void GenerateConstructors(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
 };
 
 
@@ -778,11 +870,16 @@ class IntegerType : public TypeBase
 
     virtual bool CanReferenceType() const;
     virtual bool ReferencesType(const TypeBase & type) const;
+    virtual bool CollectReferences(StringList & names) const;
 
 	virtual void GenerateConstructors(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
     virtual bool NeedGenInfo() const;
     virtual void GenerateInfo(const TypeBase* type, std::ostream& , std::ostream&);
     virtual TypePtr FlattenThisType(TypePtr& self, const TypeBase & parent);
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
   protected:
     NamedNumberList allowedValues;
 };
@@ -802,7 +899,12 @@ class EnumeratedType : public TypeBase
 	virtual bool NeedGenInfo() const { return true;}
     bool IsPrimitiveType() const;
     virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
   protected:
+    int GetMaxEnumValue() const;
     NamedNumberList enumerations;
     size_t numEnums;
     bool extendable;
@@ -830,6 +932,10 @@ class BitStringType : public TypeBase
 	std::string GetTypeName() const;
 	virtual std::string GetPrimitiveType() const { return TypeBase::GetPrimitiveType();}
     virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
   protected:
 
     NamedNumberList allowedBits;
@@ -846,6 +952,10 @@ class OctetStringType : public TypeBase
 	virtual const char* GetConstrainedType() const;
 	virtual void GenerateConstructors(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
     virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
 };
 
 
@@ -856,6 +966,9 @@ class NullType : public TypeBase
     virtual const char * GetAncestorClass() const;
 	virtual void BeginParseThisTypeValue() const;
 	virtual void EndParseThisTypeValue() const;
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
 };
 
 
@@ -874,6 +987,8 @@ class SequenceType : public TypeBase
     virtual const char * GetAncestorClass() const;
     virtual bool CanReferenceType() const;
     virtual bool ReferencesType(const TypeBase & type) const;
+    virtual bool CollectReferences(StringList & names) const;
+	virtual void ResolveReferences() const;
 
 	void GenerateComponent(TypeBase& field, std::ostream & hdr, std::ostream & cxx, std::ostream & inl, int id);
 	virtual bool CanBeFwdDeclared(bool isComponent ) const ;
@@ -884,6 +999,11 @@ class SequenceType : public TypeBase
     virtual RemoveReuslt CanRemoveType(const TypeBase&) ;
     virtual bool RemoveThisType(const TypeBase&);
     virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
+    virtual void GenerateLite(std::ostream& hdr, std::ostream& cxx);
   protected:
     TypesVector fields;
     size_t numFields;
@@ -906,15 +1026,21 @@ class SequenceOfType : public TypeBase
     virtual const char * GetAncestorClass() const;
     virtual bool CanReferenceType() const;
     virtual bool ReferencesType(const TypeBase & type) const;
+    virtual bool CollectReferences(StringList & names) const;
 	virtual	std::string GetTypeName() const;
 	virtual bool FwdDeclareMe(std::ostream & hdr);
 	virtual bool IsSequenceOfType() const { return true;}
+	virtual void ResolveReferences() const;
 	virtual void RemovePERInvisibleConstraint(const ParameterPtr&);
 	virtual bool UseType(const TypeBase& type) const ;
 	virtual void GenerateConstructors(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
 	void SetNonTypedef(bool v) { nonTypedef = v;}
     virtual RemoveReuslt CanRemoveType(const TypeBase&) ;
     virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
  protected:
     TypePtr baseType;
 	bool nonTypedef;
@@ -948,10 +1074,15 @@ class ChoiceType : public SequenceType
     virtual void GenerateOperators(std::ostream & hdr, std::ostream & cxx, const TypeBase & actualType);
     virtual bool IsPrimitiveType() const;
     virtual bool IsChoice() const;
+	virtual const TypeBase* GetIntegerAlternative() const;
     virtual const char * GetAncestorClass() const;
 	void GenerateComponent(TypeBase& field, std::ostream & hdr, std::ostream & cxx, std::ostream& inl, int id);
     virtual RemoveReuslt CanRemoveType(const TypeBase&) ;
 	virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLite(std::ostream& hdr, std::ostream& cxx);
   private:
 	  std::vector<TypeBase*> sortedFields;
 };
@@ -995,7 +1126,14 @@ class StringTypeBase : public TypeBase
     virtual bool NeedGenInfo() const;
 	virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
 	virtual const char* GetCanonicalSetString() const { return NULL;};
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
   protected:
+	virtual unsigned GetCharSetAlignedBits(const TypeBase& type) const;
+	// the tail of the InfoType of type, which is also the PER character set it is written with
+	virtual std::string GetCharSet(const TypeBase& type, const char* separator) const;
 	const char* canonicalSet;
 	const char* canonicalSetRep;
 	int canonicalSetSize;
@@ -1011,6 +1149,12 @@ class BMPStringType : public StringTypeBase
     virtual void GenerateOperators(std::ostream & hdr, std::ostream & cxx, const TypeBase & actualType);
 	virtual void GenerateConstructors(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
 	virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
+  protected:
+	virtual unsigned GetCharSetAlignedBits(const TypeBase& type) const;
+	virtual std::string GetCharSet(const TypeBase& type, const char* separator) const;
 };
 
 
@@ -1144,6 +1288,8 @@ class ObjectIdentifierType : public TypeBase
 	virtual void BeginParseThisTypeValue() const;
 	virtual void EndParseThisTypeValue() const;
 	virtual void GenerateConstructors(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
 };
 
 
@@ -1160,11 +1306,13 @@ class ObjectClassFieldType : public TypeBase
     void PrintOn(std::ostream &) const;
     virtual bool CanReferenceType() const;
     virtual bool ReferencesType(const TypeBase & type) const;
+    virtual bool CollectReferences(StringList & names) const;
 	TypeBase* GetFieldType() ;
 	const TypeBase* GetFieldType() const ;
     virtual std::string GetTypeName() const;
 	void AddTableConstraint(std::shared_ptr<TableConstraint> constraint);
-    void GenerateDecoder(std::ostream&);
+    void GenerateDecoder(const TypesVector& components, size_t index, 
+                         std::ostream& preDecoder, std::ostream& decoder);
 	virtual void GenerateInfo(const TypeBase* type, std::ostream& hdr, std::ostream& cxx);
     std::string GetConstrainedTypeName() const;
   protected:
@@ -1191,6 +1339,11 @@ class ImportedType : public TypeBase
 	virtual const std::string& GetCModuleName() const { return cModuleName; }
     const std::string& GetModuleName() const { return moduleName; }
     bool IsPrimitiveType() const;
+    virtual SizeRange ComputePERBits(const TypeBase& type) const;
+    virtual SizeRange ComputeBERContents(const TypeBase& type) const;
+    virtual std::string ComputeLiteType(const TypeBase& type) const;
+    virtual void GenerateLiteCodec(const TypeBase& type, const std::string& value, bool encode, std::ostream& cxx) const;
+    virtual void GenerateLite(std::ostream& hdr, std::ostream& cxx);
   protected:
     std::string modulePrefix;
     bool    parameterised;
@@ -1237,6 +1390,8 @@ class ValueBase : public Printable
 
     virtual void GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl) const;
 	virtual bool IsPERInvisibleConstraint(const Parameter&) const { return false;}
+	// looks up the values the value names, before the files are written
+	virtual void ResolveReferences() const {}
 
   protected:
     void PrintBase(std::ostream &) const;
@@ -1256,6 +1411,7 @@ class DefinedValue : public ValueBase
     const std::string & GetReference() const { return referenceName; }
     virtual void GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl) const;
 	virtual bool IsPERInvisibleConstraint(const Parameter& param) const { return param.GetName() == referenceName;}
+	virtual void ResolveReferences() const;
   protected:
     std::string referenceName;
     mutable ValuePtr actualValue;
@@ -1399,6 +1555,7 @@ class SequenceValue : public ValueBase
   public:
     SequenceValue(ValuesList * list = NULL);
     void PrintOn(std::ostream &) const;
+    virtual void ResolveReferences() const;
   protected:
     ValuesList values;
 };
@@ -1410,6 +1567,7 @@ class ChoiceValue : public ValueBase
 	: type(typ), fieldname(fieldName), value(val) { }
     void PrintOn(std::ostream &) const;
     virtual void GenerateCplusplus(std::ostream & hdr, std::ostream & cxx, std::ostream & inl) const;
+    virtual void ResolveReferences() const { value->ResolveReferences(); }
   protected:
 	const TypePtr type;
 	std::string fieldname;
@@ -1532,6 +1690,8 @@ public:
 	// used only for FixedTypeValueField and FixedTypeValueSetField
 	virtual TypeBase* GetFieldType() { return NULL;}
 	virtual const TypeBase* GetFieldType() const { return NULL; }
+	// marks the type of the field as used, for -r
+	virtual void MarkReachable(ModuleDefinition& module) const;
 
 	// 
 
@@ -1567,6 +1727,7 @@ public:
 	virtual int GetToken() const;
     void PrintOn(std::ostream &) const;
 	virtual void ResolveReference() const;
+	virtual void MarkReachable(ModuleDefinition& module) const;
 	virtual void Generate_info_type_constructor(std::ostream&) const;
 	virtual void Generate_info_type_memfun(std::ostream& hdr) const;
 	virtual void Generate_info_type_mem(std::ostream& ) const;
@@ -1867,6 +2028,7 @@ public:
 	virtual void BeginParseObjectSet() const = 0;
 	virtual void EndParseObjectSet() const = 0;
 	virtual void ResolveReference() const =0;
+	virtual void MarkReachable(ModuleDefinition& ) const {}
 	virtual void GenerateCplusplus(std::ostream& , std::ostream& , std::ostream& ){}
 	virtual const std::string& GetKeyName() const =0;
 protected:
@@ -1897,6 +2059,7 @@ public:
 	virtual void EndParseObjectSet() const;
     void PrintOn(std::ostream &) const;
 	virtual void ResolveReference() const;
+	virtual void MarkReachable(ModuleDefinition& module) const;
 
 	void ResolveKey();
 	const std::string& GetKeyName() const { return keyName; }
@@ -1969,6 +2132,10 @@ public:
 	virtual void GenerateInitializationList(std::ostream& , std::ostream& , std::ostream& ){}
 	virtual bool IsExtendable() const { return false;}
 	virtual void GenerateInstanceCode(const std::string& , std::ostream& ) const{}
+	// marks the types, objects and object sets of the setting as used, for -r
+	virtual void MarkReachable(ModuleDefinition& ) const {}
+	// looks up the names the setting uses, before the files are written
+	virtual void ResolveReferences() const {}
 };
 
 class TypeSetting : public Setting
@@ -1982,6 +2149,8 @@ public:
     void PrintOn(std::ostream & strm) const;
 	virtual void GenerateCplusplus(const std::string& prefix, const std::string& name, std::ostream& hdr, std::ostream& cxx, std::ostream& inl, unsigned& flag);
 	virtual void GenerateInfo(const std::string& name,std::ostream& hdr);
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual void ResolveReferences() const { type->ResolveReferences(); }
 protected:
 	TypePtr type;
 };
@@ -2000,6 +2169,8 @@ public:
     void PrintOn(std::ostream & strm) const;
 	virtual void GenerateCplusplus(const std::string& prefix, const std::string& name, std::ostream& hdr, std::ostream& cxx, std::ostream& inl, unsigned& flag);
 	virtual void GenerateInitializationList(std::ostream& , std::ostream& , std::ostream& );
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual void ResolveReferences() const;
 protected:
 	TypePtr  type;
 	ValuePtr value;
@@ -2030,6 +2201,8 @@ public:
 	const InformationObject* GetObject() const { return object.get(); }
     void PrintOn(std::ostream & strm) const ;
 	virtual void GenerateCplusplus(const std::string& prefix, const std::string& name, std::ostream& hdr, std::ostream& cxx, std::ostream& inl, unsigned& flag);
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual void ResolveReferences() const;
 protected:
 	ObjectClassBase* objectClass;
 	InformationObjectPtr object;
@@ -2048,6 +2221,8 @@ public:
 	virtual void GenerateInfo(const std::string& name,std::ostream& hdr);
 	virtual bool IsExtendable() const { return objectSet->IsExtendable(); }
 	void GenerateInstanceCode(const std::string& prefix, std::ostream& cxx) const;
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual void ResolveReferences() const { objectSet->ResolveReferences(); }
 protected:
 	ObjectClassBase* objectClass;
 	ConstraintPtr objectSet;
@@ -2069,6 +2244,8 @@ public:
 	void GenerateInitializationList(std::ostream & hdr, std::ostream & cxx, std::ostream & inl);
 	void GenerateInfo(std::ostream& hdr); 
 	void GenerateInstanceCode(const std::string& prefix, std::ostream& cxx) const;
+	void MarkReachable(ModuleDefinition& module) const;
+	void ResolveReferences() const { setting->ResolveReferences(); }
 protected:
 	std::string name;
     std::string identifier;
@@ -2092,6 +2269,11 @@ public:
 	virtual void GenerateCplusplus(std::ostream&  , std::ostream & , std::ostream & ){}
 	virtual bool IsExtendable() const =0;
 	virtual void GenerateInstanceCode(std::ostream& cxx) const =0;
+	// marks what the object uses, for -r
+	virtual void MarkReachable(ModuleDefinition& ) const {}
+	// looks up the names the object uses before the files are written; false
+	// when the object is named by a parameter
+	virtual bool ResolveReferences() const { return true; }
 protected:
 	virtual bool VerifyObjectDefinition() = 0 ;
 	std::string name;
@@ -2112,6 +2294,8 @@ public:
 	virtual const Setting* GetSetting(const std::string& fieldname) const; 
 	virtual bool IsExtendable() const { return reference->IsExtendable(); }
 	virtual void GenerateInstanceCode(std::ostream& cxx) const;
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual bool ResolveReferences() const;
 protected:
 	std::string referenceName;
 	mutable const InformationObject* reference;
@@ -2124,6 +2308,8 @@ public:
 		: DefinedObject(name, ref), moduleName(modName) {}
 	const std::string& GetModuleName() const { return moduleName; }
 	virtual void GenerateInstanceCode(std::ostream& cxx) const;
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual bool ResolveReferences() const;
 private:
 	std::string moduleName;
 };
@@ -2143,6 +2329,8 @@ public:
 	virtual void GenerateCplusplus(std::ostream& hdr , std::ostream & cxx, std::ostream & inl);
 	virtual bool IsExtendable() const ;
 	virtual void GenerateInstanceCode(std::ostream& cxx) const;
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual bool ResolveReferences() const;
 protected:
 	std::unique_ptr<FieldSettingList> settings;
 	const ObjectClassBase* referenceClass;
@@ -2159,6 +2347,8 @@ public:
 	virtual const Setting* GetSetting(const std::string& fieldname) const; 
 	virtual bool IsExtendable() const { return refObj->IsExtendable(); }
 	virtual void GenerateInstanceCode(std::ostream& cxx) const;
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual bool ResolveReferences() const { return refObj->ResolveReferences(); }
 protected:
 	virtual bool VerifyObjectDefinition();
 	InformationObjectPtr refObj;
@@ -2218,6 +2408,10 @@ public:
 	virtual bool HasParameters() const =0;
 	virtual void GenerateInstanceCode(std::ostream& cxx) const =0;
 	virtual void GenerateType(std::ostream& hdr, std::ostream& inl,std::ostream& cxx) const=0;
+	// marks the objects of the set as used, for -r
+	virtual void MarkReachable(ModuleDefinition& module) const =0;
+	// looks up the names the set uses, before the files are written
+	virtual void ResolveReferences() const =0;
 };
 
 class InformationObjectSetDefn : public InformationObjectSet
@@ -2242,6 +2436,8 @@ public:
 	void PrintOn(std::ostream &) const;
 	virtual void GenerateType(std::ostream& hdr, std::ostream& inl,std::ostream& cxx) const;
 	bool GenerateTypeConstructor(std::ostream& cxx) const;
+	virtual void MarkReachable(ModuleDefinition& module) const { rep->MarkReachable(module); }
+	virtual void ResolveReferences() const { rep->ResolveReferences(); }
 protected:
 	std::string name;
 	ObjectClassBasePtr objectClass;
@@ -2265,6 +2461,8 @@ class ImportedObjectSet :  public InformationObjectSet
 	virtual bool HasParameters() const { return reference->HasParameters(); }
 	void GenerateInstanceCode(std::ostream& ) const{}
 	virtual void GenerateType(std::ostream& , std::ostream& ,std::ostream& ) const {}
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual void ResolveReferences() const;
 	void PrintOn(std::ostream &) const {}
   private:
     const InformationObjectSet* reference;
@@ -2296,6 +2494,8 @@ public:
 	virtual bool HasPERInvisibleConstraint(const Parameter& param) const;
 
 	virtual const InformationObjectSet* GetReference() const;
+	virtual void MarkReachable(ModuleDefinition& module) const;
+	virtual bool ResolveReferences() const;
 
 	void PrintOn(std::ostream &) const;
 protected:
@@ -2331,6 +2531,8 @@ public:
 	virtual ConstraintPtr GetObjectSetFromObjectSetField(const std::string& field) const;
 	virtual bool HasPERInvisibleConstraint(const Parameter& param) const;
 
+	virtual bool ResolveReferences() const;
+
 	void PrintOn(std::ostream &) const;
 protected:
 	Constraint* GetRepresentation() const;
@@ -2356,6 +2558,7 @@ public:
 	virtual bool HasPERInvisibleConstraint(const Parameter& param) const;
 	void PrintOn(std::ostream &) const;
     virtual void GenerateObjSetAccessCode(std::ostream& );
+	virtual bool ResolveReferences() const;
 protected:
 	ConstraintPtr GetRepresentation() const;
 	ObjectSetConstraintElementPtr refObjSet;
@@ -2375,6 +2578,9 @@ public:
 	virtual ConstraintPtr GetObjectSetFromObjectSetField(const std::string& field) const;
 	virtual bool HasPERInvisibleConstraint(const Parameter& param) const;
     virtual void GenerateObjectSetInstanceCode(const std::string& prefix, std::ostream& cxx) const;
+    virtual size_t GetObjectSetInstanceCount() const { return 1; }
+    virtual void MarkReachable(ModuleDefinition& module) const;
+    virtual bool ResolveReferences() const { return object->ResolveReferences(); }
 	void PrintOn(std::ostream &) const;
 protected:
 	InformationObjectPtr object;
@@ -2552,6 +2758,7 @@ class ImportModule : public Printable
 
     const std::string& GetName() const { return fullModuleName; }
 	bool HasValuesOrObjects() const;
+	void RemoveUnreachableObjects(ModuleDefinition& module);
 	std::string GetCModuleName() const;
 	const std::string& GetLowerCaseName() const { return filename; }
 
@@ -2620,6 +2827,22 @@ class ModuleDefinition : public Printable
                            //bool useNamespaces,
                            //bool useInlines,
                            bool verbose);
+    // GenerateCplusplus() in two halves: PrepareCplusplus() rewrites the
+    // types of this module and resolves their references, OutputCplusplus()
+    // only writes the files and may run concurrently for different modules
+    // once every module is prepared and CacheTypeInfo() has run for each.
+    void PrepareCplusplus(bool verbose);
+    // Work out the sizes and lite types of the types of the module, which the
+    // writing threads then share without changing them.
+    void CacheTypeInfo();
+    void OutputCplusplus(const std::string & modName,
+                         unsigned numFiles,
+                         bool verbose);
+    // Write path.d, a make rule making the outputs depend on the ASN.1 files
+    void WriteDependencies(const std::string & path, const StringList& outputs) const;
+    void CollectSourceFiles(StringList& files, std::set<const ModuleDefinition*>& visited) const;
+    // Write path_lite.h and path_lite.cxx, the lite bindings of the types
+    void OutputLite(const std::string & path, StringList& outputs);
 
 	void ResolveObjectClassReferences() const;
 
@@ -2634,7 +2857,18 @@ class ModuleDefinition : public Printable
 	
     void AddToRemoveList(const std::string& reference);
     void RemoveReferences(bool verbose);
+
+    // Dead type elimination from the roots given with -r: mark what
+    // the roots use, directly or through imports, then drop the rest.
+    bool MarkReachable(const std::string& name);
+    void MarkReachable(const TypeBase& type);
+    void MarkReachable(const InformationObject& object);
+    void MarkReachable(const InformationObjectSet& objectSet);
+    void MarkTypesUsedByClasses();
+    void RemoveUnreachableTypes(bool verbose);
     ImportModule* FindImportedModule(const std::string& theModuleName);
+    // the types given a TypeDescriptor, listed in the table of the module
+    void AddDescriptor(const TypeBase& type) { describedTypes.insert(&type); }
 
   private:
     ModuleDefinition& operator = (const ModuleDefinition&);
@@ -2663,6 +2897,13 @@ class ModuleDefinition : public Printable
 	std::string		         path;
 	ModuleList		         subModules;
 	std::vector<std::string>     removeList;
+	std::set<const TypeBase*>    reachableTypes;
+	std::set<const InformationObject*>    reachableObjects;
+	std::set<const InformationObjectSet*> reachableObjectSets;
+	std::set<const TypeBase*>    describedTypes;
+	std::string                  descriptorTable;
+	bool                     hasTemplates;
+	std::string              sourceFile;
 };
 
 template <class T>
@@ -2678,7 +2919,7 @@ std::shared_ptr<T> FindWithName(const std::vector<std::shared_ptr<T> >& cont, co
 
 }
 
-extern ModuleDefinition * Module;
+extern thread_local ModuleDefinition * Module;
 extern ModuleList Modules;
 
 typedef std::stack<ObjectClassBase*> ClassStack;